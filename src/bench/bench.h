@@ -0,0 +1,31 @@
+/*
+ * File: bench.h
+ *
+ * Small timing helpers shared by all benchmarks.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_BENCH_H
+#define CND_BENCH_H
+
+#include <time.h>
+#include <stdio.h>
+
+/*
+ * bench_now: Current monotonic time in seconds.
+ */
+static inline double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * bench_report: Print a throughput line for 'ops' operations done in 'secs' seconds.
+ */
+static inline void bench_report(char const* name, long ops, double secs) {
+    printf("%-40s %12ld ops %10.3f ms %12.2f Mops/s\n", name, ops, secs * 1e3, ops / secs * 1e-6);
+}
+
+#endif // CND_BENCH_H
@@ -0,0 +1,96 @@
+/*
+ * File: bench_animation.c
+ *
+ * Measures update_frame for rooms of 1k to 100k animated entities, with each entity's step
+ * handler sending a command to change its subimage every frame, against the animation stage
+ * of update_frame advancing them all without commands, one entity at a time and over the
+ * entity_soa arrays. The stage is also timed alone, as updating entities without handlers
+ * takes most of the rest of the frame.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+
+#define NUM_IMGS 8
+#define PERIOD 3
+#define NUM_FRAMES 50
+
+/*
+ * commanded_step: Step handler animating its entity the old way, by a command every frame.
+ * There is no command to set a subimage, so it sends one setting the sprite, which costs the same.
+ */
+static t_update_command_container commanded_step(t_game_data const* data, t_entity const* entity) {
+    t_update_command_container commands = make_update_command_container();
+    t_update_command *command = push_command(&commands, ALTER_ENTITY);
+    command->data.alter_ent.target_id = entity->id;
+    command->data.alter_ent.modified_attr = CURRENT_SPR;
+    command->data.alter_ent.int_value = entity->current_spr_id;
+    return commands;
+}
+
+static void run(int num_ents, int mode) {
+    char const* names[3] = { "commands", "stage", "stage soa" };
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    t_sprite *sprite = calloc(1, sizeof(t_sprite));
+    sprite->num_imgs = NUM_IMGS;
+    add_sprite(data, sprite);
+    t_room *room = calloc(1, sizeof(t_room));
+    room->entity_ids = malloc(sizeof(int) * num_ents);
+    t_entity *ents = calloc(num_ents, sizeof(t_entity));
+    for(int i = 0; i < num_ents; i++) {
+        ents[i].current_spr_id = sprite->spr_id;
+        ents[i].spr_current_img = rand() % NUM_IMGS;
+        // entities sending commands are static to the animation stage
+        ents[i].spr_period = (mode == 0) ? -1 : PERIOD;
+        if(mode == 0)
+            ents[i].event_handlers.step = commanded_step;
+        add_entity(data, &ents[i]);
+        room->entity_ids[room->num_entities++] = ents[i].id;
+    }
+    add_room(data, room);
+    data->current_room_id = room->room_id;
+    if(mode == 2)
+        enable_entity_soa(data);
+    threadpool *pool = make_threadpool(1);
+
+    update_frame(data, pool);   // warm up, so arenas and command pools have grown
+    double start = bench_now();
+    for(int f = 0; f < NUM_FRAMES; f++)
+        update_frame(data, pool);
+    double elapsed = bench_now() - start;
+    char name[64];
+    snprintf(name, sizeof(name), "%d ents %s (ents)", num_ents, names[mode]);
+    bench_report(name, (long) num_ents * NUM_FRAMES, elapsed);
+    printf("%40s %8.3f ms/frame, %d commands/frame\n", "", elapsed * 1e3 / NUM_FRAMES,
+           data->optimiser.frame_submitted);
+    if(mode > 0) {
+        // the stage alone, without updating entities that have no handlers
+        start = bench_now();
+        for(int f = 0; f < NUM_FRAMES; f++)
+            animate_sprites(data);
+        elapsed = bench_now() - start;
+        snprintf(name, sizeof(name), "%d ents %s only (ents)", num_ents, names[mode]);
+        bench_report(name, (long) num_ents * NUM_FRAMES, elapsed);
+    }
+
+    threadpool_free(pool);
+    free(ents);
+    free(room->entity_ids);
+    free(room);
+    free(sprite);
+    gamedata_free(data);
+}
+
+int main() {
+    srand(1);
+    int sizes[] = { 1000, 10000, 100000 };
+    for(int i = 0; i < 3; i++) {
+        for(int mode = 0; mode < 3; mode++)
+            run(sizes[i], mode);
+    }
+    return 0;
+}
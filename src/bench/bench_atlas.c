@@ -0,0 +1,111 @@
+/*
+ * File: bench_atlas.c
+ *
+ * Measures packing 200 animated sprites into a texture atlas, and its effect on draw calls
+ * per frame for 10k entities over 4 depths, with each subimage as its own texture against
+ * one texture per atlas page.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+
+#define NUM_SPRITES 200
+#define MAX_IMGS 8
+#define MIN_SPR_SIZE 8
+#define MAX_SPR_SIZE 64
+#define NUM_ENTS 10000
+#define NUM_DEPTHS 4
+#define SCR_WIDTH 640
+#define SCR_HEIGHT 480
+#define NUM_FRAMES 20
+
+static double time_frames(t_game_data *data, game_snapshot const* snapshot, render_queue *queue) {
+    render_frame(data, snapshot, queue);    // warm up, and upload the atlas
+    double start = bench_now();
+    for(int f = 0; f < NUM_FRAMES; f++)
+        render_frame(data, snapshot, queue);
+    return (bench_now() - start) / NUM_FRAMES;
+}
+
+int main() {
+    srand(1);
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    data->scr_width = SCR_WIDTH;
+    data->scr_height = SCR_HEIGHT;
+    t_sprite **sprites = malloc(sizeof(t_sprite *) * NUM_SPRITES);
+    uint32_t *pixels[MAX_IMGS];
+    for(int i = 0; i < MAX_IMGS; i++)
+        pixels[i] = malloc(sizeof(uint32_t) * MAX_SPR_SIZE * MAX_SPR_SIZE);
+    long num_imgs = 0;
+    GLuint next_texture = 1;
+    for(int i = 0; i < NUM_SPRITES; i++) {
+        int num_sprite_imgs = 1 + rand() % MAX_IMGS;
+        int width = MIN_SPR_SIZE + rand() % (MAX_SPR_SIZE - MIN_SPR_SIZE + 1);
+        int height = MIN_SPR_SIZE + rand() % (MAX_SPR_SIZE - MIN_SPR_SIZE + 1);
+        t_sprite *sprite = make_sprite(num_sprite_imgs, width, height, malloc(sizeof(GLuint) * num_sprite_imgs));
+        for(int j = 0; j < sprite->num_imgs; j++) {
+            sprite->texture[j] = next_texture++;
+            for(int k = 0; k < sprite->width * sprite->height; k++)
+                pixels[j][k] = (rand() % 4 == 0) ? 0 : 0xFF000000u | (uint32_t) rand();
+        }
+        sprite_set_pixels(sprite, (uint32_t const* const*) pixels);
+        add_sprite(data, sprite);
+        sprites[i] = sprite;
+        num_imgs += sprite->num_imgs;
+    }
+    t_room *room = calloc(1, sizeof(t_room));
+    room->entity_ids = malloc(sizeof(int) * NUM_ENTS);
+    t_entity *ents = calloc(NUM_ENTS, sizeof(t_entity));
+    for(int i = 0; i < NUM_ENTS; i++) {
+        t_sprite *sprite = sprites[rand() % NUM_SPRITES];
+        ents[i].current_spr_id = sprite->spr_id;
+        ents[i].spr_current_img = rand() % sprite->num_imgs;
+        ents[i].x = rand() % SCR_WIDTH;
+        ents[i].y = rand() % SCR_HEIGHT;
+        ents[i].depth = rand() % NUM_DEPTHS;
+        add_entity(data, &ents[i]);
+        room->entity_ids[room->num_entities++] = ents[i].id;
+    }
+    add_room(data, room);
+    data->current_room_id = room->room_id;
+    software_renderer *renderer = make_software_renderer(0);
+    set_renderer(data, &renderer->backend);
+    publish_game_snapshot(data);
+    game_snapshot const* snapshot = snapshot_acquire(&data->snapshots);
+    render_queue queue = make_render_queue(NUM_ENTS);
+
+    double unpacked_secs = time_frames(data, snapshot, &queue);
+    int unpacked_batches = render_queue_num_batches(&queue);
+
+    double start = bench_now();
+    build_sprite_atlas(data, 1024);
+    bench_report("pack 200 sprites (subimages)", num_imgs, bench_now() - start);
+    printf("%40s %d pages of %d, %.1f%% efficient\n", "", data->atlas->num_pages,
+           data->atlas->page_size, 100.0 * atlas_efficiency(data->atlas));
+
+    double packed_secs = time_frames(data, snapshot, &queue);
+    int packed_batches = render_queue_num_batches(&queue);
+    char name[64];
+    snprintf(name, sizeof(name), "%d ents own textures (images)", NUM_ENTS);
+    bench_report(name, queue.num_images, unpacked_secs);
+    printf("%40s %8.3f ms/frame, %d draw calls/frame\n", "", unpacked_secs * 1e3, unpacked_batches);
+    snprintf(name, sizeof(name), "%d ents atlas (images)", NUM_ENTS);
+    bench_report(name, queue.num_images, packed_secs);
+    printf("%40s %8.3f ms/frame, %d draw calls/frame\n", "", packed_secs * 1e3, packed_batches);
+
+    render_queue_free(&queue);
+    free(ents);
+    free(room->entity_ids);
+    free(room);
+    gamedata_free(data);
+    for(int i = 0; i < NUM_SPRITES; i++)
+        free_sprite(sprites[i]);
+    free(sprites);
+    for(int i = 0; i < MAX_IMGS; i++)
+        free(pixels[i]);
+    return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * File: bench_cmdbuffer.c
+ *
+ * Compares pushing and walking commands in segment containers against the
+ * GSList containers they replaced, which allocated one full size command
+ * (with a model t_entity and t_room inside) and one list node per command.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <glib.h>
+
+#define NUM_COMMANDS 200000
+#define NUM_FRAMES 20
+
+/*
+ * old_update_command: Layout of commands before segment containers.
+ */
+struct old_update_command {
+    enum command_type type;
+    union {
+        struct { int target_id; t_entity model_ent; enum alter_entity_attr modified_attr; } alter_ent;
+        struct { int target_id; t_room model_room; enum alter_room_attr modified_attr; } alter_room;
+    } data;
+};
+
+struct old_container {
+    int num_commands;
+    GSList *commands;
+    GSList *commands_end;
+};
+
+static void old_push(struct old_container *container, int target, int x) {
+    struct old_update_command *command = malloc(sizeof(struct old_update_command));
+    command->type = ALTER_ENTITY;
+    command->data.alter_ent.target_id = target;
+    command->data.alter_ent.modified_attr = X;
+    command->data.alter_ent.model_ent.x = x;
+    GSList *node = g_slist_prepend(NULL, command);
+    if(container->commands_end == NULL)
+        container->commands = node;
+    else
+        container->commands_end->next = node;
+    container->commands_end = node;
+    container->num_commands++;
+}
+
+int main() {
+    long sum = 0;
+    double push_time = 0.0, walk_time = 0.0;
+    for(int f = 0; f < NUM_FRAMES; f++) {
+        struct old_container container = { 0, NULL, NULL };
+        double start = bench_now();
+        for(int i = 0; i < NUM_COMMANDS; i++)
+            old_push(&container, i, i);
+        push_time += bench_now() - start;
+        start = bench_now();
+        for(GSList *node = container.commands; node != NULL; node = node->next)
+            sum += ((struct old_update_command *) node->data)->data.alter_ent.model_ent.x;
+        for(GSList *node = container.commands; node != NULL; node = node->next)
+            free(node->data);
+        g_slist_free(container.commands);
+        walk_time += bench_now() - start;
+    }
+    printf("command size: GSList %zu bytes + node, segments %zu bytes\n",
+           sizeof(struct old_update_command),
+           offsetof(t_update_command, data) + sizeof(struct alter_entity_command));
+    bench_report("GSList push", (long) NUM_COMMANDS * NUM_FRAMES, push_time);
+    bench_report("GSList walk + free", (long) NUM_COMMANDS * NUM_FRAMES, walk_time);
+
+    push_time = walk_time = 0.0;
+    long segments_before = 0;
+    for(int f = 0; f < NUM_FRAMES; f++) {
+        if(f == 1)
+            segments_before = command_segments_allocated();
+        t_update_command_container container = make_update_command_container();
+        double start = bench_now();
+        for(int i = 0; i < NUM_COMMANDS; i++) {
+            t_update_command *command = push_command(&container, ALTER_ENTITY);
+            command->data.alter_ent.target_id = i;
+            command->data.alter_ent.modified_attr = X;
+            command->data.alter_ent.int_value = i;
+        }
+        push_time += bench_now() - start;
+        start = bench_now();
+        command_iter iter = iter_commands(&container);
+        t_update_command *command;
+        while((command = next_command(&iter)) != NULL)
+            sum -= command->data.alter_ent.int_value;
+        free_update_command_container(&container);
+        walk_time += bench_now() - start;
+    }
+    bench_report("segment push", (long) NUM_COMMANDS * NUM_FRAMES, push_time);
+    bench_report("segment walk + free", (long) NUM_COMMANDS * NUM_FRAMES, walk_time);
+    printf("segments allocated after first frame: %ld\n", command_segments_allocated() - segments_before);
+    if(sum != 0)
+        fprintf(stderr, "Command values differ between containers.\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * File: bench_collisionmask.c
+ *
+ * Measures pixel perfect tests of two overlapping sprites' masks, in tests per second,
+ * for each kernel against testing pixel by pixel.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+
+#define NUM_SIZES 3
+#define NUM_OFFSETS 1024
+#define NUM_REPEATS 50
+
+/*
+ * make_ring: Make a mask solid only on a ring, so most overlaps are misses which test every row.
+ */
+static collision_mask make_ring(int size) {
+    uint32_t *pixels = malloc(sizeof(uint32_t) * size * size);
+    int r = size / 2;
+    for(int y = 0; y < size; y++) {
+        for(int x = 0; x < size; x++) {
+            int d2 = (x - r) * (x - r) + (y - r) * (y - r);
+            pixels[y * size + x] = (d2 <= r * r && d2 >= (r - 2) * (r - 2)) ? 0xFF000000u : 0;
+        }
+    }
+    collision_mask mask = make_collision_mask(pixels, size, size);
+    free(pixels);
+    return mask;
+}
+
+static bool per_pixel(collision_mask const* a, int ax, int ay, collision_mask const* b, int bx, int by) {
+    for(int y = 0; y < a->height; y++) {
+        for(int x = 0; x < a->width; x++) {
+            if(collision_mask_get(a, x, y) && collision_mask_get(b, ax + x - bx, ay + y - by))
+                return true;
+        }
+    }
+    return false;
+}
+
+int main() {
+    srand(1);
+    int sizes[NUM_SIZES] = { 32, 64, 128 };
+    enum mask_kernel kernels[] = { MASK_KERNEL_SCALAR, MASK_KERNEL_SSE2, MASK_KERNEL_AVX2 };
+    char const* kernel_names[] = { "scalar", "sse2", "avx2" };
+    int *offsets = malloc(sizeof(int) * 2 * NUM_OFFSETS);
+    for(int s = 0; s < NUM_SIZES; s++) {
+        int size = sizes[s];
+        collision_mask a = make_ring(size), b = make_ring(size);
+        // b inside a's ring, or overlapping its edge
+        for(int i = 0; i < NUM_OFFSETS; i++) {
+            offsets[2 * i] = rand() % size - size / 2;
+            offsets[2 * i + 1] = rand() % size - size / 2;
+        }
+        char name[64];
+        long hits = 0;
+        for(int k = 0; k < 3; k++) {
+            if(!use_mask_kernel(kernels[k]))
+                continue;
+            hits = 0;
+            double start = bench_now();
+            for(int r = 0; r < NUM_REPEATS; r++) {
+                for(int i = 0; i < NUM_OFFSETS; i++)
+                    hits += masks_intersect(&a, 0, 0, &b, offsets[2 * i], offsets[2 * i + 1]);
+            }
+            snprintf(name, sizeof(name), "%dx%d masks %s (tests)", size, size, kernel_names[k]);
+            bench_report(name, (long) NUM_REPEATS * NUM_OFFSETS, bench_now() - start);
+        }
+        long naive_hits = 0;
+        double start = bench_now();
+        for(int i = 0; i < NUM_OFFSETS; i++)
+            naive_hits += per_pixel(&a, 0, 0, &b, offsets[2 * i], offsets[2 * i + 1]);
+        snprintf(name, sizeof(name), "%dx%d per pixel (tests)", size, size);
+        bench_report(name, NUM_OFFSETS, bench_now() - start);
+        if(naive_hits * NUM_REPEATS != hits)
+            printf("%40s hits differ: %ld vs %ld\n", "", hits / NUM_REPEATS, naive_hits);
+        collision_mask_free(&a);
+        collision_mask_free(&b);
+    }
+    use_mask_kernel(MASK_KERNEL_AUTO);
+    free(offsets);
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * File: bench_dispatch.c
+ *
+ * Stress test of command dispatch: 100k ALTER_ENTITY commands per frame over
+ * 10k entities, dispatched serially and then sharded over all cores.
+ * Checks that every entity ends at its last submitted position.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+#define NUM_ENTS 10000
+#define NUM_COMMANDS 100000
+#define NUM_FRAMES 20
+
+static t_update_command_container make_commands(int *expected_x) {
+    t_update_command_container commands = make_update_command_container();
+    for(int i = 0; i < NUM_COMMANDS; i++) {
+        t_update_command *command = push_command(&commands, ALTER_ENTITY);
+        int target = 1 + rand() % NUM_ENTS;
+        command->data.alter_ent.target_id = target;
+        command->data.alter_ent.modified_attr = X;
+        command->data.alter_ent.int_value = i;
+        expected_x[target] = i;
+    }
+    return commands;
+}
+
+static void run(t_game_data *data, int num_workers, int *expected_x) {
+    threadpool *pool = make_threadpool(num_workers);
+    double total = 0.0;
+    bool correct = true;
+    t_update_command **schedule = malloc(sizeof(t_update_command *) * NUM_COMMANDS);
+    for(int f = 0; f < NUM_FRAMES; f++) {
+        t_update_command_container commands = make_commands(expected_x);
+        command_iter iter = iter_commands(&commands);
+        for(int i = 0; i < NUM_COMMANDS; i++)
+            schedule[i] = next_command(&iter);
+        double start = bench_now();
+        dispatch_commands(data, pool, schedule, NUM_COMMANDS);
+        total += bench_now() - start;
+        free_update_command_container(&commands);
+        for(int id = 1; id <= NUM_ENTS; id++)
+            correct = correct && (get_entity(data, id)->x == expected_x[id]);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "dispatch, %d workers%s", threadpool_num_workers(pool), correct ? "" : " (WRONG)");
+    bench_report(name, (long) NUM_COMMANDS * NUM_FRAMES, total);
+    free(schedule);
+    threadpool_free(pool);
+}
+
+int main() {
+    srand(1);
+    t_game_data data = make_game_data(NULL);
+    for(int i = 0; i < NUM_ENTS; i++)
+        add_entity(&data, calloc(1, sizeof(t_entity)));
+    int *expected_x = calloc(NUM_ENTS + 1, sizeof(int));
+    run(&data, 1, expected_x);
+    run(&data, 0, expected_x);
+    free(expected_x);
+    return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * File: bench_entity_soa.c
+ *
+ * Compares a per-frame sprite timer pass over t_entity structs against the
+ * same pass over entity_soa arrays, reporting time and cache misses per frame.
+ * Cache misses are read with perf_event_open, and are skipped if unavailable.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define NUM_FRAMES 200
+
+static int open_cache_miss_counter() {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void counter_start(int fd) {
+    if(fd < 0) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+static long long counter_stop(int fd) {
+    long long count = -1;
+    if(fd < 0) return count;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if(read(fd, &count, sizeof(count)) != sizeof(count))
+        count = -1;
+    return count;
+}
+
+static void run(int num_ents, int fd) {
+    slotmap map = make_slotmap(num_ents);
+    for(int i = 0; i < num_ents; i++) {
+        t_entity *ent = calloc(1, sizeof(t_entity));
+        ent->id = i + 1;
+        ent->spr_period = (i % 4 == 0) ? -1 : 3;
+        slotmap_add(&map, ent->id, ent);
+    }
+    entity_soa *soa = make_entity_soa(num_ents);
+    t_entity **ents = (t_entity **) slotmap_get_elems(&map);
+    for(int i = 0; i < num_ents; i++)
+        entity_soa_push(soa, ents[i]);
+    printf("-- %d entities, %d frames\n", num_ents, NUM_FRAMES);
+
+    counter_start(fd);
+    double start = bench_now();
+    for(int f = 0; f < NUM_FRAMES; f++) {
+        for(int i = 0; i < num_ents; i++) {
+            if(ents[i]->spr_period >= 0)
+                ents[i]->spr_last_subimg_time++;
+        }
+    }
+    double secs = bench_now() - start;
+    long long misses = counter_stop(fd);
+    bench_report("AoS timer pass", (long) num_ents * NUM_FRAMES, secs);
+    if(misses >= 0)
+        printf("    cache misses/frame: %lld\n", misses / NUM_FRAMES);
+
+    counter_start(fd);
+    start = bench_now();
+    for(int f = 0; f < NUM_FRAMES; f++)
+        entity_soa_tick_subimg_timers(soa);
+    secs = bench_now() - start;
+    misses = counter_stop(fd);
+    bench_report("SoA timer pass", (long) num_ents * NUM_FRAMES, secs);
+    if(misses >= 0)
+        printf("    cache misses/frame: %lld\n", misses / NUM_FRAMES);
+
+    for(int i = 0; i < num_ents; i++) {
+        if(ents[i]->spr_last_subimg_time != soa->spr_last_subimg_time[i])
+            fprintf(stderr, "Mismatch between AoS and SoA at %d.\n", i);
+        free(ents[i]);
+    }
+    entity_soa_free(soa);
+    slotmap_free(&map);
+}
+
+int main() {
+    int fd = open_cache_miss_counter();
+    if(fd < 0)
+        printf("(perf counters unavailable, reporting time only)\n");
+    int sizes[] = { 1000, 10000, 100000 };
+    for(int i = 0; i < 3; i++)
+        run(sizes[i], fd);
+    if(fd >= 0)
+        close(fd);
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * File: bench_glrender.c
+ *
+ * Measures rendering 1k to 50k sprites at 640x480 with the OpenGL renderer, in sprites drawn
+ * per second, ms per frame, draw calls and bytes uploaded per frame, with each subimage as its
+ * own texture against one texture per atlas page. Runs headless on Mesa's surfaceless EGL
+ * platform, so without a GPU it measures llvmpipe, whose fill rate dominates the frame time.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#define GL_GLEXT_PROTOTYPES
+#include "../cnoodle.h"
+#include "bench.h"
+#include <GL/glext.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <stdlib.h>
+
+#define SCR_WIDTH 640
+#define SCR_HEIGHT 480
+#define NUM_SPRITES 200
+#define MIN_SPR_SIZE 4
+#define MAX_SPR_SIZE 16
+#define NUM_FRAMES 20
+
+/*
+ * make_context: Make an OpenGL 4.4 core context current without any window, returning false if
+ * there is no EGL display that can.
+ */
+static bool make_context() {
+    EGLint major, minor;
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if(get_platform_display == NULL)
+            return false;
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+            return false;
+    }
+    EGLint attributes[] = { EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 4,
+                            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+    if(!eglBindAPI(EGL_OPENGL_API))
+        return false;
+    EGLContext context = eglCreateContext(display, NULL, EGL_NO_CONTEXT, attributes);
+    return context != EGL_NO_CONTEXT && eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+static void time_frames(t_game_data *data, game_snapshot const* snapshot, render_queue *queue,
+                        gl_renderer *renderer, char const* name) {
+    render_frame(data, snapshot, queue);    // warm up, and upload any atlas
+    long total_bytes = renderer->total_bytes_uploaded;
+    long stalls = 0;
+    double start = bench_now();
+    for(int f = 0; f < NUM_FRAMES; f++) {
+        render_frame(data, snapshot, queue);
+        stalls += renderer->frame_stalls;
+    }
+    glFinish();
+    double elapsed = bench_now() - start;
+    bench_report(name, renderer->frame_instances * NUM_FRAMES, elapsed);
+    printf("%40s %8.3f ms/frame, %ld draw calls/frame, %ld KB/frame, %ld stalls\n", "", elapsed * 1e3 / NUM_FRAMES,
+           renderer->frame_draw_calls, (renderer->total_bytes_uploaded - total_bytes) / NUM_FRAMES / 1024, stalls);
+}
+
+static void run(int num_ents, t_sprite **sprites) {
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    data->scr_width = SCR_WIDTH;
+    data->scr_height = SCR_HEIGHT;
+    for(int i = 0; i < NUM_SPRITES; i++) {
+        // unpack them from the previous run's atlas
+        free(sprites[i]->regions);
+        sprites[i]->regions = NULL;
+        add_sprite(data, sprites[i]);
+    }
+    t_room *room = calloc(1, sizeof(t_room));
+    room->entity_ids = malloc(sizeof(int) * num_ents);
+    t_entity *ents = calloc(num_ents, sizeof(t_entity));
+    for(int i = 0; i < num_ents; i++) {
+        t_sprite *sprite = sprites[rand() % NUM_SPRITES];
+        ents[i].current_spr_id = sprite->spr_id;
+        ents[i].spr_current_img = rand() % sprite->num_imgs;
+        ents[i].x = rand() % SCR_WIDTH;
+        ents[i].y = rand() % SCR_HEIGHT;
+        ents[i].depth = rand() % 4;
+        add_entity(data, &ents[i]);
+        room->entity_ids[room->num_entities++] = ents[i].id;
+    }
+    add_room(data, room);
+    data->current_room_id = room->room_id;
+    gl_renderer *renderer = make_gl_renderer(0x202020, 0);
+    set_renderer(data, &renderer->backend);
+    publish_game_snapshot(data);
+    game_snapshot const* snapshot = snapshot_acquire(&data->snapshots);
+    render_queue queue = make_render_queue(num_ents);
+
+    char name[64];
+    snprintf(name, sizeof(name), "%d sprites own textures (sprites)", num_ents);
+    time_frames(data, snapshot, &queue, renderer, name);
+    build_sprite_atlas(data, 1024);
+    snprintf(name, sizeof(name), "%d sprites atlas (sprites)", num_ents);
+    time_frames(data, snapshot, &queue, renderer, name);
+
+    render_queue_free(&queue);
+    free(ents);
+    free(room->entity_ids);
+    free(room);
+    gamedata_free(data);
+}
+
+int main() {
+    if(!make_context()) {
+        printf("no OpenGL 4.4 context\n");
+        return 1;
+    }
+    GLuint framebuffer, colorbuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &colorbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorbuffer);
+
+    srand(1);
+    t_sprite **sprites = malloc(sizeof(t_sprite *) * NUM_SPRITES);
+    uint32_t *pixels = malloc(sizeof(uint32_t) * MAX_SPR_SIZE * MAX_SPR_SIZE);
+    for(int i = 0; i < NUM_SPRITES; i++) {
+        int width = MIN_SPR_SIZE + rand() % (MAX_SPR_SIZE - MIN_SPR_SIZE + 1);
+        int height = MIN_SPR_SIZE + rand() % (MAX_SPR_SIZE - MIN_SPR_SIZE + 1);
+        t_sprite *sprite = make_sprite(1, width, height, malloc(sizeof(GLuint)));
+        for(int k = 0; k < sprite->width * sprite->height; k++)
+            pixels[k] = (rand() % 4 == 0) ? 0 : 0xFF000000u | (uint32_t) rand();
+        glGenTextures(1, sprite->texture);
+        glBindTexture(GL_TEXTURE_2D, sprite->texture[0]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, sprite->width, sprite->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        sprite_set_pixels(sprite, (uint32_t const* const*) &pixels);
+        sprites[i] = sprite;
+    }
+    int sizes[] = { 1000, 10000, 50000 };
+    for(int i = 0; i < 3; i++)
+        run(sizes[i], sprites);
+    for(int i = 0; i < NUM_SPRITES; i++) {
+        glDeleteTextures(1, sprites[i]->texture);
+        free_sprite(sprites[i]);
+    }
+    free(sprites);
+    free(pixels);
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * File: bench_hashtable.c
+ *
+ * Compares insert/lookup/delete throughput of the open addressing hashtable
+ * against the chained hashtable with 64 fixed buckets it replaced.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+
+#define CHAINED_BUCKETS 64
+#define LOOKUPS_PER_ELEM 8
+
+/*
+ * chained_table: Reference implementation of the old table, one heap node per element.
+ */
+typedef struct {
+    llist_node *buckets[CHAINED_BUCKETS];
+} chained_table;
+
+static void chained_add(chained_table *table, void *elem, elem_type type) {
+    llist_node *node = malloc(sizeof(llist_node));
+    *node = make_node(elem, type);
+    int pos = get_id(elem, type) % CHAINED_BUCKETS;
+    node->next = table->buckets[pos];
+    table->buckets[pos] = node;
+}
+
+static void *chained_get(chained_table *table, int id) {
+    for(llist_node *node = table->buckets[id % CHAINED_BUCKETS]; node != NULL; node = node->next) {
+        if(get_llist_node_id(*node) == id)
+            return node->elem;
+    }
+    return NULL;
+}
+
+static void chained_del(chained_table *table, int id) {
+    llist_node **link = &table->buckets[id % CHAINED_BUCKETS];
+    while(*link != NULL) {
+        if(get_llist_node_id(**link) == id) {
+            llist_node *dead = *link;
+            *link = dead->next;
+            free(dead);
+            return;
+        }
+        link = &(*link)->next;
+    }
+}
+
+static void run(int num_elems) {
+    t_entity *ents = malloc(sizeof(t_entity) * num_elems);
+    int *order = malloc(sizeof(int) * num_elems * LOOKUPS_PER_ELEM);
+    for(int i = 0; i < num_elems; i++) {
+        ents[i].id = i + 1;
+        ents[i].x = i;
+    }
+    for(int i = 0; i < num_elems * LOOKUPS_PER_ELEM; i++)
+        order[i] = 1 + rand() % num_elems;
+    long num_lookups = (long) num_elems * LOOKUPS_PER_ELEM;
+    long checksum = 0;
+    char name[64];
+    printf("-- %d elements\n", num_elems);
+
+    chained_table *chained = calloc(1, sizeof(chained_table));
+    double start = bench_now();
+    for(int i = 0; i < num_elems; i++)
+        chained_add(chained, &ents[i], ENTITY);
+    snprintf(name, sizeof(name), "chained insert");
+    bench_report(name, num_elems, bench_now() - start);
+    start = bench_now();
+    for(long i = 0; i < num_lookups; i++)
+        checksum += ((t_entity *) chained_get(chained, order[i]))->x;
+    bench_report("chained lookup", num_lookups, bench_now() - start);
+    start = bench_now();
+    for(int i = 0; i < num_elems; i++)
+        chained_del(chained, ents[i].id);
+    bench_report("chained delete", num_elems, bench_now() - start);
+    free(chained);
+
+    hashtable table = make_hashtable(0);
+    start = bench_now();
+    for(int i = 0; i < num_elems; i++)
+        hashtable_add(&table, &ents[i], ENTITY);
+    bench_report("open addressing insert", num_elems, bench_now() - start);
+    start = bench_now();
+    for(long i = 0; i < num_lookups; i++)
+        checksum -= ((t_entity *) hashtable_get(&table, order[i]))->x;
+    bench_report("open addressing lookup", num_lookups, bench_now() - start);
+    start = bench_now();
+    for(int i = 0; i < num_elems; i++)
+        hashtable_del(&table, ents[i].id);
+    bench_report("open addressing delete", num_elems, bench_now() - start);
+    hashtable_free(&table);
+
+    if(checksum != 0)
+        fprintf(stderr, "Lookup mismatch between tables.\n");
+    free(order);
+    free(ents);
+}
+
+int main() {
+    srand(1);
+    int sizes[] = { 1000, 10000, 100000 };
+    for(int i = 0; i < 3; i++)
+        run(sizes[i]);
+    return 0;
+}
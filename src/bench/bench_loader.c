@@ -0,0 +1,180 @@
+/*
+ * File: bench_loader.c
+ *
+ * Measures starting a game of 1,000 assets (sprites and sounds): loaded one after another before
+ * the game starts, against given to the asset loader. For the loader, both the time until every
+ * handle is given out, when the game could start, and until every asset is usable are timed.
+ * Files are dropped from the page cache before each cold run, as with bench_pack.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#define _GNU_SOURCE
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define NUM_ASSETS 1000
+#define NUM_SOUNDS 200      // the rest are sprites
+#define SPR_SIZE 64
+#define SPR_IMGS 4
+#define SOUND_FRAMES (MIXER_SAMPLE_RATE / 4)
+
+static char paths[NUM_ASSETS][96];     // room for the bench directory plus a file name
+
+static void write_le(FILE *file, int num_bytes, uint32_t value) {
+    for(int i = 0; i < num_bytes; i++)
+        fputc((value >> (8 * i)) & 0xFF, file);
+}
+
+static void write_assets() {
+    uint32_t *pixels = malloc(sizeof(uint32_t) * SPR_SIZE * SPR_SIZE * SPR_IMGS);
+    for(int i = 0; i < NUM_ASSETS; i++) {
+        FILE *file = fopen(paths[i], "wb");
+        if(i < NUM_SOUNDS) {
+            fwrite("RIFF", 1, 4, file);
+            write_le(file, 4, 36 + SOUND_FRAMES * 4);
+            fwrite("WAVEfmt ", 1, 8, file);
+            write_le(file, 4, 16);
+            write_le(file, 2, WAV_PCM);
+            write_le(file, 2, 2);
+            write_le(file, 4, MIXER_SAMPLE_RATE);
+            write_le(file, 4, MIXER_SAMPLE_RATE * 4);
+            write_le(file, 2, 4);
+            write_le(file, 2, 16);
+            fwrite("data", 1, 4, file);
+            write_le(file, 4, SOUND_FRAMES * 4);
+            for(long k = 0; k < 2 * SOUND_FRAMES; k++)
+                write_le(file, 2, (uint16_t) rand());
+        } else {
+            for(int k = 0; k < SPR_SIZE * SPR_SIZE * SPR_IMGS; k++)
+                pixels[k] = (uint32_t) rand();
+            fprintf(file, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n",
+                    SPR_SIZE, SPR_SIZE * SPR_IMGS);
+            fwrite(pixels, sizeof(uint32_t), SPR_SIZE * SPR_SIZE * SPR_IMGS, file);
+        }
+        fclose(file);
+    }
+    free(pixels);
+}
+
+/*
+ * drop_cached: Ask the kernel to drop every asset from its page cache (see bench_pack.c).
+ */
+static void drop_cached() {
+    for(int i = 0; i < NUM_ASSETS; i++) {
+        int fd = open(paths[i], O_RDONLY);
+        if(fd < 0)
+            continue;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+/*
+ * load_serial: Load every asset before starting, as a game does without the loader.
+ */
+static double load_serial() {
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    t_sprite *sprites = calloc(NUM_ASSETS, sizeof(t_sprite));
+    t_sound *sounds = calloc(NUM_ASSETS, sizeof(t_sound));
+    double start = bench_now();
+    for(int i = 0; i < NUM_ASSETS; i++) {
+        if(i < NUM_SOUNDS) {
+            sounds[i].snd_path = paths[i];
+            load_sound(&sounds[i]);
+            add_sound(data, &sounds[i]);
+        } else {
+            sprites[i].num_imgs = SPR_IMGS;
+            sprites[i].width = sprites[i].height = SPR_SIZE;
+            load_sprite(&sprites[i], paths[i]);
+            add_sprite(data, &sprites[i]);
+        }
+    }
+    double elapsed = bench_now() - start;
+    for(int i = 0; i < NUM_ASSETS; i++) {
+        free(sounds[i].samples);
+        for(int k = 0; k < SPR_IMGS && sprites[i].masks != NULL; k++) {
+            collision_mask_free(&sprites[i].masks[k]);
+            free(sprites[i].pixels[k]);
+        }
+        free(sprites[i].masks);
+        free(sprites[i].pixels);
+    }
+    free(sprites);
+    free(sounds);
+    gamedata_free(data);
+    return elapsed;
+}
+
+/*
+ * load_async: Give every asset to the loader, timing until all handles are given out, and until all are usable.
+ */
+static double load_async(int num_threads, double *startup) {
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    enable_asset_loader(data, num_threads);
+    double start = bench_now();
+    for(int i = 0; i < NUM_ASSETS; i++) {
+        if(i < NUM_SOUNDS)
+            load_sound_async(data, paths[i], 0);
+        else
+            load_sprite_async(data, paths[i], SPR_IMGS, SPR_SIZE, SPR_SIZE);
+    }
+    *startup = bench_now() - start;
+    // as the render loop would, one frame's worth of uploads at a time
+    loader_wait(data->loader);
+    while(loader_upload(data->loader, NULL) > 0)
+        ;
+    double elapsed = bench_now() - start;
+    if(data->loader->loaded != NUM_ASSETS)
+        fprintf(stderr, "Loaded only %ld assets.\n", data->loader->loaded);
+    gamedata_free(data);
+    return elapsed;
+}
+
+static void time_async(int num_threads, bool cold) {
+    char name[64];
+    if(cold)
+        drop_cached();
+    double startup;
+    double elapsed = load_async(num_threads, &startup);
+    snprintf(name, sizeof(name), "async, %d threads, %s (assets)", num_threads, cold ? "cold" : "warm");
+    bench_report(name, NUM_ASSETS, elapsed);
+    printf("%40s %8.2f ms until started, %8.2f ms until all usable\n", "", startup * 1e3, elapsed * 1e3);
+}
+
+int main() {
+    srand(1);
+    char dir[64];
+    snprintf(dir, sizeof(dir), "/tmp/cnd_bench_loader_%d", (int) getpid());
+    mkdir(dir, 0700);
+    for(int i = 0; i < NUM_ASSETS; i++)
+        snprintf(paths[i], sizeof(paths[i]), "%s/%d.%s", dir, i, i < NUM_SOUNDS ? "wav" : "pam");
+    write_assets();
+    sync();
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("%ld online CPUs\n", num_cpus);
+
+    for(int cold = 1; cold >= 0; cold--) {
+        if(cold)
+            drop_cached();
+        double elapsed = load_serial();
+        bench_report(cold ? "serial, cold (assets)" : "serial, warm (assets)", NUM_ASSETS, elapsed);
+        printf("%40s %8.2f ms until started\n", "", elapsed * 1e3);
+        time_async(1, cold);
+        time_async(4, cold);
+        if(num_cpus > 4)
+            time_async((int) num_cpus, cold);
+    }
+
+    for(int i = 0; i < NUM_ASSETS; i++)
+        remove(paths[i]);
+    rmdir(dir);
+    return 0;
+}
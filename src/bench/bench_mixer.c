@@ -0,0 +1,119 @@
+/*
+ * File: bench_mixer.c
+ *
+ * Measures mixing throughput of the audio mixer offline, without any sound device: 1 to 64
+ * voices loaded in memory, one sample at a time against SSE, and sounds streamed from a WAV
+ * file by the decode thread. Reports voices mixed per ms of CPU time, ie. how many voices one
+ * ms of CPU time per ms of audio could keep playing, counting the decode thread's time too.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SOUND_FRAMES (MIXER_BLOCK_FRAMES * 344)    // about 2 seconds, in whole blocks
+#define MIX_SECONDS 10
+#define STREAM_PATH_FORMAT "/tmp/cnd_bench_mixer_%d.wav"
+
+/*
+ * cpu_now: CPU time used by every thread of the process, in seconds.
+ */
+static double cpu_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void write_le(FILE *file, int num_bytes, uint32_t value) {
+    for(int i = 0; i < num_bytes; i++)
+        fputc((value >> (8 * i)) & 0xFF, file);
+}
+
+/*
+ * write_stream: Write a long 16 bit stereo WAV file to stream, so decoding converts every sample.
+ */
+static void write_stream(char const* path, float const* samples) {
+    FILE *file = fopen(path, "wb");
+    uint32_t data_size = (uint32_t) MIX_SECONDS * MIXER_SAMPLE_RATE * 4;
+    fwrite("RIFF", 1, 4, file);
+    write_le(file, 4, 36 + data_size);
+    fwrite("WAVEfmt ", 1, 8, file);
+    write_le(file, 4, 16);
+    write_le(file, 2, WAV_PCM);
+    write_le(file, 2, 2);
+    write_le(file, 4, MIXER_SAMPLE_RATE);
+    write_le(file, 4, MIXER_SAMPLE_RATE * 4);
+    write_le(file, 2, 4);
+    write_le(file, 2, 16);
+    fwrite("data", 1, 4, file);
+    write_le(file, 4, data_size);
+    for(long i = 0; i < (long) MIX_SECONDS * MIXER_SAMPLE_RATE * 2; i++)
+        write_le(file, 2, (uint16_t) (int16_t) (samples[i % (2 * SOUND_FRAMES)] * 32767));
+    fclose(file);
+}
+
+/*
+ * wait_for_frames: Wait until a stream has a block decoded, or has been decoded to its end.
+ */
+static void wait_for_frames(mixer_stream *stream) {
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 50000 };
+    while(spsc_ring_count(&stream->frames) < MIXER_BLOCK_FRAMES && !atomic_load(&stream->finished))
+        nanosleep(&pause, NULL);
+}
+
+/*
+ * run: Mix MIX_SECONDS of audio with num_voices sounds playing, streamed or from memory.
+ */
+static void run(int num_voices, bool simd, char const* stream_path, float const* samples) {
+    audio_mixer *mixer = make_mixer();
+    mixer->use_simd = simd;
+    for(int i = 0; i < num_voices && stream_path != NULL; i++)
+        mixer_play_stream(mixer, i + 1, stream_path, 1.0f / num_voices);
+    float out[2 * MIXER_BLOCK_FRAMES];
+    long num_blocks = (long) MIX_SECONDS * MIXER_SAMPLE_RATE / MIXER_BLOCK_FRAMES;
+    double start = bench_now(), cpu_start = cpu_now();
+    for(long b = 0; b < num_blocks; b++) {
+        // memory sounds start again once finished, so every voice plays throughout
+        if(stream_path == NULL && b % (SOUND_FRAMES / MIXER_BLOCK_FRAMES) == 0) {
+            for(int i = 0; i < num_voices; i++)
+                mixer_play(mixer, i + 1, samples, SOUND_FRAMES, 1.0f / num_voices);
+        }
+        // streams wait for the decode thread as a device's pace would, sleeping so as not to use CPU time
+        for(int i = 0; i < num_voices && stream_path != NULL; i++)
+            wait_for_frames(&mixer->streams[i]);
+        mixer_mix(mixer, out, MIXER_BLOCK_FRAMES);
+    }
+    double elapsed = bench_now() - start, cpu = cpu_now() - cpu_start;
+    double audio_ms = num_blocks * MIXER_BLOCK_FRAMES * 1e3 / MIXER_SAMPLE_RATE;
+    char name[64];
+    snprintf(name, sizeof(name), "%d voices %s%s (voice frames)", num_voices,
+             (stream_path != NULL) ? "streamed " : "", simd ? "sse" : "scalar");
+    bench_report(name, (long) num_voices * num_blocks * MIXER_BLOCK_FRAMES, elapsed);
+    printf("%40s %8.2f us/block, %8.1f voices per ms of CPU, %ld underruns\n", "", cpu * 1e6 / num_blocks,
+           num_voices * audio_ms / (cpu * 1e3), atomic_load(&mixer->underruns));
+    mixer_free(mixer);
+}
+
+int main() {
+    srand(1);
+    float *samples = malloc(sizeof(float) * 2 * SOUND_FRAMES);
+    for(int i = 0; i < 2 * SOUND_FRAMES; i++)
+        samples[i] = (float) rand() / RAND_MAX * 2.0f - 1.0f;
+    int counts[] = { 1, 8, 32, MIXER_MAX_VOICES };
+    for(int i = 0; i < 4; i++) {
+        run(counts[i], false, NULL, samples);
+        run(counts[i], true, NULL, samples);
+    }
+    char path[64];
+    snprintf(path, sizeof(path), STREAM_PATH_FORMAT, (int) getpid());
+    write_stream(path, samples);
+    run(MIXER_MAX_STREAMS, true, path, samples);
+    remove(path);
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,136 @@
+/*
+ * File: bench_pack.c
+ *
+ * Measures starting a game of 100k entities: built one element at a time, as a game does
+ * without a pack, against loaded by make_game_data from a pack. Packs are timed both cold,
+ * having asked the kernel to drop the file from its page cache first, and warm.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#define _GNU_SOURCE
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define NUM_ENTITIES 100000
+#define NUM_ROOMS 100
+#define NUM_SPRITES 100
+#define NUM_SOUNDS 100
+#define RUNS 5
+
+/*
+ * build_game: Build a game the way one is built without a pack, allocating every element.
+ */
+static t_game_data *build_game() {
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    for(int i = 0; i < NUM_SPRITES; i++) {
+        t_sprite *sprite = calloc(1, sizeof(t_sprite));
+        sprite->num_imgs = 4;
+        sprite->width = sprite->height = 32;
+        add_sprite(data, sprite);
+    }
+    for(int i = 0; i < NUM_SOUNDS; i++) {
+        t_sound *sound = calloc(1, sizeof(t_sound));
+        sound->snd_path = malloc(32);
+        snprintf(sound->snd_path, 32, "sounds/sound_%d.wav", i);
+        add_sound(data, sound);
+    }
+    t_room *rooms[NUM_ROOMS];
+    for(int i = 0; i < NUM_ROOMS; i++) {
+        rooms[i] = calloc(1, sizeof(t_room));
+        rooms[i]->width = rooms[i]->height = 4096;
+        rooms[i]->entity_ids = malloc(sizeof(int) * NUM_ENTITIES / NUM_ROOMS);
+        add_room(data, rooms[i]);
+    }
+    for(int i = 0; i < NUM_ENTITIES; i++) {
+        t_entity *entity = calloc(1, sizeof(t_entity));
+        entity->x = rand() % 4096;
+        entity->y = rand() % 4096;
+        entity->current_spr_id = 1 + rand() % NUM_SPRITES;
+        entity->spr_period = -1;
+        add_entity(data, entity);
+        t_room *room = rooms[i % NUM_ROOMS];
+        room->entity_ids[room->num_entities++] = entity->id;
+    }
+    data->current_room_id = rooms[0]->room_id;
+    return data;
+}
+
+static void free_built_game(t_game_data *data) {
+    int *ids = get_entity_ids(data);
+    for(int i = 0; i < data->num_entities; i++)
+        free(get_entity(data, ids[i]));
+    ids = get_room_ids(data);
+    for(int i = 0; i < data->num_rooms; i++) {
+        t_room *room = get_room(data, ids[i]);
+        free(room->entity_ids);
+        free(room);
+    }
+    ids = get_sound_ids(data);
+    for(int i = 0; i < data->num_sounds; i++) {
+        t_sound *sound = get_sound(data, ids[i]);
+        free(sound->snd_path);
+        free(sound);
+    }
+    ids = get_sprite_ids(data);
+    for(int i = 0; i < data->num_sprites; i++)
+        free(get_sprite(data, ids[i]));
+    gamedata_free(data);
+}
+
+/*
+ * drop_cached: Ask the kernel to drop a file from its page cache, so the next read goes to disk.
+ * Only a hint, so cold times are an upper bound on how warm the file still is.
+ */
+static void drop_cached(char const* path) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static void time_pack(char const* path, bool cold, char const* name) {
+    double elapsed = 0;
+    for(int r = 0; r < RUNS; r++) {
+        if(cold)
+            drop_cached(path);
+        double start = bench_now();
+        t_game_data *data = malloc(sizeof(t_game_data));
+        *data = make_game_data((char *) path);
+        elapsed += bench_now() - start;
+        if(data->num_entities != NUM_ENTITIES)
+            fprintf(stderr, "Pack loaded %d entities.\n", data->num_entities);
+        gamedata_free(data);
+    }
+    bench_report(name, (long) RUNS * NUM_ENTITIES, elapsed);
+    printf("%40s %8.2f ms/start\n", "", elapsed * 1e3 / RUNS);
+}
+
+int main() {
+    srand(1);
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/cnd_bench_pack_%d.pack", (int) getpid());
+
+    double elapsed = 0;
+    for(int r = 0; r < RUNS; r++) {
+        double start = bench_now();
+        t_game_data *data = build_game();
+        elapsed += bench_now() - start;
+        if(r == 0)
+            save_game_pack(data, path);
+        free_built_game(data);
+    }
+    bench_report("built element by element (entities)", (long) RUNS * NUM_ENTITIES, elapsed);
+    printf("%40s %8.2f ms/start\n", "", elapsed * 1e3 / RUNS);
+
+    time_pack(path, true, "pack, cold (entities)");
+    time_pack(path, false, "pack, warm (entities)");
+    remove(path);
+    return 0;
+}
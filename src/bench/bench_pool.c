@@ -0,0 +1,157 @@
+/*
+ * File: bench_pool.c
+ *
+ * Churns 50k entities a frame for 30 frames: each frame spawns 50k bullets into a room and
+ * removes the 50k spawned the frame before. Bullets are malloc'd with separately malloc'd
+ * ent_data, against made from the entity pools with ent_data inline, against spawned with
+ * SPAWN_BATCH. Reports heap allocations made, and resident memory at the end of each run, which
+ * runs in a process of its own so memory kept by one cannot be reused by the next.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define CHURN_PER_FRAME 50000
+#define NUM_FRAMES 30
+#define BATCH_SIZE 100
+
+enum churn_mode { MALLOC_ENTITIES, POOL_ENTITIES, SPAWN_BATCHES };
+
+typedef struct {
+    int vx;
+    int vy;
+    int damage;
+    int lifetime;
+} bullet_data;
+
+static t_update_command_container bullet_step(t_game_data const* data, t_entity const* entity) {
+    return make_update_command_container();
+}
+
+static ent_func_vtable const bullet_handlers = { .step = bullet_step };
+static bullet_data const bullet_init = { .vx = 0, .vy = -4, .damage = 1, .lifetime = 120 };
+
+static long resident_kb() {
+    long pages = 0, resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if(statm == NULL)
+        return -1;
+    if(fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+        resident = -1;
+    fclose(statm);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void run(char const* name, enum churn_mode mode) {
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    t_room room = {0};
+    add_room(data, &room);
+    t_archetype bullet = {
+            .event_handlers = bullet_handlers, .spr_period = -1,
+            .ent_data_size = sizeof(bullet_data), .ent_data_init = &bullet_init
+    };
+    int arch_id = register_archetype(data, &bullet);
+    // entities spawned last frame, and this frame
+    t_entity **last = malloc(sizeof(t_entity *) * CHURN_PER_FRAME);
+    t_entity **current = malloc(sizeof(t_entity *) * CHURN_PER_FRAME);
+    int last_first_id = 0;
+    t_update_command **schedule = malloc(sizeof(t_update_command *) * CHURN_PER_FRAME * 2);
+
+    long mallocs = 0;
+    long heap_before = get_heap_allocations();
+    double total = 0.0;
+    for(int f = 0; f <= NUM_FRAMES; f++) {
+        double start = bench_now();
+        t_update_command_container commands = make_update_command_container();
+        int first_id = data->max_id + 1;
+        if(mode == SPAWN_BATCHES) {
+            for(int i = 0; i < CHURN_PER_FRAME; i += BATCH_SIZE) {
+                t_update_command *command = push_command(&commands, SPAWN_BATCH);
+                command->data.spawn_batch = (struct spawn_batch_command) {
+                        .arch_id = arch_id, .count = BATCH_SIZE, .room_id = room.room_id, .x = i, .dx = 1
+                };
+            }
+        } else {
+            for(int i = 0; i < CHURN_PER_FRAME; i++) {
+                t_entity *entity;
+                if(mode == MALLOC_ENTITIES) {
+                    entity = malloc(sizeof(t_entity));
+                    *entity = (t_entity) { .spr_period = -1, .x = i, .ent_data = malloc(sizeof(bullet_data)) };
+                    mallocs += 2;
+                } else {
+                    entity = make_entity_with_data(0, i, 0, sizeof(bullet_data));
+                }
+                entity->event_handlers = bullet_handlers;
+                *(bullet_data *) entity->ent_data = bullet_init;
+                current[i] = entity;
+                t_update_command *command = push_command(&commands, ADD_ENTITY);
+                command->data.add_ent = (struct add_entity_command) { .new_entity = entity, .room_id = room.room_id };
+            }
+        }
+        for(int i = 0; f > 0 && i < CHURN_PER_FRAME; i++) {
+            t_update_command *command = push_command(&commands, REM_ENTITY);
+            command->data.rem_ent.ent_id = last_first_id + i;
+        }
+        int num_scheduled = optimise_commands(data, &commands, schedule);
+        dispatch_commands(data, NULL, schedule, num_scheduled);
+        free_update_command_container(&commands);
+        // spawned entities are freed by the game data; the rest by whoever made them
+        for(int i = 0; f > 0 && mode != SPAWN_BATCHES && i < CHURN_PER_FRAME; i++) {
+            if(mode == MALLOC_ENTITIES) {
+                free(last[i]->ent_data);
+                free(last[i]);
+            } else {
+                free_entity(last[i]);
+            }
+        }
+        arena_reset(frame_arena_local());
+        t_entity **swap = last;
+        last = current;
+        current = swap;
+        last_first_id = first_id;
+        // the first frame only spawns, so is not timed
+        if(f > 0)
+            total += bench_now() - start;
+    }
+    long allocations = mallocs + get_heap_allocations() - heap_before;
+
+    char full_name[64];
+    bool correct = data->num_entities == CHURN_PER_FRAME && room.num_entities == CHURN_PER_FRAME;
+    snprintf(full_name, sizeof(full_name), "%s%s", name, correct ? "" : " (WRONG)");
+    bench_report(full_name, (long) CHURN_PER_FRAME * NUM_FRAMES, total);
+    printf("%40s %8.3f ms per frame of %d spawns and removals\n", "", total / NUM_FRAMES * 1e3, CHURN_PER_FRAME);
+    printf("%40s %8ld heap allocations, %ld kB resident\n", "", allocations, resident_kb());
+    fflush(stdout);
+
+    for(int i = 0; mode != SPAWN_BATCHES && i < CHURN_PER_FRAME; i++)
+        free_entity(last[i]);
+    free(last);
+    free(current);
+    free(schedule);
+    free(room.entity_ids);
+    gamedata_free(data);
+}
+
+static void run_alone(char const* name, enum churn_mode mode) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid == 0) {
+        run(name, mode);
+        exit(EXIT_SUCCESS);
+    }
+    waitpid(pid, NULL, 0);
+}
+
+int main() {
+    run_alone("malloc'd entity and ent_data", MALLOC_ENTITIES);
+    run_alone("pooled entity, inline ent_data", POOL_ENTITIES);
+    run_alone("SPAWN_BATCH, pooled", SPAWN_BATCHES);
+    return 0;
+}
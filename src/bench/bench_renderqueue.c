@@ -0,0 +1,103 @@
+/*
+ * File: bench_renderqueue.c
+ *
+ * Compares building and ordering a frame's queued images with the radix sorted
+ * render queue against a balanced binary tree (glibc's tsearch), as first planned
+ * in docs/overview.md.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#define _GNU_SOURCE
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <search.h>
+
+#define NUM_FRAMES 10
+#define NUM_DEPTHS 64
+#define NUM_TEXTURES 256
+
+/*
+ * tree_image: Node of the reference tree, one heap allocation per queued image.
+ */
+typedef struct {
+    queued_image image;
+    int order;  // queue order, to keep equal keys distinct and stable
+} tree_image;
+
+static long tree_checksum;
+
+static int compare_images(void const* a, void const* b) {
+    tree_image const* x = a;
+    tree_image const* y = b;
+    if(x->image.key != y->image.key)
+        return (x->image.key < y->image.key) ? -1 : 1;
+    return x->order - y->order;
+}
+
+static void visit_image(void const* node, VISIT which, int level) {
+    if(which == postorder || which == leaf)
+        tree_checksum = tree_checksum * 31 + (*(tree_image * const*) node)->image.spr_id;
+}
+
+static void free_image(void *node) {
+    free(node);
+}
+
+static void run(int num_images) {
+    int *depths = malloc(sizeof(int) * num_images);
+    GLuint *textures = malloc(sizeof(GLuint) * num_images);
+    for(int i = 0; i < num_images; i++) {
+        depths[i] = rand() % NUM_DEPTHS;
+        textures[i] = 1 + rand() % NUM_TEXTURES;
+    }
+    printf("-- %d images\n", num_images);
+
+    double start = bench_now();
+    for(int f = 0; f < NUM_FRAMES; f++) {
+        void *root = NULL;
+        for(int i = 0; i < num_images; i++) {
+            tree_image *node = malloc(sizeof(tree_image));
+            node->image.key = ((uint64_t) ((uint32_t) depths[i] ^ 0x80000000u) << 32) | textures[i];
+            node->image.spr_id = i;
+            node->image.depth = depths[i];
+            node->image.texture = textures[i];
+            node->order = i;
+            tsearch(node, &root, compare_images);
+        }
+        tree_checksum = 0;
+        twalk(root, visit_image);
+        tdestroy(root, free_image);
+    }
+    bench_report("tree insert + walk", (long) num_images * NUM_FRAMES, bench_now() - start);
+    long expected = tree_checksum;
+
+    render_queue queue = make_render_queue(0);
+    start = bench_now();
+    for(int f = 0; f < NUM_FRAMES; f++) {
+        render_queue_clear(&queue);
+        for(int i = 0; i < num_images; i++)
+            render_queue_push(&queue, i, 0, 0, 0, depths[i], textures[i]);
+        render_queue_sort(&queue);
+        tree_checksum = 0;
+        for(int i = 0; i < queue.num_images; i++)
+            tree_checksum = tree_checksum * 31 + queue.images[i].spr_id;
+    }
+    bench_report("radix queue push + sort + walk", (long) num_images * NUM_FRAMES, bench_now() - start);
+    if(tree_checksum != expected)
+        fprintf(stderr, "Draw order mismatch between tree and render queue.\n");
+    printf("%40s %d draw batches\n", "", render_queue_num_batches(&queue));
+    render_queue_free(&queue);
+    free(depths);
+    free(textures);
+}
+
+int main() {
+    srand(1);
+    int sizes[] = { 10000, 50000, 100000, 200000 };
+    for(int i = 0; i < 4; i++)
+        run(sizes[i]);
+    return 0;
+}
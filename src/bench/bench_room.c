@@ -0,0 +1,142 @@
+/*
+ * File: bench_room.c
+ *
+ * Removes 10k entities in a single frame from a game of 40k entities over 8 rooms: searching every
+ * room for each removed entity, as was done before rooms were indexed, against a batch of REM_ENTITY
+ * commands dispatched on rooms whose entities were written in directly (so searched for once,
+ * together) and on rooms filled with add_room_entity (so found through the index).
+ * Checks that exactly the removed entities are gone from the rooms.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_ROOMS 8
+#define ENTS_PER_ROOM 5000
+#define NUM_ENTS (NUM_ROOMS * ENTS_PER_ROOM)
+#define NUM_REMOVED 10000
+#define NUM_FRAMES 5
+
+enum fill { FILL_WRITTEN, FILL_INDEXED };
+
+typedef struct {
+    t_game_data *data;
+    t_room rooms[NUM_ROOMS];
+    t_entity *ents;
+} bench_game;
+
+static void make_bench_game(bench_game *game, enum fill fill) {
+    game->data = malloc(sizeof(t_game_data));
+    *game->data = make_game_data(NULL);
+    game->ents = calloc(NUM_ENTS, sizeof(t_entity));
+    for(int r = 0; r < NUM_ROOMS; r++) {
+        game->rooms[r] = (t_room) { .entity_ids = malloc(sizeof(int) * ENTS_PER_ROOM) };
+        add_room(game->data, &game->rooms[r]);
+    }
+    for(int i = 0; i < NUM_ENTS; i++) {
+        t_room *room = &game->rooms[i % NUM_ROOMS];
+        add_entity(game->data, &game->ents[i]);
+        if(fill == FILL_INDEXED)
+            add_room_entity(game->data, room, game->ents[i].id);
+        else
+            room->entity_ids[room->num_entities++] = game->ents[i].id;
+    }
+}
+
+static void free_bench_game(bench_game *game) {
+    for(int r = 0; r < NUM_ROOMS; r++)
+        free(game->rooms[r].entity_ids);
+    free(game->ents);
+    gamedata_free(game->data);
+}
+
+/*
+ * rem_searching: Remove one entity by searching every room for it, keeping each room's order.
+ */
+static void rem_searching(t_game_data *data, int id) {
+    del_entity(data, id);
+    int *room_ids = get_room_ids(data);
+    for(int i = 0; i < data->num_rooms; i++) {
+        t_room *room = get_room(data, room_ids[i]);
+        for(int j = 0; j < room->num_entities; j++) {
+            if(room->entity_ids[j] == id) {
+                memmove(room->entity_ids + j, room->entity_ids + j + 1, sizeof(int) * (room->num_entities - j - 1));
+                room->num_entities--;
+                break;
+            }
+        }
+    }
+}
+
+static bool check_removed(bench_game *game, bool const* removed) {
+    int remaining = 0;
+    for(int r = 0; r < NUM_ROOMS; r++) {
+        for(int j = 0; j < game->rooms[r].num_entities; j++) {
+            if(removed[game->rooms[r].entity_ids[j]])
+                return false;
+        }
+        remaining += game->rooms[r].num_entities;
+    }
+    return remaining == NUM_ENTS - NUM_REMOVED && game->data->num_entities == NUM_ENTS - NUM_REMOVED;
+}
+
+static void run(char const* name, enum fill fill, bool batched) {
+    double total = 0.0;
+    bool correct = true;
+    int *ids = malloc(sizeof(int) * NUM_ENTS);
+    bool *removed = malloc(sizeof(bool) * (NUM_ENTS + NUM_ROOMS + 1));
+    t_update_command *commands = calloc(NUM_REMOVED, sizeof(t_update_command));
+    t_update_command **schedule = malloc(sizeof(t_update_command *) * NUM_REMOVED);
+    for(int f = 0; f < NUM_FRAMES; f++) {
+        bench_game game;
+        make_bench_game(&game, fill);
+        // a random NUM_REMOVED of the entities
+        for(int i = 0; i < NUM_ENTS; i++)
+            ids[i] = game.ents[i].id;
+        for(int i = 0; i < NUM_REMOVED; i++) {
+            int k = i + rand() % (NUM_ENTS - i);
+            int id = ids[k];
+            ids[k] = ids[i];
+            ids[i] = id;
+        }
+        memset(removed, 0, sizeof(bool) * (NUM_ENTS + NUM_ROOMS + 1));
+        for(int i = 0; i < NUM_REMOVED; i++) {
+            removed[ids[i]] = true;
+            commands[i].type = REM_ENTITY;
+            commands[i].data.rem_ent.ent_id = ids[i];
+            schedule[i] = &commands[i];
+        }
+
+        double start = bench_now();
+        if(batched) {
+            dispatch_commands(game.data, NULL, schedule, NUM_REMOVED);
+        } else {
+            for(int i = 0; i < NUM_REMOVED; i++)
+                rem_searching(game.data, ids[i]);
+        }
+        total += bench_now() - start;
+        correct = correct && check_removed(&game, removed);
+        free_bench_game(&game);
+        arena_reset(frame_arena_local());
+    }
+    char full_name[64];
+    snprintf(full_name, sizeof(full_name), "%s%s", name, correct ? "" : " (WRONG)");
+    bench_report(full_name, (long) NUM_REMOVED * NUM_FRAMES, total);
+    printf("%40s %8.3f ms per frame of %d removals\n", "", total / NUM_FRAMES * 1e3, NUM_REMOVED);
+    free(schedule);
+    free(commands);
+    free(removed);
+    free(ids);
+}
+
+int main() {
+    srand(1);
+    run("search every room per removal", FILL_WRITTEN, false);
+    run("batch, rooms written directly", FILL_WRITTEN, true);
+    run("batch, rooms indexed", FILL_INDEXED, true);
+    return 0;
+}
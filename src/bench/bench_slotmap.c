@@ -0,0 +1,85 @@
+/*
+ * File: bench_slotmap.c
+ *
+ * Compares the slotmap entity store against the hashtable for random lookups,
+ * iteration over all entities, and deletion, at 1k/10k/100k entities.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+
+#define LOOKUPS_PER_ELEM 16
+#define ITERATIONS 20
+
+static void run(int num_elems) {
+    t_entity *ents = malloc(sizeof(t_entity) * num_elems);
+    int *order = malloc(sizeof(int) * num_elems * LOOKUPS_PER_ELEM);
+    for(int i = 0; i < num_elems; i++) {
+        ents[i].id = i + 1;
+        ents[i].x = 1;
+    }
+    long num_lookups = (long) num_elems * LOOKUPS_PER_ELEM;
+    for(long i = 0; i < num_lookups; i++)
+        order[i] = 1 + rand() % num_elems;
+    long sum = 0;
+    printf("-- %d entities\n", num_elems);
+
+    hashtable table = make_hashtable(0);
+    slotmap map = make_slotmap(0);
+    for(int i = 0; i < num_elems; i++) {
+        hashtable_add(&table, &ents[i], ENTITY);
+        slotmap_add(&map, ents[i].id, &ents[i]);
+    }
+
+    double start = bench_now();
+    for(long i = 0; i < num_lookups; i++)
+        sum += ((t_entity *) hashtable_get(&table, order[i]))->x;
+    bench_report("hashtable lookup", num_lookups, bench_now() - start);
+    start = bench_now();
+    for(long i = 0; i < num_lookups; i++)
+        sum += ((t_entity *) slotmap_get(&map, order[i]))->x;
+    bench_report("slotmap lookup", num_lookups, bench_now() - start);
+
+    // iteration as done by the update loop: fetch ID list, then every entity
+    start = bench_now();
+    for(int it = 0; it < ITERATIONS; it++) {
+        int *ids = hashtable_get_ids(&table);
+        for(int i = 0; i < num_elems; i++)
+            sum += ((t_entity *) hashtable_get(&table, ids[i]))->x;
+        arena_reset(frame_arena_local());
+    }
+    bench_report("hashtable iterate (get_ids + get)", (long) num_elems * ITERATIONS, bench_now() - start);
+    start = bench_now();
+    for(int it = 0; it < ITERATIONS; it++) {
+        t_entity **elems = (t_entity **) slotmap_get_elems(&map);
+        for(int i = 0; i < map.num_entries; i++)
+            sum += elems[i]->x;
+    }
+    bench_report("slotmap iterate (dense view)", (long) num_elems * ITERATIONS, bench_now() - start);
+
+    start = bench_now();
+    for(int i = 0; i < num_elems; i++)
+        hashtable_del(&table, ents[i].id);
+    bench_report("hashtable delete", num_elems, bench_now() - start);
+    start = bench_now();
+    for(int i = 0; i < num_elems; i++)
+        slotmap_del(&map, ents[i].id);
+    bench_report("slotmap delete", num_elems, bench_now() - start);
+
+    printf("(checksum %ld)\n", sum);
+    hashtable_free(&table);
+    slotmap_free(&map);
+    free(order);
+    free(ents);
+}
+
+int main() {
+    srand(1);
+    int sizes[] = { 1000, 10000, 100000 };
+    for(int i = 0; i < 3; i++)
+        run(sizes[i]);
+    return 0;
+}
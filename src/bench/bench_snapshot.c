@@ -0,0 +1,84 @@
+/*
+ * File: bench_snapshot.c
+ *
+ * Measures how long the update loop spends publishing a snapshot for rooms of
+ * different sizes, with and without the render loop reading them concurrently.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define NUM_PUBLISHES 2000
+
+static atomic_bool reading;
+
+/*
+ * render_reader: Acquires snapshots as fast as it can, as a render loop with no vsync would.
+ */
+static void *render_reader(void *arg) {
+    t_game_data *data = arg;
+    long checksum = 0;
+    while(atomic_load_explicit(&reading, memory_order_relaxed)) {
+        game_snapshot const* snapshot = snapshot_acquire(&data->snapshots);
+        if(snapshot->num_entities > 0)
+            checksum += snapshot->entities[snapshot->num_entities - 1].x;
+    }
+    return (void *) checksum;
+}
+
+static void run(int num_ents, bool with_reader) {
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    t_room *room = calloc(1, sizeof(t_room));
+    room->entity_ids = malloc(sizeof(int) * num_ents);
+    t_entity *ents = calloc(num_ents, sizeof(t_entity));
+    for(int i = 0; i < num_ents; i++) {
+        ents[i].x = i;
+        add_entity(data, &ents[i]);
+        room->entity_ids[room->num_entities++] = ents[i].id;
+    }
+    add_room(data, room);
+    data->current_room_id = room->room_id;
+
+    pthread_t reader;
+    atomic_store(&reading, true);
+    if(with_reader)
+        pthread_create(&reader, NULL, render_reader, data);
+    double worst = 0.0;
+    double start = bench_now();
+    for(int i = 0; i < NUM_PUBLISHES; i++) {
+        double publish_start = bench_now();
+        publish_game_snapshot(data);
+        double latency = bench_now() - publish_start;
+        if(latency > worst)
+            worst = latency;
+    }
+    double total = bench_now() - start;
+    atomic_store(&reading, false);
+    if(with_reader)
+        pthread_join(reader, NULL);
+
+    char name[64];
+    snprintf(name, sizeof(name), "%d ents publish%s", num_ents, with_reader ? " (reader)" : "");
+    bench_report(name, NUM_PUBLISHES, total);
+    printf("%40s mean %8.2f us, worst %8.2f us\n", "", total * 1e6 / NUM_PUBLISHES, worst * 1e6);
+
+    free(ents);
+    free(room->entity_ids);
+    free(room);
+    gamedata_free(data);
+}
+
+int main() {
+    int sizes[] = { 1000, 10000, 100000 };
+    for(int i = 0; i < 3; i++) {
+        run(sizes[i], false);
+        run(sizes[i], true);
+    }
+    return 0;
+}
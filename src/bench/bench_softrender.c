@@ -0,0 +1,97 @@
+/*
+ * File: bench_softrender.c
+ *
+ * Measures headless rendering of 1k to 20k sprites at 640x480 with the software renderer,
+ * in sprites drawn per second and ms per frame, blending with SIMD and one pixel at a time.
+ * Pass a file path to also write the last frame drawn to it as a PPM image.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+
+#define SCR_WIDTH 640
+#define SCR_HEIGHT 480
+#define SPR_SIZE 32
+#define NUM_FRAMES 20
+
+/*
+ * make_ball: Make a sprite of an opaque disc with a soft edge and a transparent background,
+ * so frames blend opaque, transparent and partly transparent pixels like real sprites.
+ */
+static t_sprite *make_ball() {
+    t_sprite *sprite = make_sprite(1, SPR_SIZE, SPR_SIZE, calloc(1, sizeof(GLuint)));
+    uint32_t *pixels = malloc(sizeof(uint32_t) * SPR_SIZE * SPR_SIZE);
+    int r = SPR_SIZE / 2;
+    for(int y = 0; y < SPR_SIZE; y++) {
+        for(int x = 0; x < SPR_SIZE; x++) {
+            int d2 = (x - r) * (x - r) + (y - r) * (y - r);
+            uint32_t alpha = (d2 < (r - 3) * (r - 3)) ? 255 : (d2 < r * r) ? 255 * (r * r - d2) / (r * r) : 0;
+            pixels[y * SPR_SIZE + x] = (alpha << 24) | (uint32_t) (x * 8) << 16 | (uint32_t) (y * 8) << 8 | 0x80;
+        }
+    }
+    sprite_set_pixels(sprite, (uint32_t const* const*) &pixels);
+    free(pixels);
+    return sprite;
+}
+
+static void run(int num_ents, char const* ppm_path) {
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    data->scr_width = SCR_WIDTH;
+    data->scr_height = SCR_HEIGHT;
+    t_sprite *sprite = make_ball();
+    add_sprite(data, sprite);
+    t_room *room = calloc(1, sizeof(t_room));
+    room->entity_ids = malloc(sizeof(int) * num_ents);
+    t_entity *ents = calloc(num_ents, sizeof(t_entity));
+    for(int i = 0; i < num_ents; i++) {
+        // some hang over the edges of the screen, so are clipped
+        ents[i].x = rand() % (SCR_WIDTH + SPR_SIZE) - SPR_SIZE / 2;
+        ents[i].y = rand() % (SCR_HEIGHT + SPR_SIZE) - SPR_SIZE / 2;
+        ents[i].depth = rand() % 16;
+        ents[i].current_spr_id = sprite->spr_id;
+        add_entity(data, &ents[i]);
+        room->entity_ids[room->num_entities++] = ents[i].id;
+    }
+    add_room(data, room);
+    data->current_room_id = room->room_id;
+    software_renderer *renderer = make_software_renderer(0x202020);
+    set_renderer(data, &renderer->backend);
+    publish_game_snapshot(data);
+    game_snapshot const* snapshot = snapshot_acquire(&data->snapshots);
+    render_queue queue = make_render_queue(num_ents);
+
+    for(int simd = 1; simd >= 0; simd--) {
+        renderer->use_simd = simd;
+        render_frame(data, snapshot, &queue);   // warm up
+        double start = bench_now();
+        for(int f = 0; f < NUM_FRAMES; f++)
+            render_frame(data, snapshot, &queue);
+        double elapsed = bench_now() - start;
+        char name[64];
+        snprintf(name, sizeof(name), "%d sprites %s (sprites)", num_ents, simd ? "sse2" : "scalar");
+        bench_report(name, (long) renderer->frame_images * NUM_FRAMES, elapsed);
+        printf("%40s %8.3f ms/frame, %ld Mpixels/s\n", "", elapsed * 1e3 / NUM_FRAMES,
+               (long) (renderer->frame_pixels * NUM_FRAMES / elapsed * 1e-6));
+    }
+    if(ppm_path != NULL && !software_renderer_write_ppm(renderer, ppm_path))
+        printf("could not write %s\n", ppm_path);
+
+    render_queue_free(&queue);
+    free(ents);
+    free(room->entity_ids);
+    free(room);
+    gamedata_free(data);
+    free_sprite(sprite);
+}
+
+int main(int argc, char *argv[]) {
+    srand(1);
+    int sizes[] = { 1000, 5000, 20000 };
+    for(int i = 0; i < 3; i++)
+        run(sizes[i], (argc > 1 && i == 0) ? argv[1] : NULL);
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * File: bench_soundcache.c
+ *
+ * Measures the latency of playing short sound effects: streamed from their WAV file on every
+ * play, decoded into the sound cache on their first play, mapped from the cache file written
+ * by an earlier run on their first play, and played again once cached. Only the play itself is
+ * timed, with the mixer mixing offline in between. Streamed plays only decode their first blocks
+ * before returning, but decode the whole file again on the decode thread every time they play.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NUM_SOUNDS 100
+#define SOUND_FRAMES (MIXER_SAMPLE_RATE / 2)
+#define CACHE_BUDGET (64 << 20)
+
+static void write_le(FILE *file, int num_bytes, uint32_t value) {
+    for(int i = 0; i < num_bytes; i++)
+        fputc((value >> (8 * i)) & 0xFF, file);
+}
+
+/*
+ * write_wav: Write a 16 bit stereo WAV file of noise, so decoding converts every sample.
+ */
+static void write_wav(char const* path) {
+    FILE *file = fopen(path, "wb");
+    uint32_t data_size = SOUND_FRAMES * 4;
+    fwrite("RIFF", 1, 4, file);
+    write_le(file, 4, 36 + data_size);
+    fwrite("WAVEfmt ", 1, 8, file);
+    write_le(file, 4, 16);
+    write_le(file, 2, WAV_PCM);
+    write_le(file, 2, 2);
+    write_le(file, 4, MIXER_SAMPLE_RATE);
+    write_le(file, 4, MIXER_SAMPLE_RATE * 4);
+    write_le(file, 2, 4);
+    write_le(file, 2, 16);
+    fwrite("data", 1, 4, file);
+    write_le(file, 4, data_size);
+    for(long i = 0; i < 2 * SOUND_FRAMES; i++)
+        write_le(file, 2, (uint16_t) rand());
+    fclose(file);
+}
+
+/*
+ * stop_all: Stop every sound, and wait until the decode thread has freed every stream.
+ */
+static void stop_all(audio_mixer *mixer, t_sound *sounds, sound_cache *cache) {
+    float out[2];
+    for(int i = 0; i < NUM_SOUNDS; i++)
+        mixer_end(mixer, sounds[i].snd_id);
+    mixer_mix(mixer, out, 1);
+    if(cache != NULL)
+        sound_cache_collect(cache, mixer);
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 100000 };
+    for(int i = 0; i < MIXER_MAX_STREAMS; i++) {
+        while(atomic_load(&mixer->streams[i].state) != STREAM_FREE)
+            nanosleep(&pause, NULL);
+    }
+}
+
+/*
+ * time_plays: Play every sound once, one stream's worth at a time, timing only the plays.
+ */
+static void time_plays(audio_mixer *mixer, t_sound *sounds, sound_cache *cache, char const* name) {
+    double elapsed = 0;
+    for(int i = 0; i < NUM_SOUNDS; i += MIXER_MAX_STREAMS) {
+        double start = bench_now();
+        for(int k = i; k < i + MIXER_MAX_STREAMS && k < NUM_SOUNDS; k++) {
+            if(cache != NULL)
+                play_cached_sound(mixer, cache, &sounds[k]);
+            else
+                play_sound(mixer, &sounds[k]);
+        }
+        elapsed += bench_now() - start;
+        stop_all(mixer, sounds, cache);
+    }
+    bench_report(name, NUM_SOUNDS, elapsed);
+    printf("%40s %8.1f us/play", "", elapsed * 1e6 / NUM_SOUNDS);
+    if(cache != NULL)
+        printf(", %ld hits, %ld misses, %ld from file, %zu KB resident", cache->hits, cache->misses,
+               cache->file_loads, cache->resident_bytes / 1024);
+    printf("\n");
+}
+
+int main() {
+    srand(1);
+    t_sound *sounds = calloc(NUM_SOUNDS, sizeof(t_sound));
+    for(int i = 0; i < NUM_SOUNDS; i++) {
+        sounds[i].snd_id = i + 1;
+        sounds[i].snd_path = malloc(64);
+        sprintf(sounds[i].snd_path, "/tmp/cnd_bench_soundcache_%d_%d.wav", (int) getpid(), i);
+        write_wav(sounds[i].snd_path);
+    }
+    audio_mixer *mixer = make_mixer();
+
+    time_plays(mixer, sounds, NULL, "streamed every play (plays)");
+    sound_cache *cache = make_sound_cache(CACHE_BUDGET, true);
+    time_plays(mixer, sounds, cache, "first play, decoded (plays)");
+    time_plays(mixer, sounds, cache, "cached play (plays)");
+    sound_cache_free(cache);
+    // as if a later run, with the cache files written by this one
+    cache = make_sound_cache(CACHE_BUDGET, true);
+    time_plays(mixer, sounds, cache, "first play, cache file (plays)");
+    sound_cache_free(cache);
+
+    mixer_free(mixer);
+    char name[80];
+    for(int i = 0; i < NUM_SOUNDS; i++) {
+        snprintf(name, sizeof(name), "%s%s", sounds[i].snd_path, SOUND_CACHE_SUFFIX);
+        remove(name);
+        remove(sounds[i].snd_path);
+        free(sounds[i].snd_path);
+    }
+    free(sounds);
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * File: bench_spatialgrid.c
+ *
+ * Measures culling a large room down to the entities on screen, with a spatial grid
+ * against testing every entity in the room, as the visible fraction of the room grows.
+ * Also measures the cost of keeping the grid up to date as entities move.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+
+#define NUM_ENTS 100000
+#define ROOM_WIDTH 8000
+#define ROOM_HEIGHT 6000
+#define CELL_SIZE 64
+#define NUM_FRAMES 200
+
+/*
+ * naive_cull: Test every entity of a room against the camera, as loop_render would without a grid.
+ */
+static int naive_cull(t_game_data *data, t_room *room, int *visible) {
+    int num_visible = 0;
+    for(int i = 0; i < room->num_entities; i++) {
+        t_entity *entity = get_entity(data, room->entity_ids[i]);
+        if(entity->x >= data->camera_x && entity->x < data->camera_x + data->scr_width
+                && entity->y >= data->camera_y && entity->y < data->camera_y + data->scr_height)
+            visible[num_visible++] = entity->id;
+    }
+    return num_visible;
+}
+
+int main() {
+    srand(1);
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    t_room *room = calloc(1, sizeof(t_room));
+    room->width = ROOM_WIDTH;
+    room->height = ROOM_HEIGHT;
+    room->entity_ids = malloc(sizeof(int) * NUM_ENTS);
+    t_entity *ents = calloc(NUM_ENTS, sizeof(t_entity));
+    for(int i = 0; i < NUM_ENTS; i++) {
+        ents[i].x = rand() % ROOM_WIDTH;
+        ents[i].y = rand() % ROOM_HEIGHT;
+        add_entity(data, &ents[i]);
+        room->entity_ids[room->num_entities++] = ents[i].id;
+    }
+    add_room(data, room);
+    data->current_room_id = room->room_id;
+    int *visible = malloc(sizeof(int) * NUM_ENTS);
+    printf("%d entities in a %dx%d room\n", NUM_ENTS, ROOM_WIDTH, ROOM_HEIGHT);
+
+    // screen sizes showing 1%, 4% and 16% of the room
+    double widths[] = { ROOM_WIDTH / 10.0, ROOM_WIDTH / 5.0, ROOM_WIDTH / 2.5 };
+    for(int s = 0; s < 3; s++) {
+        data->scr_width = (int) widths[s];
+        data->scr_height = (int) (widths[s] * ROOM_HEIGHT / ROOM_WIDTH);
+        long num_found = 0;
+        double start = bench_now();
+        for(int f = 0; f < NUM_FRAMES; f++) {
+            data->camera_x = rand() % (ROOM_WIDTH - data->scr_width);
+            data->camera_y = rand() % (ROOM_HEIGHT - data->scr_height);
+            num_found += naive_cull(data, room, visible);
+        }
+        printf("-- screen %dx%d, %.1f visible entities per frame\n",
+               data->scr_width, data->scr_height, (double) num_found / NUM_FRAMES);
+        bench_report("naive cull", NUM_FRAMES, bench_now() - start);
+
+        enable_room_grid(data, room, CELL_SIZE);
+        start = bench_now();
+        for(int f = 0; f < NUM_FRAMES; f++) {
+            data->camera_x = rand() % (ROOM_WIDTH - data->scr_width);
+            data->camera_y = rand() % (ROOM_HEIGHT - data->scr_height);
+            publish_game_snapshot(data);
+            arena_reset(frame_arena_local());
+        }
+        bench_report("grid culled snapshot publish", NUM_FRAMES, bench_now() - start);
+        spatial_grid_free(room->grid);
+        room->grid = NULL;
+    }
+
+    enable_room_grid(data, room, CELL_SIZE);
+    double start = bench_now();
+    for(int f = 0; f < 10; f++) {
+        for(int i = 0; i < NUM_ENTS; i++) {
+            struct alter_entity_command move = {
+                    .target_id = ents[i].id, .modified_attr = X, .int_value = ents[i].x + rand() % 9 - 4
+            };
+            cmd_alter_entity(data, move);
+        }
+    }
+    bench_report("moves kept in grid", (long) NUM_ENTS * 10, bench_now() - start);
+    spatial_grid_free(room->grid);
+    room->grid = NULL;
+    start = bench_now();
+    for(int f = 0; f < 10; f++) {
+        for(int i = 0; i < NUM_ENTS; i++) {
+            struct alter_entity_command move = {
+                    .target_id = ents[i].id, .modified_attr = X, .int_value = ents[i].x + rand() % 9 - 4
+            };
+            cmd_alter_entity(data, move);
+        }
+    }
+    bench_report("moves without grid", (long) NUM_ENTS * 10, bench_now() - start);
+
+    free(visible);
+    free(ents);
+    free(room->entity_ids);
+    free(room);
+    gamedata_free(data);
+    return 0;
+}
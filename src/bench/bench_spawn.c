@@ -0,0 +1,97 @@
+/*
+ * File: bench_spawn.c
+ *
+ * Spawns 10k identical bullets into a room per frame for 20 frames: as one ADD_ENTITY command
+ * each, with the entity and its ent_data allocated by the entity issuing it, against SPAWN_BATCH
+ * commands of an archetype, from one emitter and from 100 emitters of 100 bullets each.
+ * Commands are pushed, scheduled and dispatched as the update loop does.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SPAWNS_PER_FRAME 10000
+#define NUM_FRAMES 20
+
+typedef struct {
+    int vx;
+    int vy;
+    int damage;
+    int lifetime;
+} bullet_data;
+
+static t_update_command_container bullet_step(t_game_data const* data, t_entity const* entity) {
+    return make_update_command_container();
+}
+
+static ent_func_vtable const bullet_handlers = { .step = bullet_step };
+static bullet_data const bullet_init = { .vx = 0, .vy = -4, .damage = 1, .lifetime = 120 };
+
+static void run(char const* name, int batch_size) {
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    t_room room = {0};
+    add_room(data, &room);
+    t_archetype bullet = {
+            .event_handlers = bullet_handlers, .spr_period = -1,
+            .ent_data_size = sizeof(bullet_data), .ent_data_init = &bullet_init
+    };
+    int arch_id = register_archetype(data, &bullet);
+    t_entity **added = malloc(sizeof(t_entity *) * SPAWNS_PER_FRAME * NUM_FRAMES);
+    int num_added = 0;
+    t_update_command **schedule = malloc(sizeof(t_update_command *) * SPAWNS_PER_FRAME);
+
+    double total = 0.0;
+    for(int f = 0; f < NUM_FRAMES; f++) {
+        double start = bench_now();
+        t_update_command_container commands = make_update_command_container();
+        if(batch_size == 0) {
+            for(int i = 0; i < SPAWNS_PER_FRAME; i++) {
+                t_entity *entity = malloc(sizeof(t_entity));
+                bullet_data *ent_data = malloc(sizeof(bullet_data));
+                *ent_data = bullet_init;
+                *entity = (t_entity) { .event_handlers = bullet_handlers, .spr_period = -1, .x = i, .ent_data = ent_data };
+                added[num_added++] = entity;
+                t_update_command *command = push_command(&commands, ADD_ENTITY);
+                command->data.add_ent = (struct add_entity_command) { .new_entity = entity, .room_id = room.room_id };
+            }
+        } else {
+            for(int i = 0; i < SPAWNS_PER_FRAME; i += batch_size) {
+                t_update_command *command = push_command(&commands, SPAWN_BATCH);
+                command->data.spawn_batch = (struct spawn_batch_command) {
+                        .arch_id = arch_id, .count = batch_size, .room_id = room.room_id, .x = i, .dx = 1
+                };
+            }
+        }
+        int num_scheduled = optimise_commands(data, &commands, schedule);
+        dispatch_commands(data, NULL, schedule, num_scheduled);
+        free_update_command_container(&commands);
+        arena_reset(frame_arena_local());
+        total += bench_now() - start;
+    }
+    char full_name[64];
+    bool correct = data->num_entities == SPAWNS_PER_FRAME * NUM_FRAMES && room.num_entities == data->num_entities;
+    snprintf(full_name, sizeof(full_name), "%s%s", name, correct ? "" : " (WRONG)");
+    bench_report(full_name, (long) SPAWNS_PER_FRAME * NUM_FRAMES, total);
+    printf("%40s %8.3f ms per frame of %d spawns\n", "", total / NUM_FRAMES * 1e3, SPAWNS_PER_FRAME);
+
+    for(int i = 0; i < num_added; i++) {
+        free(added[i]->ent_data);
+        free(added[i]);
+    }
+    free(added);
+    free(schedule);
+    free(room.entity_ids);
+    gamedata_free(data);
+}
+
+int main() {
+    run("ADD_ENTITY per bullet", 0);
+    run("SPAWN_BATCH, 100 of 100 bullets", 100);
+    run("SPAWN_BATCH, 1 of 10000 bullets", SPAWNS_PER_FRAME);
+    return 0;
+}
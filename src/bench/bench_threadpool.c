@@ -0,0 +1,69 @@
+/*
+ * File: bench_threadpool.c
+ *
+ * Measures update phase frame time for a room of entities with a CPU-heavy
+ * step handler, as the number of update workers goes from 1 to all cores.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+
+#define NUM_ENTS 20000
+#define NUM_FRAMES 20
+#define STEP_WORK 200
+
+/*
+ * busy_step: Step handler doing some arithmetic, then moving the entity one pixel right.
+ */
+static t_update_command_container busy_step(t_game_data const* data, t_entity const* entity) {
+    double acc = entity->x;
+    for(int i = 0; i < STEP_WORK; i++)
+        acc = sin(acc) + 1.0;
+    t_update_command_container commands = make_update_command_container();
+    t_update_command *command = push_command(&commands, ALTER_ENTITY);
+    command->data.alter_ent.target_id = entity->id;
+    command->data.alter_ent.modified_attr = X;
+    command->data.alter_ent.int_value = entity->x + (acc > 0.0);
+    return commands;
+}
+
+int main() {
+    t_game_data data = make_game_data(NULL);
+    t_room *room = calloc(1, sizeof(t_room));
+    room->entity_ids = malloc(sizeof(int) * NUM_ENTS);
+    for(int i = 0; i < NUM_ENTS; i++) {
+        t_entity *ent = calloc(1, sizeof(t_entity));
+        ent->spr_period = -1;
+        ent->event_handlers.step = busy_step;
+        add_entity(&data, ent);
+        room->entity_ids[room->num_entities++] = ent->id;
+    }
+    add_room(&data, room);
+    data.current_room_id = room->room_id;
+
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    double base_time = 0.0;
+    printf("%d entities, %d frames\n", NUM_ENTS, NUM_FRAMES);
+    for(int workers = 1; workers <= num_cpus; workers *= 2) {
+        threadpool *pool = make_threadpool(workers);
+        double start = bench_now();
+        for(int f = 0; f < NUM_FRAMES; f++) {
+            t_update_command_container commands = update_entities(&data, pool);
+            free_update_command_container(&commands);
+            arena_reset(frame_arena_local());
+        }
+        double frame_ms = (bench_now() - start) * 1e3 / NUM_FRAMES;
+        if(workers == 1)
+            base_time = frame_ms;
+        printf("%3d workers: %8.3f ms/frame  (speedup %.2fx)\n", workers, frame_ms, base_time / frame_ms);
+        threadpool_free(pool);
+        if(workers * 2 > num_cpus && workers != num_cpus)
+            workers = (int) num_cpus / 2;   // always finish on all cores
+    }
+    return 0;
+}
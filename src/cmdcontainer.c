@@ -0,0 +1,182 @@
+/*
+ * File: cmdcontainer.c
+ *
+ * Contains all methods for update command containers.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnoodle.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdatomic.h>
+
+// Size of each command's part of the update_command data union, indexed by command_type.
+static const size_t command_data_sizes[] = {
+        [ALTER_ENTITY] = sizeof(struct alter_entity_command),
+        [ADD_ENTITY] = sizeof(struct add_entity_command),
+        [REM_ENTITY] = sizeof(struct rem_entity_command),
+        [ALTER_ROOM] = sizeof(struct alter_room_command),
+        [NEXT_ROOM] = sizeof(struct next_room_command),
+        [PLAY_SND] = sizeof(struct play_sound_command),
+        [PAUSE_SND] = sizeof(struct pause_sound_command),
+        [END_SND] = sizeof(struct end_sound_command),
+        [QUIT] = sizeof(struct quit_command),
+        [SPAWN_BATCH] = sizeof(struct spawn_batch_command)
+};
+
+static _Thread_local struct command_segment_pool *local_pool = NULL;
+static atomic_long num_segments_allocated = 0;
+
+/*
+ * take_segment: Private method to take an empty segment from the calling thread's pool.
+ */
+static struct command_segment *take_segment() {
+    if(local_pool == NULL) {
+        // never freed, as other threads may still hold its segments when this thread exits
+        local_pool = calloc(1, sizeof(struct command_segment_pool));
+        if(local_pool == NULL) {
+            perror("Could not allocate command segment pool.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if(local_pool->free_segments == NULL)
+        local_pool->free_segments = atomic_exchange(&local_pool->returned, NULL);
+    struct command_segment *segment = local_pool->free_segments;
+    if(segment != NULL) {
+        local_pool->free_segments = segment->next;
+    } else {
+        segment = malloc(sizeof(struct command_segment));
+        if(segment == NULL) {
+            perror("Could not allocate command segment.");
+            exit(EXIT_FAILURE);
+        }
+        segment->owner = local_pool;
+        atomic_fetch_add_explicit(&num_segments_allocated, 1, memory_order_relaxed);
+        note_heap_allocation();
+    }
+    segment->next = NULL;
+    segment->used = 0;
+    return segment;
+}
+
+/*
+ * give_segment: Private method to give a segment back to the pool of the thread that took it.
+ */
+static void give_segment(struct command_segment *segment) {
+    struct command_segment_pool *owner = segment->owner;
+    if(owner == local_pool) {
+        segment->next = owner->free_segments;
+        owner->free_segments = segment;
+        return;
+    }
+    segment->next = atomic_load_explicit(&owner->returned, memory_order_relaxed);
+    while(!atomic_compare_exchange_weak(&owner->returned, &segment->next, segment));
+}
+
+/*
+ * make_update_command_container: Create an empty container.
+ */
+t_update_command_container make_update_command_container() {
+    t_update_command_container container;
+    container.num_commands = 0;
+    container.first = NULL;
+    container.last = NULL;
+    return container;
+}
+
+/*
+ * push_command: Append a new zeroed command of a type to the end of a container.
+ * Returns the command, with size and type set, for the caller to fill in its data.
+ */
+t_update_command *push_command(t_update_command_container *container, enum command_type type) {
+    size_t size = offsetof(t_update_command, data) + command_data_sizes[type];
+    size = (size + 7) & ~(size_t) 7;    // keep every record 8 byte aligned
+    if(container->last == NULL || container->last->used + size > COMMAND_SEGMENT_SIZE) {
+        struct command_segment *segment = take_segment();
+        if(container->last == NULL)
+            container->first = segment;
+        else
+            container->last->next = segment;
+        container->last = segment;
+    }
+    t_update_command *command = (t_update_command *) (container->last->data + container->last->used);
+    memset(command, 0, size);
+    command->size = (unsigned short) size;
+    command->type = (unsigned short) type;
+    container->last->used += (int) size;
+    container->num_commands++;
+    return command;
+}
+
+/*
+ * iter_commands: Get an iterator at the first command of a container.
+ */
+command_iter iter_commands(t_update_command_container const* container) {
+    command_iter iter = { .segment = container->first, .offset = 0 };
+    return iter;
+}
+
+/*
+ * next_command: Get the command at an iterator and move it along, or return NULL if none are left.
+ */
+t_update_command *next_command(command_iter *iter) {
+    while(iter->segment != NULL && iter->offset >= iter->segment->used) {
+        iter->segment = iter->segment->next;
+        iter->offset = 0;
+    }
+    if(iter->segment == NULL)
+        return NULL;
+    t_update_command *command = (t_update_command *) (iter->segment->data + iter->offset);
+    iter->offset += command->size;
+    return command;
+}
+
+/*
+ * append_container: Move all commands of 'src' onto the end of 'dest' in constant time.
+ * 'src' is left empty, and pointers to its commands are no longer valid.
+ */
+void append_container(t_update_command_container *dest, t_update_command_container *src) {
+    if(src->first == NULL)
+        return;
+    if(src->first == src->last && dest->last != NULL
+            && dest->last->used + src->first->used <= COMMAND_SEGMENT_SIZE) {
+        // most handlers return a few commands: copy them rather than chaining a mostly empty segment
+        memcpy(dest->last->data + dest->last->used, src->first->data, src->first->used);
+        dest->last->used += src->first->used;
+        dest->num_commands += src->num_commands;
+        give_segment(src->first);
+        *src = make_update_command_container();
+        return;
+    }
+    if(dest->last == NULL)
+        dest->first = src->first;
+    else
+        dest->last->next = src->first;
+    dest->last = src->last;
+    dest->num_commands += src->num_commands;
+    *src = make_update_command_container();
+}
+
+/*
+ * free_update_command_container: Give all segments of a container back to their pools, leaving it empty.
+ * Called once per frame on the merged container, after all its commands are dispatched.
+ */
+void free_update_command_container(t_update_command_container *container) {
+    struct command_segment *segment = container->first;
+    while(segment != NULL) {
+        struct command_segment *next = segment->next;
+        give_segment(segment);
+        segment = next;
+    }
+    *container = make_update_command_container();
+}
+
+/*
+ * command_segments_allocated: Get number of segments ever allocated from the heap, by all threads.
+ */
+long command_segments_allocated() {
+    return atomic_load_explicit(&num_segments_allocated, memory_order_relaxed);
+}
@@ -0,0 +1,159 @@
+/*
+ * File: cmdoptimiser.c
+ *
+ * Scheduling and elimination of update commands before they are dispatched.
+ *
+ * Commands are put into phases, so all additions happen before alterations,
+ * which happen before removals, and quitting happens last. Commands with no
+ * effect are dropped: alterations of an entity removed in the same update, repeated removals,
+ * all but the last alteration of each attribute of an entity, repeated
+ * PLAY_SND/END_SND of one sound, and PLAY_SND of a sound ended later on.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnoodle.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Flags in command_marks, set for an ID when a later command makes earlier ones redundant
+#define MARK_REMOVED (1u << 0)
+#define MARK_SND_PLAY (1u << 1)
+#define MARK_SND_END (1u << 2)
+#define MARK_ALTER(attr) (1u << (3 + (attr)))
+
+#define NUM_PHASES 7
+
+/*
+ * command_phase: Private method to get the phase a command is dispatched in.
+ */
+static int command_phase(t_update_command const* command) {
+    switch(command->type) {
+        case ADD_ENTITY: case SPAWN_BATCH: return 0;
+        case ALTER_ENTITY: return 1;    // kept together, so they are dispatched in parallel
+        case ALTER_ROOM: return 2;
+        case PLAY_SND: case PAUSE_SND: case END_SND: return 3;
+        case REM_ENTITY: return 4;
+        case NEXT_ROOM: return 5;
+        case QUIT: return 6;
+        default: return 3;
+    }
+}
+
+/*
+ * get_marks: Private method to get the marks for an ID in the current frame.
+ */
+static struct command_marks *get_marks(struct command_optimiser *optimiser, int id) {
+    if(id < 0 || id >= optimiser->num_marks)
+        return NULL;
+    struct command_marks *marks = &optimiser->marks[id];
+    if(marks->frame != optimiser->frame) {
+        marks->frame = optimiser->frame;
+        marks->flags = 0;
+    }
+    return marks;
+}
+
+/*
+ * test_and_mark: Private method to set a flag for an ID, returning whether any of 'test' flags were set.
+ */
+static bool test_and_mark(struct command_optimiser *optimiser, int id, unsigned test, unsigned mark) {
+    struct command_marks *marks = get_marks(optimiser, id);
+    if(marks == NULL)
+        return false;
+    bool was_set = (marks->flags & test) != 0;
+    marks->flags |= mark;
+    return was_set;
+}
+
+/*
+ * is_redundant: Private method deciding whether a command is made redundant by later ones.
+ * Commands must be given in reverse order of submission, after all removals have been marked.
+ */
+static bool is_redundant(struct command_optimiser *optimiser, t_update_command const* command) {
+    switch(command->type) {
+        case ALTER_ENTITY: {
+            unsigned alter = MARK_ALTER(command->data.alter_ent.modified_attr);
+            return test_and_mark(optimiser, command->data.alter_ent.target_id, MARK_REMOVED | alter, alter);
+        }
+        case PLAY_SND:
+            return test_and_mark(optimiser, command->data.play_snd.sound_id,
+                                 MARK_SND_PLAY | MARK_SND_END, MARK_SND_PLAY);
+        case END_SND:
+            return test_and_mark(optimiser, command->data.end_snd.sound_id, MARK_SND_END, MARK_SND_END);
+        default:
+            return false;
+    }
+}
+
+/*
+ * optimise_commands: Schedule the commands of a container into phases, leaving out those with no effect.
+ * Commands keep their submission order within each phase. The container itself is left untouched.
+ * Counts are recorded in data->optimiser.
+ *
+ * schedule (t_update_command **): Filled with the commands to dispatch, in order; must have
+ *      room for all commands in the container.
+ *
+ * Returns (int): Number of commands in schedule.
+ */
+int optimise_commands(t_game_data *data, t_update_command_container *container, t_update_command **schedule) {
+    struct command_optimiser *optimiser = &data->optimiser;
+    int num_commands = container->num_commands;
+    optimiser->frame++;
+    optimiser->frame_submitted = num_commands;
+    optimiser->frame_eliminated = 0;
+    optimiser->total_submitted += num_commands;
+    if(num_commands == 0)
+        return 0;
+    if(optimiser->num_marks <= data->max_id) {
+        int num_marks = data->max_id + 1;
+        struct command_marks *marks = realloc(optimiser->marks, sizeof(struct command_marks) * num_marks);
+        if(marks == NULL) {
+            perror("Could not allocate command marks.");
+            exit(EXIT_FAILURE);
+        }
+        for(int i = optimiser->num_marks; i < num_marks; i++)
+            marks[i].frame = 0;
+        optimiser->marks = marks;
+        optimiser->num_marks = num_marks;
+        note_heap_allocation();
+    }
+
+    // commands are variable size, so collect pointers to walk them backwards
+    t_update_command **commands = frame_alloc(sizeof(t_update_command *) * num_commands);
+    bool *redundant = frame_alloc(sizeof(bool) * num_commands);
+    memset(redundant, 0, sizeof(bool) * num_commands);
+    command_iter iter = iter_commands(container);
+    for(int i = 0; i < num_commands; i++)
+        commands[i] = next_command(&iter);
+
+    // removals are dispatched after all alterations, so mark every removed entity first
+    for(int i = 0; i < num_commands; i++) {
+        if(commands[i]->type == REM_ENTITY)
+            redundant[i] = test_and_mark(optimiser, commands[i]->data.rem_ent.ent_id, MARK_REMOVED, MARK_REMOVED);
+    }
+    // then walk backwards, so each command is checked against everything submitted after it
+    int phase_starts[NUM_PHASES + 1] = { 0 };
+    int num_eliminated = 0;
+    for(int i = num_commands - 1; i >= 0; i--) {
+        if(redundant[i] || is_redundant(optimiser, commands[i])) {
+            redundant[i] = true;
+            num_eliminated++;
+        } else {
+            phase_starts[command_phase(commands[i]) + 1]++;
+        }
+    }
+
+    // stable counting sort of surviving commands by phase
+    for(int i = 0; i < NUM_PHASES; i++)
+        phase_starts[i + 1] += phase_starts[i];
+    for(int i = 0; i < num_commands; i++) {
+        if(!redundant[i])
+            schedule[phase_starts[command_phase(commands[i])]++] = commands[i];
+    }
+
+    optimiser->frame_eliminated = num_eliminated;
+    optimiser->total_eliminated += num_eliminated;
+    return num_commands - num_eliminated;
+}
@@ -0,0 +1,164 @@
+/*
+ * File: cnd_archetype.c
+ *
+ * Contains all source code for entity archetypes and spawning entities from them in batches.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnoodle.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+/*
+ * make_archetype_registry: Create an empty archetype registry.
+ */
+archetype_registry make_archetype_registry() {
+    archetype_registry registry;
+    registry.num_archetypes = 0;
+    registry.archetype_capacity = 0;
+    registry.archetypes = NULL;
+    registry.num_blocks = 0;
+    registry.block_capacity = 0;
+    registry.blocks = NULL;
+    return registry;
+}
+
+/*
+ * register_archetype: Add an archetype to a game, so entities can be spawned from it.
+ *
+ * archetype (t_archetype const*): Archetype to copy into the registry; ent_data_init, if set, is
+ *      not copied, so must outlive the game data.
+ *
+ * Returns (int): ID of the archetype, for SPAWN_BATCH commands.
+ */
+int register_archetype(t_game_data *data, t_archetype const* archetype) {
+    archetype_registry *registry = &data->archetypes;
+    if(registry->num_archetypes == registry->archetype_capacity) {
+        registry->archetype_capacity = (registry->archetype_capacity > 0) ? registry->archetype_capacity * 2 : 8;
+        registry->archetypes = realloc(registry->archetypes, sizeof(t_archetype) * registry->archetype_capacity);
+        if(registry->archetypes == NULL) {
+            perror("Could not allocate archetypes.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    registry->archetypes[registry->num_archetypes] = *archetype;
+    return registry->num_archetypes++;
+}
+
+/*
+ * get_archetype: Get the archetype with an ID, or NULL if there is none.
+ */
+t_archetype *get_archetype(t_game_data *data, int arch_id) {
+    if(arch_id < 0 || arch_id >= data->archetypes.num_archetypes)
+        return NULL;
+    return &data->archetypes.archetypes[arch_id];
+}
+
+/*
+ * add_block: Private method to record a spawned block, which always has the highest IDs so far.
+ */
+static void add_block(archetype_registry *registry, int first_id, int count) {
+    if(registry->num_blocks == registry->block_capacity) {
+        registry->block_capacity = (registry->block_capacity > 0) ? registry->block_capacity * 2 : 8;
+        registry->blocks = realloc(registry->blocks, sizeof(spawn_block) * registry->block_capacity);
+        if(registry->blocks == NULL) {
+            perror("Could not allocate spawn blocks.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    registry->blocks[registry->num_blocks++] = (spawn_block) {
+            .first_id = first_id, .count = count, .num_live = count
+    };
+}
+
+/*
+ * spawn_entities: Spawn a batch of entities from an archetype, as the SPAWN_BATCH dispatcher does.
+ * Every entity is taken from the entity pools with its ent_data inline where it fits (see
+ * make_entity_with_data), given the next consecutive IDs, added to the entity store in one go,
+ * and added to the room together. The game data owns the entities, freeing each once removed,
+ * so they must not be freed with free_entity.
+ *
+ * Returns (int): ID of the first entity, the rest following in order, or 0 if nothing was spawned.
+ */
+int spawn_entities(t_game_data *data, struct spawn_batch_command const* cmd) {
+    t_archetype const* archetype = get_archetype(data, cmd->arch_id);
+    if(archetype == NULL || cmd->count <= 0)
+        return 0;
+    int count = cmd->count;
+    t_entity **entities = frame_alloc(sizeof(t_entity *) * count);
+    int first_id = data->max_id + 1;
+    data->max_id += count;
+    for(int i = 0; i < count; i++) {
+        t_entity *entity = make_entity_with_data(archetype->spr_id, cmd->x + i * cmd->dx, cmd->y + i * cmd->dy,
+                                                 archetype->ent_data_size);
+        entity->id = first_id + i;
+        entity->event_handlers = archetype->event_handlers;
+        entity->spr_period = archetype->spr_period;
+        entity->depth = archetype->depth;
+        if(archetype->ent_data_init != NULL)
+            memcpy(entity->ent_data, archetype->ent_data_init, archetype->ent_data_size);
+        entities[i] = entity;
+    }
+
+    slotmap_add_range(&data->entities, first_id, count, (void **) entities);
+    data->num_entities += count;
+    if(data->hot_entities != NULL) {
+        t_sprite const* sprite = get_sprite(data, archetype->spr_id);
+        int num_imgs = (sprite != NULL) ? sprite->num_imgs : 0;
+        for(int i = 0; i < count; i++) {
+            entity_soa_push(data->hot_entities, entities[i]);
+            data->hot_entities->spr_num_imgs[data->hot_entities->num_entries - 1] = num_imgs;
+        }
+    }
+    t_room *room = get_room(data, cmd->room_id);
+    if(room != NULL)
+        add_room_entity_range(data, room, first_id, count);
+    add_block(&data->archetypes, first_id, count);
+    return first_id;
+}
+
+/*
+ * release_spawned_entity: Note that an entity has been removed, forgetting its block if it was the block's last.
+ *
+ * Returns (bool): true if the entity was spawned, so belongs to the game data and must be freed.
+ */
+bool release_spawned_entity(archetype_registry *registry, int id) {
+    // find the last block starting at or before the ID
+    int low = 0, high = registry->num_blocks;
+    while(low < high) {
+        int mid = (low + high) / 2;
+        if(registry->blocks[mid].first_id <= id)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if(low == 0)
+        return false;
+    spawn_block *block = &registry->blocks[low - 1];
+    if(id >= block->first_id + block->count)
+        return false;
+    if(--block->num_live == 0) {
+        memmove(block, block + 1, sizeof(spawn_block) * (registry->num_blocks - low));
+        registry->num_blocks--;
+    }
+    return true;
+}
+
+/*
+ * archetype_registry_free: Free every archetype, and every spawned entity still in the entity store.
+ */
+void archetype_registry_free(archetype_registry *registry, slotmap const* entities) {
+    for(int i = 0; i < registry->num_blocks; i++) {
+        spawn_block const* block = &registry->blocks[i];
+        for(int id = block->first_id; id < block->first_id + block->count; id++) {
+            t_entity *entity = slotmap_get(entities, id);
+            if(entity != NULL)
+                free_entity(entity);
+        }
+    }
+    free(registry->blocks);
+    free(registry->archetypes);
+}
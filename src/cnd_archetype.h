@@ -0,0 +1,63 @@
+/*
+ * File: cnd_archetype.h
+ *
+ * Header for entity archetypes, templates that many identical entities are spawned from at once.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_ARCHETYPE_H
+#define CND_ARCHETYPE_H
+
+#include "cnd_datatypes.h"
+#include "cnd_slotmap.h"
+#include <stddef.h>
+
+struct spawn_batch_command;     // defined in cnd_commands.h
+
+/*
+ * archetype: Everything entities of one kind start out with, eg. a bullet or a particle.
+ * Registered once with register_archetype, then spawned many at a time with SPAWN_BATCH.
+ */
+typedef struct {
+    ent_func_vtable event_handlers;     // Event handlers of every entity spawned, eg. moving a bullet.
+    int spr_id;     // Sprite every entity starts out with, or 0 for none.
+    int spr_period;     // Frames between sprite subimages, or -1 if static.
+    int depth;
+    size_t ent_data_size;   // Bytes of ent_data each entity gets, or 0 for none.
+    void const* ent_data_init;  // Copied into each entity's ent_data, or NULL to zero it.
+} t_archetype;
+
+/*
+ * spawn_block: Entities spawned by one SPAWN_BATCH, which were given consecutive IDs.
+ * The game data owns them, freeing each as it is removed.
+ */
+typedef struct {
+    int first_id;   // entities have IDs first_id to first_id + count - 1, in order
+    int count;
+    int num_live;   // entities not yet removed
+} spawn_block;
+
+/*
+ * archetype_registry: Every archetype of a game, by ID, and the blocks spawned from them.
+ * Archetype IDs are indices into the registry, from 0, and are separate from element IDs.
+ */
+typedef struct {
+    int num_archetypes;
+    int archetype_capacity;
+    t_archetype *archetypes;
+    int num_blocks;
+    int block_capacity;
+    spawn_block *blocks;    // in order of first_id, as IDs only ever increase
+} archetype_registry;
+
+// All archetype functions (see cnd_archetype.c)
+
+archetype_registry make_archetype_registry();
+int register_archetype(t_game_data *data, t_archetype const* archetype);
+t_archetype *get_archetype(t_game_data *data, int arch_id);
+int spawn_entities(t_game_data *data, struct spawn_batch_command const* cmd);
+bool release_spawned_entity(archetype_registry *registry, int id);
+void archetype_registry_free(archetype_registry *registry, slotmap const* entities);
+
+#endif //CND_ARCHETYPE_H
@@ -0,0 +1,127 @@
+/*
+ * File: cnd_arena.c
+ *
+ * Contains all source code for frame arenas, and the engine's heap allocation counter.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_arena.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+
+struct arena_block {
+    struct arena_block *next;
+    size_t size;    // bytes available in data
+    size_t used;    // bytes allocated from data
+    alignas(max_align_t) unsigned char data[];
+};
+
+static _Thread_local frame_arena local_arena = { NULL, NULL };
+static atomic_long num_heap_allocations = 0;
+
+/*
+ * make_frame_arena: Create an empty frame arena. No memory is allocated until first used.
+ */
+frame_arena make_frame_arena() {
+    frame_arena arena = { NULL, NULL };
+    return arena;
+}
+
+/*
+ * make_block: Private method to allocate a block with room for at least 'size' bytes.
+ */
+static struct arena_block *make_block(size_t size) {
+    size_t block_size = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+    struct arena_block *block = malloc(sizeof(struct arena_block) + block_size);
+    if(block == NULL) {
+        perror("Could not allocate arena block.");
+        exit(EXIT_FAILURE);
+    }
+    note_heap_allocation();
+    block->next = NULL;
+    block->size = block_size;
+    block->used = 0;
+    return block;
+}
+
+/*
+ * arena_alloc: Allocate memory from an arena, aligned for any type.
+ * Memory is uninitialized, and is valid until the arena is next reset.
+ */
+void *arena_alloc(frame_arena *arena, size_t size) {
+    size = (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+    if(arena->current == NULL) {
+        arena->first = arena->current = make_block(size);
+    }
+    // move along to the next block that fits, reusing blocks kept from earlier frames
+    while(arena->current->used + size > arena->current->size) {
+        if(arena->current->next == NULL) {
+            arena->current->next = make_block(size);
+        } else if(arena->current->next->size < size) {
+            // too small for this request, put a big enough block in front of it
+            struct arena_block *block = make_block(size);
+            block->next = arena->current->next;
+            arena->current->next = block;
+        }
+        arena->current = arena->current->next;
+        arena->current->used = 0;
+    }
+    void *mem = arena->current->data + arena->current->used;
+    arena->current->used += size;
+    return mem;
+}
+
+/*
+ * arena_reset: Free everything allocated from an arena at once, keeping its blocks for reuse.
+ */
+void arena_reset(frame_arena *arena) {
+    arena->current = arena->first;
+    if(arena->current != NULL)
+        arena->current->used = 0;
+}
+
+/*
+ * arena_free: Give all of an arena's blocks back to the heap.
+ */
+void arena_free(frame_arena *arena) {
+    struct arena_block *block = arena->first;
+    while(block != NULL) {
+        struct arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->first = arena->current = NULL;
+}
+
+/*
+ * frame_arena_local: Get the calling thread's frame arena.
+ */
+frame_arena *frame_arena_local() {
+    return &local_arena;
+}
+
+/*
+ * frame_alloc: Allocate memory from the calling thread's frame arena.
+ */
+void *frame_alloc(size_t size) {
+    return arena_alloc(&local_arena, size);
+}
+
+/*
+ * note_heap_allocation: Count one heap allocation made on a per-frame path.
+ */
+void note_heap_allocation() {
+    atomic_fetch_add_explicit(&num_heap_allocations, 1, memory_order_relaxed);
+}
+
+/*
+ * get_heap_allocations: Get number of heap allocations made on per-frame paths since startup.
+ * A frame that does not change this made no heap allocations.
+ */
+long get_heap_allocations() {
+    return atomic_load_explicit(&num_heap_allocations, memory_order_relaxed);
+}
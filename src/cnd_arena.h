@@ -0,0 +1,50 @@
+/*
+ * File: cnd_arena.h
+ *
+ * Header for frame arenas.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_ARENA_H
+#define CND_ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE (64 * 1024)     // default size of each block of memory in an arena
+
+struct arena_block;
+
+/*
+ * frame_arena: Bump allocator for temporaries that only live until the end of a tick.
+ * Allocating moves an offset along the current block; resetting moves it back to the
+ * start of the first block, keeping all blocks, so once an arena has grown to the size
+ * a frame needs, it never touches the heap again.
+ *
+ * Each thread has its own arena (see frame_arena_local), so allocating needs no locks.
+ * The update loop resets its thread's arena at the end of every tick,
+ * and pool workers reset theirs at the start of every job.
+ * Pool workers free their arena when the pool is freed, and loop_update frees its thread's
+ * arena before returning; any other thread that allocates from its arena must call
+ * arena_free(frame_arena_local()) itself before it exits.
+ */
+typedef struct {
+    struct arena_block *first;  // first block, or NULL if nothing was ever allocated
+    struct arena_block *current;    // block currently being allocated from
+} frame_arena;
+
+// All frame arena functions (see cnd_arena.c)
+
+frame_arena make_frame_arena();
+void *arena_alloc(frame_arena *arena, size_t size);
+void arena_reset(frame_arena *arena);
+void arena_free(frame_arena *arena);
+frame_arena *frame_arena_local();
+void *frame_alloc(size_t size);
+
+// Heap allocation counting, for checking that steady-state frames do not allocate
+
+void note_heap_allocation();
+long get_heap_allocations();
+
+#endif //CND_ARENA_H
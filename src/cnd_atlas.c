@@ -0,0 +1,219 @@
+/*
+ * File: cnd_atlas.c
+ *
+ * Contains all source code for texture atlases.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_atlas.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * make_texture_atlas: Create an atlas with no pages.
+ *
+ * page_size (int): Width and height of pages; images larger than this get a page of their own.
+ */
+texture_atlas *make_texture_atlas(int page_size) {
+    texture_atlas *atlas = malloc(sizeof(texture_atlas));
+    if(atlas == NULL) {
+        perror("Could not allocate texture atlas.");
+        exit(EXIT_FAILURE);
+    }
+    atlas->page_size = (page_size > 0) ? page_size : DEFAULT_ATLAS_PAGE_SIZE;
+    atlas->dirty = false;
+    atlas->num_pages = 0;
+    atlas->page_capacity = 0;
+    atlas->pages = NULL;
+    return atlas;
+}
+
+/*
+ * add_page: Private method to add an empty page to an atlas, returning its index.
+ */
+static int add_page(texture_atlas *atlas, int width, int height) {
+    if(atlas->num_pages == atlas->page_capacity) {
+        atlas->page_capacity = (atlas->page_capacity > 0) ? atlas->page_capacity * 2 : 4;
+        atlas->pages = realloc(atlas->pages, sizeof(atlas_page) * atlas->page_capacity);
+        if(atlas->pages == NULL) {
+            perror("Could not allocate texture atlas pages.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    atlas_page *page = &atlas->pages[atlas->num_pages];
+    page->width = width;
+    page->height = height;
+    page->pixels = calloc((size_t) width * height, sizeof(uint32_t));
+    page->node_capacity = 16;
+    page->skyline = malloc(sizeof(skyline_node) * page->node_capacity);
+    if(page->pixels == NULL || page->skyline == NULL) {
+        perror("Could not allocate texture atlas page.");
+        exit(EXIT_FAILURE);
+    }
+    page->skyline[0] = (skyline_node) { 0, 0, width };
+    page->num_nodes = 1;
+    page->used_area = 0;
+    page->texture = 0;
+    return atlas->num_pages++;
+}
+
+/*
+ * skyline_fit: Private method to find how low an image can sit with its left edge on a skyline node.
+ * Returns the y of its top edge, or -1 if it does not fit in the page there.
+ */
+static int skyline_fit(atlas_page const* page, int index, int width, int height) {
+    if(page->skyline[index].x + width > page->width)
+        return -1;
+    int y = 0;
+    // the skyline covers the page's whole width, so the nodes cannot run out first
+    for(int i = index, remaining = width; remaining > 0; i++) {
+        if(page->skyline[i].y > y)
+            y = page->skyline[i].y;
+        if(y + height > page->height)
+            return -1;
+        remaining -= page->skyline[i].width;
+    }
+    return y;
+}
+
+/*
+ * skyline_remove: Private method to remove a node from a skyline.
+ */
+static void skyline_remove(atlas_page *page, int index) {
+    memmove(&page->skyline[index], &page->skyline[index + 1], sizeof(skyline_node) * (page->num_nodes - index - 1));
+    page->num_nodes--;
+}
+
+/*
+ * skyline_add: Private method to raise the skyline over an image placed at a node.
+ */
+static void skyline_add(atlas_page *page, int index, int y, int width, int height) {
+    if(page->num_nodes == page->node_capacity) {
+        page->node_capacity *= 2;
+        page->skyline = realloc(page->skyline, sizeof(skyline_node) * page->node_capacity);
+        if(page->skyline == NULL) {
+            perror("Could not allocate texture atlas skyline.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memmove(&page->skyline[index + 1], &page->skyline[index], sizeof(skyline_node) * (page->num_nodes - index));
+    page->num_nodes++;
+    page->skyline[index] = (skyline_node) { page->skyline[index + 1].x, y + height, width };
+    // cut back the nodes now under the image
+    while(index + 1 < page->num_nodes) {
+        skyline_node const* prev = &page->skyline[index];
+        skyline_node *node = &page->skyline[index + 1];
+        int overlap = prev->x + prev->width - node->x;
+        if(overlap <= 0)
+            break;
+        node->x += overlap;
+        node->width -= overlap;
+        if(node->width > 0)
+            break;
+        skyline_remove(page, index + 1);
+    }
+    // merge neighbours of the same height
+    for(int i = 0; i + 1 < page->num_nodes;) {
+        if(page->skyline[i].y == page->skyline[i + 1].y) {
+            page->skyline[i].width += page->skyline[i + 1].width;
+            skyline_remove(page, i + 1);
+        } else {
+            i++;
+        }
+    }
+}
+
+/*
+ * page_insert: Private method to place an image as low as possible in a page.
+ * Returns false if it does not fit.
+ */
+static bool page_insert(atlas_page *page, int width, int height, int *x, int *y) {
+    int best_index = -1, best_bottom = 0, best_width = 0;
+    for(int i = 0; i < page->num_nodes; i++) {
+        int fit_y = skyline_fit(page, i, width, height);
+        if(fit_y < 0)
+            continue;
+        // lowest bottom edge first, then the narrowest node, leaving wider gaps for later images
+        if(best_index < 0 || fit_y + height < best_bottom
+                || (fit_y + height == best_bottom && page->skyline[i].width < best_width)) {
+            best_index = i;
+            best_bottom = fit_y + height;
+            best_width = page->skyline[i].width;
+        }
+    }
+    if(best_index < 0)
+        return false;
+    *x = page->skyline[best_index].x;
+    *y = best_bottom - height;
+    skyline_add(page, best_index, *y, width, height);
+    return true;
+}
+
+/*
+ * atlas_insert: Reserve space for an image in an atlas, adding a page if no page has room.
+ *
+ * width, height (int): Size of image in pixels.
+ *
+ * Returns (atlas_region): Where the image goes; its pixels must then be copied in with atlas_blit.
+ */
+atlas_region atlas_insert(texture_atlas *atlas, int width, int height) {
+    int padded_width = width + ATLAS_PADDING, padded_height = height + ATLAS_PADDING;
+    atlas_region region = { .width = width, .height = height };
+    for(region.page = 0; region.page < atlas->num_pages; region.page++) {
+        if(page_insert(&atlas->pages[region.page], padded_width, padded_height, &region.x, &region.y))
+            break;
+    }
+    if(region.page == atlas->num_pages) {
+        int page_width = (padded_width > atlas->page_size) ? padded_width : atlas->page_size;
+        int page_height = (padded_height > atlas->page_size) ? padded_height : atlas->page_size;
+        region.page = add_page(atlas, page_width, page_height);
+        page_insert(&atlas->pages[region.page], padded_width, padded_height, &region.x, &region.y);
+    }
+    atlas_page *page = &atlas->pages[region.page];
+    page->used_area += (long) width * height;
+    region.u0 = (float) region.x / page->width;
+    region.v0 = (float) region.y / page->height;
+    region.u1 = (float) (region.x + width) / page->width;
+    region.v1 = (float) (region.y + height) / page->height;
+    return region;
+}
+
+/*
+ * atlas_blit: Copy an image's pixels into the space reserved for it.
+ *
+ * pixels (uint32_t const*): region->width * region->height pixels, row by row.
+ */
+void atlas_blit(texture_atlas *atlas, atlas_region const* region, uint32_t const* pixels) {
+    atlas_page *page = &atlas->pages[region->page];
+    atlas->dirty = true;
+    for(int row = 0; row < region->height; row++) {
+        memcpy(page->pixels + (size_t) (region->y + row) * page->width + region->x,
+               pixels + (size_t) row * region->width, sizeof(uint32_t) * region->width);
+    }
+}
+
+/*
+ * atlas_efficiency: Get the fraction of the atlas' pages covered by images, from 0 to 1.
+ */
+double atlas_efficiency(texture_atlas const* atlas) {
+    long used = 0, total = 0;
+    for(int i = 0; i < atlas->num_pages; i++) {
+        used += atlas->pages[i].used_area;
+        total += (long) atlas->pages[i].width * atlas->pages[i].height;
+    }
+    return (total > 0) ? (double) used / total : 0.0;
+}
+
+/*
+ * texture_atlas_free: Free all memory in an atlas. Does not delete textures uploaded from its pages.
+ */
+void texture_atlas_free(texture_atlas *atlas) {
+    for(int i = 0; i < atlas->num_pages; i++) {
+        free(atlas->pages[i].pixels);
+        free(atlas->pages[i].skyline);
+    }
+    free(atlas->pages);
+    free(atlas);
+}
@@ -0,0 +1,81 @@
+/*
+ * File: cnd_atlas.h
+ *
+ * Header for texture atlases, which pack many sprites' subimages into a few large pages.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_ATLAS_H
+#define CND_ATLAS_H
+
+#include <GL/gl.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DEFAULT_ATLAS_PAGE_SIZE 2048    // width and height of atlas pages, supported by all GL 3 GPUs
+#define ATLAS_PADDING 1     // empty pixels around each image, so filtering does not bleed in neighbours
+
+/*
+ * atlas_region: Where an image was packed in an atlas.
+ */
+typedef struct {
+    int page;   // index of page in atlas
+    int x;      // top-left corner and size in the page, in pixels
+    int y;
+    int width;
+    int height;
+    float u0;   // the same rectangle as texture coordinates, from 0 to 1
+    float v0;
+    float u1;
+    float v1;
+} atlas_region;
+
+/*
+ * skyline_node: One horizontal segment of a page's skyline, ie. the top edge of the space used below it.
+ */
+typedef struct {
+    int x;
+    int y;
+    int width;
+} skyline_node;
+
+/*
+ * atlas_page: One texture of an atlas, with its pixels and the skyline of space used so far.
+ */
+typedef struct {
+    int width;
+    int height;
+    uint32_t *pixels;   // width * height RGBA pixels, row by row, transparent where unused
+    int num_nodes;
+    int node_capacity;
+    skyline_node *skyline;  // sorted by x, covering the page's whole width
+    long used_area;     // pixels covered by images, not counting padding
+    GLuint texture;     // texture of the page, set by the render backend that uploads it, or 0
+} atlas_page;
+
+/*
+ * texture_atlas: Pages of images packed with the skyline bottom-left heuristic.
+ *
+ * Each image is placed wherever its bottom edge would be lowest, on top of the images already
+ * packed, so space is only wasted under overhangs. Images that fit no page start a new one.
+ * Packing images from tallest to shortest keeps the skyline flat, which packs them tightest.
+ * Images drawn from the same page can share a texture, and so a single draw call.
+ */
+typedef struct {
+    int page_size;
+    bool dirty;     // pages changed since they were last uploaded
+    int num_pages;
+    int page_capacity;
+    atlas_page *pages;
+} texture_atlas;
+
+// All texture atlas functions (see cnd_atlas.c)
+
+texture_atlas *make_texture_atlas(int page_size);
+atlas_region atlas_insert(texture_atlas *atlas, int width, int height);
+void atlas_blit(texture_atlas *atlas, atlas_region const* region, uint32_t const* pixels);
+double atlas_efficiency(texture_atlas const* atlas);
+void texture_atlas_free(texture_atlas *atlas);
+
+#endif //CND_ATLAS_H
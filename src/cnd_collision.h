@@ -0,0 +1,74 @@
+/*
+ * File: cnd_collision.h
+ *
+ * Header for collision detection between entities' sprites.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_COLLISION_H
+#define CND_COLLISION_H
+
+#include "cnd_datatypes.h"
+
+/*
+ * collision_box: Axis aligned bounding box of an entity's sprite, covering [min, max) on each axis.
+ */
+typedef struct {
+    int id;     // ID of entity
+    int min_x;
+    int max_x;
+    int min_y;
+    int max_y;
+    collision_mask const* mask;     // mask of the sprite's current subimage, or NULL to collide by box
+} collision_box;
+
+/*
+ * collision_pair: Two entities whose boxes intersect, with a < b.
+ */
+typedef struct {
+    int a;
+    int b;
+} collision_pair;
+
+/*
+ * collision_world: Sweep and prune broad phase over the current room's entities.
+ *
+ * Boxes are kept sorted by min_x from one frame to the next. Each frame their positions are
+ * refreshed in place and they are insertion sorted again, which is close to linear as entities
+ * only move a little per frame. Sweeping the sorted boxes then only pairs up boxes overlapping
+ * on the x axis, which are tested exactly on both axes. If both entities' sprites have collision
+ * masks, intersecting boxes are then tested pixel by pixel.
+ */
+typedef struct {
+    int num_boxes;
+    int box_capacity;
+    collision_box *boxes;   // sorted by min_x
+    int num_pairs;
+    int pair_capacity;
+    collision_pair *pairs;  // pairs found in the last frame
+    int num_marks;      // number of IDs covered by marks
+    unsigned *marks;    // ID -> frame it was last seen in the room, to sync boxes with the room
+    unsigned frame;
+    /*
+     * contacts: Other entities each entity collided with in the last frame, for update_entity.
+     * Entity at dense index i collided with contacts[contact_starts[i]] to contacts[contact_starts[i+1] - 1].
+     * Allocated from the frame arena, so only valid during the tick that found them.
+     */
+    int num_indices;    // number of dense indices covered by contact_starts
+    int *contact_starts;
+    int *contacts;
+    // statistics for the last frame
+    long frame_candidates;  // pairs overlapping on the x axis, ie. tested by the narrow phase
+    long frame_swaps;   // swaps made re-sorting boxes, ie. how far from sorted they were
+    long frame_mask_tests;  // intersecting boxes tested pixel by pixel
+} collision_world;
+
+// All collision functions (see collisions.c)
+
+collision_world *make_collision_world();
+void detect_collisions(t_game_data *data, collision_world *world);
+int get_contacts(collision_world const* world, int dense_index, int const** contacts);
+void collision_world_free(collision_world *world);
+
+#endif //CND_COLLISION_H
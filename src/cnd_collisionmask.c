@@ -0,0 +1,224 @@
+/*
+ * File: cnd_collisionmask.c
+ *
+ * Contains all source code for pixel perfect collision masks.
+ *
+ * Two masks are tested by lining up the words of one with the other's, shifting by their
+ * x offset, and ANDing the overlapping rows. The rows of one word column are contiguous,
+ * so with SSE2 or AVX2 two or four rows are shifted and ANDed per instruction. The kernel
+ * is picked at runtime from what the CPU supports, with a scalar fallback.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_collisionmask.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MASK_HAVE_X86 1
+#endif
+
+/*
+ * rows_kernel: Returns true if any of 'n' words of 'a' ANDed with the word of 'b'
+ * at the same index, shifted by 'shift' bits, is nonzero.
+ */
+typedef bool (*rows_kernel)(uint64_t const* a, uint64_t const* b, int n, int shift);
+
+static bool scalar_shl(uint64_t const* a, uint64_t const* b, int n, int shift) {
+    for(int i = 0; i < n; i++) {
+        if(a[i] & (b[i] << shift))
+            return true;
+    }
+    return false;
+}
+
+static bool scalar_shr(uint64_t const* a, uint64_t const* b, int n, int shift) {
+    for(int i = 0; i < n; i++) {
+        if(a[i] & (b[i] >> shift))
+            return true;
+    }
+    return false;
+}
+
+#ifdef MASK_HAVE_X86
+
+/*
+ * sse2_any: Private method returning true if any bit of a vector is set.
+ */
+__attribute__((target("sse2")))
+static inline bool sse2_any(__m128i v) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(v, _mm_setzero_si128())) != 0xFFFF;
+}
+
+__attribute__((target("sse2")))
+static bool sse2_shl(uint64_t const* a, uint64_t const* b, int n, int shift) {
+    __m128i count = _mm_cvtsi32_si128(shift);
+    int i = 0;
+    for(; i + 2 <= n; i += 2) {
+        __m128i va = _mm_loadu_si128((__m128i const*) (a + i));
+        __m128i vb = _mm_sll_epi64(_mm_loadu_si128((__m128i const*) (b + i)), count);
+        if(sse2_any(_mm_and_si128(va, vb)))
+            return true;
+    }
+    return scalar_shl(a + i, b + i, n - i, shift);
+}
+
+__attribute__((target("sse2")))
+static bool sse2_shr(uint64_t const* a, uint64_t const* b, int n, int shift) {
+    __m128i count = _mm_cvtsi32_si128(shift);
+    int i = 0;
+    for(; i + 2 <= n; i += 2) {
+        __m128i va = _mm_loadu_si128((__m128i const*) (a + i));
+        __m128i vb = _mm_srl_epi64(_mm_loadu_si128((__m128i const*) (b + i)), count);
+        if(sse2_any(_mm_and_si128(va, vb)))
+            return true;
+    }
+    return scalar_shr(a + i, b + i, n - i, shift);
+}
+
+__attribute__((target("avx2")))
+static bool avx2_shl(uint64_t const* a, uint64_t const* b, int n, int shift) {
+    __m128i count = _mm_cvtsi32_si128(shift);
+    int i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m256i va = _mm256_loadu_si256((__m256i const*) (a + i));
+        __m256i vb = _mm256_sll_epi64(_mm256_loadu_si256((__m256i const*) (b + i)), count);
+        if(!_mm256_testz_si256(va, vb))
+            return true;
+    }
+    return scalar_shl(a + i, b + i, n - i, shift);
+}
+
+__attribute__((target("avx2")))
+static bool avx2_shr(uint64_t const* a, uint64_t const* b, int n, int shift) {
+    __m128i count = _mm_cvtsi32_si128(shift);
+    int i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m256i va = _mm256_loadu_si256((__m256i const*) (a + i));
+        __m256i vb = _mm256_srl_epi64(_mm256_loadu_si256((__m256i const*) (b + i)), count);
+        if(!_mm256_testz_si256(va, vb))
+            return true;
+    }
+    return scalar_shr(a + i, b + i, n - i, shift);
+}
+
+#endif
+
+static rows_kernel kernel_shl = NULL;
+static rows_kernel kernel_shr = NULL;
+
+/*
+ * use_mask_kernel: Choose the implementation used by masks_intersect.
+ * Returns false, leaving the kernel unchanged, if the CPU does not support it.
+ */
+bool use_mask_kernel(enum mask_kernel kernel) {
+#ifdef MASK_HAVE_X86
+    if(kernel == MASK_KERNEL_AUTO)
+        kernel = __builtin_cpu_supports("avx2") ? MASK_KERNEL_AVX2
+                 : __builtin_cpu_supports("sse2") ? MASK_KERNEL_SSE2 : MASK_KERNEL_SCALAR;
+    if(kernel == MASK_KERNEL_AVX2 && __builtin_cpu_supports("avx2")) {
+        kernel_shl = avx2_shl;
+        kernel_shr = avx2_shr;
+        return true;
+    }
+    if(kernel == MASK_KERNEL_SSE2 && __builtin_cpu_supports("sse2")) {
+        kernel_shl = sse2_shl;
+        kernel_shr = sse2_shr;
+        return true;
+    }
+#else
+    if(kernel == MASK_KERNEL_AUTO)
+        kernel = MASK_KERNEL_SCALAR;
+#endif
+    if(kernel == MASK_KERNEL_SCALAR) {
+        kernel_shl = scalar_shl;
+        kernel_shr = scalar_shr;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * make_collision_mask: Create a mask from a subimage's pixels.
+ *
+ * pixels (uint32_t const*): width * height RGBA pixels, row by row, as uploaded to GL,
+ *      ie. bytes R, G, B, A in memory, so alpha is the top byte of each little endian word.
+ *
+ * Returns (collision_mask): Mask with a bit set for every pixel with alpha of at least MASK_ALPHA_THRESHOLD.
+ */
+collision_mask make_collision_mask(uint32_t const* pixels, int width, int height) {
+    collision_mask mask;
+    mask.width = width;
+    mask.height = height;
+    mask.words_per_row = (width + 63) / 64;
+    // one spare word, so an empty mask still gets an allocation
+    mask.bits = calloc((size_t) mask.words_per_row * height + 1, sizeof(uint64_t));
+    if(mask.bits == NULL) {
+        perror("Could not allocate collision mask.");
+        exit(EXIT_FAILURE);
+    }
+    for(int y = 0; y < height; y++) {
+        for(int x = 0; x < width; x++) {
+            if((pixels[y * width + x] >> 24) >= MASK_ALPHA_THRESHOLD)
+                mask.bits[(x / 64) * height + y] |= (uint64_t) 1 << (x % 64);
+        }
+    }
+    return mask;
+}
+
+/*
+ * collision_mask_get: Return true if the pixel of a mask at (x, y) is solid, false otherwise or if outside it.
+ */
+bool collision_mask_get(collision_mask const* mask, int x, int y) {
+    if(x < 0 || y < 0 || x >= mask->width || y >= mask->height)
+        return false;
+    return (mask->bits[(x / 64) * mask->height + y] >> (x % 64)) & 1;
+}
+
+/*
+ * masks_intersect: Return true if any solid pixels of two masks overlap, false otherwise.
+ *
+ * ax, ay, bx, by (int): Positions of the top-left corners of the masks.
+ */
+bool masks_intersect(collision_mask const* a, int ax, int ay, collision_mask const* b, int bx, int by) {
+    if(kernel_shl == NULL)
+        use_mask_kernel(MASK_KERNEL_AUTO);
+    // make b the right one, so it is shifted left (ie. to higher bits) to line up with a
+    if(bx < ax) {
+        collision_mask const* swap_mask = a;
+        a = b;
+        b = swap_mask;
+        int swap = ax; ax = bx; bx = swap;
+        swap = ay; ay = by; by = swap;
+    }
+    int y0 = (ay > by) ? ay : by;
+    int y1 = (ay + a->height < by + b->height) ? ay + a->height : by + b->height;
+    int x1 = (ax + a->width < bx + b->width) ? ax + a->width : bx + b->width;
+    if(y0 >= y1 || bx >= x1)
+        return false;
+    int num_rows = y1 - y0;
+    int dx = bx - ax;
+    int word_shift = dx / 64, bit_shift = dx % 64;
+    for(int k = dx / 64; k <= (x1 - 1 - ax) / 64; k++) {
+        uint64_t const* a_rows = a->bits + (size_t) k * a->height + (y0 - ay);
+        // word k of a lines up with the low part of b's word j, and the high part of word j - 1
+        int j = k - word_shift;
+        if(j < b->words_per_row
+                && kernel_shl(a_rows, b->bits + (size_t) j * b->height + (y0 - by), num_rows, bit_shift))
+            return true;
+        if(bit_shift != 0 && j >= 1 && j - 1 < b->words_per_row
+                && kernel_shr(a_rows, b->bits + (size_t) (j - 1) * b->height + (y0 - by), num_rows, 64 - bit_shift))
+            return true;
+    }
+    return false;
+}
+
+/*
+ * collision_mask_free: Free all memory in a mask.
+ */
+void collision_mask_free(collision_mask *mask) {
+    free(mask->bits);
+    mask->bits = NULL;
+}
@@ -0,0 +1,50 @@
+/*
+ * File: cnd_collisionmask.h
+ *
+ * Header for pixel perfect collision masks.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_COLLISIONMASK_H
+#define CND_COLLISIONMASK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MASK_ALPHA_THRESHOLD 128    // pixels with at least this alpha are solid
+
+/*
+ * collision_mask: One bit per pixel of a subimage, set if the pixel is solid.
+ *
+ * Each row is packed into 64 bit words, pixel x being bit x % 64 of word x / 64.
+ * Words are stored word column by word column: all rows' first words, then all rows'
+ * second words, and so on, so the same word of consecutive rows is contiguous and
+ * several rows can be tested at once with SIMD. Bits past the width are always 0.
+ */
+typedef struct {
+    int width;
+    int height;
+    int words_per_row;
+    uint64_t *bits;     // words_per_row * height words, bits[word * height + row]
+} collision_mask;
+
+/*
+ * mask_kernel: Implementation used to test rows of masks against each other.
+ */
+enum mask_kernel {
+    MASK_KERNEL_AUTO,   // best supported by the CPU
+    MASK_KERNEL_SCALAR,
+    MASK_KERNEL_SSE2,
+    MASK_KERNEL_AVX2
+};
+
+// All collision mask functions (see cnd_collisionmask.c)
+
+collision_mask make_collision_mask(uint32_t const* pixels, int width, int height);
+bool collision_mask_get(collision_mask const* mask, int x, int y);
+bool masks_intersect(collision_mask const* a, int ax, int ay, collision_mask const* b, int bx, int by);
+bool use_mask_kernel(enum mask_kernel kernel);
+void collision_mask_free(collision_mask *mask);
+
+#endif //CND_COLLISIONMASK_H
@@ -9,7 +9,9 @@
 #ifndef CND_COMMANDS_H
 #define CND_COMMANDS_H
 
-#include <glib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "cnd_threadpool.h"
 
 // Type of command.
 enum command_type {
@@ -21,28 +23,45 @@ enum command_type {
     PLAY_SND,
     PAUSE_SND,
     END_SND,
-    QUIT
+    QUIT,
+    SPAWN_BATCH
 };
 
 /*
  * update_command: A request to alter the game's global state.
- * Returned by entities upon running their update_self() functions, and parsed by the global update().
+ * Returned by entities upon running their event handlers, and parsed by the global update().
  * Will update variables or flags in game_data.
  * Contains its command_type and a command-specific list of values.
+ * Commands are variable size records: only the part of the data union used by their type is stored.
  */
 
 // All data types for details of specific commands.
 enum alter_entity_attr {
-    CURRENT_SPR, X, Y, UPDATE_SELF, ENT_DATA
+    CURRENT_SPR, X, Y, UPDATE_SELF, ENT_DATA, DEPTH
 };
 struct alter_entity_command {
     int target_id;
-    t_entity model_ent; // Target entity is modified to be like this one
     enum alter_entity_attr modified_attr;   // Attribute of target entity to modify
+    union {     // New value of the modified attribute
+        int int_value;      // CURRENT_SPR, X, Y or DEPTH
+        ent_func_vtable const* event_handlers;  // UPDATE_SELF, copied into the entity
+        void *ent_data;     // ENT_DATA
+    };
 };
 
 struct add_entity_command {
-    t_entity new_entity;    // Can have any ID, will be set upon creation to be highest existing ID + 1
+    t_entity *new_entity;   // Can have any ID, will be set upon creation to be highest existing ID + 1
+    int room_id;    // Room to add the new entity to, or 0 to add it to none.
+};
+
+struct spawn_batch_command {
+    int arch_id;    // Archetype to spawn entities of (see register_archetype).
+    int count;      // Number of entities to spawn, given consecutive IDs from highest existing ID + 1.
+    int room_id;    // Room to add the new entities to, or 0 to add them to none.
+    int x;  // Position of the first entity; each after it is offset by (dx, dy) from the one before,
+    int y;  // eg. a row of bullets. Entities can also place themselves in their init handler.
+    int dx;
+    int dy;
 };
 
 struct rem_entity_command {
@@ -54,8 +73,14 @@ enum alter_room_attr {
 };
 struct alter_room_command {
     int target_id;
-    t_room model_room;
     enum alter_room_attr modified_attr;
+    union {     // New value of the modified attribute
+        int int_value;      // WIDTH or HEIGHT
+        struct {    // ENTITIES, room takes ownership of the array
+            int *entity_ids;
+            int num_entities;
+        };
+    };
 };
 
 struct next_room_command {
@@ -82,10 +107,12 @@ struct quit_command {
 };
 
 struct update_command {
-    enum command_type type;
+    unsigned short size;    // Size of this record in bytes
+    unsigned short type;    // enum command_type
     union {
         struct alter_entity_command alter_ent;
         struct add_entity_command add_ent;
+        struct spawn_batch_command spawn_batch;
         struct rem_entity_command rem_ent;
         struct alter_room_command alter_room;
         struct next_room_command next_room;
@@ -100,6 +127,7 @@ struct update_command {
 
 void cmd_alter_entity(t_game_data*, struct alter_entity_command);
 void cmd_add_entity(t_game_data*, struct add_entity_command);
+void cmd_spawn_batch(t_game_data*, struct spawn_batch_command);
 void cmd_rem_entity(t_game_data*, struct rem_entity_command);
 void cmd_alter_room(t_game_data*, struct alter_room_command);
 void cmd_next_room(t_game_data*, struct next_room_command);
@@ -108,30 +136,72 @@ void cmd_pause_sound(t_game_data*, struct pause_sound_command);
 void cmd_end_sound(t_game_data*, struct end_sound_command);
 void cmd_quit(t_game_data*, struct quit_command);
 
+// Dispatch of whole command sets (see dispatchers.c)
+
+bool dispatch_command(t_game_data*, t_update_command*);
+bool dispatch_commands(t_game_data*, threadpool*, t_update_command**, int);
+
+// Command scheduling and elimination (see cmdoptimiser.c)
+
+int optimise_commands(t_game_data*, t_update_command_container*, t_update_command**);
+
 /*
- * update_command_container: Contains a series of update commands from a single entity.
- * Stores these as a linked list, which is never traversed beyond the first element; by
- * having the threadpool of command dispatchers only take the first command and move the
- * head pointer one along and having updating entities only append commands to the start,
- * the asymptotic complexity of pushing or popping a command is entirely constant.
+ * update_command_container: Contains a series of update commands, eg. from a single entity.
+ * Commands are packed one after another into fixed size segments, which are bump allocated:
+ * pushing a command only moves an offset along, unless the last segment is full.
+ *
+ * Update command containers can also be combined by linking the first segment of one onto the
+ * last segment of the other, which is why each container remembers its last segment. This also
+ * takes constant time. After all entities have updated, all their containers are combined in this
+ * way and the resulting container is fed to the dispatchers.
  *
- * Update command containers can also be combined by putting the head of one's llist on the
- * tail of the other, which is why each container remembers the address of its last element.
- * This also takes constant time. After all entities have updated, all their containers will
- * be combined in this way and the resulting container is fed to the dispatcher threadpool.
+ * Segments come from a pool owned by the thread that pushed into them, and are given back to that
+ * pool when the container is freed at the end of the frame, so after the first few frames no
+ * commands need any heap allocation at all.
+ */
+#define COMMAND_SEGMENT_SIZE 4096
+
+struct command_segment_pool;
+
+struct command_segment {
+    struct command_segment *next;   // Next segment in container, or in pool if free.
+    struct command_segment_pool *owner;     // Pool to give segment back to.
+    int used;   // Number of bytes used in data.
+    _Alignas(8) unsigned char data[COMMAND_SEGMENT_SIZE];
+};
+
+/*
+ * command_segment_pool: Free segments of one thread.
+ * Only the owning thread takes from free_segments; other threads freeing its segments push them
+ * onto returned, which the owner takes all at once when free_segments runs dry.
  */
+struct command_segment_pool {
+    struct command_segment *free_segments;
+    _Atomic(struct command_segment *) returned;
+};
+
 struct update_command_container {
     int num_commands;
-    GSList *commands;   // Linked list of update commands (uses standard GLib linked list.)
-    GSList *commands_end;   // Last entry in linked list.
+    struct command_segment *first;  // First segment, or NULL if empty.
+    struct command_segment *last;   // Last segment, where commands are pushed.
 };
 
+/*
+ * command_iter: Position in a container, for walking all its commands in order.
+ */
+typedef struct {
+    struct command_segment *segment;
+    int offset;
+} command_iter;
+
 // All update command container functions (see cmdcontainer.c)
 
 t_update_command_container make_update_command_container();
-void push_command(t_update_command_container *);
-void pop_command(t_update_command_container *);
-void remove_command(t_update_command_container *, t_update_command *);
+t_update_command *push_command(t_update_command_container *, enum command_type);
+command_iter iter_commands(t_update_command_container const*);
+t_update_command *next_command(command_iter *);
 void append_container(t_update_command_container *, t_update_command_container *);
+void free_update_command_container(t_update_command_container *);
+long command_segments_allocated();
 
 #endif // CND_COMMANDS_H
@@ -8,10 +8,20 @@
 
 #include <portaudio.h>
 #include <GL/gl.h>
+#include <stdbool.h>
+#include <stdatomic.h>
 
 #ifndef CND_DATATYPES_H
 #define CND_DATATYPES_H
 
+#include "cnd_spatialgrid.h"
+#include "cnd_collisionmask.h"
+#include "cnd_atlas.h"
+#include "cnd_image.h"
+#include "cnd_mixer.h"
+#include "cnd_soundcache.h"
+#include "cnd_pool.h"
+
 // All type declarations
 
 struct game_data;
@@ -19,6 +29,7 @@ struct entity;
 struct room;
 struct sprite;
 struct sound;
+struct render_backend;
 struct update_command;
 struct update_command_container;
 
@@ -27,10 +38,25 @@ typedef struct entity t_entity;
 typedef struct room t_room;
 typedef struct sprite t_sprite;
 typedef struct sound t_sound;
+typedef struct render_backend render_backend;     // defined in cnd_render.h
 // Declared here for entity update, defined in cnd_commands.h
 typedef struct update_command t_update_command;
 typedef struct update_command_container t_update_command_container;
 
+/*
+ * asset_state: Whether a sprite or sound can be used yet, if loaded in the background (see cnd_loader.h).
+ * Elements made any other way start out, and stay, ASSET_READY.
+ */
+enum asset_state {
+    ASSET_READY = 0,    // usable
+    ASSET_LOADING,      // still being read and decoded
+    ASSET_DECODED,      // sprites only: decoded, waiting for the render thread to give it textures
+    ASSET_FAILED        // could not be read or decoded, so never usable
+};
+
+// asset_ready: Whether a sprite or sound is usable, after which everything it loaded can be read.
+#define asset_ready(elem) (atomic_load_explicit(&(elem)->state, memory_order_acquire) == ASSET_READY)
+
 /*
  * room: Contains a screen's worth of entities, eg. a pause menu or a level.
  * Only one room is focused on at a time, and its entities are all updated each frame.
@@ -41,8 +67,10 @@ struct room {
     int room_id;    // ID of the room.
     int* entity_ids; // IDs of all entities inside of room
     int num_entities;   // Number of entities in room.
+    int entity_capacity;    // Length of entity_ids if grown by add_room_entity, otherwise 0 (ie. num_entities).
     int width;      // Width of room in pixels.
     int height;     // Height of room in pixels.
+    spatial_grid *grid;     // Index of entity positions for culling, or NULL if not enabled.
 };
 
 // Room functions (see rooms.c)
@@ -59,14 +87,23 @@ void free_room(t_room *);
 struct sprite {
     int spr_id;         // ID of sprite.
     int num_imgs;       // Number of subimages.
+    int width;          // Size of every subimage in pixels, also used as the sprite's hitbox.
+    int height;
     GLuint* texture;    // Array of subimage textures
+    collision_mask* masks;  // Array of subimage collision masks, or NULL to collide by hitbox (see sprite_set_pixels)
+    uint32_t** pixels;  // Array of subimage RGBA pixels, or NULL, for rendering without a GPU (see cnd_softrender.h)
+    atlas_region* regions;  // Array of subimage places in the game's atlas, or NULL if not packed (see build_sprite_atlas)
+    _Atomic int state;  // enum asset_state; only size and num_imgs may be read unless asset_ready
 };
 
 // Sprite functions (see sprites.c)
 
-t_sprite *make_sprite(int, GLuint*);
+t_sprite *make_sprite(int, int, int, GLuint*);
+void sprite_set_pixels(t_sprite *, uint32_t const* const*);
+bool decode_sprite(t_sprite *, void const*, size_t);
+bool load_sprite(t_sprite *, char const*);
 void free_sprite(t_sprite *);
-void draw_sprite(t_sprite * /* add args needed when rendering finished */);
+void draw_sprite(render_backend *, t_sprite const*, int, int, int);
 
 /*
  * ent_func_vtable: A vtable of every function that an entity needs.
@@ -79,7 +116,8 @@ typedef struct {
     t_update_command_container (*step)(t_game_data const*, t_entity const*);
     // destroy: Called on the update just before the entity is removed.
     t_update_command_container (*destroy)(t_game_data const*, t_entity const*);
-    // collide: Called if the entity's sprite intersects with another entity's sprite.
+    // collide: Called if the entity's sprite intersects with another entity's sprite, given its ID.
+    // Called once per other entity hit, after step, if collisions are enabled (see enable_collisions).
     t_update_command_container (*collide)(t_game_data const*, t_entity const*, int);
     // key_pressed: Called if a key is being held down during the current update.
     t_update_command_container (*key_pressed)(t_game_data const*, t_entity const* /* TODO */);
@@ -98,38 +136,55 @@ typedef struct {
 struct entity {
     int id; // Unique identifier for an entity.
     ent_func_vtable event_handlers;     // Vtable of event handler functions.
+    bool has_initialised;   // Whether init() has been called yet.
     int current_spr_id;     // ID of the entity's current sprite.
     int spr_period;     // Number of frames between each sprite subimage, if -1 then static
     int spr_current_img;    // Index of current sprite subimage starting at 0
     int spr_last_subimg_time;   // Number of frames since last sprite subimage.
     int x;  // X-Y coordinates of the entity in the room. (Y = down, X = right)
     int y;
+    int prev_x;     // Position before the last tick that moved the entity, for interpolating between ticks.
+    int prev_y;
+    unsigned long moved_tick;   // Game's tick count once the tick that last moved the entity ended, or 0 if never.
+    int depth;  // Draw order, images of lower depth are drawn first (ie. further back).
+    int room_id;    // Room the entity was last indexed in (see index_room), or 0 if none.
+    int room_slot;  // Index of the entity's ID in that room's entity_ids.
+    bool pooled;    // Whether made by make_entity, so freed back to its pool (see cnd_pool.h).
     void *ent_data; // can be used by entity, must be cast to a meaningful struct first
 };
 
 // Entity functions (see entities.c)
 
 t_entity *make_entity(int, int, int, void *);
+t_entity *make_entity_with_data(int, int, int, size_t);
 void free_entity(t_entity *);
-t_update_command_container update_entity(t_game_data*, t_entity *); // TODO: deprecate update_self in favor of vtable of callbacks
+void animate_entity(t_entity *, int);
+t_update_command_container update_entity(t_game_data*, t_entity *);
 void draw_entity(t_entity * /* TODO */);
 
 /*
  * sound: A single sound to play, eg. a music track or a sound effect.
  * Contains a file path to a sound and a volume from 0 to a positive value.
+ * Short sounds can be loaded into memory with load_sound; the rest are streamed from their file as they play.
  */
 struct sound {
     int snd_id;     // ID of the sound.
-    char* snd_path;     // Path to the sound source file, relative to the main executable.
+    char* snd_path;     // Path to the sound source file (a WAV file at MIXER_SAMPLE_RATE), relative to the main executable.
     int volume;     // Volume of the sound in decibels.
+    float *samples;     // Interleaved stereo frames if loaded, otherwise NULL.
+    long num_frames;    // Number of frames in samples.
+    _Atomic int state;  // enum asset_state; sounds are not played unless asset_ready
 };
 
 // Sound functions (see sounds.c)
 
 t_sound *make_sound(char*, int);
 void free_sound(t_sound *);
-void play_sound(t_sound *);
-void pause_sound(t_sound *);
-void stop_sound(t_sound *);
+bool load_sound(t_sound *);
+bool decode_sound(t_sound *, void const*, size_t);
+void play_sound(audio_mixer *, t_sound *);
+void play_cached_sound(audio_mixer *, sound_cache *, t_sound *);
+void pause_sound(audio_mixer *, t_sound *);
+void stop_sound(audio_mixer *, t_sound *);
 
 #endif // CND_DATATYPES_H
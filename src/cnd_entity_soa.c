@@ -0,0 +1,155 @@
+/*
+ * File: cnd_entity_soa.c
+ *
+ * Contains all source code for structure-of-arrays entity storage.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_entity_soa.h"
+#include "cnd_arena.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+/*
+ * resize: Private method to reallocate every field array to hold 'capacity' entities.
+ */
+static void resize(entity_soa *soa, int capacity) {
+    int **int_fields[] = {
+            &soa->x, &soa->y,
+            &soa->current_spr_id, &soa->spr_period,
+            &soa->spr_current_img, &soa->spr_last_subimg_time,
+            &soa->spr_num_imgs
+    };
+    for(int i = 0; i < sizeof(int_fields) / sizeof(int_fields[0]); i++) {
+        int *field = realloc(*int_fields[i], sizeof(int) * capacity);
+        if(field == NULL) {
+            perror("Could not allocate field array for entity_soa.");
+            exit(EXIT_FAILURE);
+        }
+        *int_fields[i] = field;
+    }
+    ent_func_vtable *handlers = realloc(soa->event_handlers, sizeof(ent_func_vtable) * capacity);
+    if(handlers == NULL) {
+        perror("Could not allocate handler array for entity_soa.");
+        exit(EXIT_FAILURE);
+    }
+    soa->event_handlers = handlers;
+    soa->capacity = capacity;
+    note_heap_allocation();
+}
+
+/*
+ * make_entity_soa: Create an empty entity_soa.
+ *
+ * num_elems (int): Expected number of entities; the arrays grow past this automatically.
+ */
+entity_soa *make_entity_soa(int num_elems) {
+    entity_soa *soa = calloc(1, sizeof(entity_soa));
+    if(soa == NULL) {
+        perror("Could not allocate entity_soa.");
+        exit(EXIT_FAILURE);
+    }
+    resize(soa, (num_elems > 0) ? num_elems : 16);
+    return soa;
+}
+
+/*
+ * entity_soa_push: Append an entity's hot fields at the next dense index.
+ * Its sprite's number of subimages is not known here, so starts at 0 until set by the caller.
+ */
+void entity_soa_push(entity_soa *soa, t_entity const* entity) {
+    if(soa->num_entries == soa->capacity)
+        resize(soa, soa->capacity * 2);
+    soa->spr_num_imgs[soa->num_entries] = 0;
+    entity_soa_store(soa, soa->num_entries++, entity);
+}
+
+/*
+ * entity_soa_swap_remove: Remove the entity at a dense index, moving the last entity into its place.
+ * Mirrors slotmap_del, so indices stay in step with the entity slotmap.
+ */
+void entity_soa_swap_remove(entity_soa *soa, int index) {
+    int last = --soa->num_entries;
+    soa->x[index] = soa->x[last];
+    soa->y[index] = soa->y[last];
+    soa->current_spr_id[index] = soa->current_spr_id[last];
+    soa->spr_period[index] = soa->spr_period[last];
+    soa->spr_current_img[index] = soa->spr_current_img[last];
+    soa->spr_last_subimg_time[index] = soa->spr_last_subimg_time[last];
+    soa->spr_num_imgs[index] = soa->spr_num_imgs[last];
+    soa->event_handlers[index] = soa->event_handlers[last];
+}
+
+/*
+ * entity_soa_load: Copy the hot fields at a dense index into a t_entity.
+ * Lets code written against t_entity keep working while the arrays are authoritative.
+ */
+void entity_soa_load(entity_soa const* soa, int index, t_entity *entity) {
+    entity->x = soa->x[index];
+    entity->y = soa->y[index];
+    entity->current_spr_id = soa->current_spr_id[index];
+    entity->spr_period = soa->spr_period[index];
+    entity->spr_current_img = soa->spr_current_img[index];
+    entity->spr_last_subimg_time = soa->spr_last_subimg_time[index];
+    entity->event_handlers = soa->event_handlers[index];
+}
+
+/*
+ * entity_soa_store: Copy the hot fields of a t_entity into the arrays at a dense index.
+ */
+void entity_soa_store(entity_soa *soa, int index, t_entity const* entity) {
+    soa->x[index] = entity->x;
+    soa->y[index] = entity->y;
+    soa->current_spr_id[index] = entity->current_spr_id;
+    soa->spr_period[index] = entity->spr_period;
+    soa->spr_current_img[index] = entity->spr_current_img;
+    soa->spr_last_subimg_time[index] = entity->spr_last_subimg_time;
+    soa->event_handlers[index] = entity->event_handlers;
+}
+
+/*
+ * entity_soa_tick_subimg_timers: Advance the subimage timer of every animated entity by one frame.
+ * Touches only two int arrays, and has no branches, so compiles to vector code.
+ */
+void entity_soa_tick_subimg_timers(entity_soa *soa) {
+    int *restrict timers = soa->spr_last_subimg_time;
+    int const* restrict periods = soa->spr_period;
+    for(int i = 0; i < soa->num_entries; i++)
+        timers[i] += (periods[i] >= 0);     // static sprites have a period of -1
+}
+
+/*
+ * entity_soa_animate: Advance the sprite animation of the entities at dense indices begin to end - 1
+ * by one frame, as animate_entity does for one entity.
+ * Selects with masks rather than branching, so compiles to vector code.
+ */
+void entity_soa_animate(entity_soa *soa, int begin, int end) {
+    int *restrict imgs = soa->spr_current_img;
+    int *restrict timers = soa->spr_last_subimg_time;
+    int const* restrict periods = soa->spr_period;
+    int const* restrict num_imgs = soa->spr_num_imgs;
+    for(int i = begin; i < end; i++) {
+        int animated = (periods[i] >= 0) & (num_imgs[i] > 0);
+        int timer = timers[i] + animated;
+        int next = animated & (timer >= periods[i]);
+        int img = imgs[i] + next;
+        timers[i] = next ? 0 : timer;
+        imgs[i] = (next & (img >= num_imgs[i])) ? 0 : img;
+    }
+}
+
+/*
+ * entity_soa_free: Free an entity_soa and all its arrays.
+ */
+void entity_soa_free(entity_soa *soa) {
+    free(soa->x);
+    free(soa->y);
+    free(soa->current_spr_id);
+    free(soa->spr_period);
+    free(soa->spr_current_img);
+    free(soa->spr_last_subimg_time);
+    free(soa->spr_num_imgs);
+    free(soa->event_handlers);
+    free(soa);
+}
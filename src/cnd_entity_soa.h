@@ -0,0 +1,45 @@
+/*
+ * File: cnd_entity_soa.h
+ *
+ * Header for structure-of-arrays entity storage.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_ENTITY_SOA_H
+#define CND_ENTITY_SOA_H
+
+#include "cnd_datatypes.h"
+
+/*
+ * entity_soa: Hot entity fields, stored as one contiguous array per field.
+ * Indexed by an entity's dense index in t_game_data.entities, and kept in the same order,
+ * so bulk passes over one field (eg. sprite timers) only touch that field's memory.
+ * While enabled, these arrays hold the authoritative values of the fields they store;
+ * the copies in t_entity are refreshed with entity_soa_load before handlers see them.
+ */
+typedef struct {
+    int num_entries;    // number of entities stored
+    int capacity;       // number of entities the arrays can hold
+    int *x;     // positions
+    int *y;
+    int *current_spr_id;    // sprite animation state
+    int *spr_period;
+    int *spr_current_img;
+    int *spr_last_subimg_time;
+    int *spr_num_imgs;      // subimages of each entity's current sprite, or 0 if it has none
+    ent_func_vtable *event_handlers;    // handler tables
+} entity_soa;
+
+// All entity_soa functions (see cnd_entity_soa.c)
+
+entity_soa *make_entity_soa(int num_elems);
+void entity_soa_push(entity_soa *soa, t_entity const* entity);
+void entity_soa_swap_remove(entity_soa *soa, int index);
+void entity_soa_load(entity_soa const* soa, int index, t_entity *entity);
+void entity_soa_store(entity_soa *soa, int index, t_entity const* entity);
+void entity_soa_tick_subimg_timers(entity_soa *soa);
+void entity_soa_animate(entity_soa *soa, int begin, int end);
+void entity_soa_free(entity_soa *soa);
+
+#endif //CND_ENTITY_SOA_H
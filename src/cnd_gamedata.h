@@ -11,6 +11,35 @@
 
 #include "cnd_datatypes.h"
 #include "cnd_hashtable.h"
+#include "cnd_slotmap.h"
+#include "cnd_entity_soa.h"
+#include "cnd_threadpool.h"
+#include "cnd_arena.h"
+#include "cnd_scheduler.h"
+#include "cnd_snapshot.h"
+#include "cnd_renderqueue.h"
+#include "cnd_render.h"
+#include "cnd_collision.h"
+#include "cnd_pack.h"
+#include "cnd_loader.h"
+#include "cnd_archetype.h"
+
+/*
+ * command_optimiser: Statistics and scratch space for optimise_commands (see cmdoptimiser.c).
+ */
+struct command_marks {
+    unsigned frame;     // frame in which flags were set; flags from older frames are ignored
+    unsigned flags;     // which commands have been seen for this ID
+};
+struct command_optimiser {
+    int frame_submitted;    // commands submitted in the last frame
+    int frame_eliminated;   // commands optimised out in the last frame
+    long total_submitted;   // commands submitted since the game started
+    long total_eliminated;  // commands optimised out since the game started
+    unsigned frame;     // current frame number
+    int num_marks;      // number of IDs covered by marks
+    struct command_marks *marks;    // marks indexed by ID, reused every frame
+};
 
 /*
  * game_data: Contains all data about a particular game.
@@ -21,9 +50,20 @@ struct game_data {
     /*
      * entities: All entities in game.
      * Only place where entities can be directly referenced.
+     * Stored in a slotmap rather than a hashtable, as entity IDs are dense and never reused.
      */
     int num_entities;
-    hashtable entities;
+    slotmap entities;
+    /*
+     * hot_entities: Optional structure-of-arrays copy of hot entity fields (see cnd_entity_soa.h).
+     * NULL unless enabled with enable_entity_soa; when set, it is authoritative for those fields.
+     */
+    entity_soa *hot_entities;
+    /*
+     * collisions: Broad phase state for calling entities' collide handlers (see cnd_collision.h).
+     * NULL unless enabled with enable_collisions.
+     */
+    collision_world *collisions;
     /*
      * rooms: All rooms in game.
      * Only place where rooms can be directly referenced.
@@ -49,6 +89,50 @@ struct game_data {
     int camera_y;
     int current_room_id;   // ID of current room.
     int max_id;     // Largest ID ever used.
+    int num_workers;    // Number of threads updating entities, or 0 to use all cores.
+    tick_scheduler scheduler;   // Paces updates to a fixed tick rate, set with init_tick_scheduler.
+    unsigned long tick;     // Number of ticks run so far.
+    /*
+     * snapshots: Render-relevant state published by the update loop after each batch of ticks.
+     * The render loop only reads these, never the rest of game_data, so needs no locks.
+     */
+    snapshot_buffer snapshots;
+    /*
+     * renderer: Backend drawing the render loop's frames (see cnd_render.h), owned by the game data.
+     * NULL until set with set_renderer, in which case frames are queued but not drawn.
+     */
+    render_backend *renderer;
+    /*
+     * atlas: Pages that all sprites with pixels are packed into, so images can be drawn in fewer batches.
+     * NULL until built with build_sprite_atlas.
+     */
+    texture_atlas *atlas;
+    /*
+     * mixer: Mixes sounds played by PLAY_SND commands on the output device's own thread.
+     * NULL until enabled with enable_audio, in which case sound commands are ignored.
+     */
+    audio_mixer *mixer;
+    /*
+     * sound_cache: Sounds decoded once and shared by every play of them (see cnd_soundcache.h).
+     * NULL until enabled with enable_sound_cache, in which case sounds not loaded are streamed.
+     */
+    sound_cache *sound_cache;
+    /*
+     * pack: Pack file the game data was loaded from, which owns every element loaded from it
+     * (see cnd_pack.h). NULL if not loaded from a pack.
+     */
+    game_pack *pack;
+    /*
+     * loader: Reads and decodes sprites and sounds on background threads (see cnd_loader.h).
+     * NULL until enabled with enable_asset_loader.
+     */
+    asset_loader *loader;
+    /*
+     * archetypes: Templates that entities are spawned from in batches with SPAWN_BATCH, and the
+     * spawned entities themselves, which the game data owns (see cnd_archetype.h).
+     */
+    archetype_registry archetypes;
+    struct command_optimiser optimiser;     // Command elimination statistics and scratch space.
 };
 
 // Game data interface commands (see gamedata.c for implementation)
@@ -63,19 +147,32 @@ void gamedata_free(t_game_data *);
 t_entity *get_entity(t_game_data *, int);
 void add_entity(t_game_data *, t_entity *);
 void del_entity(t_game_data *, int);
-int *get_entity_ids(t_game_data *);
+int *get_entity_ids(t_game_data *);   // view into entity store, do not free
+void enable_entity_soa(t_game_data *);
+void enable_collisions(t_game_data *);
+void set_renderer(t_game_data *, render_backend *);
+bool enable_audio(t_game_data *, enum audio_output);
+void enable_sound_cache(t_game_data *, size_t, bool);
+void enable_asset_loader(t_game_data *, int);
 
 // room functions
 t_room *get_room(t_game_data *, int);
 void add_room(t_game_data *, t_room *);
 void del_room(t_game_data *, int);
 int *get_room_ids(t_game_data *);
+void enable_room_grid(t_game_data *, t_room *, int);
+void rebuild_room_grid(t_game_data *, t_room *);
+void index_room(t_game_data *, t_room *);
+void add_room_entity(t_game_data *, t_room *, int);
+void add_room_entity_range(t_game_data *, t_room *, int, int);
+void del_room_entities(t_game_data *, int const*, int);
 
 // sprite functions
 t_sprite *get_sprite(t_game_data *, int);
 void add_sprite(t_game_data *, t_sprite *);
 void del_sprite(t_game_data *, int);
 int *get_sprite_ids(t_game_data *);
+void build_sprite_atlas(t_game_data *, int);
 
 // sound functions
 t_sound *get_sound(t_game_data *, int);
@@ -85,6 +182,12 @@ int *get_sound_ids(t_game_data *);
 
 int *get_ids(t_game_data *);
 
+void animate_sprites(t_game_data *);
+t_update_command_container update_entities(t_game_data *, threadpool *);
+bool update_frame(t_game_data *, threadpool *);
+void publish_game_snapshot(t_game_data *);
+void queue_snapshot_images(t_game_data *, game_snapshot const*, double, render_queue *);
+void render_frame(t_game_data *, game_snapshot const*, render_queue *);
 int loop_update(t_game_data *);
 int loop_render(t_game_data *);
 
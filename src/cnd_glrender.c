@@ -0,0 +1,322 @@
+/*
+ * File: cnd_glrender.c
+ *
+ * Contains all source code for the OpenGL render backend.
+ *
+ * Each image becomes one instance of a quad; the vertex shader builds its four corners from
+ * gl_VertexID, so there is no vertex buffer, only the instance buffer. Each batch is a single
+ * glDrawArraysInstancedBaseInstance over a range of that buffer.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#define GL_GLEXT_PROTOTYPES
+#include "cnd_glrender.h"
+#include <GL/glext.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#define FENCE_TIMEOUT 1000000000    // nanoseconds to wait for a fence before checking it again
+
+static char const* vertex_source =
+    "#version 330 core\n"
+    "layout(location = 0) in vec4 rect;\n"
+    "layout(location = 1) in vec4 uv;\n"
+    "uniform vec2 screen;\n"
+    "out vec2 tex_coord;\n"
+    "void main() {\n"
+    "    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+    "    vec2 pos = rect.xy + corner * rect.zw;\n"
+    "    tex_coord = mix(uv.xy, uv.zw, corner);\n"
+    "    gl_Position = vec4(pos.x / screen.x * 2.0 - 1.0, 1.0 - pos.y / screen.y * 2.0, 0.0, 1.0);\n"
+    "}\n";
+
+static char const* fragment_source =
+    "#version 330 core\n"
+    "in vec2 tex_coord;\n"
+    "uniform sampler2D image;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    color = texture(image, tex_coord);\n"
+    "}\n";
+
+/*
+ * compile_shader: Private method to compile a shader, printing its log and returning 0 on failure.
+ */
+static GLuint compile_shader(GLenum type, char const* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint ok;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if(!ok) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "Could not compile sprite shader: %s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+/*
+ * make_program: Private method to build the sprite shader program, returning 0 on failure.
+ */
+static GLuint make_program() {
+    GLuint vertex = compile_shader(GL_VERTEX_SHADER, vertex_source);
+    GLuint fragment = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+    if(vertex == 0 || fragment == 0)
+        return 0;
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    GLint ok;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if(!ok) {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        fprintf(stderr, "Could not link sprite shader: %s\n", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+/*
+ * map_instance_buffer: Private method to create the instance buffer, mapped for as long as it exists,
+ * and point the vertex array's per-instance attributes at it.
+ */
+static void map_instance_buffer(gl_renderer *renderer) {
+    GLsizeiptr size = (GLsizeiptr) sizeof(gl_instance) * renderer->capacity * GL_RENDER_FRAMES;
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &renderer->instance_buffer);
+    glBindVertexArray(renderer->vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer->instance_buffer);
+    glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+    renderer->instances = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+    if(renderer->instances == NULL) {
+        perror("Could not map instance buffer.");
+        exit(EXIT_FAILURE);
+    }
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(gl_instance), (void *) offsetof(gl_instance, x));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(gl_instance), (void *) offsetof(gl_instance, u0));
+    for(GLuint i = 0; i < 2; i++) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+}
+
+/*
+ * unmap_instance_buffer: Private method to delete the instance buffer, once the GPU is done with it.
+ */
+static void unmap_instance_buffer(gl_renderer *renderer) {
+    for(int i = 0; i < GL_RENDER_FRAMES; i++) {
+        if(renderer->fences[i] != 0) {
+            glClientWaitSync(renderer->fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(renderer->fences[i]);
+            renderer->fences[i] = 0;
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, renderer->instance_buffer);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glDeleteBuffers(1, &renderer->instance_buffer);
+    renderer->instances = NULL;
+}
+
+/*
+ * region_start: Private method to get the index of the first instance of the current frame's region.
+ */
+static int region_start(gl_renderer const* renderer) {
+    return (int) (renderer->frame % GL_RENDER_FRAMES) * renderer->capacity;
+}
+
+/*
+ * flush_batch: Private method to draw all instances gathered since the last batch, in one call.
+ */
+static void flush_batch(gl_renderer *renderer) {
+    int count = renderer->num_instances - renderer->batch_start;
+    if(count == 0)
+        return;
+    glBindTexture(GL_TEXTURE_2D, renderer->batch_texture);
+    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, count,
+                                      region_start(renderer) + renderer->batch_start);
+    renderer->frame_draw_calls++;
+    renderer->batch_start = renderer->num_instances;
+}
+
+static void gl_begin_frame(render_backend *backend, int width, int height) {
+    gl_renderer *renderer = (gl_renderer *) backend;
+    if(renderer->grow) {
+        unmap_instance_buffer(renderer);
+        renderer->capacity *= 2;
+        map_instance_buffer(renderer);
+        renderer->grow = false;
+    }
+    renderer->frame_draw_calls = renderer->frame_instances = renderer->frame_stalls = 0;
+    renderer->frame_bytes_uploaded = renderer->pending_bytes;
+    renderer->pending_bytes = 0;
+    // wait until the GPU has finished the frame that last used this region
+    GLsync *fence = &renderer->fences[renderer->frame % GL_RENDER_FRAMES];
+    if(*fence != 0) {
+        if(glClientWaitSync(*fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            renderer->frame_stalls++;
+            while(glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT) == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(*fence);
+        *fence = 0;
+    }
+    renderer->num_instances = renderer->batch_start = 0;
+    renderer->batch_texture = 0;
+    glViewport(0, 0, width, height);
+    // images arrive sorted by depth (see cnd_renderqueue.h), so are simply drawn over each other in order
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    // alpha blends over like colour does, so stays opaque over an opaque background
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    uint32_t clear = renderer->clear_color;
+    glClearColor((clear & 0xFF) / 255.0f, ((clear >> 8) & 0xFF) / 255.0f,
+                 ((clear >> 16) & 0xFF) / 255.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glUseProgram(renderer->program);
+    glUniform2f(renderer->screen_uniform, (float) width, (float) height);
+    glBindVertexArray(renderer->vertex_array);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+static void gl_draw_image(render_backend *backend, t_sprite const* sprite, int subimg, int x, int y) {
+    gl_renderer *renderer = (gl_renderer *) backend;
+    GLuint texture = sprite->texture[subimg];
+    float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+    if(sprite->regions != NULL) {
+        atlas_region const* region = &sprite->regions[subimg];
+        texture = renderer->page_textures[region->page];
+        u0 = region->u0;
+        v0 = region->v0;
+        u1 = region->u1;
+        v1 = region->v1;
+    }
+    if(texture != renderer->batch_texture) {
+        flush_batch(renderer);
+        renderer->batch_texture = texture;
+    }
+    if(renderer->num_instances == renderer->capacity) {
+        // out of room: draw what there is, wait for it, and reuse the region, growing it next frame
+        flush_batch(renderer);
+        glFinish();
+        renderer->frame_stalls++;
+        renderer->num_instances = renderer->batch_start = 0;
+        renderer->grow = true;
+    }
+    gl_instance *instance = &renderer->instances[region_start(renderer) + renderer->num_instances++];
+    *instance = (gl_instance) { (float) x, (float) y, (float) sprite->width, (float) sprite->height,
+                                u0, v0, u1, v1 };
+    renderer->frame_instances++;
+    renderer->frame_bytes_uploaded += sizeof(gl_instance);
+    renderer->total_bytes_uploaded += sizeof(gl_instance);
+}
+
+/*
+ * gl_upload_atlas: Create a texture for each page of an atlas, replacing those of any previous atlas.
+ */
+static void gl_upload_atlas(render_backend *backend, texture_atlas *atlas) {
+    gl_renderer *renderer = (gl_renderer *) backend;
+    glDeleteTextures(renderer->num_page_textures, renderer->page_textures);
+    free(renderer->page_textures);
+    renderer->num_page_textures = atlas->num_pages;
+    renderer->page_textures = malloc(sizeof(GLuint) * (atlas->num_pages + 1));
+    if(renderer->page_textures == NULL) {
+        perror("Could not allocate atlas textures.");
+        exit(EXIT_FAILURE);
+    }
+    glGenTextures(atlas->num_pages, renderer->page_textures);
+    for(int i = 0; i < atlas->num_pages; i++) {
+        atlas_page *page = &atlas->pages[i];
+        glBindTexture(GL_TEXTURE_2D, renderer->page_textures[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, page->width, page->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, page->pixels);
+        page->texture = renderer->page_textures[i];
+        long bytes = (long) page->width * page->height * sizeof(uint32_t);
+        renderer->pending_bytes += bytes;
+        renderer->total_bytes_uploaded += bytes;
+    }
+}
+
+/*
+ * gl_upload_sprite: Create a texture for each subimage of a sprite, into its texture array.
+ * Sprite textures belong to the sprite rather than the renderer.
+ */
+static void gl_upload_sprite(render_backend *backend, t_sprite *sprite) {
+    gl_renderer *renderer = (gl_renderer *) backend;
+    glGenTextures(sprite->num_imgs, sprite->texture);
+    for(int i = 0; i < sprite->num_imgs; i++) {
+        glBindTexture(GL_TEXTURE_2D, sprite->texture[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, sprite->width, sprite->height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     sprite->pixels[i]);
+        long bytes = (long) sprite->width * sprite->height * sizeof(uint32_t);
+        renderer->pending_bytes += bytes;
+        renderer->total_bytes_uploaded += bytes;
+    }
+}
+
+static void gl_end_frame(render_backend *backend) {
+    gl_renderer *renderer = (gl_renderer *) backend;
+    flush_batch(renderer);
+    renderer->fences[renderer->frame % GL_RENDER_FRAMES] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    renderer->frame++;
+}
+
+static void gl_free(render_backend *backend) {
+    gl_renderer *renderer = (gl_renderer *) backend;
+    unmap_instance_buffer(renderer);
+    glDeleteTextures(renderer->num_page_textures, renderer->page_textures);
+    free(renderer->page_textures);
+    glDeleteVertexArrays(1, &renderer->vertex_array);
+    glDeleteProgram(renderer->program);
+    free(renderer);
+}
+
+/*
+ * make_gl_renderer: Create an OpenGL renderer, to be set as a game's renderer (see set_renderer).
+ * Must be called on the render thread, with an OpenGL 4.4 context current, which it then draws to.
+ *
+ * clear_color (uint32_t): RGBA color behind all images; its alpha is ignored.
+ * capacity (int): Instances per frame before the buffer grows, or 0 for DEFAULT_GL_INSTANCES.
+ *
+ * Returns (gl_renderer *): The renderer, or NULL if its shaders could not be built.
+ */
+gl_renderer *make_gl_renderer(uint32_t clear_color, int capacity) {
+    GLuint program = make_program();
+    if(program == 0)
+        return NULL;
+    gl_renderer *renderer = calloc(1, sizeof(gl_renderer));
+    if(renderer == NULL) {
+        perror("Could not allocate OpenGL renderer.");
+        exit(EXIT_FAILURE);
+    }
+    renderer->backend.begin_frame = gl_begin_frame;
+    renderer->backend.draw_image = gl_draw_image;
+    renderer->backend.upload_atlas = gl_upload_atlas;
+    renderer->backend.upload_sprite = gl_upload_sprite;
+    renderer->backend.end_frame = gl_end_frame;
+    renderer->backend.free = gl_free;
+    renderer->program = program;
+    renderer->clear_color = clear_color;
+    renderer->screen_uniform = glGetUniformLocation(program, "screen");
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "image"), 0);
+    renderer->capacity = (capacity > 0) ? capacity : DEFAULT_GL_INSTANCES;
+    glGenVertexArrays(1, &renderer->vertex_array);
+    map_instance_buffer(renderer);
+    return renderer;
+}
@@ -0,0 +1,75 @@
+/*
+ * File: cnd_glrender.h
+ *
+ * Header for the OpenGL render backend, which draws images in instanced batches.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_GLRENDER_H
+#define CND_GLRENDER_H
+
+#include "cnd_render.h"
+#include <GL/gl.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define GL_RENDER_FRAMES 3      // frames of instance data in flight at once, ie. triple buffering
+#define DEFAULT_GL_INSTANCES 16384  // instances per frame before the buffer has to grow
+
+/*
+ * gl_instance: Everything the vertex shader needs to draw one image, as a quad of 4 vertices.
+ */
+typedef struct {
+    float x;    // top-left corner and size on screen, in pixels
+    float y;
+    float width;
+    float height;
+    float u0;   // rectangle of the texture to draw, from 0 to 1
+    float v0;
+    float u1;
+    float v1;
+} gl_instance;
+
+/*
+ * gl_renderer: Render backend drawing with OpenGL 4.4, one instanced draw call per run of images
+ * sharing a texture, eg. each atlas page (see build_sprite_atlas).
+ *
+ * Instances are written straight into a buffer that stays mapped for the renderer's lifetime,
+ * split into GL_RENDER_FRAMES regions used in turn, one per frame. A fence is placed after each
+ * frame's draws, and waited on before its region is written again, so the CPU only writes
+ * instances the GPU has finished with, and normally never waits as the GPU is frames behind.
+ * Textures of atlas pages are created and owned by the renderer. Frames are drawn to whatever
+ * framebuffer is bound, and are not swapped; that is up to whoever owns the window.
+ */
+typedef struct {
+    render_backend backend;     // must be first, so this can be used as a render_backend
+    GLuint program;
+    GLuint vertex_array;
+    GLuint instance_buffer;
+    GLint screen_uniform;
+    uint32_t clear_color;   // color filling the framebuffer at the start of each frame
+    gl_instance *instances;     // persistently mapped instance buffer, GL_RENDER_FRAMES * capacity instances
+    int capacity;       // instances per frame region
+    bool grow;      // a frame overflowed its region, so grow it before the next
+    GLsync fences[GL_RENDER_FRAMES];    // fence after the last frame drawn from each region, or 0
+    unsigned long frame;    // frames begun, so region frame % GL_RENDER_FRAMES is being written
+    int num_instances;      // instances written to the current region
+    int batch_start;    // first instance of the batch being gathered
+    GLuint batch_texture;   // texture of the batch being gathered
+    int num_page_textures;
+    GLuint *page_textures;  // textures created for atlas pages
+    long pending_bytes;     // bytes of atlas pages uploaded since the last frame began
+    // statistics for the last frame
+    long frame_draw_calls;
+    long frame_instances;
+    long frame_bytes_uploaded;  // instance data, plus atlas pages uploaded before the frame
+    long frame_stalls;  // times the CPU had to wait for the GPU
+    long total_bytes_uploaded;
+} gl_renderer;
+
+// All OpenGL renderer functions (see cnd_glrender.c)
+
+gl_renderer *make_gl_renderer(uint32_t clear_color, int capacity);
+
+#endif //CND_GLRENDER_H
@@ -4,132 +4,229 @@
  * Contains all source code for hashtables.
  * Hashtables are used by t_game_data to store entities, rooms, etc.
  *
+ * Hashtables use open addressing with Robin Hood linear probing: every slot
+ * stores its ID inline, and on insertion an element may displace another that
+ * is closer to its home slot. This keeps probe sequences short and contiguous,
+ * so a lookup is usually a single cache line. Deletion shifts following
+ * elements backwards, so no tombstones are needed.
+ *
  * Author: Jack Romo <sharrackor@gmail.com>
  */
 
 #include "cnd_hashtable.h"
+#include "cnd_arena.h"
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <pthread.h>
 
+#define HASHTABLE_MIN_CAPACITY 8
+
+/*
+ * make_slots: Private method to allocate an array of empty slots.
+ */
+static hashtable_slot *make_slots(int capacity) {
+    hashtable_slot *slots = malloc(sizeof(hashtable_slot) * capacity);
+    if(slots == NULL) {
+        perror("Could not allocate slots for hashtable.");
+        exit(EXIT_FAILURE);
+    }
+    for(int i = 0; i < capacity; i++) {
+        slots[i].dist = -1;
+        slots[i].elem = NULL;
+    }
+    return slots;
+}
+
 /*
  * make_hashtable: Create a hashtable.
  *
- * num_elems (int): Number of linked lists in hashtable.
+ * num_elems (int): Expected number of elements; the table grows past this automatically.
  *
  * Returns (hashtable): Empty hashtable.
  */
 hashtable make_hashtable(int num_elems) {
     hashtable table;
-    llist_node** list = malloc(sizeof(llist_node*) * num_elems);
-    if(list == NULL) {
-        perror("Could not allocate list for hashtable.");
-        exit(EXIT_FAILURE);
+    int capacity = HASHTABLE_MIN_CAPACITY;
+    int log_capacity = 3;
+    // keep load factor under 7/8 for the expected number of elements
+    while(capacity - capacity / 8 < num_elems) {
+        capacity *= 2;
+        log_capacity++;
     }
-    table.list = list;
-    table.num_elems = num_elems;
-    table.mutexes = malloc(sizeof(pthread_mutex_t) * num_elems);
+    table.capacity = capacity;
+    table.num_entries = 0;
+    table.shift = 32 - log_capacity;
+    table.slots = make_slots(capacity);
+    table.mutexes = malloc(sizeof(pthread_mutex_t) * HASHTABLE_NUM_LOCKS);
     if(table.mutexes == NULL) {
         perror("Could not allocate mutexes for hashtable.");
         exit(EXIT_FAILURE);
     }
-    for(int i = 0; i < table.num_elems; i++) {
+    for(int i = 0; i < HASHTABLE_NUM_LOCKS; i++) {
         pthread_mutex_init(&table.mutexes[i], NULL);
     }
     return table;
 }
 
 /*
- * hash: Private method for hashing an ID.
+ * hash: Private method for hashing an ID to its home slot.
+ * Uses Fibonacci hashing, so consecutive IDs are spread evenly over the table.
  */
-int hash(int id, hashtable table) {
-    return id % (table.num_elems);
+int hash(int id, hashtable const* table) {
+    return (int) (((uint32_t) id * 2654435769u) >> table->shift);
 }
 
 /*
- * hashtable_trylock_id: Acquire lock on llist in hashtable responsible for 'id'.
+ * hashtable_lock_id: Acquire lock on the stripe of a hashtable responsible for 'id'.
  * Stall until this is accomplished.
  */
-void hashtable_lock_id(hashtable table, int id) {
-    pthread_mutex_lock(&table.mutexes[hash(id, table)]);
+void hashtable_lock_id(hashtable *table, int id) {
+    pthread_mutex_lock(&table->mutexes[id & (HASHTABLE_NUM_LOCKS - 1)]);
 }
 
 /*
- * hashtable_trylock_id: Attempt to acquire lock on llist in hashtable responsible for 'id'.
+ * hashtable_trylock_id: Attempt to acquire lock on the stripe of a hashtable responsible for 'id'.
  *
  * Will try once; if fails, will return nonzero value.
  */
-int hashtable_trylock_id(hashtable table, int id) {
-    return pthread_mutex_trylock(&table.mutexes[hash(id, table)]);
+int hashtable_trylock_id(hashtable *table, int id) {
+    return pthread_mutex_trylock(&table->mutexes[id & (HASHTABLE_NUM_LOCKS - 1)]);
 }
 
 /*
  * hashtable_unlock_id: Release lock on an ID.
  */
-void hashtable_unlock_id(hashtable table, int id) {
-    pthread_mutex_unlock(&table.mutexes[hash(id, table)]);
+void hashtable_unlock_id(hashtable *table, int id) {
+    pthread_mutex_unlock(&table->mutexes[id & (HASHTABLE_NUM_LOCKS - 1)]);
+}
+
+/*
+ * find_slot: Private method to get the index of the slot holding 'id', or -1 if absent.
+ */
+static int find_slot(hashtable const* table, int id) {
+    int mask = table->capacity - 1;
+    int pos = hash(id, table);
+    for(int dist = 0;; dist++) {
+        hashtable_slot const* slot = &table->slots[pos];
+        // Robin Hood invariant: once we pass a slot closer to home than us, the ID is absent
+        if(slot->dist < dist)
+            return -1;
+        if(slot->id == id)
+            return pos;
+        pos = (pos + 1) & mask;
+    }
+}
+
+/*
+ * insert_slot: Private method to insert an entry, assuming there is space and the ID is absent.
+ */
+static void insert_slot(hashtable *table, int id, void* elem) {
+    int mask = table->capacity - 1;
+    int pos = hash(id, table);
+    hashtable_slot entry = { .id = id, .dist = 0, .elem = elem };
+    for(;;) {
+        hashtable_slot *slot = &table->slots[pos];
+        if(slot->dist < 0) {
+            *slot = entry;
+            return;
+        }
+        if(slot->dist < entry.dist) {
+            // take from the rich: swap with the element closer to its home slot
+            hashtable_slot displaced = *slot;
+            *slot = entry;
+            entry = displaced;
+        }
+        entry.dist++;
+        pos = (pos + 1) & mask;
+    }
+}
+
+/*
+ * grow: Private method to double the capacity of a hashtable and reinsert all elements.
+ */
+static void grow(hashtable *table) {
+    hashtable_slot *old_slots = table->slots;
+    int old_capacity = table->capacity;
+    table->capacity *= 2;
+    table->shift--;
+    table->slots = make_slots(table->capacity);
+    note_heap_allocation();
+    for(int i = 0; i < old_capacity; i++) {
+        if(old_slots[i].dist >= 0)
+            insert_slot(table, old_slots[i].id, old_slots[i].elem);
+    }
+    free(old_slots);
 }
 
 /*
  * hashtable_add: Add an element to a hashtable of any type.
+ * If an element with the same ID already exists, it is replaced.
  */
-void hashtable_add(hashtable table, void* elem, elem_type type) {
-    llist_node elem_node = make_node(elem, type);
-    int entry_pos = hash(get_id(elem, type), table);
-    add_node(&table.list[entry_pos], elem_node);
+void hashtable_add(hashtable *table, void* elem, elem_type type) {
+    int id = get_id(elem, type);
+    int pos = find_slot(table, id);
+    if(pos >= 0) {
+        table->slots[pos].elem = elem;
+        return;
+    }
+    if(table->num_entries + 1 > table->capacity - table->capacity / 8)
+        grow(table);
+    insert_slot(table, id, elem);
+    table->num_entries++;
 }
 
 /*
- * hashtable_get: Get a void* to an element with an ID in a hashtable.
+ * hashtable_get: Get a void* to an element with an ID in a hashtable, or NULL if absent.
  */
-void *hashtable_get(hashtable table, int id) {
-    int entry_pos = hash(id, table);
-    return get_node(table.list[entry_pos], id).elem;
+void *hashtable_get(hashtable const* table, int id) {
+    int pos = find_slot(table, id);
+    return (pos >= 0) ? table->slots[pos].elem : NULL;
 }
 
 /*
  * hashtable_del: Delete an element with an ID in a hashtable.
+ * Does not free the element itself.
  */
-void hashtable_del(hashtable table, int id) {
-    int entry_pos = hash(id, table);
-    del_node(&table.list[entry_pos], id);
+void hashtable_del(hashtable *table, int id) {
+    int mask = table->capacity - 1;
+    int pos = find_slot(table, id);
+    if(pos < 0) {
+        fprintf(stderr, "Could not find ID %d in hashtable.\n", id);
+        return;
+    }
+    // shift following elements back until one is at home or a slot is empty
+    int next = (pos + 1) & mask;
+    while(table->slots[next].dist > 0) {
+        table->slots[pos] = table->slots[next];
+        table->slots[pos].dist--;
+        pos = next;
+        next = (next + 1) & mask;
+    }
+    table->slots[pos].dist = -1;
+    table->slots[pos].elem = NULL;
+    table->num_entries--;
 }
 
 /*
  * hashtable_contains: Return true if contains an ID, false otherwise.
  */
-bool hashtable_contains(hashtable table, int id) {
-    for(int i = 0; i < table.num_elems; i++) {
-        if(llist_contains(table.list[i], id))
-            return true;
-    }
-    return false;
+bool hashtable_contains(hashtable const* table, int id) {
+    return find_slot(table, id) >= 0;
 }
 
 /*
  * hashtable_get_ids: Get array of all IDs in hashtable.
+ * Array is allocated from the calling thread's frame arena, so is valid until the end of
+ * the current tick, and must not be freed.
  */
-int *hashtable_get_ids(hashtable table) {
-    int **id_arrays = (int **) malloc(sizeof(int*)*table.num_elems);
-    if(id_arrays == NULL) exit(EXIT_FAILURE);
-    int lengths[table.num_elems];
-    int sum_lengths = 0;
-    for(int i = 0; i < table.num_elems; i++) {
-        lengths[i] = llist_get_length(table.list[i]);
-        sum_lengths += lengths[i];
-        id_arrays[i] = (int *) malloc(sizeof(int)*lengths[i]);
-        if(id_arrays[i] == NULL) exit(EXIT_FAILURE);
-        id_arrays[i] = llist_get_all_ids(table.list[i]);
-    }
-    int *ids = (int *) malloc(sizeof(int)*sum_lengths);
-    if(ids == NULL) exit(EXIT_FAILURE);
+int *hashtable_get_ids(hashtable const* table) {
+    int *ids = (int *) frame_alloc(sizeof(int) * table->num_entries);
     int index = 0;
-    for(int i = 0; i < table.num_elems; i++) {
-        for(int j = 0; j < lengths[i]; j++) {
-            ids[index] = id_arrays[i][j];
-            index++;
-        }
+    for(int i = 0; i < table->capacity; i++) {
+        if(table->slots[i].dist >= 0)
+            ids[index++] = table->slots[i].id;
     }
     return ids;
 }
@@ -137,20 +234,21 @@ int *hashtable_get_ids(hashtable table) {
 /*
  * hashtable_get_num_entries: Get number of entries in hashtable.
  */
-int hashtable_get_num_entries(hashtable table) {
-    int length = 0;
-    for(int i = 0; i < table.num_elems; i++) {
-        length += llist_get_length(table.list[i]);
-    }
-    return length;
+int hashtable_get_num_entries(hashtable const* table) {
+    return table->num_entries;
 }
 
 /*
  * hashtable_free: Free all memory in hashtable.
+ * Elements themselves are owned by the caller and are not freed.
  */
-void hashtable_free(hashtable table) {
-    for(int i = 0; i < table.num_elems; i++) {
-        llist_free(table.list[i]);
+void hashtable_free(hashtable *table) {
+    for(int i = 0; i < HASHTABLE_NUM_LOCKS; i++) {
+        pthread_mutex_destroy(&table->mutexes[i]);
     }
-    free(table.mutexes);
+    free(table->mutexes);
+    free(table->slots);
+    table->slots = NULL;
+    table->mutexes = NULL;
+    table->capacity = table->num_entries = 0;
 }
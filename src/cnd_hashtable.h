@@ -12,26 +12,44 @@
 #include "cnd_llist.h"
 #include <pthread.h>
 
+// Number of lock stripes per hashtable, independent of its capacity (must be a power of two).
+#define HASHTABLE_NUM_LOCKS 64
 
 /*
- * hashtable: Table of linked lists. Indexes elements by ID.
+ * hashtable_slot: A single entry in a hashtable.
+ * The ID is stored inline next to the element, so a probe never dereferences the element.
  */
 typedef struct {
-    int num_elems;  // number of linked lists in hashtable
-    llist_node** list;  // all linked lists
-    pthread_mutex_t *mutexes;  // mutexes for each linked list
+    int id;         // ID of the element in this slot.
+    int dist;       // Distance from the slot the ID hashes to, -1 if the slot is empty.
+    void* elem;     // Element stored in this slot.
+} hashtable_slot;
+
+/*
+ * hashtable: Open addressing table of elements indexed by ID.
+ * Uses Robin Hood linear probing, and doubles in capacity when it becomes too full.
+ */
+typedef struct {
+    int capacity;   // number of slots in hashtable, always a power of two
+    int num_entries;    // number of occupied slots
+    int shift;      // right shift used to turn a hashed ID into a slot index
+    hashtable_slot* slots;  // all slots
+    pthread_mutex_t *mutexes;  // striped mutexes, shared between all IDs with the same low hash bits
 } hashtable;
 
 // All hashtable functions (see cnd_hashtable.c)
 
 hashtable make_hashtable(int num_elems);
-int hash(int id, hashtable table);
-void hashtable_add(hashtable table, void* elem, elem_type type);
-void *hashtable_get(hashtable table, int id);
-void hashtable_del(hashtable table, int id);
-bool hashtable_contains(hashtable table, int id);
-int *hashtable_get_ids(hashtable table);
-int hashtable_get_num_entries(hashtable table);
-void hashtable_free(hashtable table);
+int hash(int id, hashtable const* table);
+void hashtable_lock_id(hashtable *table, int id);
+int hashtable_trylock_id(hashtable *table, int id);
+void hashtable_unlock_id(hashtable *table, int id);
+void hashtable_add(hashtable *table, void* elem, elem_type type);
+void *hashtable_get(hashtable const* table, int id);
+void hashtable_del(hashtable *table, int id);
+bool hashtable_contains(hashtable const* table, int id);
+int *hashtable_get_ids(hashtable const* table);
+int hashtable_get_num_entries(hashtable const* table);
+void hashtable_free(hashtable *table);
 
 #endif //CND_HASHTABLE_H
@@ -0,0 +1,151 @@
+/*
+ * File: cnd_image.c
+ *
+ * Contains all source code for decoding sprite image files.
+ *
+ * Images are binary Netpbm files: PPM (P6), which are opaque, or PAM (P7) with RGB or RGB_ALPHA
+ * tuples, both with a maxval of 255. These need no compression library, and PAM's pixels are
+ * already laid out as sprites keep them, so decoding one is a copy.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_image.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+
+#define MAX_IMAGE_SIZE 16384    // widest and tallest images decoded, so sizes cannot overflow
+
+/*
+ * image_header: Private cursor over an image's header.
+ */
+typedef struct {
+    char const* pos;
+    char const* end;
+} image_header;
+
+/*
+ * skip_space: Private method to skip whitespace and comments, which run from # to the end of the line.
+ */
+static void skip_space(image_header *header) {
+    while(header->pos < header->end) {
+        if(*header->pos == '#') {
+            while(header->pos < header->end && *header->pos != '\n')
+                header->pos++;
+        } else if(isspace((unsigned char) *header->pos)) {
+            header->pos++;
+        } else {
+            return;
+        }
+    }
+}
+
+/*
+ * read_token: Private method to read the next word of a header into a buffer of 32 chars.
+ */
+static bool read_token(image_header *header, char *token) {
+    skip_space(header);
+    int length = 0;
+    while(header->pos < header->end && !isspace((unsigned char) *header->pos) && length < 31)
+        token[length++] = *header->pos++;
+    token[length] = '\0';
+    return length > 0;
+}
+
+static bool read_number(image_header *header, int *value) {
+    char token[32];
+    char *end;
+    if(!read_token(header, token))
+        return false;
+    long number = strtol(token, &end, 10);
+    if(*end != '\0' || number < 0 || number > MAX_IMAGE_SIZE)
+        return false;
+    *value = (int) number;
+    return true;
+}
+
+/*
+ * read_pam_header: Private method to read the fields of a PAM header, up to and including ENDHDR.
+ */
+static bool read_pam_header(image_header *header, int *width, int *height, int *depth, int *maxval) {
+    char token[32];
+    bool alpha = false, tuple_given = false;
+    while(read_token(header, token)) {
+        if(strcmp(token, "ENDHDR") == 0) {
+            // a PAM's tuple type may only say what its depth already does
+            return !tuple_given || (alpha == (*depth == 4));
+        } else if(strcmp(token, "WIDTH") == 0) {
+            if(!read_number(header, width))
+                return false;
+        } else if(strcmp(token, "HEIGHT") == 0) {
+            if(!read_number(header, height))
+                return false;
+        } else if(strcmp(token, "DEPTH") == 0) {
+            if(!read_number(header, depth))
+                return false;
+        } else if(strcmp(token, "MAXVAL") == 0) {
+            if(!read_number(header, maxval))
+                return false;
+        } else if(strcmp(token, "TUPLTYPE") == 0) {
+            if(!read_token(header, token))
+                return false;
+            tuple_given = true;
+            alpha = strcmp(token, "RGB_ALPHA") == 0;
+            if(!alpha && strcmp(token, "RGB") != 0)
+                return false;
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
+/*
+ * decode_image: Decode an image file in memory into RGBA pixels, as sprites keep them (see sprite_set_pixels).
+ *
+ * data (void const*): The whole file.
+ * width, height (int *): Set to the size of the image.
+ *
+ * Returns (uint32_t *): width * height pixels, row by row from the top, to be freed by the caller;
+ * or NULL if the file is not a supported image, or is cut short.
+ */
+uint32_t *decode_image(void const* data, size_t size, int *width, int *height) {
+    image_header header = { data, (char const*) data + size };
+    char magic[32];
+    int depth = 3, maxval = 0;
+    *width = *height = -1;
+    if(!read_token(&header, magic))
+        return NULL;
+    if(strcmp(magic, "P6") == 0) {
+        if(!read_number(&header, width) || !read_number(&header, height) || !read_number(&header, &maxval))
+            return NULL;
+    } else if(strcmp(magic, "P7") == 0) {
+        if(!read_pam_header(&header, width, height, &depth, &maxval))
+            return NULL;
+    } else {
+        return NULL;
+    }
+    // exactly one whitespace char separates the header from the pixels
+    if(*width < 0 || *height < 0 || maxval != 255 || (depth != 3 && depth != 4)
+            || header.pos >= header.end || !isspace((unsigned char) *header.pos))
+        return NULL;
+    unsigned char const* src = (unsigned char const*) header.pos + 1;
+    size_t num_pixels = (size_t) *width * *height;
+    if((size_t) (header.end - (char const*) src) < num_pixels * depth)
+        return NULL;
+    uint32_t *pixels = malloc(sizeof(uint32_t) * (num_pixels + 1));
+    if(pixels == NULL) {
+        perror("Could not allocate image.");
+        exit(EXIT_FAILURE);
+    }
+    if(depth == 4) {
+        memcpy(pixels, src, sizeof(uint32_t) * num_pixels);
+    } else {
+        for(size_t i = 0; i < num_pixels; i++, src += 3)
+            pixels[i] = src[0] | src[1] << 8 | src[2] << 16 | 0xFF000000u;
+    }
+    return pixels;
+}
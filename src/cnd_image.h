@@ -0,0 +1,19 @@
+/*
+ * File: cnd_image.h
+ *
+ * Header for decoding sprite image files.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_IMAGE_H
+#define CND_IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// All image decoding functions (see cnd_image.c)
+
+uint32_t *decode_image(void const* data, size_t size, int *width, int *height);
+
+#endif //CND_IMAGE_H
@@ -8,6 +8,7 @@
 
 #include "cnoodle.h"
 #include "cnd_llist.h"
+#include "cnd_arena.h"
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -123,11 +124,11 @@ int llist_get_length(llist_node* start) {
 
 /*
  * llist_get_all_ids: Get an array of all IDs in a linked list.
+ * Allocated from the calling thread's frame arena, so must not be freed.
  */
 int *llist_get_all_ids(llist_node* start) {
     llist_node* current_node = start;
-    int *ids = malloc(sizeof(int)*llist_get_length(start));
-    if(ids == NULL) exit(EXIT_FAILURE);
+    int *ids = frame_alloc(sizeof(int)*llist_get_length(start));
     for(int i=0; current_node->next != NULL; i++) {
         ids[i] = get_id(current_node->elem, current_node->type);
         current_node = current_node->next;
@@ -0,0 +1,338 @@
+/*
+ * File: cnd_loader.c
+ *
+ * Contains all source code for the asset loader.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnoodle.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+ * read_buffer: Private per-worker buffer that files are read into, grown to the largest so far.
+ */
+typedef struct {
+    char *data;
+    size_t capacity;
+} read_buffer;
+
+/*
+ * read_whole: Private method to read all of an open file into a worker's buffer.
+ *
+ * Returns (bool): false if the file could not be read, or changed size while being read.
+ */
+static bool read_whole(int fd, size_t size, read_buffer *buffer) {
+    if(size > buffer->capacity) {
+        free(buffer->data);
+        buffer->capacity = size;
+        buffer->data = malloc(size);
+        if(buffer->data == NULL) {
+            perror("Could not allocate asset buffer.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    size_t done = 0;
+    while(done < size) {
+        ssize_t count = pread(fd, buffer->data + done, size - done, (off_t) done);
+        if(count <= 0)
+            return false;
+        done += (size_t) count;
+    }
+    return true;
+}
+
+/*
+ * load_batch: Private method to read and decode a batch of jobs, outside of the loader's lock.
+ * Every file is opened and read ahead before any is read, so the kernel can fetch them all at once.
+ */
+static void load_batch(asset_job **batch, int count, bool *decoded, size_t *bytes_read, read_buffer *buffer) {
+    int fds[LOADER_BATCH];
+    size_t sizes[LOADER_BATCH];
+    for(int i = 0; i < count; i++) {
+        struct stat info;
+        fds[i] = open(batch[i]->path, O_RDONLY);
+        if(fds[i] >= 0 && fstat(fds[i], &info) != 0) {
+            close(fds[i]);
+            fds[i] = -1;
+        }
+        if(fds[i] < 0)
+            continue;
+        sizes[i] = (size_t) info.st_size;
+        posix_fadvise(fds[i], 0, 0, POSIX_FADV_WILLNEED);
+    }
+    *bytes_read = 0;
+    for(int i = 0; i < count; i++) {
+        decoded[i] = false;
+        if(fds[i] < 0)
+            continue;
+        if(read_whole(fds[i], sizes[i], buffer)) {
+            *bytes_read += sizes[i];
+            if(batch[i]->sprite != NULL)
+                decoded[i] = decode_sprite(batch[i]->sprite, buffer->data, sizes[i]);
+            else
+                decoded[i] = decode_sound(batch[i]->sound, buffer->data, sizes[i]);
+        }
+        close(fds[i]);
+    }
+}
+
+/*
+ * loader_worker: Private method run by each worker thread, loading queued jobs until the loader is freed.
+ */
+static void *loader_worker(void *arg) {
+    asset_loader *loader = arg;
+    asset_job *batch[LOADER_BATCH];
+    bool decoded[LOADER_BATCH];
+    read_buffer buffer = { NULL, 0 };
+    pthread_mutex_lock(&loader->lock);
+    for(;;) {
+        while(loader->queue_head == NULL && !loader->shutting_down)
+            pthread_cond_wait(&loader->work_cond, &loader->lock);
+        if(loader->shutting_down)
+            break;
+        // share what is queued between the workers, so a short queue is not read by one of them alone
+        int count = (loader->num_queued + loader->num_threads - 1) / loader->num_threads;
+        if(count > LOADER_BATCH)
+            count = LOADER_BATCH;
+        loader->num_queued -= count;
+        for(int i = 0; i < count; i++) {
+            batch[i] = loader->queue_head;
+            loader->queue_head = loader->queue_head->next;
+        }
+        if(loader->queue_head == NULL)
+            loader->queue_tail = NULL;
+        pthread_mutex_unlock(&loader->lock);
+
+        size_t bytes_read;
+        load_batch(batch, count, decoded, &bytes_read, &buffer);
+
+        pthread_mutex_lock(&loader->lock);
+        loader->bytes_read += (long) bytes_read;
+        for(int i = 0; i < count; i++) {
+            asset_job *job = batch[i];
+            if(!decoded[i]) {
+                loader->failed++;
+                if(job->sprite != NULL)
+                    atomic_store_explicit(&job->sprite->state, ASSET_FAILED, memory_order_release);
+                else
+                    atomic_store_explicit(&job->sound->state, ASSET_FAILED, memory_order_release);
+            } else if(job->sprite != NULL) {
+                // only the render thread can give it textures
+                loader->loaded++;
+                atomic_store_explicit(&job->sprite->state, ASSET_DECODED, memory_order_release);
+                job->next = loader->decoded;
+                loader->decoded = job;
+                atomic_fetch_add_explicit(&loader->num_decoded, 1, memory_order_release);
+            } else {
+                loader->loaded++;
+                atomic_store_explicit(&job->sound->state, ASSET_READY, memory_order_release);
+            }
+        }
+        loader->num_pending -= count;
+        if(loader->num_pending == 0)
+            pthread_cond_broadcast(&loader->idle_cond);
+    }
+    pthread_mutex_unlock(&loader->lock);
+    free(buffer.data);
+    return NULL;
+}
+
+/*
+ * make_asset_loader: Create an asset loader, to be given to a game with enable_asset_loader.
+ *
+ * num_threads (int): Number of worker threads. If 0 or less, uses one per online CPU.
+ *
+ * Returns (asset_loader *): New loader, with its threads waiting for assets.
+ */
+asset_loader *make_asset_loader(int num_threads) {
+    if(num_threads <= 0) {
+        long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = (num_cpus > 0) ? (int) num_cpus : 1;
+    }
+    asset_loader *loader = calloc(1, sizeof(asset_loader));
+    if(loader == NULL) {
+        perror("Could not allocate asset loader.");
+        exit(EXIT_FAILURE);
+    }
+    loader->num_threads = num_threads;
+    loader->threads = malloc(sizeof(pthread_t) * num_threads);
+    if(loader->threads == NULL) {
+        perror("Could not allocate asset loader threads.");
+        exit(EXIT_FAILURE);
+    }
+    atomic_init(&loader->num_decoded, 0);
+    pthread_mutex_init(&loader->lock, NULL);
+    pthread_cond_init(&loader->work_cond, NULL);
+    pthread_cond_init(&loader->idle_cond, NULL);
+    for(int i = 0; i < num_threads; i++) {
+        if(pthread_create(&loader->threads[i], NULL, loader_worker, loader) != 0) {
+            perror("Could not create asset loader thread.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return loader;
+}
+
+/*
+ * queue_job: Private method to queue an asset for the workers to load.
+ */
+static void queue_job(asset_loader *loader, t_sprite *sprite, t_sound *sound, char const* path) {
+    asset_job *job = calloc(1, sizeof(asset_job));
+    if(job == NULL || (job->path = strdup(path)) == NULL) {
+        perror("Could not allocate asset job.");
+        exit(EXIT_FAILURE);
+    }
+    job->sprite = sprite;
+    job->sound = sound;
+    pthread_mutex_lock(&loader->lock);
+    job->next_owned = loader->owned;
+    loader->owned = job;
+    if(loader->queue_tail != NULL)
+        loader->queue_tail->next = job;
+    else
+        loader->queue_head = job;
+    loader->queue_tail = job;
+    loader->num_queued++;
+    loader->num_pending++;
+    pthread_cond_signal(&loader->work_cond);
+    pthread_mutex_unlock(&loader->lock);
+}
+
+/*
+ * load_sprite_async: Add a sprite to a game at once, and load its image in the background (see decode_sprite).
+ * Its size must be given up front, as the game may use it as a hitbox before the image is read.
+ * The game must have an asset loader (see enable_asset_loader), which owns the sprite.
+ *
+ * Returns (t_sprite *): The sprite, with its ID, only usable once asset_ready.
+ */
+t_sprite *load_sprite_async(t_game_data *data, char const* path, int num_imgs, int width, int height) {
+    GLuint *texture = calloc((size_t) num_imgs + 1, sizeof(GLuint));
+    if(texture == NULL) {
+        perror("Could not allocate sprite.");
+        exit(EXIT_FAILURE);
+    }
+    t_sprite *sprite = make_sprite(num_imgs, width, height, texture);
+    atomic_init(&sprite->state, ASSET_LOADING);
+    add_sprite(data, sprite);
+    queue_job(data->loader, sprite, NULL, path);
+    return sprite;
+}
+
+/*
+ * load_sound_async: Add a sound to a game at once, and decode it into memory in the background
+ * (see load_sound). Playing it before it is loaded does nothing.
+ * The game must have an asset loader (see enable_asset_loader), which owns the sound.
+ *
+ * Returns (t_sound *): The sound, with its ID, only usable once asset_ready.
+ */
+t_sound *load_sound_async(t_game_data *data, char const* path, int volume) {
+    char *snd_path = strdup(path);
+    if(snd_path == NULL) {
+        perror("Could not allocate sound.");
+        exit(EXIT_FAILURE);
+    }
+    t_sound *sound = make_sound(snd_path, volume);
+    atomic_init(&sound->state, ASSET_LOADING);
+    add_sound(data, sound);
+    queue_job(data->loader, NULL, sound, path);
+    return sound;
+}
+
+/*
+ * loader_upload: Give decoded sprites textures with a render backend, making them usable.
+ * Must be called on the render thread; handles at most LOADER_UPLOADS_PER_FRAME sprites, so a burst
+ * of loads is spread over several frames. Never waits for the workers when none are decoded.
+ *
+ * renderer (render_backend *): Backend to create textures with, or NULL if nothing is drawn.
+ *
+ * Returns (int): Number of sprites made usable.
+ */
+int loader_upload(asset_loader *loader, render_backend *renderer) {
+    if(atomic_load_explicit(&loader->num_decoded, memory_order_acquire) == 0)
+        return 0;
+    asset_job *uploads = NULL;
+    int count = 0;
+    pthread_mutex_lock(&loader->lock);
+    while(loader->decoded != NULL && count < LOADER_UPLOADS_PER_FRAME) {
+        asset_job *job = loader->decoded;
+        loader->decoded = job->next;
+        job->next = uploads;
+        uploads = job;
+        count++;
+    }
+    atomic_fetch_sub_explicit(&loader->num_decoded, count, memory_order_relaxed);
+    pthread_mutex_unlock(&loader->lock);
+    for(asset_job *job = uploads; job != NULL; job = job->next) {
+        if(renderer != NULL)
+            renderer->upload_sprite(renderer, job->sprite);
+        atomic_store_explicit(&job->sprite->state, ASSET_READY, memory_order_release);
+    }
+    return count;
+}
+
+/*
+ * loader_reupload: Queue every usable sprite made by the loader for textures again, eg. after
+ * the render backend changed, so those made by the old backend are not drawn with the new one.
+ * The sprites are not drawn until loader_upload gives them textures once more.
+ * Must be called on the render thread.
+ */
+void loader_reupload(asset_loader *loader) {
+    int count = 0;
+    pthread_mutex_lock(&loader->lock);
+    for(asset_job *job = loader->owned; job != NULL; job = job->next_owned) {
+        if(job->sprite == NULL || !asset_ready(job->sprite))
+            continue;
+        atomic_store_explicit(&job->sprite->state, ASSET_DECODED, memory_order_relaxed);
+        job->next = loader->decoded;
+        loader->decoded = job;
+        count++;
+    }
+    atomic_fetch_add_explicit(&loader->num_decoded, count, memory_order_release);
+    pthread_mutex_unlock(&loader->lock);
+}
+
+/*
+ * loader_wait: Block until every asset given so far has been read and decoded, eg. behind a loading screen.
+ * Sprites still need loader_upload afterwards to be usable.
+ */
+void loader_wait(asset_loader *loader) {
+    pthread_mutex_lock(&loader->lock);
+    while(loader->num_pending > 0)
+        pthread_cond_wait(&loader->idle_cond, &loader->lock);
+    pthread_mutex_unlock(&loader->lock);
+}
+
+/*
+ * asset_loader_free: Stop the workers, abandoning assets not yet loaded, and free every sprite and
+ * sound made by the loader.
+ */
+void asset_loader_free(asset_loader *loader) {
+    pthread_mutex_lock(&loader->lock);
+    loader->shutting_down = true;
+    pthread_cond_broadcast(&loader->work_cond);
+    pthread_mutex_unlock(&loader->lock);
+    for(int i = 0; i < loader->num_threads; i++)
+        pthread_join(loader->threads[i], NULL);
+    asset_job *job = loader->owned;
+    while(job != NULL) {
+        asset_job *next = job->next_owned;
+        if(job->sprite != NULL)
+            free_sprite(job->sprite);
+        else
+            free_sound(job->sound);
+        free(job->path);
+        free(job);
+        job = next;
+    }
+    pthread_cond_destroy(&loader->work_cond);
+    pthread_cond_destroy(&loader->idle_cond);
+    pthread_mutex_destroy(&loader->lock);
+    free(loader->threads);
+    free(loader);
+}
@@ -0,0 +1,75 @@
+/*
+ * File: cnd_loader.h
+ *
+ * Header for the asset loader, which reads and decodes sprites and sounds on background threads.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_LOADER_H
+#define CND_LOADER_H
+
+#include "cnd_datatypes.h"
+#include "cnd_render.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define LOADER_BATCH 16     // files a worker opens and reads ahead at once
+#define LOADER_UPLOADS_PER_FRAME 32     // sprites given textures per call of loader_upload
+
+/*
+ * asset_job: One sprite or sound to read and decode.
+ */
+typedef struct asset_job {
+    t_sprite *sprite;   // exactly one of sprite and sound is set
+    t_sound *sound;
+    char *path;
+    struct asset_job *next;     // next job in the queue or decoded list
+    struct asset_job *next_owned;   // next of every job the loader has been given
+} asset_job;
+
+/*
+ * asset_loader: Worker threads reading and decoding sprites and sounds, so a game starts without
+ * waiting for every file.
+ *
+ * Sprites and sounds are added to the game data as soon as they are requested, so have IDs at once,
+ * but stay unusable until loaded (see asset_ready). Workers take queued files a batch at a time,
+ * opening every file of the batch and asking the kernel to read them all ahead before reading each
+ * whole with pread, so the disk serves a batch at once rather than one file after another.
+ * Sounds are usable once decoded. Sprites then still need textures, which the render backend
+ * can only create on the render thread, so decoded sprites wait in a list until loader_upload is
+ * called there, which makes them usable.
+ *
+ * Every sprite and sound made by the loader belongs to it, and is freed with it.
+ */
+typedef struct {
+    int num_threads;
+    pthread_t *threads;
+    pthread_mutex_t lock;   // protects everything below except num_decoded
+    pthread_cond_t work_cond;   // signalled when jobs are queued or the loader shuts down
+    pthread_cond_t idle_cond;   // signalled when the last queued job is finished
+    bool shutting_down;
+    asset_job *queue_head;  // jobs no worker has taken yet, in the order given
+    asset_job *queue_tail;
+    int num_queued;
+    asset_job *decoded;     // sprites waiting for textures
+    asset_job *owned;   // every job, so its element can be freed
+    int num_pending;    // jobs queued or being read
+    _Atomic int num_decoded;    // sprites waiting for textures, checked without locking
+    // statistics
+    long loaded;    // assets decoded
+    long failed;    // assets that could not be read or decoded
+    long bytes_read;
+} asset_loader;
+
+// All asset loader functions (see cnd_loader.c)
+
+asset_loader *make_asset_loader(int num_threads);
+t_sprite *load_sprite_async(t_game_data *data, char const* path, int num_imgs, int width, int height);
+t_sound *load_sound_async(t_game_data *data, char const* path, int volume);
+int loader_upload(asset_loader *loader, render_backend *renderer);
+void loader_reupload(asset_loader *loader);
+void loader_wait(asset_loader *loader);
+void asset_loader_free(asset_loader *loader);
+
+#endif //CND_LOADER_H
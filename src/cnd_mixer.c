@@ -0,0 +1,485 @@
+/*
+ * File: cnd_mixer.c
+ *
+ * Contains all source code for the real-time audio mixer.
+ *
+ * Each block, every voice's frames are scaled by its gain and added into the output, then the
+ * output is clipped to -1 to 1. With SSE, four samples are scaled and added at once.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_mixer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#define NS_PER_SEC 1000000000LL
+#define DECODE_FRAMES 4096      // frames decoded into a stream's ring at a time
+#define DECODE_IDLE_NS 2000000  // time the decode thread sleeps when every stream is full
+
+/*
+ * accumulate: Private method to add n samples scaled by a gain into the output.
+ */
+static void accumulate(float *restrict out, float const* restrict src, int n, float gain) {
+    for(int i = 0; i < n; i++)
+        out[i] += src[i] * gain;
+}
+
+/*
+ * clip: Private method to clamp n samples to -1 to 1.
+ */
+static void clip(float *out, int n) {
+    for(int i = 0; i < n; i++)
+        out[i] = (out[i] > 1.0f) ? 1.0f : (out[i] < -1.0f) ? -1.0f : out[i];
+}
+
+#ifdef __SSE__
+
+static void accumulate_sse(float *restrict out, float const* restrict src, int n, float gain) {
+    __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m128 a = _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(src + i), g));
+        __m128 b = _mm_add_ps(_mm_loadu_ps(out + i + 4), _mm_mul_ps(_mm_loadu_ps(src + i + 4), g));
+        _mm_storeu_ps(out + i, a);
+        _mm_storeu_ps(out + i + 4, b);
+    }
+    accumulate(out + i, src + i, n - i, gain);
+}
+
+static void clip_sse(float *out, int n) {
+    __m128 hi = _mm_set1_ps(1.0f), lo = _mm_set1_ps(-1.0f);
+    int i = 0;
+    for(; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, _mm_max_ps(lo, _mm_min_ps(hi, _mm_loadu_ps(out + i))));
+    clip(out + i, n - i);
+}
+
+#endif
+
+/*
+ * mix_samples: Private method to add samples into the output, with SSE if enabled.
+ */
+static void mix_samples(audio_mixer const* mixer, float *out, float const* src, int n, float gain) {
+#ifdef __SSE__
+    if(mixer->use_simd) {
+        accumulate_sse(out, src, n, gain);
+        return;
+    }
+#endif
+    accumulate(out, src, n, gain);
+}
+
+static void clip_samples(audio_mixer const* mixer, float *out, int n) {
+#ifdef __SSE__
+    if(mixer->use_simd) {
+        clip_sse(out, n);
+        return;
+    }
+#endif
+    clip(out, n);
+}
+
+/*
+ * retire_stream: Private method to hand a stream back to the decode thread, to be closed and freed.
+ */
+static void retire_stream(mixer_stream *stream) {
+    if(stream != NULL)
+        atomic_store_explicit(&stream->state, STREAM_RETIRED, memory_order_release);
+}
+
+/*
+ * return_samples: Private method to hand a borrowed play's samples back to the game's thread, once
+ * the audio thread will no longer read them.
+ */
+static void return_samples(audio_mixer *mixer, int sound_id, bool borrowed) {
+    if(borrowed && spsc_ring_write(&mixer->returns, &sound_id, 1) == 0)
+        atomic_fetch_add_explicit(&mixer->returns_dropped, 1, memory_order_relaxed);
+}
+
+/*
+ * run_command: Private method to carry out one command on the audio thread.
+ */
+static void run_command(audio_mixer *mixer, mixer_command const* command) {
+    bool resumed = false;
+    for(int i = 0; i < MIXER_MAX_VOICES; i++) {
+        mixer_voice *voice = &mixer->voices[i];
+        if(voice->sound_id != command->sound_id)
+            continue;
+        switch(command->type) {
+            case MIXER_PLAY:
+                resumed = resumed || voice->paused;
+                voice->paused = false;
+                break;
+            case MIXER_PAUSE:
+                voice->paused = true;
+                break;
+            case MIXER_END:
+                retire_stream(voice->stream);
+                return_samples(mixer, voice->sound_id, voice->borrowed);
+                voice->sound_id = 0;
+                break;
+        }
+    }
+    if(command->type != MIXER_PLAY)
+        return;
+    if(resumed) {
+        retire_stream(command->stream);     // opened for nothing, as the sound was only paused
+        return_samples(mixer, command->sound_id, command->borrowed);
+        return;
+    }
+    for(int i = 0; i < MIXER_MAX_VOICES; i++) {
+        mixer_voice *voice = &mixer->voices[i];
+        if(voice->sound_id == 0) {
+            *voice = (mixer_voice) {
+                    .sound_id = command->sound_id, .gain = command->gain, .samples = command->samples,
+                    .num_frames = command->num_frames, .borrowed = command->borrowed, .stream = command->stream
+            };
+            return;
+        }
+    }
+    retire_stream(command->stream);
+    return_samples(mixer, command->sound_id, command->borrowed);
+    atomic_fetch_add_explicit(&mixer->voices_dropped, 1, memory_order_relaxed);
+}
+
+/*
+ * mix_block: Private method to mix up to MIXER_BLOCK_FRAMES frames of every voice into the output.
+ */
+static void mix_block(audio_mixer *mixer, float *out, int num_frames) {
+    memset(out, 0, sizeof(float) * 2 * num_frames);
+    int playing = 0;
+    bool underrun = false;
+    for(int i = 0; i < MIXER_MAX_VOICES; i++) {
+        mixer_voice *voice = &mixer->voices[i];
+        if(voice->sound_id == 0)
+            continue;
+        if(voice->paused) {
+            playing++;
+            continue;
+        }
+        int count;
+        bool ended;
+        if(voice->stream != NULL) {
+            // check for the end before reading, so frames decoded just before it was set are not missed
+            bool finished = atomic_load_explicit(&voice->stream->finished, memory_order_acquire);
+            count = (int) spsc_ring_read(&voice->stream->frames, mixer->stream_frames, num_frames);
+            ended = finished && spsc_ring_count(&voice->stream->frames) == 0;
+            underrun = underrun || (!finished && count < num_frames);
+            mix_samples(mixer, out, mixer->stream_frames, 2 * count, voice->gain);
+        } else {
+            long left = voice->num_frames - voice->position;
+            count = (left < num_frames) ? (int) left : num_frames;
+            ended = count == left;
+            mix_samples(mixer, out, voice->samples + 2 * voice->position, 2 * count, voice->gain);
+        }
+        voice->position += count;
+        if(ended) {
+            retire_stream(voice->stream);
+            return_samples(mixer, voice->sound_id, voice->borrowed);
+            voice->sound_id = 0;
+        } else {
+            playing++;
+        }
+    }
+    clip_samples(mixer, out, 2 * num_frames);
+    if(underrun)
+        atomic_fetch_add_explicit(&mixer->underruns, 1, memory_order_relaxed);
+    // released, so once a sound is seen to have stopped its samples can be freed
+    atomic_store_explicit(&mixer->voices_playing, playing, memory_order_release);
+    atomic_fetch_add_explicit(&mixer->frames_mixed, num_frames, memory_order_relaxed);
+}
+
+/*
+ * mixer_mix: Mix the next frames of every sound playing. Called by the output device's audio thread,
+ * or directly to mix offline, eg. to render to a file or to benchmark; only one thread may call it.
+ * Never locks or allocates.
+ *
+ * out (float *): Array of 2 * num_frames floats, filled with interleaved stereo frames.
+ */
+void mixer_mix(audio_mixer *mixer, float *out, int num_frames) {
+    mixer_command command;
+    while(spsc_ring_read(&mixer->commands, &command, 1) == 1)
+        run_command(mixer, &command);
+    for(int done = 0; done < num_frames; done += MIXER_BLOCK_FRAMES) {
+        int count = (num_frames - done < MIXER_BLOCK_FRAMES) ? num_frames - done : MIXER_BLOCK_FRAMES;
+        mix_block(mixer, out + 2 * done, count);
+    }
+}
+
+/*
+ * decode_streams: Private method run by the decode thread, keeping every active stream's ring topped up,
+ * and closing streams the audio thread has finished with.
+ */
+static void *decode_streams(void *arg) {
+    audio_mixer *mixer = arg;
+    float *frames = malloc(sizeof(float) * 2 * DECODE_FRAMES);
+    if(frames == NULL) {
+        perror("Could not allocate stream decoding buffer.");
+        exit(EXIT_FAILURE);
+    }
+    while(atomic_load_explicit(&mixer->decoding, memory_order_relaxed)) {
+        bool busy = false;
+        for(int i = 0; i < MIXER_MAX_STREAMS; i++) {
+            mixer_stream *stream = &mixer->streams[i];
+            int state = atomic_load_explicit(&stream->state, memory_order_acquire);
+            if(state == STREAM_RETIRED) {
+                wav_close(&stream->reader);
+                spsc_ring_clear(&stream->frames);
+                atomic_store_explicit(&stream->finished, false, memory_order_relaxed);
+                atomic_store_explicit(&stream->state, STREAM_FREE, memory_order_release);
+            } else if(state == STREAM_ACTIVE && !atomic_load_explicit(&stream->finished, memory_order_relaxed)
+                      && spsc_ring_space(&stream->frames) >= DECODE_FRAMES) {
+                long count = wav_read(&stream->reader, frames, DECODE_FRAMES);
+                spsc_ring_write(&stream->frames, frames, (unsigned) count);
+                if(count < DECODE_FRAMES)
+                    atomic_store_explicit(&stream->finished, true, memory_order_release);
+                busy = true;
+            }
+        }
+        if(!busy) {
+            struct timespec idle = { .tv_sec = 0, .tv_nsec = DECODE_IDLE_NS };
+            nanosleep(&idle, NULL);
+        }
+    }
+    free(frames);
+    return NULL;
+}
+
+/*
+ * make_mixer: Create a mixer with nothing playing, and start its decode thread.
+ * Nothing is heard until an output is opened with mixer_open_output.
+ */
+audio_mixer *make_mixer() {
+    audio_mixer *mixer = calloc(1, sizeof(*mixer));
+    if(mixer == NULL) {
+        perror("Could not allocate mixer.");
+        exit(EXIT_FAILURE);
+    }
+    init_spsc_ring(&mixer->commands, MIXER_COMMANDS, sizeof(mixer_command));
+    init_spsc_ring(&mixer->returns, MIXER_RETURNS, sizeof(int));
+    mixer->stream_frames = malloc(sizeof(float) * 2 * MIXER_BLOCK_FRAMES);
+    if(mixer->stream_frames == NULL) {
+        perror("Could not allocate mixer.");
+        exit(EXIT_FAILURE);
+    }
+    for(int i = 0; i < MIXER_MAX_STREAMS; i++) {
+        atomic_init(&mixer->streams[i].state, STREAM_FREE);
+        atomic_init(&mixer->streams[i].finished, false);
+        init_spsc_ring(&mixer->streams[i].frames, MIXER_STREAM_FRAMES, sizeof(float) * 2);
+    }
+#ifdef __SSE__
+    mixer->use_simd = true;
+#endif
+    atomic_init(&mixer->decoding, true);
+    if(pthread_create(&mixer->decoder, NULL, decode_streams, mixer) != 0) {
+        perror("Could not start stream decoding thread.");
+        exit(EXIT_FAILURE);
+    }
+    return mixer;
+}
+
+/*
+ * send_command: Private method to queue a command for the audio thread, counting it if the queue is full.
+ */
+static bool send_command(audio_mixer *mixer, mixer_command const* command) {
+    if(spsc_ring_write(&mixer->commands, command, 1) == 1)
+        return true;
+    mixer->commands_dropped++;
+    return false;
+}
+
+/*
+ * mixer_play: Play a sound loaded in memory, or resume it if paused.
+ * Only to be called by one thread, ie. the game's update loop, as for all commands.
+ *
+ * samples (float const*): Interleaved stereo frames at MIXER_SAMPLE_RATE, which must stay valid while playing.
+ * gain (float): Factor each sample is multiplied by.
+ *
+ * Returns (bool): false if the command could not be sent, as too many are queued.
+ */
+bool mixer_play(audio_mixer *mixer, int sound_id, float const* samples, long num_frames, float gain) {
+    mixer_command command = {
+            .type = MIXER_PLAY, .sound_id = sound_id, .gain = gain, .samples = samples, .num_frames = num_frames
+    };
+    return send_command(mixer, &command);
+}
+
+/*
+ * mixer_play_borrowed: Play samples borrowed from their owner, eg. a sound cache, or resume the sound if paused.
+ * Every borrowed play is handed back by mixer_take_returns exactly once, when the audio thread
+ * has finished with it, even if it never played; until then, the samples must stay valid.
+ */
+bool mixer_play_borrowed(audio_mixer *mixer, int sound_id, float const* samples, long num_frames, float gain) {
+    mixer_command command = {
+            .type = MIXER_PLAY, .sound_id = sound_id, .gain = gain, .samples = samples, .num_frames = num_frames,
+            .borrowed = true
+    };
+    return send_command(mixer, &command);
+}
+
+/*
+ * mixer_take_returns: Take back borrowed plays the audio thread has finished with.
+ * Only to be called by the thread sending commands.
+ *
+ * sound_ids (int *): Array of max_returns IDs, filled with the sound ID of each play handed back.
+ *
+ * Returns (int): Number of plays handed back.
+ */
+int mixer_take_returns(audio_mixer *mixer, int *sound_ids, int max_returns) {
+    return (int) spsc_ring_read(&mixer->returns, sound_ids, (unsigned) max_returns);
+}
+
+/*
+ * mixer_play_stream: Play a WAV file while decoding it on the decode thread, or resume the sound if paused.
+ * The first frames are decoded before returning, so it starts without an underrun.
+ *
+ * Returns (bool): false if the file cannot be read or is not at MIXER_SAMPLE_RATE, every stream is
+ * in use, or the command could not be sent.
+ */
+bool mixer_play_stream(audio_mixer *mixer, int sound_id, char const* path, float gain) {
+    mixer_stream *stream = NULL;
+    for(int i = 0; i < MIXER_MAX_STREAMS && stream == NULL; i++) {
+        if(atomic_load_explicit(&mixer->streams[i].state, memory_order_acquire) == STREAM_FREE)
+            stream = &mixer->streams[i];
+    }
+    if(stream == NULL || !wav_open(&stream->reader, path))
+        return false;
+    if(stream->reader.sample_rate != MIXER_SAMPLE_RATE) {
+        wav_close(&stream->reader);
+        return false;
+    }
+    // the stream is not yet shared, so this thread can decode into it as the decode thread would
+    float frames[2 * MIXER_BLOCK_FRAMES];
+    for(int i = 0; i < 4 && !atomic_load_explicit(&stream->finished, memory_order_relaxed); i++) {
+        long count = wav_read(&stream->reader, frames, MIXER_BLOCK_FRAMES);
+        spsc_ring_write(&stream->frames, frames, (unsigned) count);
+        if(count < MIXER_BLOCK_FRAMES)
+            atomic_store_explicit(&stream->finished, true, memory_order_relaxed);
+    }
+    atomic_store_explicit(&stream->state, STREAM_ACTIVE, memory_order_release);
+    mixer_command command = { .type = MIXER_PLAY, .sound_id = sound_id, .gain = gain, .stream = stream };
+    if(send_command(mixer, &command))
+        return true;
+    retire_stream(stream);
+    return false;
+}
+
+/*
+ * mixer_pause: Pause every play of a sound, until it is played again.
+ */
+bool mixer_pause(audio_mixer *mixer, int sound_id) {
+    mixer_command command = { .type = MIXER_PAUSE, .sound_id = sound_id };
+    return send_command(mixer, &command);
+}
+
+/*
+ * mixer_end: Stop every play of a sound.
+ */
+bool mixer_end(audio_mixer *mixer, int sound_id) {
+    mixer_command command = { .type = MIXER_END, .sound_id = sound_id };
+    return send_command(mixer, &command);
+}
+
+static int portaudio_callback(void const* input, void *output, unsigned long num_frames,
+                              PaStreamCallbackTimeInfo const* time_info, PaStreamCallbackFlags flags, void *user_data) {
+    mixer_mix(user_data, output, (int) num_frames);
+    return paContinue;
+}
+
+/*
+ * run_null_device: Private method run by the null device's thread, mixing a block whenever a real
+ * device would ask for one, and throwing it away.
+ */
+static void *run_null_device(void *arg) {
+    audio_mixer *mixer = arg;
+    float out[2 * MIXER_BLOCK_FRAMES];
+    long long block_ns = NS_PER_SEC * MIXER_BLOCK_FRAMES / MIXER_SAMPLE_RATE;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long due_ns = (long long) now.tv_sec * NS_PER_SEC + now.tv_nsec;
+    while(atomic_load_explicit(&mixer->null_running, memory_order_relaxed)) {
+        mixer_mix(mixer, out, MIXER_BLOCK_FRAMES);
+        due_ns += block_ns;
+        struct timespec until = { .tv_sec = due_ns / NS_PER_SEC, .tv_nsec = due_ns % NS_PER_SEC };
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR);
+    }
+    return NULL;
+}
+
+/*
+ * mixer_open_output: Start playing the mix on an output, closing any output already open.
+ *
+ * Returns (bool): false if the output could not be opened, eg. there is no sound device.
+ */
+bool mixer_open_output(audio_mixer *mixer, enum audio_output output) {
+    mixer_close_output(mixer);
+    mixer->output = output;
+    if(output == AUDIO_NULL) {
+        atomic_store(&mixer->null_running, true);
+        if(pthread_create(&mixer->null_device, NULL, run_null_device, mixer) != 0) {
+            perror("Could not start null audio device.");
+            return false;
+        }
+        mixer->output_open = true;
+        return true;
+    }
+    PaError error = Pa_Initialize();
+    if(error == paNoError) {
+        error = Pa_OpenDefaultStream(&mixer->pa_stream, 0, 2, paFloat32, MIXER_SAMPLE_RATE, MIXER_BLOCK_FRAMES,
+                                     portaudio_callback, mixer);
+        if(error == paNoError) {
+            error = Pa_StartStream(mixer->pa_stream);
+            if(error == paNoError) {
+                mixer->output_open = true;
+                return true;
+            }
+            Pa_CloseStream(mixer->pa_stream);
+        }
+        Pa_Terminate();
+    }
+    fprintf(stderr, "Could not open audio output: %s\n", Pa_GetErrorText(error));
+    return false;
+}
+
+/*
+ * mixer_close_output: Stop playing the mix on its output, if one is open.
+ * Once closed, the mix can be mixed offline with mixer_mix.
+ */
+void mixer_close_output(audio_mixer *mixer) {
+    if(!mixer->output_open)
+        return;
+    if(mixer->output == AUDIO_NULL) {
+        atomic_store(&mixer->null_running, false);
+        pthread_join(mixer->null_device, NULL);
+    } else {
+        Pa_StopStream(mixer->pa_stream);
+        Pa_CloseStream(mixer->pa_stream);
+        Pa_Terminate();
+    }
+    mixer->output_open = false;
+}
+
+/*
+ * mixer_free: Close a mixer's output, stop its decode thread and free it.
+ */
+void mixer_free(audio_mixer *mixer) {
+    mixer_close_output(mixer);
+    atomic_store(&mixer->decoding, false);
+    pthread_join(mixer->decoder, NULL);
+    for(int i = 0; i < MIXER_MAX_STREAMS; i++) {
+        wav_close(&mixer->streams[i].reader);
+        spsc_ring_free(&mixer->streams[i].frames);
+    }
+    spsc_ring_free(&mixer->commands);
+    spsc_ring_free(&mixer->returns);
+    free(mixer->stream_frames);
+    free(mixer);
+}
@@ -0,0 +1,135 @@
+/*
+ * File: cnd_mixer.h
+ *
+ * Header for the real-time audio mixer.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_MIXER_H
+#define CND_MIXER_H
+
+#include "cnd_ring.h"
+#include "cnd_wav.h"
+#include <portaudio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#define MIXER_SAMPLE_RATE 44100     // frames per second of output, and of every sound played
+#define MIXER_MAX_VOICES 64     // sounds playing at once, counting each play of a sound
+#define MIXER_MAX_STREAMS 8     // sounds streamed from disk at once
+#define MIXER_BLOCK_FRAMES 256  // frames mixed at a time, and asked for by the output device
+#define MIXER_COMMANDS 256      // commands queued for the audio thread before more are dropped
+#define MIXER_STREAM_FRAMES 32768   // frames decoded ahead of each stream, about 0.75 seconds
+#define MIXER_RETURNS 512       // borrowed plays finished but not yet taken back, more than can be outstanding
+
+/*
+ * audio_output: Where a mixer's output goes.
+ */
+enum audio_output {
+    AUDIO_PORTAUDIO,    // the default output device, through PortAudio
+    AUDIO_NULL      // nowhere, mixed on a thread at the same pace a device would ask for it
+};
+
+/*
+ * stream_state: Stage of a stream slot's life. Each change is only ever made by one thread.
+ */
+enum stream_state {
+    STREAM_FREE,    // unused; the game's thread may claim it
+    STREAM_ACTIVE,  // being decoded by the decode thread, and played by the audio thread
+    STREAM_RETIRED  // finished with by the audio thread; the decode thread closes it, then frees it
+};
+
+/*
+ * mixer_stream: A sound decoded from disk a little ahead of where it is playing, for long tracks.
+ */
+typedef struct {
+    _Atomic int state;      // a stream_state
+    _Atomic bool finished;  // whether the whole file has been decoded into the ring
+    wav_reader reader;  // owned by the decode thread while active
+    spsc_ring frames;   // decoded stereo frames, from the decode thread to the audio thread
+} mixer_stream;
+
+/*
+ * mixer_command_type: Requests from the game to the audio thread, sent by PLAY_SND, PAUSE_SND and END_SND.
+ */
+enum mixer_command_type {
+    MIXER_PLAY,     // resume the sound if paused, otherwise start playing it again
+    MIXER_PAUSE,    // pause every play of the sound
+    MIXER_END       // stop every play of the sound
+};
+
+typedef struct {
+    enum mixer_command_type type;
+    int sound_id;
+    float gain;     // all for MIXER_PLAY only
+    float const* samples;   // stereo frames of a sound loaded in memory, or NULL if streamed
+    long num_frames;
+    bool borrowed;  // whether the samples are handed back through the returns ring once finished with
+    mixer_stream *stream;   // stream of the sound if not loaded in memory
+} mixer_command;
+
+/*
+ * mixer_voice: One play of a sound. Owned by the audio thread.
+ */
+typedef struct {
+    int sound_id;   // 0 if the voice is not playing anything
+    bool paused;
+    float gain;
+    float const* samples;   // sound loaded in memory, or NULL if streamed
+    long num_frames;
+    long position;  // frames played so far
+    bool borrowed;
+    mixer_stream *stream;
+} mixer_voice;
+
+/*
+ * audio_mixer: Mixes every sound playing into one stereo output, on the output device's audio thread.
+ *
+ * The game's thread (ie. the update loop dispatching sound commands) sends commands through a
+ * lock free ring, and the audio thread takes them at the start of each block it mixes, so the
+ * audio thread never locks, allocates or touches a file. Sounds loaded in memory are mixed
+ * straight from their samples. Streamed sounds are decoded by a background thread into a ring
+ * per stream, which the audio thread reads from; if the decode thread falls behind, the stream
+ * is silent until it catches up, and this is counted as an underrun.
+ */
+typedef struct {
+    spsc_ring commands;     // mixer_commands from the game's thread to the audio thread
+    spsc_ring returns;      // sound IDs of borrowed plays finished with, from the audio thread to the game's thread
+    mixer_voice voices[MIXER_MAX_VOICES];
+    mixer_stream streams[MIXER_MAX_STREAMS];
+    float *stream_frames;   // a block of frames read from a stream, used by the audio thread only
+    bool use_simd;  // mix with SSE, otherwise one sample at a time
+    pthread_t decoder;  // thread decoding streams
+    _Atomic bool decoding;  // cleared to stop the decode thread
+    // output
+    enum audio_output output;
+    bool output_open;
+    PaStream *pa_stream;    // PortAudio stream, if output is AUDIO_PORTAUDIO
+    pthread_t null_device;  // thread asking for blocks, if output is AUDIO_NULL
+    _Atomic bool null_running;  // cleared to stop the null device's thread
+    // statistics, kept by the audio thread
+    _Atomic long frames_mixed;
+    _Atomic int voices_playing;     // voices playing or paused after the last block mixed
+    _Atomic long underruns;     // blocks in which a stream had fewer frames decoded than it needed
+    _Atomic long voices_dropped;    // plays ignored as every voice was in use
+    _Atomic long returns_dropped;   // borrowed plays not handed back as the returns ring was full
+    long commands_dropped;  // commands not sent as the ring was full, kept by the game's thread
+} audio_mixer;
+
+// All mixer functions (see cnd_mixer.c)
+
+audio_mixer *make_mixer();
+bool mixer_open_output(audio_mixer *mixer, enum audio_output output);
+void mixer_close_output(audio_mixer *mixer);
+bool mixer_play(audio_mixer *mixer, int sound_id, float const* samples, long num_frames, float gain);
+bool mixer_play_borrowed(audio_mixer *mixer, int sound_id, float const* samples, long num_frames, float gain);
+int mixer_take_returns(audio_mixer *mixer, int *sound_ids, int max_returns);
+bool mixer_play_stream(audio_mixer *mixer, int sound_id, char const* path, float gain);
+bool mixer_pause(audio_mixer *mixer, int sound_id);
+bool mixer_end(audio_mixer *mixer, int sound_id);
+void mixer_mix(audio_mixer *mixer, float *out, int num_frames);
+void mixer_free(audio_mixer *mixer);
+
+#endif //CND_MIXER_H
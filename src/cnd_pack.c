@@ -0,0 +1,393 @@
+/*
+ * File: cnd_pack.c
+ *
+ * Contains all source code for loading and saving game packs.
+ *
+ * A pack is mapped rather than read, and its sections are laid out exactly as they are used, so
+ * loading is one pass over each array with no parsing; the string table is used where it is
+ * mapped. Packs are only read and written on little endian machines, so that they can be.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnoodle.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Game packs are little endian, and are mapped without converting."
+#endif
+
+_Static_assert(sizeof(int) == sizeof(int32_t), "Room entity IDs are copied straight from packs.");
+
+#define PACK_ALIGN 8
+
+static uint64_t align_up(uint64_t offset) {
+    return (offset + PACK_ALIGN - 1) / PACK_ALIGN * PACK_ALIGN;
+}
+
+/*
+ * section_fits: Private method to check a section of count elements lies within a pack of some size.
+ */
+static bool section_fits(uint64_t offset, uint64_t count, size_t elem_size, size_t size) {
+    return offset % PACK_ALIGN == 0 && offset <= size && count <= (size - offset) / elem_size;
+}
+
+/*
+ * valid_id: Private method to check an ID in a pack could have been given out by add_entity and co.
+ */
+static bool valid_id(int32_t id, struct pack_header const* header) {
+    return id > 0 && id <= header->max_id;
+}
+
+static int compare_ids(void const* a, void const* b) {
+    return (*(int const*) a > *(int const*) b) - (*(int const*) a < *(int const*) b);
+}
+
+/*
+ * has_duplicate_ids: Private method to check whether any two pack elements of one type share an ID,
+ * which adding them to the game data would silently overwrite.
+ * Every pack element type starts with its ID, so elements are read 'stride' bytes apart.
+ */
+static bool has_duplicate_ids(void const* elems, uint32_t count, size_t stride) {
+    int *ids = malloc(sizeof(int) * (count > 0 ? count : 1));
+    if(ids == NULL) {
+        perror("Could not allocate game pack IDs.");
+        exit(EXIT_FAILURE);
+    }
+    for(uint32_t i = 0; i < count; i++)
+        memcpy(&ids[i], (char const*) elems + i * stride, sizeof(int32_t));
+    qsort(ids, count, sizeof(int), compare_ids);
+    bool duplicate = false;
+    for(uint32_t i = 1; i < count && !duplicate; i++)
+        duplicate = ids[i] == ids[i - 1];
+    free(ids);
+    return duplicate;
+}
+
+/*
+ * check_pack: Private method to check a mapped pack is whole and consistent, so loading needs no checks.
+ *
+ * Returns (char const*): Why the pack cannot be loaded, or NULL if it can.
+ */
+static char const* check_pack(void const* mapping, size_t size) {
+    struct pack_header const* header = mapping;
+    if(size < sizeof(*header) || memcmp(header->magic, PACK_MAGIC, sizeof(header->magic)) != 0)
+        return "not a game pack";
+    if(header->version != PACK_VERSION || header->header_size != sizeof(*header))
+        return "made for another version of CNoodle";
+    if(!section_fits(header->strings_offset, header->strings_size, 1, size)
+            || !section_fits(header->rooms_offset, header->num_rooms, sizeof(struct pack_room), size)
+            || !section_fits(header->room_entity_ids_offset, header->num_room_entity_ids, sizeof(int32_t), size)
+            || !section_fits(header->sprites_offset, header->num_sprites, sizeof(struct pack_sprite), size)
+            || !section_fits(header->sounds_offset, header->num_sounds, sizeof(struct pack_sound), size)
+            || !section_fits(header->entities_offset, header->num_entities, sizeof(struct pack_entity), size))
+        return "truncated";
+    if(header->max_id < 0 || header->num_rooms > INT32_MAX || header->num_sprites > INT32_MAX
+            || header->num_sounds > INT32_MAX || header->num_entities > INT32_MAX)
+        return "too large";
+    char const* strings = (char const*) mapping + header->strings_offset;
+    if(header->strings_size == 0 || strings[0] != '\0' || strings[header->strings_size - 1] != '\0')
+        return "string table is not terminated";
+    struct pack_room const* rooms = (void const*) ((char const*) mapping + header->rooms_offset);
+    for(uint32_t i = 0; i < header->num_rooms; i++) {
+        if(!valid_id(rooms[i].room_id, header)
+                || (uint64_t) rooms[i].first_entity + rooms[i].num_entities > header->num_room_entity_ids)
+            return "room out of range";
+    }
+    struct pack_sprite const* sprites = (void const*) ((char const*) mapping + header->sprites_offset);
+    uint64_t num_imgs = 0;
+    for(uint32_t i = 0; i < header->num_sprites; i++) {
+        if(!valid_id(sprites[i].spr_id, header) || sprites[i].num_imgs < 0)
+            return "sprite out of range";
+        num_imgs += (uint64_t) sprites[i].num_imgs;
+    }
+    if(num_imgs > INT32_MAX)
+        return "too large";
+    struct pack_sound const* sounds = (void const*) ((char const*) mapping + header->sounds_offset);
+    for(uint32_t i = 0; i < header->num_sounds; i++) {
+        if(!valid_id(sounds[i].snd_id, header) || sounds[i].path >= header->strings_size)
+            return "sound out of range";
+    }
+    struct pack_entity const* entities = (void const*) ((char const*) mapping + header->entities_offset);
+    for(uint32_t i = 0; i < header->num_entities; i++) {
+        if(!valid_id(entities[i].id, header))
+            return "entity out of range";
+    }
+    if(has_duplicate_ids(rooms, header->num_rooms, sizeof(*rooms))
+            || has_duplicate_ids(sprites, header->num_sprites, sizeof(*sprites))
+            || has_duplicate_ids(sounds, header->num_sounds, sizeof(*sounds))
+            || has_duplicate_ids(entities, header->num_entities, sizeof(*entities)))
+        return "an ID is used twice";
+    return NULL;
+}
+
+/*
+ * open_game_pack: Map a pack file into memory and check it can be loaded.
+ *
+ * Returns (game_pack *): The pack, with nothing loaded from it yet, or NULL if it cannot be read
+ * or is not a valid pack, having printed why.
+ */
+game_pack *open_game_pack(char const* path) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if(fd < 0 || fstat(fd, &info) != 0) {
+        perror("Could not open game pack");
+        if(fd >= 0)
+            close(fd);
+        return NULL;
+    }
+    size_t size = (size_t) info.st_size;
+    void *mapping = (size > 0) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    char const* problem = (mapping == MAP_FAILED) ? "empty or cannot be mapped" : check_pack(mapping, size);
+    if(problem != NULL) {
+        fprintf(stderr, "Could not load game pack %s: %s.\n", path, problem);
+        if(mapping != MAP_FAILED)
+            munmap(mapping, size);
+        return NULL;
+    }
+    game_pack *pack = calloc(1, sizeof(*pack));
+    if(pack == NULL) {
+        perror("Could not allocate game pack.");
+        exit(EXIT_FAILURE);
+    }
+    pack->mapping = mapping;
+    pack->size = size;
+    pack->header = mapping;
+    return pack;
+}
+
+/*
+ * pack_array: Private method to allocate one array for every element of a type in a pack.
+ */
+static void *pack_array(uint32_t count, size_t elem_size) {
+    void *array = calloc(count > 0 ? count : 1, elem_size);
+    if(array == NULL) {
+        perror("Could not allocate game pack elements.");
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
+
+/*
+ * load_game_pack: Add every element of a pack to game data, keeping their IDs, and set the screen
+ * size and current room. The game data takes ownership of the pack, freeing it in gamedata_free;
+ * only one pack can be loaded into a game data.
+ * Entities are loaded without event handlers, to be set by the game afterwards.
+ */
+void load_game_pack(t_game_data *data, game_pack *pack) {
+    if(data->pack != NULL) {
+        fprintf(stderr, "Game data already has a pack loaded.\n");
+        game_pack_free(pack);
+        return;
+    }
+    data->pack = pack;
+    struct pack_header const* header = pack->header;
+    char const* base = pack->mapping;
+
+    struct pack_room const* rooms = (void const*) (base + header->rooms_offset);
+    int32_t const* room_entity_ids = (void const*) (base + header->room_entity_ids_offset);
+    pack->rooms = pack_array(header->num_rooms, sizeof(t_room));
+    for(uint32_t i = 0; i < header->num_rooms; i++) {
+        t_room *room = &pack->rooms[i];
+        room->room_id = rooms[i].room_id;
+        room->width = rooms[i].width;
+        room->height = rooms[i].height;
+        room->num_entities = (int) rooms[i].num_entities;
+        // copied, as rooms own their arrays and may free them when altered
+        room->entity_ids = malloc(sizeof(int) * (rooms[i].num_entities > 0 ? rooms[i].num_entities : 1));
+        if(room->entity_ids == NULL) {
+            perror("Could not allocate room entity IDs.");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(room->entity_ids, room_entity_ids + rooms[i].first_entity, sizeof(int) * rooms[i].num_entities);
+        hashtable_add(&data->rooms, room, ROOM);
+        data->num_rooms++;
+    }
+
+    struct pack_sprite const* sprites = (void const*) (base + header->sprites_offset);
+    pack->sprites = pack_array(header->num_sprites, sizeof(t_sprite));
+    uint32_t num_imgs = 0;
+    for(uint32_t i = 0; i < header->num_sprites; i++)
+        num_imgs += (uint32_t) sprites[i].num_imgs;
+    // no images are loaded yet, so every subimage starts with no texture, ie. draws nothing
+    pack->sprite_textures = pack_array(num_imgs, sizeof(GLuint));
+    num_imgs = 0;
+    for(uint32_t i = 0; i < header->num_sprites; i++) {
+        t_sprite *sprite = &pack->sprites[i];
+        sprite->spr_id = sprites[i].spr_id;
+        sprite->num_imgs = sprites[i].num_imgs;
+        sprite->width = sprites[i].width;
+        sprite->height = sprites[i].height;
+        sprite->texture = pack->sprite_textures + num_imgs;
+        num_imgs += (uint32_t) sprites[i].num_imgs;
+        hashtable_add(&data->sprites, sprite, SPRITE);
+        data->num_sprites++;
+    }
+
+    struct pack_sound const* sounds = (void const*) (base + header->sounds_offset);
+    char const* strings = base + header->strings_offset;
+    pack->sounds = pack_array(header->num_sounds, sizeof(t_sound));
+    for(uint32_t i = 0; i < header->num_sounds; i++) {
+        t_sound *sound = &pack->sounds[i];
+        sound->snd_id = sounds[i].snd_id;
+        sound->volume = sounds[i].volume;
+        sound->snd_path = (char *) strings + sounds[i].path;    // only ever read
+        hashtable_add(&data->sounds, sound, SOUND);
+        data->num_sounds++;
+    }
+
+    struct pack_entity const* entities = (void const*) (base + header->entities_offset);
+    pack->entities = pack_array(header->num_entities, sizeof(t_entity));
+    for(uint32_t i = 0; i < header->num_entities; i++) {
+        t_entity *entity = &pack->entities[i];
+        entity->id = entities[i].id;
+        entity->current_spr_id = entities[i].current_spr_id;
+        entity->spr_period = entities[i].spr_period;
+        entity->spr_current_img = entities[i].spr_current_img;
+        entity->x = entities[i].x;
+        entity->y = entities[i].y;
+        entity->depth = entities[i].depth;
+        slotmap_add(&data->entities, entity->id, entity);
+        data->num_entities++;
+    }
+    // rooms were loaded before their entities existed
+    for(uint32_t i = 0; i < header->num_rooms; i++)
+        index_room(data, &pack->rooms[i]);
+
+    data->scr_width = header->scr_width;
+    data->scr_height = header->scr_height;
+    data->current_room_id = header->current_room_id;
+    if(header->max_id > data->max_id)
+        data->max_id = header->max_id;
+}
+
+/*
+ * sorted_ids: Private method to get the IDs of a hashtable in order, so packs of the same data are identical.
+ */
+static int *sorted_ids(hashtable const* table) {
+    int *ids = hashtable_get_ids(table);
+    qsort(ids, (size_t) hashtable_get_num_entries(table), sizeof(int), compare_ids);
+    return ids;
+}
+
+/*
+ * save_game_pack: Write every room, sprite, sound and entity of game data to a pack file, with
+ * the screen size and current room. Event handlers, ent_data and sprite images are not saved.
+ *
+ * Returns (bool): false if the file could not be written.
+ */
+bool save_game_pack(t_game_data *data, char const* path) {
+    int num_rooms = hashtable_get_num_entries(&data->rooms);
+    int num_sprites = hashtable_get_num_entries(&data->sprites);
+    int num_sounds = hashtable_get_num_entries(&data->sounds);
+    int num_entities = slotmap_get_num_entries(&data->entities);
+    int *room_ids = sorted_ids(&data->rooms);
+    int *sprite_ids = sorted_ids(&data->sprites);
+    int *sound_ids = sorted_ids(&data->sounds);
+    // lay out every section before writing any of it
+    uint64_t num_room_entity_ids = 0, strings_size = 1;
+    for(int i = 0; i < num_rooms; i++)
+        num_room_entity_ids += (uint64_t) get_room(data, room_ids[i])->num_entities;
+    for(int i = 0; i < num_sounds; i++) {
+        t_sound const* sound = get_sound(data, sound_ids[i]);
+        if(sound->snd_path != NULL)
+            strings_size += strlen(sound->snd_path) + 1;
+    }
+    struct pack_header header = {
+            .version = PACK_VERSION, .header_size = sizeof(header),
+            .scr_width = data->scr_width, .scr_height = data->scr_height,
+            .current_room_id = data->current_room_id, .max_id = data->max_id,
+            .num_rooms = (uint32_t) num_rooms, .num_room_entity_ids = (uint32_t) num_room_entity_ids,
+            .num_sprites = (uint32_t) num_sprites, .num_sounds = (uint32_t) num_sounds,
+            .num_entities = (uint32_t) num_entities, .strings_size = (uint32_t) strings_size
+    };
+    memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+    header.strings_offset = align_up(sizeof(header));
+    header.rooms_offset = align_up(header.strings_offset + strings_size);
+    header.room_entity_ids_offset = align_up(header.rooms_offset + sizeof(struct pack_room) * num_rooms);
+    header.sprites_offset = align_up(header.room_entity_ids_offset + sizeof(int32_t) * num_room_entity_ids);
+    header.sounds_offset = align_up(header.sprites_offset + sizeof(struct pack_sprite) * num_sprites);
+    header.entities_offset = align_up(header.sounds_offset + sizeof(struct pack_sound) * num_sounds);
+    size_t size = header.entities_offset + sizeof(struct pack_entity) * num_entities;
+    char *buffer = calloc(1, size);
+    if(buffer == NULL) {
+        perror("Could not allocate game pack.");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(buffer, &header, sizeof(header));
+
+    struct pack_room *rooms = (void *) (buffer + header.rooms_offset);
+    int32_t *room_entity_ids = (void *) (buffer + header.room_entity_ids_offset);
+    uint32_t first_entity = 0;
+    for(int i = 0; i < num_rooms; i++) {
+        t_room const* room = get_room(data, room_ids[i]);
+        rooms[i] = (struct pack_room) {
+                .room_id = room->room_id, .width = room->width, .height = room->height,
+                .num_entities = (uint32_t) room->num_entities, .first_entity = first_entity
+        };
+        memcpy(room_entity_ids + first_entity, room->entity_ids, sizeof(int) * room->num_entities);
+        first_entity += (uint32_t) room->num_entities;
+    }
+    struct pack_sprite *sprites = (void *) (buffer + header.sprites_offset);
+    for(int i = 0; i < num_sprites; i++) {
+        t_sprite const* sprite = get_sprite(data, sprite_ids[i]);
+        sprites[i] = (struct pack_sprite) {
+                .spr_id = sprite->spr_id, .num_imgs = sprite->num_imgs, .width = sprite->width, .height = sprite->height
+        };
+    }
+    struct pack_sound *sounds = (void *) (buffer + header.sounds_offset);
+    char *strings = buffer + header.strings_offset;
+    uint32_t next_string = 1;
+    for(int i = 0; i < num_sounds; i++) {
+        t_sound const* sound = get_sound(data, sound_ids[i]);
+        sounds[i] = (struct pack_sound) { .snd_id = sound->snd_id, .volume = sound->volume };
+        if(sound->snd_path != NULL) {
+            sounds[i].path = next_string;
+            strcpy(strings + next_string, sound->snd_path);
+            next_string += (uint32_t) strlen(sound->snd_path) + 1;
+        }
+    }
+    struct pack_entity *entities = (void *) (buffer + header.entities_offset);
+    t_entity **elems = (t_entity **) slotmap_get_elems(&data->entities);
+    for(int i = 0; i < num_entities; i++) {
+        entities[i] = (struct pack_entity) {
+                .id = elems[i]->id, .current_spr_id = elems[i]->current_spr_id, .spr_period = elems[i]->spr_period,
+                .spr_current_img = elems[i]->spr_current_img, .x = elems[i]->x, .y = elems[i]->y,
+                .depth = elems[i]->depth
+        };
+    }
+
+    FILE *file = fopen(path, "wb");
+    bool written = file != NULL && fwrite(buffer, 1, size, file) == size;
+    if(file != NULL)
+        written = (fclose(file) == 0) && written;
+    free(buffer);
+    return written;
+}
+
+/*
+ * game_pack_free: Free every element loaded from a pack, and unmap it.
+ */
+void game_pack_free(game_pack *pack) {
+    if(pack->rooms != NULL) {
+        for(uint32_t i = 0; i < pack->header->num_rooms; i++) {
+            free(pack->rooms[i].entity_ids);
+            if(pack->rooms[i].grid != NULL)
+                spatial_grid_free(pack->rooms[i].grid);
+        }
+    }
+    free(pack->rooms);
+    free(pack->sprites);
+    free(pack->sprite_textures);
+    free(pack->sounds);
+    free(pack->entities);
+    munmap(pack->mapping, pack->size);
+    free(pack);
+}
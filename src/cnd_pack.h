@@ -0,0 +1,115 @@
+/*
+ * File: cnd_pack.h
+ *
+ * Header for game packs, the binary file format game data is loaded from.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_PACK_H
+#define CND_PACK_H
+
+#include "cnd_datatypes.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#define PACK_MAGIC "CNDPACK"    // first 8 bytes of every pack, with its terminating 0
+#define PACK_VERSION 1      // changed whenever the layout changes; other versions are not loaded
+
+/*
+ * pack_header: Start of a pack file, giving the position of every section.
+ *
+ * All values are little endian, and every section starts on an 8 byte boundary. A pack holds, in order:
+ * the string table (0 terminated strings, referred to by their offset into it, 0 being the empty
+ * string), rooms, the entity IDs of every room one room after another, sprites, sounds, then entities.
+ */
+struct pack_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;   // sizeof(struct pack_header)
+    int32_t scr_width;
+    int32_t scr_height;
+    int32_t current_room_id;
+    int32_t max_id;
+    uint32_t num_rooms;
+    uint32_t num_room_entity_ids;
+    uint32_t num_sprites;
+    uint32_t num_sounds;
+    uint32_t num_entities;
+    uint32_t strings_size;
+    uint64_t strings_offset;    // offsets from the start of the file
+    uint64_t rooms_offset;
+    uint64_t room_entity_ids_offset;
+    uint64_t sprites_offset;
+    uint64_t sounds_offset;
+    uint64_t entities_offset;
+};
+
+struct pack_room {
+    int32_t room_id;
+    int32_t width;
+    int32_t height;
+    uint32_t num_entities;
+    uint32_t first_entity;  // index of its first entity ID among every room's entity IDs
+    uint32_t padding;
+};
+
+/*
+ * pack_sprite: Sprite metadata only; images are loaded separately, as they need a GL context.
+ */
+struct pack_sprite {
+    int32_t spr_id;
+    int32_t num_imgs;
+    int32_t width;
+    int32_t height;
+};
+
+struct pack_sound {
+    int32_t snd_id;
+    int32_t volume;
+    uint32_t path;  // offset into the string table
+    uint32_t padding;
+};
+
+/*
+ * pack_entity: Initial state of an entity. Event handlers and ent_data are set by the game once loaded.
+ */
+struct pack_entity {
+    int32_t id;
+    int32_t current_spr_id;
+    int32_t spr_period;
+    int32_t spr_current_img;
+    int32_t x;
+    int32_t y;
+    int32_t depth;
+    int32_t padding;
+};
+
+/*
+ * game_pack: A pack file mapped into memory, and every element loaded from it.
+ *
+ * Elements are allocated in one array per type rather than one at a time, so belong to the pack
+ * rather than whoever removes them from the game data, and must not be freed with free_room,
+ * free_sprite or free_sound. Sprites share one array of textures, all 0 as packs hold no images, so
+ * draw nothing until they are given some. Sound paths point straight into the mapped string table, which stays
+ * mapped until the pack is freed. Rooms own their entity ID arrays, as for any other room.
+ */
+typedef struct {
+    void *mapping;
+    size_t size;
+    struct pack_header const* header;
+    t_room *rooms;
+    t_sprite *sprites;
+    GLuint *sprite_textures;    // subimage textures of every sprite, one after another, all 0 until set
+    t_sound *sounds;
+    t_entity *entities;
+} game_pack;
+
+// All game pack functions (see cnd_pack.c)
+
+game_pack *open_game_pack(char const* path);
+void load_game_pack(t_game_data *data, game_pack *pack);
+bool save_game_pack(t_game_data *data, char const* path);
+void game_pack_free(game_pack *pack);
+
+#endif //CND_PACK_H
@@ -0,0 +1,171 @@
+/*
+ * File: cnd_pool.c
+ *
+ * Contains all source code for object pools.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnoodle.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+struct pool_cache;
+
+/*
+ * pool_slot: Header of every slot, followed by the element itself.
+ */
+struct pool_slot {
+    _Alignas(max_align_t) struct pool_cache *owner;    // cache of the thread that carved the slot
+    struct pool_slot *next;     // next free slot, only while free
+};
+
+struct pool_slab {
+    struct pool_slab *next;
+    _Alignas(max_align_t) unsigned char data[];
+};
+
+/*
+ * pool_cache: Free slots of one pool for one thread.
+ * Only the owning thread takes from free_slots; other threads freeing its slots push them
+ * onto returned, which the owner takes all at once when free_slots runs dry.
+ */
+struct pool_cache {
+    enum pool_id pool;
+    struct pool_slot *free_slots;
+    _Atomic(struct pool_slot *) returned;
+    struct pool_slab *slabs;    // every slab carved by this thread
+    struct pool_cache *next;    // next cache of any thread, so slabs stay reachable after threads exit
+    _Atomic long num_slabs;     // statistics, summed over every cache by get_pool_stats
+    _Atomic long num_allocs;
+    _Atomic long num_frees;
+};
+
+#define entity_slot(ent_data_size) (pool_align_up(sizeof(t_entity)) + (ent_data_size))
+
+// Size of the element in each pool's slots, indexed by pool_id.
+static const size_t elem_sizes[] = {
+        [ROOM_POOL] = sizeof(t_room),
+        [SPRITE_POOL] = sizeof(t_sprite),
+        [SOUND_POOL] = sizeof(t_sound),
+        [ENTITY_POOL] = entity_slot(0),
+        [ENTITY_POOL_16] = entity_slot(16),
+        [ENTITY_POOL_32] = entity_slot(32),
+        [ENTITY_POOL_64] = entity_slot(64),
+        [ENTITY_POOL_128] = entity_slot(128),
+        [ENTITY_POOL_256] = entity_slot(POOL_MAX_ENT_DATA)
+};
+
+static _Thread_local struct pool_cache *local_caches[NUM_POOLS];
+static _Atomic(struct pool_cache *) all_caches = NULL;
+
+/*
+ * local_cache: Private method to get the calling thread's cache of a pool, making it on first use.
+ */
+static struct pool_cache *local_cache(enum pool_id pool) {
+    struct pool_cache *cache = local_caches[pool];
+    if(cache != NULL)
+        return cache;
+    // never freed, as other threads may still hold its slots when this thread exits
+    cache = calloc(1, sizeof(struct pool_cache));
+    if(cache == NULL) {
+        perror("Could not allocate pool cache.");
+        exit(EXIT_FAILURE);
+    }
+    cache->pool = pool;
+    cache->next = atomic_load_explicit(&all_caches, memory_order_relaxed);
+    while(!atomic_compare_exchange_weak(&all_caches, &cache->next, cache));
+    local_caches[pool] = cache;
+    return cache;
+}
+
+/*
+ * carve_slab: Private method to allocate a slab for a cache, and add all of its slots to the cache's free slots.
+ */
+static void carve_slab(struct pool_cache *cache) {
+    size_t stride = sizeof(struct pool_slot) + pool_align_up(elem_sizes[cache->pool]);
+    struct pool_slab *slab = malloc(sizeof(struct pool_slab) + stride * POOL_SLAB_SLOTS);
+    if(slab == NULL) {
+        perror("Could not allocate pool slab.");
+        exit(EXIT_FAILURE);
+    }
+    note_heap_allocation();
+    slab->next = cache->slabs;
+    cache->slabs = slab;
+    // in address order, so slots handed out one after another are next to each other
+    for(int i = POOL_SLAB_SLOTS - 1; i >= 0; i--) {
+        struct pool_slot *slot = (struct pool_slot *) (slab->data + stride * i);
+        slot->owner = cache;
+        slot->next = cache->free_slots;
+        cache->free_slots = slot;
+    }
+    atomic_fetch_add_explicit(&cache->num_slabs, 1, memory_order_relaxed);
+}
+
+/*
+ * pool_alloc: Take a slot from a pool, from the calling thread's own free slots where possible.
+ *
+ * Returns (void *): Uninitialised memory for one element of the pool, aligned for any type.
+ */
+void *pool_alloc(enum pool_id pool) {
+    struct pool_cache *cache = local_cache(pool);
+    if(cache->free_slots == NULL)
+        cache->free_slots = atomic_exchange(&cache->returned, NULL);
+    if(cache->free_slots == NULL)
+        carve_slab(cache);
+    struct pool_slot *slot = cache->free_slots;
+    cache->free_slots = slot->next;
+    atomic_fetch_add_explicit(&cache->num_allocs, 1, memory_order_relaxed);
+    return slot + 1;
+}
+
+/*
+ * pool_free: Give a slot taken with pool_alloc back to the thread that carved it. Can be called from any thread.
+ */
+void pool_free(void *elem) {
+    if(elem == NULL)
+        return;
+    struct pool_slot *slot = (struct pool_slot *) elem - 1;
+    struct pool_cache *owner = slot->owner;
+    atomic_fetch_add_explicit(&owner->num_frees, 1, memory_order_relaxed);
+    if(owner == local_caches[owner->pool]) {
+        slot->next = owner->free_slots;
+        owner->free_slots = slot;
+        return;
+    }
+    slot->next = atomic_load_explicit(&owner->returned, memory_order_relaxed);
+    while(!atomic_compare_exchange_weak(&owner->returned, &slot->next, slot));
+}
+
+/*
+ * entity_pool_for: Get the pool for entities with ent_data of a size kept inline.
+ *
+ * Returns (enum pool_id): The smallest pool it fits in, or NUM_POOLS if larger than POOL_MAX_ENT_DATA.
+ */
+enum pool_id entity_pool_for(size_t ent_data_size) {
+    if(ent_data_size == 0)
+        return ENTITY_POOL;
+    size_t size_class = 16;
+    for(enum pool_id pool = ENTITY_POOL_16; pool <= ENTITY_POOL_256; pool++, size_class *= 2) {
+        if(ent_data_size <= size_class)
+            return pool;
+    }
+    return NUM_POOLS;
+}
+
+/*
+ * get_pool_stats: Get the totals of a pool over every thread. Only exact while no thread is using the pool.
+ */
+pool_stats get_pool_stats(enum pool_id pool) {
+    pool_stats stats = { 0, 0, 0 };
+    for(struct pool_cache *cache = atomic_load(&all_caches); cache != NULL; cache = cache->next) {
+        if(cache->pool != pool)
+            continue;
+        long num_allocs = atomic_load_explicit(&cache->num_allocs, memory_order_relaxed);
+        stats.slabs += atomic_load_explicit(&cache->num_slabs, memory_order_relaxed);
+        stats.allocs += num_allocs;
+        stats.in_use += num_allocs - atomic_load_explicit(&cache->num_frees, memory_order_relaxed);
+    }
+    return stats;
+}
@@ -0,0 +1,67 @@
+/*
+ * File: cnd_pool.h
+ *
+ * Header for object pools, fixed size allocators for rooms, sprites, sounds and entities.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_POOL_H
+#define CND_POOL_H
+
+#include <stddef.h>
+
+#define POOL_SLAB_SLOTS 256     // slots carved from each slab a thread allocates
+#define POOL_MAX_ENT_DATA 256   // largest ent_data kept inline in its entity's slot
+
+// pool_align_up: Round a size up to a multiple of the alignment of any type.
+#define pool_align_up(size) (((size) + _Alignof(max_align_t) - 1) / _Alignof(max_align_t) * _Alignof(max_align_t))
+
+// entity_inline_data: Where a pooled entity's ent_data is, if kept inline in its slot.
+#define entity_inline_data(entity) ((void *) ((char *) (entity) + pool_align_up(sizeof(t_entity))))
+
+/*
+ * pool_id: Every pool, one per type of element. Entities are pooled by the size of the ent_data
+ * kept inline after them, rounded up to the next size class.
+ */
+enum pool_id {
+    ROOM_POOL,
+    SPRITE_POOL,
+    SOUND_POOL,
+    ENTITY_POOL,    // no inline ent_data
+    ENTITY_POOL_16,
+    ENTITY_POOL_32,
+    ENTITY_POOL_64,
+    ENTITY_POOL_128,
+    ENTITY_POOL_256,
+    NUM_POOLS
+};
+
+/*
+ * pool_stats: Totals of a pool over every thread.
+ */
+typedef struct {
+    long slabs;     // slabs allocated from the heap, never given back
+    long allocs;    // slots handed out
+    long in_use;    // slots handed out and not yet freed
+} pool_stats;
+
+/*
+ * Pools hand out fixed size slots, carved a slab at a time from the heap, so steady churn of
+ * elements reuses the same memory rather than calling malloc and free for each element.
+ *
+ * Each thread allocates from its own cache of free slots, without locking. A slot freed by the
+ * thread that carved it goes straight back to that thread's cache; one freed by another thread is
+ * pushed onto the carving thread's returned stack, which it takes all at once when its cache
+ * runs dry. Slabs live until the program exits, and slots given back to a thread that has exited
+ * are not reused.
+ */
+
+// All object pool functions (see cnd_pool.c)
+
+void *pool_alloc(enum pool_id pool);
+void pool_free(void *elem);
+enum pool_id entity_pool_for(size_t ent_data_size);
+pool_stats get_pool_stats(enum pool_id pool);
+
+#endif //CND_POOL_H
@@ -0,0 +1,37 @@
+/*
+ * File: cnd_render.h
+ *
+ * Header for render backends, which draw the images queued by the render loop.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_RENDER_H
+#define CND_RENDER_H
+
+#include "cnd_datatypes.h"
+
+/*
+ * render_backend: A vtable of every function the render loop needs to draw a frame.
+ * Implementations embed this as their first member, so a pointer to one can be used as
+ * a pointer to the other (see cnd_softrender.h).
+ */
+struct render_backend {
+    // begin_frame: Called before a frame's first image is drawn, given the screen's width and height.
+    void (*begin_frame)(render_backend *, int, int);
+    // draw_image: Draw a subimage of a sprite with its top-left corner at an X-Y position on screen.
+    // Called once per image, from the furthest back to the nearest (see cnd_renderqueue.h).
+    void (*draw_image)(render_backend *, t_sprite const*, int, int, int);
+    // upload_atlas: Called before a frame if the game's texture atlas changed since, to give its pages textures.
+    // Images packed in the same page are queued with its texture, so can be drawn in one batch (see build_sprite_atlas).
+    void (*upload_atlas)(render_backend *, texture_atlas *);
+    // upload_sprite: Give a sprite loaded in the background textures of its subimages' pixels (see cnd_loader.h).
+    // Called on the render thread, before the sprite is first drawn.
+    void (*upload_sprite)(render_backend *, t_sprite *);
+    // end_frame: Called after a frame's last image is drawn, eg. to display it.
+    void (*end_frame)(render_backend *);
+    // free: Free the backend and all memory it owns.
+    void (*free)(render_backend *);
+};
+
+#endif //CND_RENDER_H
@@ -0,0 +1,143 @@
+/*
+ * File: cnd_renderqueue.c
+ *
+ * Contains all source code for render queues.
+ *
+ * Images are sorted with a least significant digit radix sort on a 64 bit key of
+ * depth then texture. This is linear in the number of images, needs no per-image
+ * allocation, and is stable, so images with equal keys keep the order they were queued in.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_renderqueue.h"
+#include "cnd_arena.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+/*
+ * make_render_queue: Create an empty render queue.
+ *
+ * num_images (int): Expected number of images per frame; the queue grows past this automatically.
+ */
+render_queue make_render_queue(int num_images) {
+    render_queue queue;
+    queue.num_images = 0;
+    queue.capacity = 0;
+    queue.images = NULL;
+    queue.scratch = NULL;
+    if(num_images > 0) {
+        queue.capacity = num_images;
+        queue.images = malloc(sizeof(queued_image) * num_images);
+        queue.scratch = malloc(sizeof(queued_image) * num_images);
+        if(queue.images == NULL || queue.scratch == NULL) {
+            perror("Could not allocate render queue.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return queue;
+}
+
+/*
+ * render_queue_clear: Remove all images from a queue, keeping its memory for the next frame.
+ */
+void render_queue_clear(render_queue *queue) {
+    queue->num_images = 0;
+}
+
+/*
+ * grow: Private method to double the capacity of a render queue.
+ */
+static void grow(render_queue *queue) {
+    int capacity = (queue->capacity > 0) ? queue->capacity * 2 : 64;
+    queued_image *images = realloc(queue->images, sizeof(queued_image) * capacity);
+    queued_image *scratch = realloc(queue->scratch, sizeof(queued_image) * capacity);
+    if(images == NULL || scratch == NULL) {
+        perror("Could not allocate render queue.");
+        exit(EXIT_FAILURE);
+    }
+    note_heap_allocation();
+    queue->images = images;
+    queue->scratch = scratch;
+    queue->capacity = capacity;
+}
+
+/*
+ * render_queue_push: Queue an image to be drawn.
+ */
+void render_queue_push(render_queue *queue, int spr_id, int subimg, int x, int y, int depth, GLuint texture) {
+    if(queue->num_images == queue->capacity)
+        grow(queue);
+    queued_image *image = &queue->images[queue->num_images++];
+    // flipping the sign bit makes negative depths sort before positive ones as unsigned
+    image->key = ((uint64_t) ((uint32_t) depth ^ 0x80000000u) << 32) | (uint32_t) texture;
+    image->spr_id = spr_id;
+    image->subimg = subimg;
+    image->x = x;
+    image->y = y;
+    image->depth = depth;
+    image->texture = texture;
+}
+
+/*
+ * render_queue_sort: Sort a queue into drawing order: by depth, then by texture, then by queue order.
+ */
+void render_queue_sort(render_queue *queue) {
+    int n = queue->num_images;
+    // one histogram per digit, all counted in a single pass over the keys
+    int counts[RADIX_PASSES][RADIX_SIZE];
+    memset(counts, 0, sizeof(counts));
+    for(int i = 0; i < n; i++) {
+        uint64_t key = queue->images[i].key;
+        for(int pass = 0; pass < RADIX_PASSES; pass++)
+            counts[pass][(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+    }
+    for(int pass = 0; pass < RADIX_PASSES; pass++) {
+        int shift = pass * RADIX_BITS;
+        int *count = counts[pass];
+        // skip digits that every key shares, eg. high bits of small depths and texture names
+        if(n == 0 || count[(queue->images[0].key >> shift) & (RADIX_SIZE - 1)] == n)
+            continue;
+        int offset = 0;
+        for(int digit = 0; digit < RADIX_SIZE; digit++) {
+            int num = count[digit];
+            count[digit] = offset;
+            offset += num;
+        }
+        for(int i = 0; i < n; i++) {
+            queued_image const* image = &queue->images[i];
+            queue->scratch[count[(image->key >> shift) & (RADIX_SIZE - 1)]++] = *image;
+        }
+        queued_image *sorted = queue->scratch;
+        queue->scratch = queue->images;
+        queue->images = sorted;
+    }
+}
+
+/*
+ * render_queue_num_batches: Get number of draw batches in a sorted queue,
+ * ie. the number of runs of images sharing a texture.
+ */
+int render_queue_num_batches(render_queue const* queue) {
+    int num_batches = 0;
+    for(int i = 0; i < queue->num_images; i++) {
+        if(i == 0 || queue->images[i].texture != queue->images[i - 1].texture)
+            num_batches++;
+    }
+    return num_batches;
+}
+
+/*
+ * render_queue_free: Free all memory in a render queue.
+ */
+void render_queue_free(render_queue *queue) {
+    free(queue->images);
+    free(queue->scratch);
+    queue->images = queue->scratch = NULL;
+    queue->num_images = queue->capacity = 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * File: cnd_renderqueue.h
+ *
+ * Header for the depth sorted render queue.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_RENDERQUEUE_H
+#define CND_RENDERQUEUE_H
+
+#include <GL/gl.h>
+#include <stdint.h>
+
+/*
+ * queued_image: One image to be drawn this frame.
+ */
+typedef struct {
+    uint64_t key;   // sort key, see render_queue_sort
+    int spr_id;     // sprite and subimage drawn
+    int subimg;
+    int x;      // position on screen, ie. relative to the camera
+    int y;
+    int depth;
+    GLuint texture;     // texture of the subimage
+} queued_image;
+
+/*
+ * render_queue: Flat array of every image to be drawn in a frame.
+ * Cleared and refilled every frame, reusing its memory, then sorted so that images are
+ * drawn from lowest to highest depth, and images of the same depth are grouped by texture
+ * so they can be drawn in one batch.
+ */
+typedef struct {
+    int num_images;
+    int capacity;
+    queued_image *images;
+    queued_image *scratch;  // second buffer for the radix sort to move images into
+} render_queue;
+
+// All render queue functions (see cnd_renderqueue.c)
+
+render_queue make_render_queue(int num_images);
+void render_queue_clear(render_queue *queue);
+void render_queue_push(render_queue *queue, int spr_id, int subimg, int x, int y, int depth, GLuint texture);
+void render_queue_sort(render_queue *queue);
+int render_queue_num_batches(render_queue const* queue);
+void render_queue_free(render_queue *queue);
+
+#endif //CND_RENDERQUEUE_H
@@ -0,0 +1,113 @@
+/*
+ * File: cnd_ring.c
+ *
+ * Contains all source code for single-producer single-consumer ring buffers.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_ring.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+/*
+ * init_spsc_ring: Set up an empty ring.
+ *
+ * min_capacity (unsigned): Elements the ring must hold, rounded up to a power of two.
+ * elem_size (size_t): Bytes per element.
+ */
+void init_spsc_ring(spsc_ring *ring, unsigned min_capacity, size_t elem_size) {
+    unsigned capacity = 1;
+    while(capacity < min_capacity)
+        capacity *= 2;
+    ring->capacity = capacity;
+    ring->elem_size = elem_size;
+    ring->buffer = malloc(elem_size * capacity);
+    if(ring->buffer == NULL) {
+        perror("Could not allocate ring buffer.");
+        exit(EXIT_FAILURE);
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+}
+
+/*
+ * copy_span: Private method to copy between a ring's buffer and an array, starting from the element
+ * at a count, in at most two pieces if it wraps around the end of the buffer.
+ */
+static void copy_span(spsc_ring *ring, unsigned at, void *elems, unsigned count, bool to_ring) {
+    unsigned start = at & (ring->capacity - 1);
+    unsigned first = (count < ring->capacity - start) ? count : ring->capacity - start;
+    char *slot = ring->buffer + start * ring->elem_size;
+    char *array = elems;
+    if(to_ring) {
+        memcpy(slot, array, first * ring->elem_size);
+        memcpy(ring->buffer, array + first * ring->elem_size, (count - first) * ring->elem_size);
+    } else {
+        memcpy(array, slot, first * ring->elem_size);
+        memcpy(array + first * ring->elem_size, ring->buffer, (count - first) * ring->elem_size);
+    }
+}
+
+/*
+ * spsc_ring_write: Append as many elements as fit. Only to be called by the producer.
+ *
+ * Returns (unsigned): Number of elements written, from 0 if the ring is full to count.
+ */
+unsigned spsc_ring_write(spsc_ring *ring, void const* elems, unsigned count) {
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    unsigned space = ring->capacity - (tail - head);
+    if(count > space)
+        count = space;
+    copy_span(ring, tail, (void *) elems, count, true);
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
+
+/*
+ * spsc_ring_read: Take as many elements as are queued, up to count. Only to be called by the consumer.
+ *
+ * Returns (unsigned): Number of elements read, from 0 if the ring is empty to count.
+ */
+unsigned spsc_ring_read(spsc_ring *ring, void *elems, unsigned count) {
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if(count > tail - head)
+        count = tail - head;
+    copy_span(ring, head, elems, count, false);
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+    return count;
+}
+
+/*
+ * spsc_ring_count: Get the number of elements queued. Exact for the consumer; may be stale for the producer.
+ */
+unsigned spsc_ring_count(spsc_ring *ring) {
+    return atomic_load_explicit(&ring->tail, memory_order_acquire)
+           - atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+/*
+ * spsc_ring_space: Get the number of elements that can be written. Exact for the producer; may be stale for the consumer.
+ */
+unsigned spsc_ring_space(spsc_ring *ring) {
+    return ring->capacity - spsc_ring_count(ring);
+}
+
+/*
+ * spsc_ring_clear: Empty a ring. Only to be called while neither side is using it.
+ */
+void spsc_ring_clear(spsc_ring *ring) {
+    atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, 0, memory_order_release);
+}
+
+/*
+ * spsc_ring_free: Free a ring's buffer.
+ */
+void spsc_ring_free(spsc_ring *ring) {
+    free(ring->buffer);
+}
@@ -0,0 +1,41 @@
+/*
+ * File: cnd_ring.h
+ *
+ * Header for single-producer single-consumer ring buffers.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_RING_H
+#define CND_RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+/*
+ * spsc_ring: Fixed size queue of elements passed from one thread to another without locks.
+ *
+ * head and tail count elements ever read and written, so never wrap back to the start of the
+ * buffer themselves; the element at either is at its count modulo the capacity. Only the
+ * consumer writes head and only the producer writes tail, each publishing the elements it has
+ * finished with, so neither side ever waits for the other, and neither allocates.
+ */
+typedef struct {
+    unsigned capacity;  // elements the ring can hold, a power of two
+    size_t elem_size;   // bytes per element
+    char *buffer;
+    _Alignas(64) _Atomic unsigned head;     // elements read, written only by the consumer
+    _Alignas(64) _Atomic unsigned tail;     // elements written, written only by the producer
+} spsc_ring;
+
+// All ring functions (see cnd_ring.c)
+
+void init_spsc_ring(spsc_ring *ring, unsigned min_capacity, size_t elem_size);
+unsigned spsc_ring_write(spsc_ring *ring, void const* elems, unsigned count);
+unsigned spsc_ring_read(spsc_ring *ring, void *elems, unsigned count);
+unsigned spsc_ring_count(spsc_ring *ring);
+unsigned spsc_ring_space(spsc_ring *ring);
+void spsc_ring_clear(spsc_ring *ring);
+void spsc_ring_free(spsc_ring *ring);
+
+#endif //CND_RING_H
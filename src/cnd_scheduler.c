@@ -0,0 +1,113 @@
+/*
+ * File: cnd_scheduler.c
+ *
+ * Contains all source code for the fixed timestep tick scheduler.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_scheduler.h"
+#include <time.h>
+#include <errno.h>
+
+#define NS_PER_SEC 1000000000LL
+
+/*
+ * now_ns: Private method to get the monotonic clock in nanoseconds.
+ */
+static long long now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * NS_PER_SEC + now.tv_nsec;
+}
+
+/*
+ * sleep_until: Private method to sleep until an absolute time on the monotonic clock.
+ * Sleeping to an absolute time means time spent being woken up is not added onto every tick.
+ */
+static void sleep_until(long long time_ns) {
+    struct timespec until = { .tv_sec = time_ns / NS_PER_SEC, .tv_nsec = time_ns % NS_PER_SEC };
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR);
+}
+
+/*
+ * init_tick_scheduler: Set up a scheduler. Its clock starts on the first wait.
+ *
+ * ticks_per_second (int): Fixed rate at which ticks are handed out.
+ * max_steps (int): Most ticks handed out by one wait when catching up, at least 1.
+ */
+void init_tick_scheduler(tick_scheduler *scheduler, int ticks_per_second, int max_steps) {
+    scheduler->tick_ns = NS_PER_SEC / ticks_per_second;
+    scheduler->max_steps = (max_steps < 1) ? 1 : max_steps;
+    scheduler->last_ns = 0;
+    scheduler->accumulator_ns = 0;
+    scheduler->due_ns = 0;
+    atomic_init(&scheduler->last_tick_ns, 0);
+    scheduler->stats = (scheduler_stats) { 0 };
+}
+
+/*
+ * scheduler_wait: Sleep until at least one tick is due, and get how many update steps to run.
+ * The first wait returns one tick immediately.
+ *
+ * Returns (int): Number of ticks to update by, from 1 to max_steps.
+ */
+int scheduler_wait(tick_scheduler *scheduler) {
+    long long now = now_ns();
+    if(scheduler->last_ns == 0) {
+        // first tick is due straight away
+        scheduler->last_ns = now - scheduler->tick_ns;
+        scheduler->due_ns = now;
+    } else {
+        scheduler->stats.busy_ns += now - scheduler->last_ns;
+    }
+    if(now < scheduler->due_ns) {
+        sleep_until(scheduler->due_ns);
+        long long woken = now_ns();
+        scheduler->stats.idle_ns += woken - now;
+        now = woken;
+    }
+    long long lateness = now - scheduler->due_ns;
+    scheduler->stats.jitter_total_ns += lateness;
+    if(lateness > scheduler->stats.jitter_max_ns)
+        scheduler->stats.jitter_max_ns = lateness;
+
+    scheduler->accumulator_ns += now - scheduler->last_ns;
+    scheduler->last_ns = now;
+    long long steps = scheduler->accumulator_ns / scheduler->tick_ns;
+    if(steps > 1)
+        scheduler->stats.num_overruns++;
+    if(steps > scheduler->max_steps) {
+        scheduler->stats.num_dropped += steps - scheduler->max_steps;
+        scheduler->accumulator_ns -= (steps - scheduler->max_steps) * scheduler->tick_ns;
+        steps = scheduler->max_steps;
+    }
+    scheduler->accumulator_ns -= steps * scheduler->tick_ns;
+    scheduler->due_ns = now + scheduler->tick_ns - scheduler->accumulator_ns;
+    // whatever is left in the accumulator has passed since the last tick was due
+    atomic_store_explicit(&scheduler->last_tick_ns, now - scheduler->accumulator_ns, memory_order_relaxed);
+    scheduler->stats.num_ticks += steps;
+    scheduler->stats.num_wakeups++;
+    return (int) steps;
+}
+
+/*
+ * scheduler_alpha: Get how far between the last tick and the next one the game is, from 0 to 1.
+ * Measured against the clock on every call, so may be called from the render loop at any time.
+ * Stays at 1 while the update loop is behind, and is 1 before the first tick, so the latest
+ * state is drawn as it is.
+ */
+double scheduler_alpha(tick_scheduler *scheduler) {
+    long long last_tick = atomic_load_explicit(&scheduler->last_tick_ns, memory_order_relaxed);
+    if(last_tick == 0)
+        return 1.0;
+    double alpha = (double) (now_ns() - last_tick) / scheduler->tick_ns;
+    return (alpha < 0.0) ? 0.0 : (alpha > 1.0) ? 1.0 : alpha;
+}
+
+/*
+ * scheduler_get_stats: Get timing statistics of a scheduler since its first wait.
+ */
+scheduler_stats scheduler_get_stats(tick_scheduler const* scheduler) {
+    return scheduler->stats;
+}
@@ -0,0 +1,58 @@
+/*
+ * File: cnd_scheduler.h
+ *
+ * Header for the fixed timestep tick scheduler.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_SCHEDULER_H
+#define CND_SCHEDULER_H
+
+#include <stdatomic.h>
+
+#define DEFAULT_TICK_RATE 60    // ticks per second
+#define DEFAULT_MAX_STEPS 5     // most ticks run to catch up after one wait
+
+/*
+ * scheduler_stats: Timing statistics of a tick scheduler, for tuning tick rate against CPU usage.
+ */
+typedef struct {
+    long num_ticks;     // ticks handed out to the update loop
+    long num_wakeups;   // waits that returned at least one tick
+    long num_overruns;  // wakeups where more than one tick was due, ie. the loop fell behind
+    long num_dropped;   // ticks skipped entirely because of the max steps cap
+    long long jitter_total_ns;  // total lateness of wakeups past the time their tick was due
+    long long jitter_max_ns;    // largest lateness of a single wakeup
+    long long busy_ns;  // total time spent outside of scheduler_wait, ie. updating
+    long long idle_ns;  // total time spent sleeping in scheduler_wait
+} scheduler_stats;
+
+/*
+ * tick_scheduler: Paces the update loop to a fixed tick rate.
+ *
+ * Real time passed is added to an accumulator, and each whole tick in it is handed out
+ * as one update step. When the loop falls behind, up to max_steps ticks are handed out
+ * at once to catch up, and any more are dropped so the loop cannot spiral.
+ * While no tick is due, the thread sleeps until the next one is.
+ * The time of the last tick handed out is published, so the render loop can find how far
+ * it is towards the next one (see scheduler_alpha) and interpolate between the last two states.
+ */
+typedef struct {
+    long long tick_ns;  // length of one tick
+    int max_steps;      // most ticks handed out by one wait
+    long long last_ns;  // time of the last wakeup, or 0 if never waited
+    long long accumulator_ns;   // time passed that has not yet been handed out as ticks
+    long long due_ns;   // time at which the next tick is due
+    _Atomic long long last_tick_ns;     // time the last tick handed out was due, or 0 if none, read by the render loop
+    scheduler_stats stats;
+} tick_scheduler;
+
+// All tick scheduler functions (see cnd_scheduler.c)
+
+void init_tick_scheduler(tick_scheduler *scheduler, int ticks_per_second, int max_steps);
+int scheduler_wait(tick_scheduler *scheduler);
+double scheduler_alpha(tick_scheduler *scheduler);
+scheduler_stats scheduler_get_stats(tick_scheduler const* scheduler);
+
+#endif //CND_SCHEDULER_H
@@ -0,0 +1,163 @@
+/*
+ * File: cnd_slotmap.c
+ *
+ * Contains all source code for slot maps.
+ * Used by t_game_data to store entities, whose IDs are allocated monotonically,
+ * so looking them up needs no hashing at all.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_slotmap.h"
+#include "cnd_arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * make_slotmap: Create a slotmap.
+ *
+ * num_elems (int): Expected number of elements; the slotmap grows past this automatically.
+ *
+ * Returns (slotmap): Empty slotmap.
+ */
+slotmap make_slotmap(int num_elems) {
+    slotmap map;
+    map.num_entries = 0;
+    map.capacity = (num_elems > 0) ? num_elems : 16;
+    map.sparse_size = 0;
+    map.sparse = NULL;
+    map.dense_ids = malloc(sizeof(int) * (map.capacity + 1));
+    map.dense = malloc(sizeof(void*) * (map.capacity + 1));
+    if(map.dense_ids == NULL || map.dense == NULL) {
+        perror("Could not allocate dense arrays for slotmap.");
+        exit(EXIT_FAILURE);
+    }
+    map.dense_ids[0] = -1;
+    map.dense[0] = NULL;
+    return map;
+}
+
+/*
+ * grow_sparse: Private method to make the sparse array cover at least 'id'.
+ */
+static void grow_sparse(slotmap *map, int id) {
+    int new_size = (map->sparse_size > 0) ? map->sparse_size : 16;
+    while(new_size <= id)
+        new_size *= 2;
+    int *sparse = realloc(map->sparse, sizeof(int) * new_size);
+    note_heap_allocation();
+    if(sparse == NULL) {
+        perror("Could not grow sparse array for slotmap.");
+        exit(EXIT_FAILURE);
+    }
+    memset(sparse + map->sparse_size, 0, sizeof(int) * (new_size - map->sparse_size));
+    map->sparse = sparse;
+    map->sparse_size = new_size;
+}
+
+/*
+ * grow_dense: Private method to double the capacity of the dense arrays until it holds at least 'min_capacity'.
+ */
+static void grow_dense(slotmap *map, int min_capacity) {
+    while(map->capacity < min_capacity)
+        map->capacity *= 2;
+    map->dense_ids = realloc(map->dense_ids, sizeof(int) * (map->capacity + 1));
+    map->dense = realloc(map->dense, sizeof(void*) * (map->capacity + 1));
+    note_heap_allocation();
+    if(map->dense_ids == NULL || map->dense == NULL) {
+        perror("Could not grow dense arrays for slotmap.");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/*
+ * slotmap_add: Add an element with an ID. If the ID already exists, its element is replaced.
+ */
+void slotmap_add(slotmap *map, int id, void* elem) {
+    if(id < 0) {
+        fprintf(stderr, "Cannot add negative ID %d to slotmap.\n", id);
+        return;
+    }
+    if(id >= map->sparse_size)
+        grow_sparse(map, id);
+    if(map->sparse[id] != 0) {
+        map->dense[map->sparse[id]] = elem;
+        return;
+    }
+    if(map->num_entries == map->capacity)
+        grow_dense(map, map->num_entries + 1);
+    int index = ++map->num_entries;
+    map->dense_ids[index] = id;
+    map->dense[index] = elem;
+    map->sparse[id] = index;
+}
+
+/*
+ * slotmap_add_range: Add elements with consecutive IDs, growing the arrays at most once.
+ * None of the IDs may be in the slotmap already.
+ *
+ * first_id (int): ID of the first element; the rest follow in order.
+ * count (int): Number of elements.
+ * elems (void **): Elements, in order of ID.
+ */
+void slotmap_add_range(slotmap *map, int first_id, int count, void **elems) {
+    if(first_id < 0 || count <= 0)
+        return;
+    int last_id = first_id + count - 1;
+    if(last_id >= map->sparse_size)
+        grow_sparse(map, last_id);
+    if(map->num_entries + count > map->capacity)
+        grow_dense(map, map->num_entries + count);
+    for(int i = 0; i < count; i++) {
+        int index = ++map->num_entries;
+        map->dense_ids[index] = first_id + i;
+        map->dense[index] = elems[i];
+        map->sparse[first_id + i] = index;
+    }
+}
+
+/*
+ * slotmap_del: Remove the element with an ID, moving the last element into its place.
+ * Does not free the element itself.
+ */
+void slotmap_del(slotmap *map, int id) {
+    int index = slotmap_index(map, id) + 1;
+    if(index == 0) {
+        fprintf(stderr, "Could not find ID %d in slotmap.\n", id);
+        return;
+    }
+    int last = map->num_entries;
+    map->dense_ids[index] = map->dense_ids[last];
+    map->dense[index] = map->dense[last];
+    map->sparse[map->dense_ids[index]] = index;
+    map->sparse[id] = 0;
+    map->num_entries--;
+}
+
+/*
+ * slotmap_contains: Return true if contains an ID, false otherwise.
+ */
+bool slotmap_contains(slotmap const* map, int id) {
+    return slotmap_index(map, id) >= 0;
+}
+
+/*
+ * slotmap_get_num_entries: Get number of entries in slotmap.
+ */
+int slotmap_get_num_entries(slotmap const* map) {
+    return map->num_entries;
+}
+
+/*
+ * slotmap_free: Free all memory in slotmap.
+ * Elements themselves are owned by the caller and are not freed.
+ */
+void slotmap_free(slotmap *map) {
+    free(map->sparse);
+    free(map->dense_ids);
+    free(map->dense);
+    map->sparse = map->dense_ids = NULL;
+    map->dense = NULL;
+    map->num_entries = map->capacity = map->sparse_size = 0;
+}
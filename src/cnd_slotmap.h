@@ -0,0 +1,73 @@
+/*
+ * File: cnd_slotmap.h
+ *
+ * Header for slot maps.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_SLOTMAP_H
+#define CND_SLOTMAP_H
+
+#include <stdbool.h>
+
+/*
+ * slotmap: Elements indexed directly by ID, stored contiguously.
+ * A sparse array maps each ID to an index into dense arrays of IDs and elements.
+ * Removal swaps the last element into the hole, so the dense arrays never have gaps.
+ *
+ * IDs are never reused (see docs/overview.md), so an ID acts as its own generation:
+ * once removed, its sparse entry stays empty and stale IDs always look up NULL.
+ */
+typedef struct {
+    int num_entries;    // number of elements stored
+    int capacity;       // number of elements the dense arrays can hold
+    int sparse_size;    // number of IDs covered by the sparse array
+    int *sparse;        // ID -> dense index, 0 if absent
+    int *dense_ids;     // IDs of all elements, from index 1 (index 0 is unused)
+    void **dense;       // all elements, from index 1 (index 0 is always NULL)
+} slotmap;
+
+// All slotmap functions (see cnd_slotmap.c)
+
+slotmap make_slotmap(int num_elems);
+void slotmap_add(slotmap *map, int id, void* elem);
+void slotmap_add_range(slotmap *map, int first_id, int count, void **elems);
+void slotmap_del(slotmap *map, int id);
+bool slotmap_contains(slotmap const* map, int id);
+int slotmap_get_num_entries(slotmap const* map);
+void slotmap_free(slotmap *map);
+
+/*
+ * slotmap_get: Get the element with an ID, or NULL if absent.
+ * Absent IDs map to dense index 0, which always holds NULL.
+ */
+static inline void *slotmap_get(slotmap const* map, int id) {
+    int index = ((unsigned) id < (unsigned) map->sparse_size) ? map->sparse[id] : 0;
+    return map->dense[index];
+}
+
+/*
+ * slotmap_index: Get the dense index of an ID, from 0 to num_entries - 1, or -1 if absent.
+ */
+static inline int slotmap_index(slotmap const* map, int id) {
+    return (((unsigned) id < (unsigned) map->sparse_size) ? map->sparse[id] : 0) - 1;
+}
+
+/*
+ * slotmap_get_ids: Get view of all IDs in dense order (num_entries long).
+ * Points into the slotmap; must not be freed, and is invalidated by add or delete.
+ */
+static inline int *slotmap_get_ids(slotmap const* map) {
+    return map->dense_ids + 1;
+}
+
+/*
+ * slotmap_get_elems: Get view of all elements in dense order (num_entries long).
+ * Same lifetime rules as slotmap_get_ids.
+ */
+static inline void **slotmap_get_elems(slotmap const* map) {
+    return map->dense + 1;
+}
+
+#endif //CND_SLOTMAP_H
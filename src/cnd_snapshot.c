@@ -0,0 +1,90 @@
+/*
+ * File: cnd_snapshot.c
+ *
+ * Contains all source code for triple buffered game state snapshots.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_snapshot.h"
+#include "cnd_arena.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#define SNAPSHOT_FRESH 4u   // set in middle when it holds a snapshot the reader has not taken
+#define SNAPSHOT_INDEX 3u   // mask for the buffer index in middle
+
+/*
+ * init_snapshot_buffer: Set up a snapshot buffer.
+ * All three snapshots start empty, and the reader sees an empty snapshot until one is published.
+ */
+void init_snapshot_buffer(snapshot_buffer *snapshots) {
+    for(int i = 0; i < 3; i++)
+        snapshots->buffers[i] = (game_snapshot) { 0 };
+    snapshots->back = 0;
+    atomic_init(&snapshots->middle, 1);
+    snapshots->front = 2;
+}
+
+/*
+ * snapshot_back: Get the snapshot for the writer to fill before publishing it.
+ * Its contents are whatever was published two snapshots ago, so must be overwritten.
+ */
+game_snapshot *snapshot_back(snapshot_buffer *snapshots) {
+    return &snapshots->buffers[snapshots->back];
+}
+
+/*
+ * snapshot_reserve: Make room in a snapshot for a number of entities.
+ * Arrays only grow, so once every buffer fits the game's rooms, publishing does not allocate.
+ */
+void snapshot_reserve(game_snapshot *snapshot, int num_entities) {
+    if(num_entities <= snapshot->capacity)
+        return;
+    int capacity = (snapshot->capacity > 0) ? snapshot->capacity : 16;
+    while(capacity < num_entities)
+        capacity *= 2;
+    snapshot_entity *entities = realloc(snapshot->entities, sizeof(snapshot_entity) * capacity);
+    if(entities == NULL) {
+        perror("Could not allocate snapshot entities.");
+        exit(EXIT_FAILURE);
+    }
+    note_heap_allocation();
+    snapshot->entities = entities;
+    snapshot->capacity = capacity;
+}
+
+/*
+ * snapshot_publish: Make the back snapshot visible to the reader, and take a new back snapshot.
+ * Only to be called by the writer.
+ */
+void snapshot_publish(snapshot_buffer *snapshots) {
+    // release: the reader must see the snapshot's contents once it sees its index
+    unsigned old = atomic_exchange_explicit(&snapshots->middle, snapshots->back | SNAPSHOT_FRESH,
+            memory_order_acq_rel);
+    snapshots->back = old & SNAPSHOT_INDEX;
+}
+
+/*
+ * snapshot_acquire: Get the latest published snapshot, without waiting for the writer.
+ * Only to be called by the reader; the snapshot is valid until its next call.
+ */
+game_snapshot const* snapshot_acquire(snapshot_buffer *snapshots) {
+    if(atomic_load_explicit(&snapshots->middle, memory_order_relaxed) & SNAPSHOT_FRESH) {
+        // acquire: pairs with the release in snapshot_publish
+        unsigned old = atomic_exchange_explicit(&snapshots->middle, snapshots->front,
+                memory_order_acq_rel);
+        snapshots->front = old & SNAPSHOT_INDEX;
+    }
+    return &snapshots->buffers[snapshots->front];
+}
+
+/*
+ * snapshot_buffer_free: Free all snapshots' memory.
+ */
+void snapshot_buffer_free(snapshot_buffer *snapshots) {
+    for(int i = 0; i < 3; i++) {
+        free(snapshots->buffers[i].entities);
+        snapshots->buffers[i] = (game_snapshot) { 0 };
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * File: cnd_snapshot.h
+ *
+ * Header for game state snapshots shared between the update and render loops.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_SNAPSHOT_H
+#define CND_SNAPSHOT_H
+
+#include <stdatomic.h>
+
+/*
+ * snapshot_entity: Render-relevant state of one entity at the end of a tick.
+ * Also holds its position at the start of that tick, for the render loop to interpolate from.
+ */
+typedef struct {
+    int id;
+    int x;
+    int y;
+    int prev_x;     // same as x and y if the entity did not move in the tick
+    int prev_y;
+    int depth;
+    int current_spr_id;
+    int spr_current_img;
+} snapshot_entity;
+
+/*
+ * game_snapshot: Immutable copy of everything the render loop reads, taken at the end of a tick.
+ */
+typedef struct {
+    unsigned long tick;     // number of ticks run when this was taken
+    int current_room_id;
+    int camera_x;
+    int camera_y;
+    int num_entities;   // number of entities in the current room
+    int capacity;       // number of entities the entities array can hold
+    snapshot_entity *entities;  // entities of the current room, in room order
+} game_snapshot;
+
+/*
+ * snapshot_buffer: Triple buffer of snapshots, passed from one writer to one reader without locks.
+ *
+ * The writer fills its back buffer, then publishes it by swapping it with the middle buffer.
+ * The reader takes the middle buffer by swapping it with its front buffer, only if a newer
+ * snapshot was published since it last did. Both swaps are a single atomic exchange, so
+ * neither side ever waits for the other, and each owns its own buffer outright in between.
+ */
+typedef struct {
+    game_snapshot buffers[3];
+    _Atomic unsigned middle;    // index of the middle buffer, plus SNAPSHOT_FRESH if not yet read
+    unsigned back;      // index of the buffer being written, owned by the writer
+    unsigned front;     // index of the buffer being read, owned by the reader
+} snapshot_buffer;
+
+// All snapshot buffer functions (see cnd_snapshot.c)
+
+void init_snapshot_buffer(snapshot_buffer *snapshots);
+game_snapshot *snapshot_back(snapshot_buffer *snapshots);
+void snapshot_reserve(game_snapshot *snapshot, int num_entities);
+void snapshot_publish(snapshot_buffer *snapshots);
+game_snapshot const* snapshot_acquire(snapshot_buffer *snapshots);
+void snapshot_buffer_free(snapshot_buffer *snapshots);
+
+#endif //CND_SNAPSHOT_H
@@ -0,0 +1,216 @@
+/*
+ * File: cnd_softrender.c
+ *
+ * Contains all source code for the software render backend.
+ *
+ * Pixels are blended as out = (src * a + dst * (255 - a)) / 255, rounded to nearest, on each
+ * color channel. With SSE2, four pixels are blended at once as 16 bit lanes, with the division
+ * done exactly by shifts, so both paths give the same image bit for bit. Runs of four fully
+ * opaque or fully transparent pixels, ie. most of a typical sprite, are copied or skipped whole.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_softrender.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define OPAQUE 0xFF000000u
+
+/*
+ * blend_pixel: Private method to blend a pixel over an opaque one.
+ */
+static inline uint32_t blend_pixel(uint32_t src, uint32_t dst) {
+    uint32_t a = src >> 24;
+    if(a == 255)
+        return src;
+    if(a == 0)
+        return dst;
+    uint32_t out = OPAQUE;
+    for(int shift = 0; shift < 24; shift += 8) {
+        // exact rounded division by 255 of a value up to 255 * 255
+        uint32_t t = ((src >> shift) & 0xFF) * a + ((dst >> shift) & 0xFF) * (255 - a) + 128;
+        out |= ((t + (t >> 8)) >> 8) << shift;
+    }
+    return out;
+}
+
+#ifdef __SSE2__
+
+/*
+ * blend_pair: Private method to blend two pixels widened to 16 bits per channel.
+ */
+static inline __m128i blend_pair(__m128i src, __m128i dst) {
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, 0xFF), 0xFF);
+    __m128i inv_a = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(src, a), _mm_mullo_epi16(dst, inv_a));
+    t = _mm_add_epi16(t, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static void blend_row_sse2(uint32_t *dst, uint32_t const* src, int n) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i alpha_mask = _mm_set1_epi32((int) OPAQUE);
+    int i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m128i s = _mm_loadu_si128((__m128i const*) (src + i));
+        __m128i alpha = _mm_and_si128(s, alpha_mask);
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xFFFF)
+            continue;
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alpha_mask)) == 0xFFFF) {
+            _mm_storeu_si128((__m128i *) (dst + i), s);
+            continue;
+        }
+        __m128i d = _mm_loadu_si128((__m128i const*) (dst + i));
+        __m128i lo = blend_pair(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        __m128i hi = blend_pair(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_or_si128(_mm_packus_epi16(lo, hi), alpha_mask));
+    }
+    for(; i < n; i++)
+        dst[i] = blend_pixel(src[i], dst[i]);
+}
+
+#endif
+
+/*
+ * blend_row: Private method to blend a row of pixels over the framebuffer.
+ */
+static void blend_row(software_renderer const* renderer, uint32_t *dst, uint32_t const* src, int n) {
+#ifdef __SSE2__
+    if(renderer->use_simd) {
+        blend_row_sse2(dst, src, n);
+        return;
+    }
+#endif
+    for(int i = 0; i < n; i++)
+        dst[i] = blend_pixel(src[i], dst[i]);
+}
+
+static void software_begin_frame(render_backend *backend, int width, int height) {
+    software_renderer *renderer = (software_renderer *) backend;
+    if(width != renderer->width || height != renderer->height || renderer->pixels == NULL) {
+        free(renderer->pixels);
+        // one spare pixel, so an empty screen still gets an allocation
+        renderer->pixels = malloc(sizeof(uint32_t) * ((size_t) width * height + 1));
+        if(renderer->pixels == NULL) {
+            perror("Could not allocate framebuffer.");
+            exit(EXIT_FAILURE);
+        }
+        renderer->width = width;
+        renderer->height = height;
+    }
+    uint32_t clear = renderer->clear_color | OPAQUE;
+    for(size_t i = 0; i < (size_t) width * height; i++)
+        renderer->pixels[i] = clear;
+    renderer->frame_images = renderer->frame_pixels = 0;
+}
+
+static void software_draw_image(render_backend *backend, t_sprite const* sprite, int subimg, int x, int y) {
+    software_renderer *renderer = (software_renderer *) backend;
+    if(sprite->pixels == NULL)
+        return;
+    // clip to the screen
+    int left = (x < 0) ? -x : 0;
+    int top = (y < 0) ? -y : 0;
+    int right = (x + sprite->width > renderer->width) ? renderer->width - x : sprite->width;
+    int bottom = (y + sprite->height > renderer->height) ? renderer->height - y : sprite->height;
+    if(left >= right || top >= bottom)
+        return;
+    uint32_t const* src = sprite->pixels[subimg];
+    for(int row = top; row < bottom; row++) {
+        blend_row(renderer, renderer->pixels + (size_t) (y + row) * renderer->width + x + left,
+                  src + (size_t) row * sprite->width + left, right - left);
+    }
+    renderer->frame_images++;
+    renderer->frame_pixels += (long) (right - left) * (bottom - top);
+}
+
+/*
+ * software_upload_atlas: Give an atlas' pages textures, which are only handles for batching,
+ * numbered from 1 in page order. Images are still blended from their sprites' own pixels, as reading
+ * them from a page, a whole page width apart per row, is far less cache friendly.
+ */
+static void software_upload_atlas(render_backend *backend, texture_atlas *atlas) {
+    for(int i = 0; i < atlas->num_pages; i++)
+        atlas->pages[i].texture = i + 1;
+}
+
+static void software_upload_sprite(render_backend *backend, t_sprite *sprite) {
+    // nothing to upload, images are blended from the sprite's own pixels
+}
+
+static void software_end_frame(render_backend *backend) {
+    // nothing to display, the frame stays in the framebuffer
+}
+
+static void software_free(render_backend *backend) {
+    software_renderer *renderer = (software_renderer *) backend;
+    free(renderer->pixels);
+    free(renderer);
+}
+
+/*
+ * make_software_renderer: Create a software renderer, to be set as a game's renderer (see set_renderer).
+ *
+ * clear_color (uint32_t): RGBA color behind all images; its alpha is ignored.
+ */
+software_renderer *make_software_renderer(uint32_t clear_color) {
+    software_renderer *renderer = malloc(sizeof(software_renderer));
+    if(renderer == NULL) {
+        perror("Could not allocate software renderer.");
+        exit(EXIT_FAILURE);
+    }
+    renderer->backend.begin_frame = software_begin_frame;
+    renderer->backend.draw_image = software_draw_image;
+    renderer->backend.upload_atlas = software_upload_atlas;
+    renderer->backend.upload_sprite = software_upload_sprite;
+    renderer->backend.end_frame = software_end_frame;
+    renderer->backend.free = software_free;
+    renderer->width = renderer->height = 0;
+    renderer->pixels = NULL;
+    renderer->clear_color = clear_color;
+    renderer->use_simd = true;
+    renderer->frame_images = renderer->frame_pixels = 0;
+    return renderer;
+}
+
+/*
+ * software_renderer_get: Get the pixel of the last frame at (x, y), or 0 if outside the screen.
+ */
+uint32_t software_renderer_get(software_renderer const* renderer, int x, int y) {
+    if(renderer->pixels == NULL || x < 0 || y < 0 || x >= renderer->width || y >= renderer->height)
+        return 0;
+    return renderer->pixels[(size_t) y * renderer->width + x];
+}
+
+/*
+ * software_renderer_write_ppm: Write the last frame to a binary PPM image file.
+ * Returns false if the file could not be written.
+ */
+bool software_renderer_write_ppm(software_renderer const* renderer, char const* path) {
+    FILE *file = fopen(path, "wb");
+    if(file == NULL)
+        return false;
+    fprintf(file, "P6\n%d %d\n255\n", renderer->width, renderer->height);
+    unsigned char *row = malloc(3 * (size_t) renderer->width + 1);
+    if(row == NULL) {
+        perror("Could not allocate PPM row.");
+        exit(EXIT_FAILURE);
+    }
+    bool ok = true;
+    for(int y = 0; y < renderer->height && ok; y++) {
+        for(int x = 0; x < renderer->width; x++) {
+            uint32_t pixel = renderer->pixels[(size_t) y * renderer->width + x];
+            row[3 * x] = pixel & 0xFF;
+            row[3 * x + 1] = (pixel >> 8) & 0xFF;
+            row[3 * x + 2] = (pixel >> 16) & 0xFF;
+        }
+        ok = fwrite(row, 3, renderer->width, file) == (size_t) renderer->width;
+    }
+    free(row);
+    return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,42 @@
+/*
+ * File: cnd_softrender.h
+ *
+ * Header for the software render backend, which draws frames on the CPU without a GPU.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_SOFTRENDER_H
+#define CND_SOFTRENDER_H
+
+#include "cnd_render.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * software_renderer: Render backend blending sprites' pixels into a framebuffer in memory.
+ *
+ * Only sprites given pixels with sprite_set_pixels are drawn. Each pixel is blended over the
+ * framebuffer by its alpha, and images are clipped to the screen, ie. the camera's rectangle.
+ * The framebuffer is always opaque, and holds the last frame drawn until the next begins,
+ * so it can be inspected or written to a file, eg. for tests or servers without a display.
+ */
+typedef struct {
+    render_backend backend;     // must be first, so this can be used as a render_backend
+    int width;      // size of framebuffer, ie. of the screen in the last frame
+    int height;
+    uint32_t *pixels;   // width * height RGBA pixels, row by row, in the format of sprite pixels
+    uint32_t clear_color;   // color filling the framebuffer at the start of each frame
+    bool use_simd;      // blend several pixels per instruction where supported, true by default
+    // statistics for the last frame
+    long frame_images;  // images drawn, ie. with pixels and at least partly on screen
+    long frame_pixels;  // pixels blended
+} software_renderer;
+
+// All software renderer functions (see cnd_softrender.c)
+
+software_renderer *make_software_renderer(uint32_t clear_color);
+uint32_t software_renderer_get(software_renderer const* renderer, int x, int y);
+bool software_renderer_write_ppm(software_renderer const* renderer, char const* path);
+
+#endif //CND_SOFTRENDER_H
@@ -0,0 +1,280 @@
+/*
+ * File: cnd_soundcache.c
+ *
+ * Contains all source code for the cache of decoded sounds.
+ *
+ * A cache file holds one page of header, then the decoded samples exactly as played, so mapping
+ * it gives page aligned samples ready to mix. Files are written under a temporary name and only
+ * renamed into place once complete, and are only used while the size and modification time of
+ * the sound they were decoded from are unchanged. Samples are in native byte order, as cache
+ * files are only meant for the machine that wrote them.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_soundcache.h"
+#include "cnd_wav.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CACHE_MAGIC "CNDPCM1"
+#define RETURNS_AT_ONCE 64  // plays taken back from the mixer at a time
+
+/*
+ * cache_header: Start of a cache file, padded to a page.
+ */
+struct cache_header {
+    char magic[8];      // CACHE_MAGIC, written last so partly written files are never used
+    uint32_t sample_rate;
+    uint32_t header_bytes;  // offset of the samples, the page size of the machine that wrote it
+    int64_t num_frames;
+    int64_t source_size;    // size and modification time of the sound decoded
+    int64_t source_mtime_ns;
+};
+
+static size_t page_size() {
+    return (size_t) sysconf(_SC_PAGESIZE);
+}
+
+static int64_t mtime_ns(struct stat const* info) {
+    return (int64_t) info->st_mtim.tv_sec * 1000000000 + info->st_mtim.tv_nsec;
+}
+
+/*
+ * cache_path: Private method to name the cache file of a sound, or its temporary file while being written.
+ * Returns NULL if the name does not fit.
+ */
+static char *cache_path(char *buffer, size_t size, char const* path, char const* extra) {
+    int length = snprintf(buffer, size, "%s%s%s", path, SOUND_CACHE_SUFFIX, extra);
+    return (length < 0 || (size_t) length >= size) ? NULL : buffer;
+}
+
+/*
+ * map_cache_file: Private method to map a sound's cache file, if there is one that is still up to date.
+ */
+static bool map_cache_file(cached_sound *sound, char const* path, struct stat const* source) {
+    char name[4096];
+    if(cache_path(name, sizeof(name), path, "") == NULL)
+        return false;
+    int fd = open(name, O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct cache_header header;
+    struct stat info;
+    bool valid = fstat(fd, &info) == 0 && pread(fd, &header, sizeof(header), 0) == sizeof(header)
+                 && memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) == 0
+                 && header.sample_rate == MIXER_SAMPLE_RATE && header.header_bytes == page_size()
+                 && header.source_size == source->st_size && header.source_mtime_ns == mtime_ns(source)
+                 && header.num_frames >= 0
+                 && info.st_size >= (off_t) (header.header_bytes + sizeof(float) * 2 * header.num_frames);
+    void *mapping = MAP_FAILED;
+    if(valid)
+        // populated now, so the audio thread never waits on the disk
+        mapping = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+        return false;
+    sound->mapping = mapping;
+    sound->mapped_bytes = (size_t) info.st_size;
+    sound->samples = (float *) ((char *) mapping + header.header_bytes);
+    sound->num_frames = (long) header.num_frames;
+    return true;
+}
+
+/*
+ * evict_sound: Private method to unmap a sound and stop holding it.
+ */
+static void evict_sound(sound_cache *cache, cached_sound *sound) {
+    munmap(sound->mapping, sound->mapped_bytes);
+    cache->resident_bytes -= sound->mapped_bytes;
+    cache->evictions++;
+    slotmap_del(&cache->sounds, sound->snd_id);
+    free(sound);
+}
+
+/*
+ * make_room: Private method to evict the sounds played least recently, until there is room in the
+ * budget for another of some size.
+ *
+ * Returns (bool): false if there is not, as the sound is larger than the budget or the rest is playing.
+ */
+static bool make_room(sound_cache *cache, size_t bytes) {
+    if(bytes > cache->budget_bytes)
+        return false;
+    while(cache->resident_bytes + bytes > cache->budget_bytes) {
+        cached_sound **sounds = (cached_sound **) slotmap_get_elems(&cache->sounds);
+        cached_sound *oldest = NULL;
+        for(int i = 0; i < slotmap_get_num_entries(&cache->sounds); i++) {
+            if(sounds[i]->plays == 0 && (oldest == NULL || sounds[i]->last_used < oldest->last_used))
+                oldest = sounds[i];
+        }
+        if(oldest == NULL)
+            return false;
+        evict_sound(cache, oldest);
+    }
+    return true;
+}
+
+/*
+ * decode_to_cache: Private method to decode a whole sound into a new memory map, written to its cache file
+ * if persistent, making room for it first.
+ */
+static bool decode_to_cache(sound_cache *cache, cached_sound *sound, char const* path, struct stat const* source) {
+    wav_reader reader;
+    if(!wav_open(&reader, path))
+        return false;
+    size_t page = page_size();
+    size_t sample_bytes = sizeof(float) * 2 * (size_t) reader.num_frames;
+    size_t bytes = page + (sample_bytes + page - 1) / page * page;
+    if(reader.sample_rate != MIXER_SAMPLE_RATE || !make_room(cache, bytes)) {
+        wav_close(&reader);
+        return false;
+    }
+    // decode straight into the cache file, falling back to memory if it cannot be written
+    char name[4096];
+    int fd = -1;
+    void *mapping = MAP_FAILED;
+    if(cache->persistent && cache_path(name, sizeof(name), path, ".tmp") != NULL) {
+        fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(fd >= 0 && ftruncate(fd, (off_t) (page + sample_bytes)) == 0)
+            mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(fd >= 0 && mapping == MAP_FAILED) {
+            close(fd);
+            unlink(name);
+            fd = -1;
+        }
+    }
+    if(mapping == MAP_FAILED)
+        mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mapping == MAP_FAILED) {
+        perror("Could not map decoded sound.");
+        exit(EXIT_FAILURE);
+    }
+    sound->mapping = mapping;
+    sound->mapped_bytes = bytes;
+    sound->samples = (float *) ((char *) mapping + page);
+    sound->num_frames = wav_read(&reader, sound->samples, reader.num_frames);
+    wav_close(&reader);
+    if(fd >= 0) {
+        struct cache_header header = {
+                .sample_rate = MIXER_SAMPLE_RATE, .header_bytes = (uint32_t) page, .num_frames = sound->num_frames,
+                .source_size = source->st_size, .source_mtime_ns = mtime_ns(source)
+        };
+        memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+        memcpy(mapping, &header, sizeof(header));
+        char final_name[4096];
+        if(cache_path(final_name, sizeof(final_name), path, "") == NULL || rename(name, final_name) != 0)
+            unlink(name);
+        close(fd);
+    }
+    // never written again, so a stray write is caught rather than heard
+    mprotect(mapping, bytes, PROT_READ);
+    return true;
+}
+
+/*
+ * make_sound_cache: Create an empty sound cache.
+ *
+ * budget_bytes (size_t): Most memory to map for sounds at once.
+ * persistent (bool): Whether to read and write cache files next to each sound.
+ */
+sound_cache *make_sound_cache(size_t budget_bytes, bool persistent) {
+    sound_cache *cache = calloc(1, sizeof(*cache));
+    if(cache == NULL) {
+        perror("Could not allocate sound cache.");
+        exit(EXIT_FAILURE);
+    }
+    cache->sounds = make_slotmap(16);
+    cache->budget_bytes = budget_bytes;
+    cache->persistent = persistent;
+    return cache;
+}
+
+/*
+ * sound_cache_acquire: Get the decoded samples of a sound to play, decoding it if not already held.
+ * The sound is held until every acquire has been matched by a release, normally by playing the
+ * samples with mixer_play_borrowed then taking them back with sound_cache_collect.
+ *
+ * path (char const*): WAV file of the sound, at MIXER_SAMPLE_RATE.
+ * num_frames (long *): Set to the number of stereo frames in the samples.
+ *
+ * Returns (float const*): Interleaved stereo samples, or NULL if the sound cannot be read, or
+ * cannot be held within the budget; such sounds should be streamed instead.
+ */
+float const* sound_cache_acquire(sound_cache *cache, int snd_id, char const* path, long *num_frames) {
+    cached_sound *sound = slotmap_get(&cache->sounds, snd_id);
+    if(sound != NULL) {
+        cache->hits++;
+    } else {
+        struct stat source;
+        if(stat(path, &source) != 0)
+            return NULL;
+        sound = calloc(1, sizeof(*sound));
+        if(sound == NULL) {
+            perror("Could not allocate cached sound.");
+            exit(EXIT_FAILURE);
+        }
+        sound->snd_id = snd_id;
+        bool loaded = false;
+        if(cache->persistent && map_cache_file(sound, path, &source)) {
+            loaded = make_room(cache, sound->mapped_bytes);
+            if(!loaded)
+                munmap(sound->mapping, sound->mapped_bytes);
+            cache->file_loads += loaded;
+        } else {
+            loaded = decode_to_cache(cache, sound, path, &source);
+        }
+        if(!loaded) {
+            free(sound);
+            return NULL;
+        }
+        cache->misses++;
+        cache->resident_bytes += sound->mapped_bytes;
+        slotmap_add(&cache->sounds, snd_id, sound);
+    }
+    sound->plays++;
+    sound->last_used = ++cache->clock;
+    *num_frames = sound->num_frames;
+    return sound->samples;
+}
+
+/*
+ * sound_cache_release: Let a sound be evicted once no longer playing, matching one sound_cache_acquire.
+ */
+void sound_cache_release(sound_cache *cache, int snd_id) {
+    cached_sound *sound = slotmap_get(&cache->sounds, snd_id);
+    if(sound != NULL && sound->plays > 0)
+        sound->plays--;
+}
+
+/*
+ * sound_cache_collect: Release every play the mixer has finished with.
+ */
+void sound_cache_collect(sound_cache *cache, audio_mixer *mixer) {
+    int snd_ids[RETURNS_AT_ONCE];
+    int count;
+    while((count = mixer_take_returns(mixer, snd_ids, RETURNS_AT_ONCE)) > 0) {
+        for(int i = 0; i < count; i++)
+            sound_cache_release(cache, snd_ids[i]);
+    }
+}
+
+/*
+ * sound_cache_free: Unmap every sound held and free the cache.
+ * Nothing may still be playing its samples, so the mixer must be freed first.
+ */
+void sound_cache_free(sound_cache *cache) {
+    cached_sound **sounds = (cached_sound **) slotmap_get_elems(&cache->sounds);
+    for(int i = 0; i < slotmap_get_num_entries(&cache->sounds); i++) {
+        munmap(sounds[i]->mapping, sounds[i]->mapped_bytes);
+        free(sounds[i]);
+    }
+    slotmap_free(&cache->sounds);
+    free(cache);
+}
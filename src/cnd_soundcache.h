@@ -0,0 +1,64 @@
+/*
+ * File: cnd_soundcache.h
+ *
+ * Header for the cache of decoded sounds.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_SOUNDCACHE_H
+#define CND_SOUNDCACHE_H
+
+#include "cnd_slotmap.h"
+#include "cnd_mixer.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+#define SOUND_CACHE_SUFFIX ".pcm"   // added to a sound's path to name its cache file
+
+/*
+ * cached_sound: A sound decoded into a memory map, shared by every voice playing it.
+ */
+typedef struct {
+    int snd_id;
+    float *samples;     // interleaved stereo frames, starting on a page boundary
+    long num_frames;
+    void *mapping;      // memory map holding the samples, of mapped_bytes bytes
+    size_t mapped_bytes;
+    int plays;  // plays the mixer has not yet handed back; cannot be evicted while above 0
+    unsigned long last_used;    // value of the cache's clock when last played
+} cached_sound;
+
+/*
+ * sound_cache: Sounds decoded once and kept in memory, so short effects played many times
+ * are not decoded again on every play.
+ *
+ * Decoded samples are held in page aligned memory maps. If persistent, a cache file of the
+ * decoded samples is also written next to each sound, and mapped straight from disk by later
+ * runs while the sound is unchanged, so is never decoded twice. Once the sounds held would
+ * use more memory than the budget, the sounds played least recently that are not playing are
+ * evicted; sounds larger than the whole budget, eg. music tracks, are not cached at all.
+ * Only used by the game's thread (ie. the update loop dispatching sound commands).
+ */
+typedef struct {
+    slotmap sounds;     // cached_sounds held, by sound ID
+    size_t budget_bytes;    // most memory held at once
+    bool persistent;    // whether cache files are read and written
+    unsigned long clock;    // plays so far, to order sounds by when they were last played
+    // statistics
+    long hits;      // plays of sounds already held
+    long misses;    // plays of sounds not held, which were mapped from a cache file or decoded
+    long file_loads;    // misses mapped from a cache file, without decoding
+    long evictions;
+    size_t resident_bytes;  // memory mapped for all sounds held
+} sound_cache;
+
+// All sound cache functions (see cnd_soundcache.c)
+
+sound_cache *make_sound_cache(size_t budget_bytes, bool persistent);
+float const* sound_cache_acquire(sound_cache *cache, int snd_id, char const* path, long *num_frames);
+void sound_cache_release(sound_cache *cache, int snd_id);
+void sound_cache_collect(sound_cache *cache, audio_mixer *mixer);
+void sound_cache_free(sound_cache *cache);
+
+#endif //CND_SOUNDCACHE_H
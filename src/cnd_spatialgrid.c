@@ -0,0 +1,221 @@
+/*
+ * File: cnd_spatialgrid.c
+ *
+ * Contains all source code for uniform spatial grids.
+ * Spatial grids are used by rooms so the render loop only looks at entities near the camera.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_spatialgrid.h"
+#include "cnd_arena.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+/*
+ * make_spatial_grid: Create an empty grid covering a room.
+ *
+ * width, height (int): Size of the room in pixels.
+ * cell_size (int): Width and height of each cell; best around the size of the largest sprite.
+ *
+ * Returns (spatial_grid *): Empty grid, to be freed with spatial_grid_free.
+ */
+spatial_grid *make_spatial_grid(int width, int height, int cell_size) {
+    spatial_grid *grid = malloc(sizeof(spatial_grid));
+    if(grid == NULL) {
+        perror("Could not allocate spatial grid.");
+        exit(EXIT_FAILURE);
+    }
+    grid->cell_size = (cell_size > 0) ? cell_size : 1;
+    grid->cols = (width > 0) ? (width + grid->cell_size - 1) / grid->cell_size : 1;
+    grid->rows = (height > 0) ? (height + grid->cell_size - 1) / grid->cell_size : 1;
+    grid->cells = calloc((size_t) grid->cols * grid->rows, sizeof(grid_cell));
+    grid->mutexes = malloc(sizeof(pthread_mutex_t) * SPATIAL_GRID_NUM_LOCKS);
+    if(grid->cells == NULL || grid->mutexes == NULL) {
+        perror("Could not allocate cells for spatial grid.");
+        exit(EXIT_FAILURE);
+    }
+    for(int i = 0; i < SPATIAL_GRID_NUM_LOCKS; i++)
+        pthread_mutex_init(&grid->mutexes[i], NULL);
+    grid->id_capacity = 0;
+    grid->cell_of = NULL;
+    grid->slot_of = NULL;
+    return grid;
+}
+
+/*
+ * clamp: Private method to clamp a value into [0, max - 1].
+ */
+static int clamp(int value, int max) {
+    return (value < 0) ? 0 : (value >= max) ? max - 1 : value;
+}
+
+/*
+ * cell_index: Private method to get the index of the cell a position lies in,
+ * or the nearest edge cell if outside the grid.
+ */
+static int cell_index(spatial_grid const* grid, int x, int y) {
+    // floor division, so positions just left of or above the room are not rounded into it
+    int col = (x >= 0) ? x / grid->cell_size : -1;
+    int row = (y >= 0) ? y / grid->cell_size : -1;
+    return clamp(row, grid->rows) * grid->cols + clamp(col, grid->cols);
+}
+
+/*
+ * cell_add: Private method to add an ID to a cell. Caller must hold the cell's lock, if shared.
+ */
+static void cell_add(spatial_grid *grid, int cell, int id) {
+    grid_cell *c = &grid->cells[cell];
+    if(c->num_ids == c->capacity) {
+        int capacity = (c->capacity > 0) ? c->capacity * 2 : 8;
+        int *ids = realloc(c->ids, sizeof(int) * capacity);
+        if(ids == NULL) {
+            perror("Could not allocate spatial grid cell.");
+            exit(EXIT_FAILURE);
+        }
+        note_heap_allocation();
+        c->ids = ids;
+        c->capacity = capacity;
+    }
+    grid->slot_of[id] = c->num_ids;
+    c->ids[c->num_ids++] = id;
+    grid->cell_of[id] = cell;
+}
+
+/*
+ * cell_del: Private method to swap-remove an ID from its cell. Caller must hold the cell's lock, if shared.
+ */
+static void cell_del(spatial_grid *grid, int cell, int id) {
+    grid_cell *c = &grid->cells[cell];
+    int slot = grid->slot_of[id];
+    int last = c->ids[--c->num_ids];
+    c->ids[slot] = last;
+    grid->slot_of[last] = slot;
+}
+
+/*
+ * spatial_grid_insert: Add an entity to a grid at a position, or move it there if already present.
+ * Not thread safe, as the grid may grow to cover the ID.
+ */
+void spatial_grid_insert(spatial_grid *grid, int id, int x, int y) {
+    if(id >= grid->id_capacity) {
+        int capacity = (grid->id_capacity > 0) ? grid->id_capacity : 64;
+        while(capacity <= id)
+            capacity *= 2;
+        int *cell_of = realloc(grid->cell_of, sizeof(int) * capacity);
+        int *slot_of = realloc(grid->slot_of, sizeof(int) * capacity);
+        if(cell_of == NULL || slot_of == NULL) {
+            perror("Could not allocate IDs for spatial grid.");
+            exit(EXIT_FAILURE);
+        }
+        note_heap_allocation();
+        for(int i = grid->id_capacity; i < capacity; i++)
+            cell_of[i] = -1;
+        grid->cell_of = cell_of;
+        grid->slot_of = slot_of;
+        grid->id_capacity = capacity;
+    }
+    if(grid->cell_of[id] >= 0)
+        spatial_grid_move(grid, id, x, y);
+    else
+        cell_add(grid, cell_index(grid, x, y), id);
+}
+
+/*
+ * spatial_grid_move: Update the position of an entity in a grid. Does nothing if the entity is absent.
+ * May be called from several threads at once for different entities.
+ */
+void spatial_grid_move(spatial_grid *grid, int id, int x, int y) {
+    if(!spatial_grid_contains(grid, id))
+        return;
+    int old_cell = grid->cell_of[id];
+    int new_cell = cell_index(grid, x, y);
+    if(old_cell == new_cell)
+        return;
+    // only one lock held at a time, so threads moving entities in opposite directions cannot deadlock
+    pthread_mutex_t *old_lock = &grid->mutexes[old_cell & (SPATIAL_GRID_NUM_LOCKS - 1)];
+    pthread_mutex_t *new_lock = &grid->mutexes[new_cell & (SPATIAL_GRID_NUM_LOCKS - 1)];
+    pthread_mutex_lock(old_lock);
+    cell_del(grid, old_cell, id);
+    pthread_mutex_unlock(old_lock);
+    pthread_mutex_lock(new_lock);
+    cell_add(grid, new_cell, id);
+    pthread_mutex_unlock(new_lock);
+}
+
+/*
+ * spatial_grid_remove: Remove an entity from a grid. Does nothing if the entity is absent.
+ */
+void spatial_grid_remove(spatial_grid *grid, int id) {
+    if(!spatial_grid_contains(grid, id))
+        return;
+    cell_del(grid, grid->cell_of[id], id);
+    grid->cell_of[id] = -1;
+}
+
+/*
+ * spatial_grid_contains: Return true if a grid contains an entity, false otherwise.
+ */
+bool spatial_grid_contains(spatial_grid const* grid, int id) {
+    return id >= 0 && id < grid->id_capacity && grid->cell_of[id] >= 0;
+}
+
+/*
+ * spatial_grid_clear: Remove all entities from a grid, keeping its memory.
+ */
+void spatial_grid_clear(spatial_grid *grid) {
+    for(int i = 0; i < grid->cols * grid->rows; i++) {
+        grid_cell *c = &grid->cells[i];
+        for(int j = 0; j < c->num_ids; j++)
+            grid->cell_of[c->ids[j]] = -1;
+        c->num_ids = 0;
+    }
+}
+
+/*
+ * spatial_grid_query: Get IDs of all entities in cells overlapping a rectangle.
+ * May include entities just outside the rectangle, as whole cells are returned,
+ * so callers needing an exact answer must test positions themselves.
+ *
+ * x, y, width, height (int): Rectangle to query, in room coordinates.
+ * num_ids (int *): Set to the number of IDs returned.
+ *
+ * Returns (int *): IDs, allocated from the calling thread's frame arena, so must not be freed.
+ */
+int *spatial_grid_query(spatial_grid const* grid, int x, int y, int width, int height, int *num_ids) {
+    int first = cell_index(grid, x, y);
+    int last = cell_index(grid, x + width - 1, y + height - 1);
+    int first_col = first % grid->cols, first_row = first / grid->cols;
+    int last_col = last % grid->cols, last_row = last / grid->cols;
+    int count = 0;
+    for(int row = first_row; row <= last_row; row++) {
+        for(int col = first_col; col <= last_col; col++)
+            count += grid->cells[row * grid->cols + col].num_ids;
+    }
+    int *ids = frame_alloc(sizeof(int) * count);
+    int index = 0;
+    for(int row = first_row; row <= last_row; row++) {
+        for(int col = first_col; col <= last_col; col++) {
+            grid_cell const* c = &grid->cells[row * grid->cols + col];
+            for(int j = 0; j < c->num_ids; j++)
+                ids[index++] = c->ids[j];
+        }
+    }
+    *num_ids = count;
+    return ids;
+}
+
+/*
+ * spatial_grid_free: Free all memory in a grid.
+ */
+void spatial_grid_free(spatial_grid *grid) {
+    for(int i = 0; i < grid->cols * grid->rows; i++)
+        free(grid->cells[i].ids);
+    for(int i = 0; i < SPATIAL_GRID_NUM_LOCKS; i++)
+        pthread_mutex_destroy(&grid->mutexes[i]);
+    free(grid->mutexes);
+    free(grid->cells);
+    free(grid->cell_of);
+    free(grid->slot_of);
+    free(grid);
+}
@@ -0,0 +1,57 @@
+/*
+ * File: cnd_spatialgrid.h
+ *
+ * Header for uniform spatial grids.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_SPATIALGRID_H
+#define CND_SPATIALGRID_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#define SPATIAL_GRID_NUM_LOCKS 64   // number of lock stripes over a grid's cells, must be a power of 2
+
+/*
+ * grid_cell: IDs of all entities whose position lies in one cell of a grid, in no particular order.
+ */
+typedef struct {
+    int num_ids;
+    int capacity;
+    int *ids;
+} grid_cell;
+
+/*
+ * spatial_grid: Buckets entity positions into square cells covering a room.
+ * Positions outside the room are kept in the nearest edge cell, so no entity is ever lost.
+ *
+ * Every entity's cell and its slot in that cell are kept in arrays indexed by ID,
+ * so moving or removing an entity is constant time. Moving only touches cells when
+ * an entity crosses into another cell; cells are then locked by stripe, so entities
+ * may be moved from several threads at once as long as each entity is only moved by one.
+ */
+typedef struct {
+    int cell_size;  // width and height of each cell in pixels
+    int cols;       // number of cells across and down
+    int rows;
+    grid_cell *cells;   // cols * rows cells, row by row
+    int id_capacity;    // number of IDs covered by cell_of and slot_of
+    int *cell_of;   // ID -> index of cell holding it, -1 if absent
+    int *slot_of;   // ID -> index in its cell's ids
+    pthread_mutex_t *mutexes;   // locks over cells, cell i uses lock i % SPATIAL_GRID_NUM_LOCKS
+} spatial_grid;
+
+// All spatial grid functions (see cnd_spatialgrid.c)
+
+spatial_grid *make_spatial_grid(int width, int height, int cell_size);
+void spatial_grid_insert(spatial_grid *grid, int id, int x, int y);
+void spatial_grid_move(spatial_grid *grid, int id, int x, int y);
+void spatial_grid_remove(spatial_grid *grid, int id);
+bool spatial_grid_contains(spatial_grid const* grid, int id);
+void spatial_grid_clear(spatial_grid *grid);
+int *spatial_grid_query(spatial_grid const* grid, int x, int y, int width, int height, int *num_ids);
+void spatial_grid_free(spatial_grid *grid);
+
+#endif //CND_SPATIALGRID_H
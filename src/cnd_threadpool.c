@@ -0,0 +1,223 @@
+/*
+ * File: cnd_threadpool.c
+ *
+ * Contains all source code for the work-stealing thread pool.
+ * Used by the update loop to run entity event handlers on every core.
+ *
+ * A job is split into chunks of items, and each worker starts with an equal
+ * contiguous run of chunks in its own deque. Workers run their own chunks
+ * first, then steal single chunks from the other end of other deques, so
+ * uneven handlers still keep every core busy.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_threadpool.h"
+#include "cnd_arena.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#define PACK_SPAN(top, bottom) (((uint64_t) (uint32_t) (top) << 32) | (uint32_t) (bottom))
+#define SPAN_TOP(span) ((int) ((span) >> 32))
+#define SPAN_BOTTOM(span) ((int) ((span) & 0xffffffffu))
+
+/*
+ * deque_pop: Private method for a worker to take a chunk from the bottom of its own deque.
+ * Returns chunk index, or -1 if empty.
+ */
+static int deque_pop(worker_deque *deque) {
+    uint64_t span = atomic_load_explicit(&deque->span, memory_order_relaxed);
+    for(;;) {
+        int top = SPAN_TOP(span), bottom = SPAN_BOTTOM(span);
+        if(top >= bottom)
+            return -1;
+        if(atomic_compare_exchange_weak(&deque->span, &span, PACK_SPAN(top, bottom - 1)))
+            return bottom - 1;
+    }
+}
+
+/*
+ * deque_steal: Private method for a worker to take a chunk from the top of another's deque.
+ * Returns chunk index, or -1 if empty.
+ */
+static int deque_steal(worker_deque *deque) {
+    uint64_t span = atomic_load_explicit(&deque->span, memory_order_relaxed);
+    for(;;) {
+        int top = SPAN_TOP(span), bottom = SPAN_BOTTOM(span);
+        if(top >= bottom)
+            return -1;
+        if(atomic_compare_exchange_weak(&deque->span, &span, PACK_SPAN(top + 1, bottom)))
+            return top;
+    }
+}
+
+/*
+ * run_chunk: Private method to run the current task over one chunk.
+ */
+static void run_chunk(threadpool *pool, int chunk, int worker) {
+    int begin = chunk * pool->chunk_size;
+    int end = begin + pool->chunk_size;
+    if(end > pool->num_items)
+        end = pool->num_items;
+    pool->task(pool->ctx, begin, end, worker);
+}
+
+/*
+ * run_worker: Private method to run a worker's share of the current job, then steal until none is left.
+ */
+static void run_worker(threadpool *pool, int worker) {
+    int chunk;
+    while((chunk = deque_pop(&pool->deques[worker])) >= 0)
+        run_chunk(pool, chunk, worker);
+    for(int i = 1; i < pool->num_workers; i++) {
+        worker_deque *victim = &pool->deques[(worker + i) % pool->num_workers];
+        while((chunk = deque_steal(victim)) >= 0)
+            run_chunk(pool, chunk, worker);
+    }
+    pthread_mutex_lock(&pool->lock);
+    if(--pool->num_running == 0)
+        pthread_cond_signal(&pool->done_cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+struct worker_args {
+    threadpool *pool;
+    int worker;
+};
+
+/*
+ * worker_main: Private method run by each pool thread, waiting for and running jobs until shutdown.
+ */
+static void *worker_main(void *arg) {
+    struct worker_args args = *(struct worker_args *) arg;
+    free(arg);
+    threadpool *pool = args.pool;
+    unsigned long seen_generation = 0;
+    for(;;) {
+        pthread_mutex_lock(&pool->lock);
+        while(pool->generation == seen_generation && !pool->shutting_down)
+            pthread_cond_wait(&pool->start_cond, &pool->lock);
+        if(pool->shutting_down) {
+            pthread_mutex_unlock(&pool->lock);
+            arena_free(frame_arena_local());
+            return NULL;
+        }
+        seen_generation = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+        // scratch memory of workers only lives for one job
+        arena_reset(frame_arena_local());
+        run_worker(pool, args.worker);
+    }
+}
+
+/*
+ * make_threadpool: Create a thread pool.
+ *
+ * num_workers (int): Number of workers, including the calling thread. If 0 or less,
+ *      uses one worker per online CPU.
+ *
+ * Returns (threadpool *): New thread pool, with its threads waiting for jobs.
+ */
+threadpool *make_threadpool(int num_workers) {
+    if(num_workers <= 0) {
+        long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_workers = (num_cpus > 0) ? (int) num_cpus : 1;
+    }
+    threadpool *pool = calloc(1, sizeof(threadpool));
+    if(pool == NULL) {
+        perror("Could not allocate thread pool.");
+        exit(EXIT_FAILURE);
+    }
+    pool->num_workers = num_workers;
+    pool->deques = aligned_alloc(_Alignof(worker_deque), sizeof(worker_deque) * num_workers);
+    pool->threads = malloc(sizeof(pthread_t) * num_workers);
+    if(pool->deques == NULL || pool->threads == NULL) {
+        perror("Could not allocate workers for thread pool.");
+        exit(EXIT_FAILURE);
+    }
+    for(int i = 0; i < num_workers; i++)
+        atomic_init(&pool->deques[i].span, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    for(int i = 1; i < num_workers; i++) {
+        struct worker_args *args = malloc(sizeof(struct worker_args));
+        if(args == NULL) exit(EXIT_FAILURE);
+        args->pool = pool;
+        args->worker = i;
+        if(pthread_create(&pool->threads[i], NULL, worker_main, args) != 0) {
+            perror("Could not create thread pool worker.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return pool;
+}
+
+/*
+ * threadpool_num_workers: Get number of workers in pool, including the calling thread.
+ */
+int threadpool_num_workers(threadpool const* pool) {
+    return pool->num_workers;
+}
+
+/*
+ * threadpool_run: Run a task over items [0, num_items) on all workers, and wait for it to finish.
+ *
+ * num_items (int): Number of items to process.
+ * chunk_size (int): Number of items per chunk, the unit of work stealing.
+ * task (threadpool_task): Function to run over each chunk.
+ * ctx (void *): Passed to every call of task.
+ */
+void threadpool_run(threadpool *pool, int num_items, int chunk_size, threadpool_task task, void *ctx) {
+    if(num_items <= 0)
+        return;
+    if(chunk_size <= 0)
+        chunk_size = 1;
+    int num_chunks = (num_items + chunk_size - 1) / chunk_size;
+    if(pool->num_workers == 1 || num_chunks == 1) {
+        task(ctx, 0, num_items, 0);
+        return;
+    }
+    pool->task = task;
+    pool->ctx = ctx;
+    pool->num_items = num_items;
+    pool->chunk_size = chunk_size;
+    // give each worker an equal contiguous run of chunks
+    for(int i = 0; i < pool->num_workers; i++) {
+        int top = (int) ((long) num_chunks * i / pool->num_workers);
+        int bottom = (int) ((long) num_chunks * (i + 1) / pool->num_workers);
+        atomic_store(&pool->deques[i].span, PACK_SPAN(top, bottom));
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->num_running = pool->num_workers;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_worker(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while(pool->num_running > 0)
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * threadpool_free: Stop all workers and free the pool.
+ */
+void threadpool_free(threadpool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutting_down = true;
+    pthread_cond_broadcast(&pool->start_cond);
+    pthread_mutex_unlock(&pool->lock);
+    for(int i = 1; i < pool->num_workers; i++)
+        pthread_join(pool->threads[i], NULL);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    free(pool->deques);
+    free(pool->threads);
+    free(pool);
+}
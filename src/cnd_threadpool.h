@@ -0,0 +1,63 @@
+/*
+ * File: cnd_threadpool.h
+ *
+ * Header for the work-stealing thread pool.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_THREADPOOL_H
+#define CND_THREADPOOL_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * threadpool_task: Function run by the pool over a range of items [begin, end).
+ * 'worker' is the index of the worker running it, from 0 to num_workers - 1,
+ * so tasks can keep per-worker results without locking.
+ */
+typedef void (*threadpool_task)(void *ctx, int begin, int end, int worker);
+
+/*
+ * worker_deque: Chunks of the current job owned by one worker.
+ * Chunks are only ever removed during a job, so the deque is just a range of
+ * chunk indices [top, bottom) packed into one atomic word: the owner takes
+ * from the bottom, and thieves take from the top.
+ */
+typedef struct {
+    _Alignas(64) _Atomic uint64_t span;     // top in high 32 bits, bottom in low 32 bits
+} worker_deque;
+
+/*
+ * threadpool: A fixed set of worker threads that run parallel-for jobs.
+ * The thread calling threadpool_run acts as worker 0, so a pool of one worker
+ * spawns no threads at all. Other workers reset their frame arena at the start
+ * of every job, so anything they allocate from it must not outlive the job.
+ */
+typedef struct {
+    int num_workers;    // number of workers, including the calling thread
+    pthread_t *threads;     // threads for workers 1 to num_workers - 1
+    worker_deque *deques;   // one deque per worker
+    pthread_mutex_t lock;   // protects generation, shutting_down and num_running
+    pthread_cond_t start_cond;  // signalled when a job starts or the pool shuts down
+    pthread_cond_t done_cond;   // signalled when the last worker finishes a job
+    unsigned long generation;   // incremented for every job
+    bool shutting_down;
+    int num_running;    // number of workers still running the current job
+    // current job
+    threadpool_task task;
+    void *ctx;
+    int num_items;
+    int chunk_size;
+} threadpool;
+
+// All threadpool functions (see cnd_threadpool.c)
+
+threadpool *make_threadpool(int num_workers);
+int threadpool_num_workers(threadpool const* pool);
+void threadpool_run(threadpool *pool, int num_items, int chunk_size, threadpool_task task, void *ctx);
+void threadpool_free(threadpool *pool);
+
+#endif //CND_THREADPOOL_H
@@ -0,0 +1,145 @@
+/*
+ * File: cnd_wav.c
+ *
+ * Contains all source code for reading WAV files.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnd_wav.h"
+#include <stdint.h>
+#include <string.h>
+
+#define WAV_READ_FRAMES 1024    // frames read from the file at a time
+
+/*
+ * read_le: Private method to read a little endian unsigned integer of 'size' bytes, returning false at end of file.
+ */
+static bool read_le(FILE *file, int size, uint32_t *value) {
+    uint8_t bytes[4];
+    if(fread(bytes, 1, size, file) != (size_t) size)
+        return false;
+    *value = 0;
+    for(int i = size - 1; i >= 0; i--)
+        *value = (*value << 8) | bytes[i];
+    return true;
+}
+
+/*
+ * wav_open: Open a WAV file, and read its header up to the first sample.
+ *
+ * Returns (bool): false if the file cannot be opened, or is not a WAV file of a supported format,
+ * in which case the reader is left closed.
+ */
+bool wav_open(wav_reader *reader, char const* path) {
+    FILE *file = fopen(path, "rb");
+    return file != NULL && wav_open_stream(reader, file);
+}
+
+/*
+ * wav_open_stream: Read the header of a WAV file already open, eg. one in memory opened with fmemopen.
+ * The reader takes ownership of the file, closing it if the header cannot be read.
+ *
+ * Returns (bool): false if the file is not a WAV file of a supported format, in which case the
+ * reader is left closed.
+ */
+bool wav_open_stream(wav_reader *reader, FILE *file) {
+    reader->file = file;
+    char id[4];
+    uint32_t size, value;
+    bool have_format = false;
+    if(fread(id, 1, 4, reader->file) != 4 || memcmp(id, "RIFF", 4) != 0
+            || !read_le(reader->file, 4, &size)
+            || fread(id, 1, 4, reader->file) != 4 || memcmp(id, "WAVE", 4) != 0)
+        goto invalid;
+    // chunks may come in any order, but samples are always in the data chunk, after the fmt chunk
+    while(fread(id, 1, 4, reader->file) == 4 && read_le(reader->file, 4, &size)) {
+        if(memcmp(id, "fmt ", 4) == 0) {
+            uint32_t bits;
+            if(size < 16 || !read_le(reader->file, 2, &value))
+                goto invalid;
+            reader->format = (int) value;
+            if(!read_le(reader->file, 2, &value))
+                goto invalid;
+            reader->channels = (int) value;
+            if(!read_le(reader->file, 4, &value))
+                goto invalid;
+            reader->sample_rate = (int) value;
+            if(!read_le(reader->file, 4, &value) || !read_le(reader->file, 2, &value)
+                    || !read_le(reader->file, 2, &bits))
+                goto invalid;
+            bool supported = (reader->format == WAV_PCM && bits == 16) || (reader->format == WAV_FLOAT && bits == 32);
+            if(!supported || reader->channels < 1 || reader->channels > 2 || reader->sample_rate <= 0)
+                goto invalid;
+            reader->bytes_per_frame = reader->channels * (int) bits / 8;
+            have_format = true;
+            size -= 16;
+        } else if(memcmp(id, "data", 4) == 0) {
+            if(!have_format)
+                goto invalid;
+            reader->num_frames = size / reader->bytes_per_frame;
+            reader->frames_read = 0;
+            return true;
+        }
+        // chunks are padded to an even size; nothing is skipped after a plain fmt chunk, so pipes can be read
+        if(size + (size & 1) > 0 && fseek(reader->file, size + (size & 1), SEEK_CUR) != 0)
+            goto invalid;
+    }
+invalid:
+    fclose(reader->file);
+    reader->file = NULL;
+    return false;
+}
+
+/*
+ * wav_read: Decode the next frames of a WAV file as interleaved stereo floats from -1 to 1.
+ * Mono files are played out of both channels.
+ *
+ * frames (float *): Array of 2 * num_frames floats to decode into.
+ *
+ * Returns (long): Frames decoded, less than num_frames only at the end of the file.
+ */
+long wav_read(wav_reader *reader, float *frames, long num_frames) {
+    uint8_t bytes[WAV_READ_FRAMES * 2 * sizeof(float)];
+    long decoded = 0;
+    if(num_frames > reader->num_frames - reader->frames_read)
+        num_frames = reader->num_frames - reader->frames_read;
+    while(decoded < num_frames) {
+        long count = num_frames - decoded;
+        if(count > WAV_READ_FRAMES)
+            count = WAV_READ_FRAMES;
+        count = (long) fread(bytes, reader->bytes_per_frame, count, reader->file);
+        if(count == 0)
+            break;
+        float *out = frames + 2 * decoded;
+        int samples = (int) count * reader->channels;
+        for(int i = 0; i < samples; i++) {
+            float sample;
+            if(reader->format == WAV_PCM) {
+                int16_t value = (int16_t) (bytes[2 * i] | bytes[2 * i + 1] << 8);
+                sample = value * (1.0f / 32768.0f);
+            } else {
+                uint32_t value = bytes[4 * i] | bytes[4 * i + 1] << 8 | bytes[4 * i + 2] << 16
+                                 | (uint32_t) bytes[4 * i + 3] << 24;
+                memcpy(&sample, &value, sizeof(float));
+            }
+            if(reader->channels == 1) {
+                out[2 * i] = out[2 * i + 1] = sample;
+            } else {
+                out[i] = sample;
+            }
+        }
+        decoded += count;
+    }
+    reader->frames_read += decoded;
+    return decoded;
+}
+
+/*
+ * wav_close: Close a WAV file.
+ */
+void wav_close(wav_reader *reader) {
+    if(reader->file != NULL)
+        fclose(reader->file);
+    reader->file = NULL;
+}
@@ -0,0 +1,39 @@
+/*
+ * File: cnd_wav.h
+ *
+ * Header for reading WAV files a piece at a time.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#ifndef CND_WAV_H
+#define CND_WAV_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#define WAV_PCM 1       // formats of samples, as in a WAV file's fmt chunk
+#define WAV_FLOAT 3
+
+/*
+ * wav_reader: An open WAV file, decoded a number of frames at a time into stereo floats.
+ * Reads 16 bit integer and 32 bit float samples, mono or stereo, at any sample rate.
+ */
+typedef struct {
+    FILE *file;
+    int format;     // WAV_PCM or WAV_FLOAT
+    int channels;   // 1 or 2
+    int sample_rate;    // frames per second
+    int bytes_per_frame;
+    long num_frames;    // frames in the file
+    long frames_read;   // frames decoded so far
+} wav_reader;
+
+// All WAV reading functions (see cnd_wav.c)
+
+bool wav_open(wav_reader *reader, char const* path);
+bool wav_open_stream(wav_reader *reader, FILE *file);
+long wav_read(wav_reader *reader, float *frames, long num_frames);
+void wav_close(wav_reader *reader);
+
+#endif //CND_WAV_H
@@ -15,5 +15,7 @@
 #include "cnd_datatypes.h"    // all data types
 #include "cnd_gamedata.h"     // game data
 #include "cnd_commands.h"  // all update commands and dispatchers
+#include "cnd_softrender.h"    // render backend without a GPU
+#include "cnd_glrender.h"      // render backend drawing instanced batches with OpenGL
 
 #endif //CNOODLE_H
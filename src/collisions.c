@@ -0,0 +1,240 @@
+/*
+ * File: collisions.c
+ *
+ * Collision detection between the current room's entities, run once per tick before
+ * entities update, so every entity's collide handler can be called for each entity it hit.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "cnoodle.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * make_collision_world: Create an empty collision world.
+ */
+collision_world *make_collision_world() {
+    collision_world *world = calloc(1, sizeof(collision_world));
+    if(world == NULL) {
+        perror("Could not allocate collision world.");
+        exit(EXIT_FAILURE);
+    }
+    return world;
+}
+
+/*
+ * reserve: Private method to grow an array to hold at least 'num' elements.
+ */
+static void *reserve(void *array, int *capacity, int num, size_t elem_size) {
+    if(num <= *capacity)
+        return array;
+    int new_capacity = (*capacity > 0) ? *capacity : 64;
+    while(new_capacity < num)
+        new_capacity *= 2;
+    array = realloc(array, elem_size * new_capacity);
+    if(array == NULL) {
+        perror("Could not allocate collision world.");
+        exit(EXIT_FAILURE);
+    }
+    note_heap_allocation();
+    *capacity = new_capacity;
+    return array;
+}
+
+/*
+ * refresh_box: Private method to set a box from its entity's position and sprite.
+ * Returns false if the entity no longer exists or has no sprite, ie. cannot collide.
+ */
+static bool refresh_box(t_game_data *data, collision_box *box) {
+    int index = slotmap_index(&data->entities, box->id);
+    if(index < 0)
+        return false;
+    int x, y, spr_id, img;
+    if(data->hot_entities != NULL) {
+        x = data->hot_entities->x[index];
+        y = data->hot_entities->y[index];
+        spr_id = data->hot_entities->current_spr_id[index];
+        img = data->hot_entities->spr_current_img[index];
+    } else {
+        t_entity const* entity = get_entity(data, box->id);
+        x = entity->x;
+        y = entity->y;
+        spr_id = entity->current_spr_id;
+        img = entity->spr_current_img;
+    }
+    t_sprite const* sprite = get_sprite(data, spr_id);
+    if(sprite == NULL || sprite->width <= 0 || sprite->height <= 0)
+        return false;
+    box->min_x = x;
+    box->max_x = x + sprite->width;
+    box->min_y = y;
+    box->max_y = y + sprite->height;
+    // sprites still loading collide by their hitbox
+    box->mask = (asset_ready(sprite) && sprite->masks != NULL && img >= 0 && img < sprite->num_imgs)
+                ? &sprite->masks[img] : NULL;
+    return true;
+}
+
+/*
+ * sync_boxes: Private method to make the boxes match the current room's entities,
+ * keeping the order of boxes that are still there from the last frame.
+ */
+static void sync_boxes(t_game_data *data, collision_world *world, t_room const* room) {
+    world->frame += 2;
+    unsigned in_room = world->frame, has_box = world->frame + 1;
+    if(data->max_id >= world->num_marks) {
+        int old_num_marks = world->num_marks;
+        world->marks = reserve(world->marks, &world->num_marks, data->max_id + 1, sizeof(unsigned));
+        memset(world->marks + old_num_marks, 0, sizeof(unsigned) * (world->num_marks - old_num_marks));
+    }
+    for(int i = 0; i < room->num_entities; i++) {
+        int id = room->entity_ids[i];
+        if(id >= 0 && id <= data->max_id)
+            world->marks[id] = in_room;
+    }
+    // refresh boxes kept from last frame, dropping any that left the room
+    int num_kept = 0;
+    for(int i = 0; i < world->num_boxes; i++) {
+        collision_box box = world->boxes[i];
+        if(world->marks[box.id] != in_room || !refresh_box(data, &box))
+            continue;
+        world->marks[box.id] = has_box;
+        world->boxes[num_kept++] = box;
+    }
+    world->num_boxes = num_kept;
+    // then add entities new to the room
+    for(int i = 0; i < room->num_entities; i++) {
+        int id = room->entity_ids[i];
+        if(id < 0 || id > data->max_id || world->marks[id] != in_room)
+            continue;
+        collision_box box = { .id = id };
+        if(!refresh_box(data, &box))
+            continue;
+        world->marks[id] = has_box;
+        world->boxes = reserve(world->boxes, &world->box_capacity, world->num_boxes + 1, sizeof(collision_box));
+        world->boxes[world->num_boxes++] = box;
+    }
+}
+
+/*
+ * sort_boxes: Private method to insertion sort boxes by min_x.
+ * Boxes are nearly sorted from the last frame, so this is close to linear.
+ */
+static void sort_boxes(collision_world *world) {
+    world->frame_swaps = 0;
+    for(int i = 1; i < world->num_boxes; i++) {
+        collision_box box = world->boxes[i];
+        int j = i;
+        while(j > 0 && world->boxes[j - 1].min_x > box.min_x) {
+            world->boxes[j] = world->boxes[j - 1];
+            j--;
+        }
+        world->boxes[j] = box;
+        world->frame_swaps += i - j;
+    }
+}
+
+/*
+ * sweep: Private method to find all pairs of intersecting boxes.
+ * Only boxes overlapping on the x axis are candidates, and the sweep stops at the first box
+ * starting past the end of the current one, as all following boxes start even later.
+ * Intersecting boxes that both have masks must also have overlapping solid pixels.
+ */
+static void sweep(collision_world *world) {
+    world->num_pairs = 0;
+    world->frame_candidates = 0;
+    world->frame_mask_tests = 0;
+    for(int i = 0; i < world->num_boxes; i++) {
+        collision_box const* a = &world->boxes[i];
+        for(int j = i + 1; j < world->num_boxes && world->boxes[j].min_x < a->max_x; j++) {
+            collision_box const* b = &world->boxes[j];
+            world->frame_candidates++;
+            // narrow phase: exact test, x already overlaps so only y is left
+            if(a->min_y >= b->max_y || b->min_y >= a->max_y)
+                continue;
+            if(a->mask != NULL && b->mask != NULL) {
+                world->frame_mask_tests++;
+                if(!masks_intersect(a->mask, a->min_x, a->min_y, b->mask, b->min_x, b->min_y))
+                    continue;
+            }
+            world->pairs = reserve(world->pairs, &world->pair_capacity, world->num_pairs + 1,
+                                   sizeof(collision_pair));
+            collision_pair *pair = &world->pairs[world->num_pairs++];
+            pair->a = (a->id < b->id) ? a->id : b->id;
+            pair->b = (a->id < b->id) ? b->id : a->id;
+        }
+    }
+}
+
+/*
+ * build_contacts: Private method to group pairs by entity, so each entity can find its own
+ * collisions in constant time. Both entities of a pair get a contact with the other.
+ */
+static void build_contacts(t_game_data *data, collision_world *world) {
+    int num_indices = data->entities.num_entries;
+    int *starts = frame_alloc(sizeof(int) * (num_indices + 1));
+    int *fill = frame_alloc(sizeof(int) * num_indices);
+    int *contacts = frame_alloc(sizeof(int) * 2 * world->num_pairs);
+    memset(starts, 0, sizeof(int) * (num_indices + 1));
+    for(int i = 0; i < world->num_pairs; i++) {
+        starts[slotmap_index(&data->entities, world->pairs[i].a) + 1]++;
+        starts[slotmap_index(&data->entities, world->pairs[i].b) + 1]++;
+    }
+    for(int i = 0; i < num_indices; i++) {
+        starts[i + 1] += starts[i];
+        fill[i] = starts[i];
+    }
+    for(int i = 0; i < world->num_pairs; i++) {
+        collision_pair const* pair = &world->pairs[i];
+        contacts[fill[slotmap_index(&data->entities, pair->a)]++] = pair->b;
+        contacts[fill[slotmap_index(&data->entities, pair->b)]++] = pair->a;
+    }
+    world->num_indices = num_indices;
+    world->contact_starts = starts;
+    world->contacts = contacts;
+}
+
+/*
+ * detect_collisions: Find every pair of entities in the current room whose sprites intersect.
+ * Must be called on the update thread, between ticks' dispatch phases; contacts are then
+ * valid until the tick's frame arena is reset.
+ */
+void detect_collisions(t_game_data *data, collision_world *world) {
+    t_room const* room = get_room(data, data->current_room_id);
+    if(room == NULL) {
+        world->num_boxes = world->num_pairs = world->num_indices = 0;
+        return;
+    }
+    sync_boxes(data, world, room);
+    sort_boxes(world);
+    sweep(world);
+    build_contacts(data, world);
+}
+
+/*
+ * get_contacts: Get the IDs of all entities an entity collided with this tick.
+ *
+ * dense_index (int): Entity's index in the entity store (see slotmap_index).
+ * contacts (int const**): Set to the array of IDs, valid until the end of the tick.
+ *
+ * Returns (int): Number of IDs.
+ */
+int get_contacts(collision_world const* world, int dense_index, int const** contacts) {
+    if(dense_index < 0 || dense_index >= world->num_indices)
+        return 0;
+    int start = world->contact_starts[dense_index];
+    *contacts = world->contacts + start;
+    return world->contact_starts[dense_index + 1] - start;
+}
+
+/*
+ * collision_world_free: Free all memory in a collision world.
+ */
+void collision_world_free(collision_world *world) {
+    free(world->boxes);
+    free(world->pairs);
+    free(world->marks);
+    free(world);
+}
@@ -5,33 +5,84 @@
  * Must support multithreading, ie. must use game data only for reading
  * then acquire a lock on desired struct to write to.
  *
+ * Entity alterations are instead made thread safe by sharding: dispatch_commands
+ * gives every target entity to exactly one worker, so they never need a lock.
+ *
  * Author: Jack Romo <sharrackor@gmail.com>
  */
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
 #include "cnoodle.h"
 
+#define DISPATCH_SHARDS_PER_WORKER 8    // more shards than workers, so stealing can balance them
+#define DISPATCH_PARALLEL_MIN 256   // runs of alters shorter than this are dispatched serially
+
 // TODO: acquire lock on needed data, modify, then release
 // only hold one lock at a time
+// (except cmd_alter_entity, which is only ever run by the worker owning its target's shard)
+
+/*
+ * note_move: Private method to remember where an entity was before it first moves in a tick,
+ * so snapshots can give the render loop both positions to interpolate between.
+ */
+static void note_move(t_game_data *data, t_entity *entity) {
+    if(entity->moved_tick == data->tick + 1)
+        return;
+    entity->prev_x = entity->x;
+    entity->prev_y = entity->y;
+    entity->moved_tick = data->tick + 1;
+}
+
+/*
+ * move_in_grid: Private method to keep the current room's spatial grid up to date with a moved entity.
+ * Other rooms' grids are rebuilt when they become current.
+ */
+static void move_in_grid(t_game_data *data, t_entity const* entity) {
+    t_room *room = get_room(data, data->current_room_id);
+    if(room != NULL && room->grid != NULL)
+        spatial_grid_move(room->grid, entity->id, entity->x, entity->y);
+}
 
 void cmd_alter_entity(t_game_data *data, struct alter_entity_command cmd) {
     t_entity *target_entity = get_entity(data, cmd.target_id);
+    if(target_entity == NULL)
+        return;
+    // hot fields are also written to their arrays, if stored separately
+    entity_soa *hot = data->hot_entities;
+    int index = slotmap_index(&data->entities, cmd.target_id);
     switch(cmd.modified_attr) {
         case CURRENT_SPR:
-            target_entity->current_spr = cmd.model_ent.current_spr;
+            target_entity->current_spr_id = cmd.int_value;
+            if(hot != NULL) {
+                t_sprite const* sprite = get_sprite(data, cmd.int_value);
+                hot->current_spr_id[index] = target_entity->current_spr_id;
+                hot->spr_num_imgs[index] = (sprite != NULL) ? sprite->num_imgs : 0;
+            }
             break;
         case X:
-            target_entity->x = cmd.model_ent.x;
+            note_move(data, target_entity);
+            target_entity->x = cmd.int_value;
+            if(hot != NULL) hot->x[index] = target_entity->x;
+            move_in_grid(data, target_entity);
             break;
         case Y:
-            target_entity->y = cmd.model_ent.y;
+            note_move(data, target_entity);
+            target_entity->y = cmd.int_value;
+            if(hot != NULL) hot->y[index] = target_entity->y;
+            move_in_grid(data, target_entity);
             break;
         case UPDATE_SELF:
-            target_entity->update_self = cmd.model_ent.update_self;
+            target_entity->event_handlers = *cmd.event_handlers;
+            if(hot != NULL) hot->event_handlers[index] = target_entity->event_handlers;
             break;
         case ENT_DATA:
-            target_entity->ent_data = cmd.model_ent.ent_data;
+            target_entity->ent_data = cmd.ent_data;
+            break;
+        case DEPTH:
+            target_entity->depth = cmd.int_value;
             break;
         default:
             break;
@@ -40,50 +91,39 @@ void cmd_alter_entity(t_game_data *data, struct alter_entity_command cmd) {
 
 void cmd_add_entity(t_game_data *data, struct add_entity_command cmd) {
     add_entity(data, cmd.new_entity);
+    t_room *room = get_room(data, cmd.room_id);
+    if(room != NULL)
+        add_room_entity(data, room, cmd.new_entity->id);
+}
+
+void cmd_spawn_batch(t_game_data *data, struct spawn_batch_command cmd) {
+    spawn_entities(data, &cmd);
 }
 
 void cmd_rem_entity(t_game_data *data, struct rem_entity_command cmd) {
+    del_room_entities(data, &cmd.ent_id, 1);
     del_entity(data, cmd.ent_id);
-    // remove entity id from rooms
-    int *room_ids = get_room_ids(data);
-    for(int i = 0; i < data->num_rooms; i++) {
-        t_room *room = get_room(data, room_ids[i]);
-        bool shifting_ids = false;
-        for(int j = 0; j < room->num_entities; j++) {
-            if(room->entity_ids[j] == cmd.ent_id) {
-                free(room->entity_ids + j);
-                shifting_ids = true;
-            } else if(shifting_ids && j < room->num_entities-1) {
-                room->entity_ids[j] = room->entity_ids[j+1];
-            }
-        }
-        room->num_entities--;
-        free(room->entity_ids + room->num_entities - 1);    // last element is empty bc. length decremented
-    }
 }
 
 void cmd_alter_room(t_game_data *data, struct alter_room_command cmd) {
     t_room *room = get_room(data, cmd.target_id);
-    int *model_ent_ids = cmd.model_room.entity_ids;
-    int model_num_ents = cmd.model_room.num_entities;
+    if(room == NULL)
+        return;
     switch(cmd.modified_attr) {
         case ENTITIES:
-            // free old entity ids, make sure not freeing ids intersecting with new entity ids
-            for(int *i = room->entity_ids;
-                    i < model_ent_ids && i < (room->entity_ids + room->num_entities);
-                    i++)
-                free(i);    // free everything in room up to model_ent_ids
-            for(int *i = model_ent_ids + model_num_ents + 1;
-                    i < (room->entity_ids + room->num_entities);
-                    i++)
-                free(i);    // free everything in room after all model_ent_ids, if any
-            room->entity_ids = cmd.model_room.entity_ids;
+            if(room->entity_ids != cmd.entity_ids)
+                free(room->entity_ids);
+            room->entity_ids = cmd.entity_ids;
+            room->num_entities = cmd.num_entities;
+            room->entity_capacity = 0;
+            index_room(data, room);
+            rebuild_room_grid(data, room);
             break;
         case WIDTH:
-            room->width = cmd.model_room.width;
+            room->width = cmd.int_value;
             break;
         case HEIGHT:
-            room->height = cmd.model_room.height;
+            room->height = cmd.int_value;
             break;
         default:
             break;
@@ -91,23 +131,178 @@ void cmd_alter_room(t_game_data *data, struct alter_room_command cmd) {
 }
 
 void cmd_next_room(t_game_data *data, struct next_room_command cmd) {
-    data->current_room = get_room(data, cmd.next_room_id);
+    data->current_room_id = cmd.next_room_id;
+    // grid was not kept up to date while the room was not current
+    t_room *room = get_room(data, cmd.next_room_id);
+    if(room != NULL)
+        rebuild_room_grid(data, room);
 }
 
-// cannot do sound-based dispatchers until audio finished
+// sound commands are only queued for the mixer's audio thread, so never wait on it
 
 void cmd_play_sound(t_game_data *data, struct play_sound_command cmd) {
-    //
+    t_sound *sound = get_sound(data, cmd.sound_id);
+    // sounds still loading in the background are not played
+    if(data->mixer == NULL || sound == NULL || !asset_ready(sound))
+        return;
+    if(data->sound_cache != NULL)
+        play_cached_sound(data->mixer, data->sound_cache, sound);
+    else
+        play_sound(data->mixer, sound);
 }
 
 void cmd_pause_sound(t_game_data *data, struct pause_sound_command cmd) {
-    //
+    t_sound *sound = get_sound(data, cmd.sound_id);
+    if(data->mixer != NULL && sound != NULL)
+        pause_sound(data->mixer, sound);
 }
 
 void cmd_end_sound(t_game_data *data, struct end_sound_command cmd) {
-    //
+    t_sound *sound = get_sound(data, cmd.sound_id);
+    if(data->mixer != NULL && sound != NULL)
+        stop_sound(data->mixer, sound);
 }
 
 void cmd_quit(t_game_data *data, struct quit_command cmd) {
-    gamedata_free(data);
+    // loop_update stops once this is dispatched; game data is freed by whoever started the
+    // loops, as the render loop may still be reading its snapshots
+}
+
+/*
+ * dispatch_command: Feed one command into its dispatcher.
+ *
+ * Returns (bool): true if the command ended the game.
+ */
+bool dispatch_command(t_game_data *data, t_update_command *command) {
+    switch (command->type) {
+        case ALTER_ENTITY:
+            cmd_alter_entity(data, command->data.alter_ent);
+            break;
+        case ADD_ENTITY:
+            cmd_add_entity(data, command->data.add_ent);
+            break;
+        case SPAWN_BATCH:
+            cmd_spawn_batch(data, command->data.spawn_batch);
+            break;
+        case REM_ENTITY:
+            cmd_rem_entity(data, command->data.rem_ent);
+            break;
+        case ALTER_ROOM:
+            cmd_alter_room(data, command->data.alter_room);
+            break;
+        case NEXT_ROOM:
+            cmd_next_room(data, command->data.next_room);
+            break;
+        case PLAY_SND:
+            cmd_play_sound(data, command->data.play_snd);
+            break;
+        case PAUSE_SND:
+            cmd_pause_sound(data, command->data.pause_snd);
+            break;
+        case END_SND:
+            cmd_end_sound(data, command->data.end_snd);
+            break;
+        case QUIT:
+            cmd_quit(data, command->data.quit);
+            return true;
+        default:
+            break;
+    }
+    return false;
+}
+
+/*
+ * alter_shards_task: Thread pool task dispatching a range of shards of entity alterations.
+ * Every command on a target is in the same shard, in submission order.
+ */
+struct alter_shards_job {
+    t_game_data *data;
+    t_update_command **sorted;  // alter commands grouped by shard
+    int *shard_starts;  // shard i is sorted[shard_starts[i]] to sorted[shard_starts[i+1] - 1]
+};
+
+static void alter_shards_task(void *ctx, int begin, int end, int worker) {
+    struct alter_shards_job *job = ctx;
+    for(int shard = begin; shard < end; shard++) {
+        for(int i = job->shard_starts[shard]; i < job->shard_starts[shard + 1]; i++)
+            cmd_alter_entity(job->data, job->sorted[i]->data.alter_ent);
+    }
+}
+
+/*
+ * dispatch_alter_run: Dispatch a run of consecutive ALTER_ENTITY commands, sharded by target.
+ * Uses a stable counting sort on target ID modulo the number of shards, so that
+ * commands on the same target keep their submission order.
+ */
+static void dispatch_alter_run(t_game_data *data, threadpool *pool, t_update_command **run, int num_commands) {
+    int num_workers = threadpool_num_workers(pool);
+    if(num_workers == 1 || num_commands < DISPATCH_PARALLEL_MIN) {
+        for(int i = 0; i < num_commands; i++)
+            cmd_alter_entity(data, run[i]->data.alter_ent);
+        return;
+    }
+    int num_shards = num_workers * DISPATCH_SHARDS_PER_WORKER;
+    int *shard_starts = frame_alloc(sizeof(int) * (num_shards + 1));
+    int *fill = frame_alloc(sizeof(int) * num_shards);
+    t_update_command **sorted = frame_alloc(sizeof(t_update_command *) * num_commands);
+    memset(shard_starts, 0, sizeof(int) * (num_shards + 1));
+    for(int i = 0; i < num_commands; i++)
+        shard_starts[(unsigned) run[i]->data.alter_ent.target_id % num_shards + 1]++;
+    for(int i = 0; i < num_shards; i++)
+        shard_starts[i + 1] += shard_starts[i];
+    for(int i = 0; i < num_shards; i++)
+        fill[i] = shard_starts[i];
+    for(int i = 0; i < num_commands; i++)
+        sorted[fill[(unsigned) run[i]->data.alter_ent.target_id % num_shards]++] = run[i];
+
+    struct alter_shards_job job = { .data = data, .sorted = sorted, .shard_starts = shard_starts };
+    threadpool_run(pool, num_shards, 1, alter_shards_task, &job);
+}
+
+/*
+ * dispatch_rem_run: Private method to dispatch a run of consecutive REM_ENTITY commands, removing
+ * all of their entities from rooms together, so entities not indexed in a room cost one search
+ * of every room between them rather than one each.
+ */
+static void dispatch_rem_run(t_game_data *data, t_update_command **run, int num_commands) {
+    int *ids = frame_alloc(sizeof(int) * num_commands);
+    for(int i = 0; i < num_commands; i++)
+        ids[i] = run[i]->data.rem_ent.ent_id;
+    del_room_entities(data, ids, num_commands);
+    for(int i = 0; i < num_commands; i++)
+        del_entity(data, ids[i]);
+}
+
+/*
+ * dispatch_commands: Dispatch a schedule of commands in order, in parallel where it is safe.
+ *
+ * Runs of consecutive ALTER_ENTITY commands are sharded by target and dispatched on
+ * the pool, and runs of REM_ENTITY commands are removed from rooms together (as
+ * optimise_commands schedules every removal together); every other command may touch
+ * several elements at once, so acts as a barrier and is dispatched alone, in order.
+ *
+ * commands (t_update_command **): Commands to dispatch, eg. as scheduled by optimise_commands.
+ * num_commands (int): Number of commands.
+ *
+ * Returns (bool): true if a command ended the game, in which case no more are dispatched.
+ */
+bool dispatch_commands(t_game_data *data, threadpool *pool, t_update_command **commands, int num_commands) {
+    bool has_game_ended = false;
+    int i = 0;
+    while(i < num_commands && !has_game_ended) {
+        int run_end = i;
+        while(run_end < num_commands && commands[run_end]->type == ALTER_ENTITY)
+            run_end++;
+        if(run_end > i)
+            dispatch_alter_run(data, pool, commands + i, run_end - i);
+        i = run_end;
+        while(run_end < num_commands && commands[run_end]->type == REM_ENTITY)
+            run_end++;
+        if(run_end > i)
+            dispatch_rem_run(data, commands + i, run_end - i);
+        i = run_end;
+        if(i < num_commands)
+            has_game_ended = dispatch_command(data, commands[i++]);
+    }
+    return has_game_ended;
 }
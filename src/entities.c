@@ -8,29 +8,124 @@
 
 #include "cnoodle.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 
+/*
+ * init_entity: Private method to set every field of a newly allocated entity.
+ */
+static t_entity *init_entity(t_entity *entity, int current_spr_id, int x, int y, void *ent_data) {
+    *entity = (t_entity) {
+            .id = 0,
+            .event_handlers = { 0 },    // all event handlers begin unset
+            .has_initialised = false,
+            .current_spr_id = current_spr_id,
+            .spr_period = -1,
+            .spr_current_img = 0,
+            .spr_last_subimg_time = 0,
+            .x = x,
+            .y = y,
+            .prev_x = x,
+            .prev_y = y,
+            .moved_tick = 0,
+            .depth = 0,
+            .room_id = 0,
+            .room_slot = 0,
+            .pooled = true,
+            .ent_data = ent_data
+    };
+    return entity;
+}
+
+/*
+ * make_entity: Make an entity from the entity pool.
+ *
+ * ent_data (void *): Entity's data, allocated with malloc, as free_entity frees it; or NULL.
+ */
 t_entity *make_entity(int current_spr_id, int x, int y, void *ent_data) {
-    t_entity *entity;
-    entity->id = 0;
-    ent_func_vtable event_handlers;     // All event handlers begin uninitialized
-    entity->event_handlers = event_handlers;
-    entity->current_spr_id = current_spr_id;
-    entity->spr_period = -1;
-    entity->spr_current_img = 0;
-    entity->spr_last_subimg_time = 0;
-    entity->x = x;
-    entity->y = y;
-    entity->ent_data = ent_data;
+    return init_entity(pool_alloc(ENTITY_POOL), current_spr_id, x, y, ent_data);
+}
+
+/*
+ * make_entity_with_data: Make an entity with zeroed ent_data of a size, kept inline in the same
+ * pool slot as the entity if no larger than POOL_MAX_ENT_DATA, so both are allocated and freed at once.
+ */
+t_entity *make_entity_with_data(int current_spr_id, int x, int y, size_t ent_data_size) {
+    enum pool_id pool = entity_pool_for(ent_data_size);
+    if(pool == NUM_POOLS) {
+        void *ent_data = calloc(1, ent_data_size);
+        if(ent_data == NULL) {
+            perror("Could not allocate entity data.");
+            exit(EXIT_FAILURE);
+        }
+        return make_entity(current_spr_id, x, y, ent_data);
+    }
+    t_entity *entity = pool_alloc(pool);
+    if(ent_data_size == 0)
+        return init_entity(entity, current_spr_id, x, y, NULL);
+    init_entity(entity, current_spr_id, x, y, entity_inline_data(entity));
+    memset(entity->ent_data, 0, ent_data_size);
     return entity;
 }
 
+/*
+ * free_entity: Free an entity and its ent_data. Entities not made by make_entity are freed with free.
+ */
 void free_entity(t_entity *entity) {
-    free(entity->ent_data);
-    free(entity);
+    // inline ent_data is freed with its slot
+    if(!entity->pooled || entity->ent_data != entity_inline_data(entity))
+        free(entity->ent_data);
+    if(entity->pooled)
+        pool_free(entity);
+    else
+        free(entity);
 }
 
+/*
+ * animate_entity: Advance an entity's sprite animation by one frame.
+ * Every spr_period frames, moves on to the next subimage, wrapping back to the first after the last.
+ * Entities with a period of -1, or without a sprite (num_imgs of 0), are left alone.
+ */
+void animate_entity(t_entity *entity, int num_imgs) {
+    if(entity->spr_period < 0 || num_imgs <= 0)
+        return;
+    if(++entity->spr_last_subimg_time < entity->spr_period)
+        return;
+    entity->spr_last_subimg_time = 0;
+    if(++entity->spr_current_img >= num_imgs)
+        entity->spr_current_img = 0;
+}
+
+/*
+ * update_entity: Run an entity's event handlers for one update, and gather their commands.
+ * Runs init on the first update, then step, then collide once for every entity it collided with.
+ * Called from the update loop's worker threads; only ever called for one entity by one thread
+ * at a time, so it may write to that entity's own bookkeeping fields.
+ */
 t_update_command_container update_entity(t_game_data *data, t_entity *entity) {
-    // TODO, dummy code for now
-    t_update_command_container container;
+    // hot fields may have been changed by bulk passes, so refresh them before handlers run
+    if(data->hot_entities != NULL)
+        entity_soa_load(data->hot_entities, slotmap_index(&data->entities, entity->id), entity);
+    t_update_command_container container = make_update_command_container();
+    ent_func_vtable *handlers = &entity->event_handlers;
+    if(!entity->has_initialised) {
+        entity->has_initialised = true;
+        if(handlers->init != NULL) {
+            t_update_command_container init_commands = handlers->init(data, entity);
+            append_container(&container, &init_commands);
+        }
+    }
+    if(handlers->step != NULL) {
+        t_update_command_container step_commands = handlers->step(data, entity);
+        append_container(&container, &step_commands);
+    }
+    if(handlers->collide != NULL && data->collisions != NULL) {
+        int const* contacts;
+        int num_contacts = get_contacts(data->collisions, slotmap_index(&data->entities, entity->id), &contacts);
+        for(int i = 0; i < num_contacts; i++) {
+            t_update_command_container collide_commands = handlers->collide(data, entity, contacts[i]);
+            append_container(&container, &collide_commands);
+        }
+    }
     return container;
 }
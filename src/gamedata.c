@@ -10,103 +10,491 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <math.h>
 
+#define UPDATE_CHUNK_SIZE 64     // entities per unit of work stealing
+
+/*
+ * make_game_data: Create game data, loaded from a pack file (see cnd_pack.h) if given one.
+ * If the pack cannot be loaded, the reason is printed and the game data starts out empty.
+ *
+ * fname (char *): Path of the pack file, or NULL to start out empty.
+ */
 t_game_data make_game_data(char* fname) {
-    // TODO: parse fname for game data, game data currently starts out empty
-    int num_hashtable_entries = 64;     // temp value, should be read from fname
+    game_pack *pack = (fname != NULL) ? open_game_pack(fname) : NULL;
+    // initial size hints only, hashtables grow as needed
+    struct pack_header const* counts = (pack != NULL) ? pack->header : &(struct pack_header) {
+            .num_rooms = 16, .num_sprites = 16, .num_sounds = 16, .num_entities = 16
+    };
     t_game_data data;
     data.num_entities = 0;
-    data.entities = make_hashtable(num_hashtable_entries);
+    data.entities = make_slotmap((int) counts->num_entities);
+    data.hot_entities = NULL;
+    data.collisions = NULL;
     data.num_rooms = 0;
-    data.rooms = make_hashtable(num_hashtable_entries);
+    data.rooms = make_hashtable((int) counts->num_rooms);
     data.num_sounds = 0;
-    data.sounds = make_hashtable(num_hashtable_entries);
+    data.sounds = make_hashtable((int) counts->num_sounds);
     data.num_sprites = 0;
-    data.sprites = make_hashtable(num_hashtable_entries);
-    data.scr_width = data.scr_height = 400;     // temp value
+    data.sprites = make_hashtable((int) counts->num_sprites);
+    data.scr_width = data.scr_height = 400;     // unless set by the pack
+    data.camera_x = data.camera_y = 0;
+    data.current_room_id = 0;
+    data.max_id = 0;
+    data.num_workers = 0;   // use all cores
+    init_tick_scheduler(&data.scheduler, DEFAULT_TICK_RATE, DEFAULT_MAX_STEPS);
+    data.tick = 0;
+    init_snapshot_buffer(&data.snapshots);
+    data.renderer = NULL;
+    data.atlas = NULL;
+    data.mixer = NULL;
+    data.sound_cache = NULL;
+    data.pack = NULL;
+    data.loader = NULL;
+    data.archetypes = make_archetype_registry();
+    data.optimiser = (struct command_optimiser) { 0 };
+    if(pack != NULL)
+        load_game_pack(&data, pack);
     return data;
 }
 
 t_entity *get_entity(t_game_data *data, int id) {
-    return (t_entity *) hashtable_get(data->entities, id);
+    return (t_entity *) slotmap_get(&data->entities, id);
+}
+
+/*
+ * sprite_num_imgs: Private method to get the number of subimages of a sprite, or 0 if there is no such sprite.
+ */
+static int sprite_num_imgs(t_game_data *data, int spr_id) {
+    t_sprite const* sprite = get_sprite(data, spr_id);
+    return (sprite != NULL) ? sprite->num_imgs : 0;
 }
 
 void add_entity(t_game_data *data, t_entity *entity) {
     data->max_id = entity->id = data->max_id + 1;
+    entity->room_id = 0;    // not in any room yet
     data->num_entities++;
-    hashtable_add(data->entities, (void*) entity, ENTITY);
+    slotmap_add(&data->entities, entity->id, (void*) entity);
+    if(data->hot_entities != NULL) {
+        entity_soa_push(data->hot_entities, entity);
+        data->hot_entities->spr_num_imgs[data->hot_entities->num_entries - 1] =
+                sprite_num_imgs(data, entity->current_spr_id);
+    }
 }
 
 void del_entity(t_game_data *data, int id) {
-    hashtable_del(data->entities, id);
+    t_entity *entity = get_entity(data, id);
+    // remove from hot fields first, as the slotmap index is lost after deletion
+    if(data->hot_entities != NULL && entity != NULL)
+        entity_soa_swap_remove(data->hot_entities, slotmap_index(&data->entities, id));
+    slotmap_del(&data->entities, id);
     data->num_entities--;
+    // spawned entities belong to the game data, so are freed once removed
+    if(entity != NULL && data->archetypes.num_blocks > 0 && release_spawned_entity(&data->archetypes, id))
+        free_entity(entity);
 }
 
+/*
+ * get_entity_ids: Get all entity IDs without allocating.
+ * Returned array is a view into the entity store, so must not be freed,
+ * and is only valid until the next entity is added or deleted.
+ */
 int *get_entity_ids(t_game_data *data) {
-    return hashtable_get_ids(data->entities);
+    return slotmap_get_ids(&data->entities);
+}
+
+/*
+ * enable_entity_soa: Start storing hot entity fields as a structure of arrays.
+ * Copies the fields of all existing entities; does nothing if already enabled.
+ */
+void enable_entity_soa(t_game_data *data) {
+    if(data->hot_entities != NULL)
+        return;
+    data->hot_entities = make_entity_soa(data->num_entities);
+    t_entity **entities = (t_entity **) slotmap_get_elems(&data->entities);
+    for(int i = 0; i < data->num_entities; i++) {
+        entity_soa_push(data->hot_entities, entities[i]);
+        data->hot_entities->spr_num_imgs[i] = sprite_num_imgs(data, entities[i]->current_spr_id);
+    }
+}
+
+/*
+ * enable_collisions: Start detecting collisions between the current room's entities every tick,
+ * calling their collide handlers. Does nothing if already enabled.
+ */
+void enable_collisions(t_game_data *data) {
+    if(data->collisions == NULL)
+        data->collisions = make_collision_world();
+}
+
+/*
+ * set_renderer: Set the backend drawing the render loop's frames, freeing the previous one.
+ * The game data takes ownership of the backend, freeing it in gamedata_free.
+ * Must be set before the render loop starts, or on the render thread between frames.
+ * Textures made by a previous backend are not used by the new one: the atlas and every
+ * sprite loaded in the background are uploaded again before the next frame.
+ */
+void set_renderer(t_game_data *data, render_backend *renderer) {
+    if(data->renderer == renderer)
+        return;
+    if(data->renderer != NULL) {
+        data->renderer->free(data->renderer);
+        if(data->loader != NULL)
+            loader_reupload(data->loader);
+    }
+    if(data->atlas != NULL)
+        data->atlas->dirty = true;
+    data->renderer = renderer;
+}
+
+/*
+ * enable_audio: Start mixing sounds on an output, so that sound commands are heard.
+ * If the output cannot be opened, sounds are still mixed, on the null output.
+ *
+ * Returns (bool): false if the output could not be opened.
+ */
+bool enable_audio(t_game_data *data, enum audio_output output) {
+    if(data->mixer == NULL)
+        data->mixer = make_mixer();
+    if(mixer_open_output(data->mixer, output))
+        return true;
+    mixer_open_output(data->mixer, AUDIO_NULL);
+    return false;
+}
+
+/*
+ * enable_sound_cache: Keep sounds decoded in memory once first played, rather than streaming them
+ * on every play. Does nothing if already enabled.
+ *
+ * budget_bytes (size_t): Most memory to hold decoded sounds in, evicting those played least recently.
+ * persistent (bool): Whether to keep decoded sounds in cache files next to them, for later runs.
+ */
+void enable_sound_cache(t_game_data *data, size_t budget_bytes, bool persistent) {
+    if(data->sound_cache == NULL)
+        data->sound_cache = make_sound_cache(budget_bytes, persistent);
+}
+
+/*
+ * enable_asset_loader: Load sprites and sounds given to load_sprite_async and load_sound_async on
+ * background threads, rather than at startup. Does nothing if already enabled.
+ *
+ * num_threads (int): Number of threads reading and decoding, or 0 for one per online CPU.
+ */
+void enable_asset_loader(t_game_data *data, int num_threads) {
+    if(data->loader == NULL)
+        data->loader = make_asset_loader(num_threads);
 }
 
 t_room *get_room(t_game_data *data, int id) {
-    return (t_room *) hashtable_get(data->rooms, id);
+    return (t_room *) hashtable_get(&data->rooms, id);
 }
 
 void add_room(t_game_data *data, t_room *room) {
     data->max_id = room->room_id = data->max_id + 1;
     data->num_rooms++;
-    hashtable_add(data->rooms, (void*) room, ROOM);
+    hashtable_add(&data->rooms, (void*) room, ROOM);
+    index_room(data, room);
 }
 
 void del_room(t_game_data *data, int id) {
-    hashtable_del(data->rooms, id);
+    hashtable_del(&data->rooms, id);
     data->num_rooms--;
 }
 
 int *get_room_ids(t_game_data *data) {
-    return hashtable_get_ids(data->rooms);
+    return hashtable_get_ids(&data->rooms);
+}
+
+/*
+ * enable_room_grid: Start keeping a spatial grid of a room's entity positions, so only entities
+ * near the camera are published to the render loop. Does nothing if already enabled.
+ *
+ * cell_size (int): Size of each grid cell in pixels; should be at least the size of the room's
+ *      largest sprite, as images whose position is over a cell away from the camera are culled.
+ */
+void enable_room_grid(t_game_data *data, t_room *room, int cell_size) {
+    if(room->grid != NULL)
+        return;
+    room->grid = make_spatial_grid(room->width, room->height, cell_size);
+    rebuild_room_grid(data, room);
+}
+
+/*
+ * rebuild_room_grid: Reinsert all of a room's entities into its spatial grid at their current positions.
+ * Grids are only kept up to date as entities move in the current room, so this is done whenever
+ * a room becomes current or its entities are replaced.
+ */
+void rebuild_room_grid(t_game_data *data, t_room *room) {
+    if(room->grid == NULL)
+        return;
+    spatial_grid_clear(room->grid);
+    for(int i = 0; i < room->num_entities; i++) {
+        t_entity const* entity = get_entity(data, room->entity_ids[i]);
+        if(entity != NULL)
+            spatial_grid_insert(room->grid, entity->id, entity->x, entity->y);
+    }
+}
+
+static int compare_ints(void const* a, void const* b) {
+    return (*(int const*) a > *(int const*) b) - (*(int const*) a < *(int const*) b);
+}
+
+/*
+ * index_room: Record where each of a room's entities is in it, so they can be removed from it without
+ * searching every room. Done whenever a room is added or its entities are replaced; an entity is in at
+ * most one room, so is indexed in whichever did so last. IDs written into a room directly are still
+ * found when removed, by searching.
+ */
+void index_room(t_game_data *data, t_room *room) {
+    for(int i = 0; i < room->num_entities; i++) {
+        t_entity *entity = get_entity(data, room->entity_ids[i]);
+        if(entity != NULL) {
+            entity->room_id = room->room_id;
+            entity->room_slot = i;
+        }
+    }
+}
+
+/*
+ * add_room_entity: Add an entity to the end of a room, indexing it and adding it to the room's grid.
+ */
+void add_room_entity(t_game_data *data, t_room *room, int id) {
+    add_room_entity_range(data, room, id, 1);
+}
+
+/*
+ * add_room_entity_range: Add entities with consecutive IDs to the end of a room at once, eg. a spawned batch.
+ * The room's array is grown by doubling, so adding many entities one by one also stays cheap.
+ * It outlives the tick, so is kept on the heap rather than in a frame arena, and stops
+ * growing once it fits the room.
+ *
+ * first_id (int): ID of the first entity; the rest follow in order.
+ * count (int): Number of entities.
+ */
+void add_room_entity_range(t_game_data *data, t_room *room, int first_id, int count) {
+    int capacity = (room->entity_capacity > room->num_entities) ? room->entity_capacity : room->num_entities;
+    if(room->num_entities + count > capacity) {
+        capacity = (capacity < 8) ? 8 : capacity;
+        while(capacity < room->num_entities + count)
+            capacity *= 2;
+        int *entity_ids = realloc(room->entity_ids, sizeof(int) * capacity);
+        if(entity_ids == NULL) {
+            perror("Could not allocate room entity IDs.");
+            exit(EXIT_FAILURE);
+        }
+        room->entity_ids = entity_ids;
+        room->entity_capacity = capacity;
+        note_heap_allocation();
+    }
+    for(int i = 0; i < count; i++) {
+        int id = first_id + i;
+        room->entity_ids[room->num_entities] = id;
+        t_entity *entity = get_entity(data, id);
+        if(entity != NULL) {
+            entity->room_id = room->room_id;
+            entity->room_slot = room->num_entities;
+            if(room->grid != NULL)
+                spatial_grid_insert(room->grid, id, entity->x, entity->y);
+        }
+        room->num_entities++;
+    }
+}
+
+/*
+ * room_swap_remove: Private method to remove the ID at a slot of a room, moving its last ID into the slot.
+ */
+static void room_swap_remove(t_game_data *data, t_room *room, int slot) {
+    int id = room->entity_ids[slot];
+    int last = room->entity_ids[--room->num_entities];
+    room->entity_ids[slot] = last;
+    if(slot < room->num_entities) {
+        t_entity *moved = get_entity(data, last);
+        if(moved != NULL) {
+            moved->room_id = room->room_id;
+            moved->room_slot = slot;
+        }
+    }
+    if(room->grid != NULL)
+        spatial_grid_remove(room->grid, id);
+}
+
+/*
+ * remove_indexed: Private method to remove an entity from the room it is indexed in, if the index is still right.
+ *
+ * Returns (bool): false if the index could not be used, so the entity must be searched for.
+ */
+static bool remove_indexed(t_game_data *data, int id) {
+    t_entity *entity = get_entity(data, id);
+    if(entity == NULL || entity->room_id == 0)
+        return false;
+    t_room *room = get_room(data, entity->room_id);
+    // rooms can be changed without reindexing, eg. by writing to their arrays directly
+    if(room == NULL || entity->room_slot >= room->num_entities || room->entity_ids[entity->room_slot] != id)
+        return false;
+    room_swap_remove(data, room, entity->room_slot);
+    entity->room_id = 0;
+    return true;
+}
+
+/*
+ * del_room_entities: Remove entities from every room they are in, without deleting the entities.
+ * Each indexed entity is removed from its room at once by swapping the room's last ID into its place,
+ * so the order of a room's entities is not kept. The rest are searched for together in a single pass
+ * over every room, which indexes every room as it goes.
+ *
+ * ids (int const*): IDs of the entities to remove.
+ * count (int): Number of IDs.
+ */
+void del_room_entities(t_game_data *data, int const* ids, int count) {
+    int *unindexed = frame_alloc(sizeof(int) * (count > 0 ? count : 1));
+    int num_unindexed = 0;
+    for(int i = 0; i < count; i++) {
+        if(!remove_indexed(data, ids[i]))
+            unindexed[num_unindexed++] = ids[i];
+    }
+    if(num_unindexed == 0)
+        return;
+    qsort(unindexed, (size_t) num_unindexed, sizeof(int), compare_ints);
+    int *room_ids = get_room_ids(data);
+    for(int i = 0; i < data->num_rooms; i++) {
+        t_room *room = get_room(data, room_ids[i]);
+        int j = 0;
+        while(j < room->num_entities) {
+            if(bsearch(&room->entity_ids[j], unindexed, (size_t) num_unindexed, sizeof(int), compare_ints) != NULL)
+                room_swap_remove(data, room, j);    // check the ID moved into this slot next
+            else
+                j++;
+        }
+        // index the rest while here, so the room is not searched again
+        index_room(data, room);
+    }
 }
 
 t_sprite *get_sprite(t_game_data *data, int id) {
-    return (t_sprite *) hashtable_get(data->sprites, id);
+    return (t_sprite *) hashtable_get(&data->sprites, id);
 }
 
 void add_sprite(t_game_data *data, t_sprite *sprite) {
     data->max_id = sprite->spr_id = data->max_id + 1;
     data->num_sprites++;
-    hashtable_add(data->sprites, (void*) sprite, SPRITE);
+    hashtable_add(&data->sprites, (void*) sprite, SPRITE);
 }
 
 void del_sprite(t_game_data *data, int id) {
-    hashtable_del(data->sprites, id);
+    hashtable_del(&data->sprites, id);
     data->num_sprites--;
+    // entities still showing the sprite stop animating
+    entity_soa *hot = data->hot_entities;
+    if(hot != NULL) {
+        for(int i = 0; i < hot->num_entries; i++) {
+            if(hot->current_spr_id[i] == id)
+                hot->spr_num_imgs[i] = 0;
+        }
+    }
 }
 
 int *get_sprite_ids(t_game_data *data) {
-    return hashtable_get_ids(data->sprites);
+    return hashtable_get_ids(&data->sprites);
+}
+
+/*
+ * compare_atlas_entries: Private method ordering subimages from tallest to shortest, then widest to narrowest.
+ * Ties are broken by sprite ID and subimage, so atlases are packed the same way every time.
+ */
+struct atlas_entry {
+    t_sprite *sprite;
+    int subimg;
+};
+
+static int compare_atlas_entries(void const* a, void const* b) {
+    struct atlas_entry const* x = a, *y = b;
+    if(x->sprite->height != y->sprite->height)
+        return y->sprite->height - x->sprite->height;
+    if(x->sprite->width != y->sprite->width)
+        return y->sprite->width - x->sprite->width;
+    if(x->sprite->spr_id != y->sprite->spr_id)
+        return x->sprite->spr_id - y->sprite->spr_id;
+    return x->subimg - y->subimg;
+}
+
+/*
+ * build_sprite_atlas: Pack the subimages of all sprites with pixels (see sprite_set_pixels) into a new atlas,
+ * replacing any previous one, and set each sprite's regions to where its subimages went.
+ * Sprites without pixels keep being drawn from their own textures.
+ * Must not be called while the render loop is running.
+ *
+ * page_size (int): Width and height of atlas pages, or 0 for DEFAULT_ATLAS_PAGE_SIZE.
+ */
+void build_sprite_atlas(t_game_data *data, int page_size) {
+    if(data->atlas != NULL)
+        texture_atlas_free(data->atlas);
+    data->atlas = make_texture_atlas(page_size);
+    int *ids = get_sprite_ids(data);
+    int num_entries = 0;
+    for(int i = 0; i < data->num_sprites; i++) {
+        t_sprite *sprite = get_sprite(data, ids[i]);
+        if(!asset_ready(sprite))
+            continue;
+        free(sprite->regions);
+        sprite->regions = NULL;
+        if(sprite->pixels != NULL)
+            num_entries += sprite->num_imgs;
+    }
+    struct atlas_entry *entries = malloc(sizeof(struct atlas_entry) * (num_entries + 1));
+    if(entries == NULL) {
+        perror("Could not allocate atlas entries.");
+        exit(EXIT_FAILURE);
+    }
+    num_entries = 0;
+    for(int i = 0; i < data->num_sprites; i++) {
+        t_sprite *sprite = get_sprite(data, ids[i]);
+        if(!asset_ready(sprite) || sprite->pixels == NULL)
+            continue;
+        sprite->regions = malloc(sizeof(atlas_region) * (sprite->num_imgs + 1));
+        if(sprite->regions == NULL) {
+            perror("Could not allocate sprite atlas regions.");
+            exit(EXIT_FAILURE);
+        }
+        for(int j = 0; j < sprite->num_imgs; j++)
+            entries[num_entries++] = (struct atlas_entry) { sprite, j };
+    }
+    qsort(entries, num_entries, sizeof(struct atlas_entry), compare_atlas_entries);
+    for(int i = 0; i < num_entries; i++) {
+        t_sprite *sprite = entries[i].sprite;
+        atlas_region region = atlas_insert(data->atlas, sprite->width, sprite->height);
+        atlas_blit(data->atlas, &region, sprite->pixels[entries[i].subimg]);
+        sprite->regions[entries[i].subimg] = region;
+    }
+    free(entries);
 }
 
 t_sound *get_sound(t_game_data *data, int id) {
-    return (t_sound *) hashtable_get(data->sounds, id);
+    return (t_sound *) hashtable_get(&data->sounds, id);
 }
 
 void add_sound(t_game_data *data, t_sound *sound) {
     data->max_id = sound->snd_id = data->max_id + 1;
     data->num_sounds++;
-    hashtable_add(data->sounds, (void*) &sound, SOUND);
+    hashtable_add(&data->sounds, (void*) sound, SOUND);
 }
 
 void del_sound(t_game_data *data, int id) {
-    hashtable_del(data->sounds, id);
+    hashtable_del(&data->sounds, id);
     data->num_sounds--;
 }
 
 int *get_sound_ids(t_game_data *data) {
-    return hashtable_get_ids(data->sounds);
+    return hashtable_get_ids(&data->sounds);
 }
 
 int get_num_ids(t_game_data *data) {
     return data->num_entities + data->num_rooms + data->num_sprites + data->num_sounds;
 }
 
+/*
+ * get_ids: Get array of every ID in use.
+ * Allocated from the calling thread's frame arena, so must not be freed.
+ */
 int *get_ids(t_game_data *data) {
     int *id_arrays[4] = {
             get_entity_ids(data), get_room_ids(data),
@@ -116,92 +504,307 @@ int *get_ids(t_game_data *data) {
             data->num_entities, data->num_rooms,
             data->num_sounds, data->num_sprites
     };
-    int *ids = malloc(sizeof(int)*get_num_ids(data));
+    int *ids = frame_alloc(sizeof(int)*get_num_ids(data));
     int index = 0;
     for(int i = 0; i < 4; i++) {
         for(int j = 0; j < lengths[i]; j++)
-            ids[index] = id_arrays[i][j];
+            ids[index++] = id_arrays[i][j];
     }
     return ids;
 }
 
 void gamedata_free(t_game_data *data) {
-    hashtable_free(data->rooms);
-    hashtable_free(data->entities);
-    hashtable_free(data->sprites);
-    hashtable_free(data->sounds);
+    // first, so no worker is still writing to a sprite or sound
+    if(data->loader != NULL)
+        asset_loader_free(data->loader);
+    hashtable_free(&data->rooms);
+    archetype_registry_free(&data->archetypes, &data->entities);
+    slotmap_free(&data->entities);
+    if(data->hot_entities != NULL)
+        entity_soa_free(data->hot_entities);
+    if(data->collisions != NULL)
+        collision_world_free(data->collisions);
+    free(data->optimiser.marks);
+    snapshot_buffer_free(&data->snapshots);
+    if(data->renderer != NULL)
+        data->renderer->free(data->renderer);
+    if(data->atlas != NULL)
+        texture_atlas_free(data->atlas);
+    if(data->mixer != NULL)
+        mixer_free(data->mixer);
+    // only once the mixer is gone, as it may still be playing cached samples
+    if(data->sound_cache != NULL)
+        sound_cache_free(data->sound_cache);
+    if(data->pack != NULL)
+        game_pack_free(data->pack);
+    hashtable_free(&data->sprites);
+    hashtable_free(&data->sounds);
     free(data);
 }
 
+/*
+ * update_entities_task: Thread pool task updating a range of the current room's entities.
+ * Each chunk appends into its own container, so no locking is needed, and merging
+ * the containers in chunk order keeps commands in room order whichever worker ran them.
+ */
+struct update_entities_job {
+    t_game_data *data;
+    t_room *room;
+    t_update_command_container *chunk_commands;     // one container per chunk
+};
+
+static void update_entities_task(void *ctx, int begin, int end, int worker) {
+    struct update_entities_job *job = ctx;
+    t_update_command_container *commands = &job->chunk_commands[begin / UPDATE_CHUNK_SIZE];
+    for(int i = begin; i < end; i++) {
+        t_entity *current_entity = get_entity(job->data, job->room->entity_ids[i]);
+        if(current_entity == NULL)
+            continue;
+        t_update_command_container entity_commands = update_entity(job->data, current_entity);
+        append_container(commands, &entity_commands);
+    }
+}
+
+/*
+ * update_entities: Update every entity in the current room on a thread pool.
+ *
+ * data (t_game_data *): Game whose current room is updated. Only read by entity handlers.
+ * pool (threadpool *): Pool to run event handlers on.
+ *
+ * Returns (t_update_command_container): All commands generated, in room order.
+ *      Chunks are merged through the calling thread's frame arena, so callers reset it every tick.
+ */
+t_update_command_container update_entities(t_game_data *data, threadpool *pool) {
+    t_update_command_container commands = make_update_command_container();
+    t_room *current_room = get_room(data, data->current_room_id);
+    if(current_room == NULL || current_room->num_entities == 0)
+        return commands;
+    int num_chunks = (current_room->num_entities + UPDATE_CHUNK_SIZE - 1) / UPDATE_CHUNK_SIZE;
+    t_update_command_container *chunk_commands = frame_alloc(sizeof(t_update_command_container) * num_chunks);
+    for(int i = 0; i < num_chunks; i++)
+        chunk_commands[i] = make_update_command_container();
+    struct update_entities_job job = {
+            .data = data, .room = current_room, .chunk_commands = chunk_commands
+    };
+    threadpool_run(pool, current_room->num_entities, UPDATE_CHUNK_SIZE, update_entities_task, &job);
+    for(int i = 0; i < num_chunks; i++)
+        append_container(&commands, &chunk_commands[i]);
+    return commands;
+}
+
+/*
+ * animate_sprites: Advance the sprite animation of every entity in the current room by one tick,
+ * without any update commands (see animate_entity).
+ *
+ * With hot fields stored separately, the room's entities are found as runs of consecutive dense
+ * indices, each animated in one vectorised pass (see entity_soa_animate). Entities added to a room
+ * together are usually one run. Otherwise each entity's sprite is looked up in turn.
+ */
+void animate_sprites(t_game_data *data) {
+    t_room *current_room = get_room(data, data->current_room_id);
+    if(current_room == NULL)
+        return;
+    entity_soa *hot = data->hot_entities;
+    if(hot != NULL) {
+        int begin = 0, end = 0;
+        for(int i = 0; i < current_room->num_entities; i++) {
+            int index = slotmap_index(&data->entities, current_room->entity_ids[i]);
+            if(index < 0)
+                continue;
+            if(index != end) {
+                entity_soa_animate(hot, begin, end);
+                begin = index;
+            }
+            end = index + 1;
+        }
+        entity_soa_animate(hot, begin, end);
+        return;
+    }
+    for(int i = 0; i < current_room->num_entities; i++) {
+        t_entity *entity = get_entity(data, current_room->entity_ids[i]);
+        if(entity != NULL)
+            animate_entity(entity, sprite_num_imgs(data, entity->current_spr_id));
+    }
+}
+
+/*
+ * update_frame: Update the game state by one tick.
+ *
+ * Advances sprite animations, finds collisions if enabled, updates all entities, schedules their
+ * commands and dispatches them, then frees all of the tick's temporaries. Temporaries come from
+ * frame arenas and command segment pools, so once these have grown to fit a frame, a tick makes
+ * no heap allocations (see get_heap_allocations).
+ *
+ * Returns (bool): true if the game has ended.
+ */
+bool update_frame(t_game_data *data, threadpool *pool) {
+    // Animate first, so collisions test the subimages that will be drawn
+    animate_sprites(data);
+    // Find collisions before entities update, so their collide handlers can be called
+    if(data->collisions != NULL)
+        detect_collisions(data, data->collisions);
+    // Get all update commands
+    t_update_command_container commands = update_entities(data, pool);
+    if(data->collisions != NULL)
+        data->collisions->num_indices = 0;     // contacts are in the frame arena, reset below
+    // Schedule commands: adds first, then alters, then removes, finally quit, dropping dead ones
+    t_update_command **schedule = frame_alloc(sizeof(t_update_command *) * commands.num_commands);
+    int num_scheduled = optimise_commands(data, &commands, schedule);
+    // Parse all commands
+    // (must be done in a separate loop bc. may modify other entities before they update)
+    bool has_game_ended = dispatch_commands(data, pool, schedule, num_scheduled);
+    free_update_command_container(&commands);
+    arena_reset(frame_arena_local());
+    data->tick++;
+    return has_game_ended;
+}
+
+/*
+ * publish_game_snapshot: Copy the state the render loop needs into a snapshot, and publish it.
+ * Only to be called by the update loop, between ticks.
+ *
+ * If the current room has a spatial grid, only entities near the camera are copied, found by
+ * querying the grid, so the cost is proportional to the number of entities on screen.
+ * Otherwise every entity in the room is copied, in room order.
+ * Entities moved by the last tick also carry their position from before it.
+ */
+void publish_game_snapshot(t_game_data *data) {
+    game_snapshot *snapshot = snapshot_back(&data->snapshots);
+    snapshot->tick = data->tick;
+    snapshot->current_room_id = data->current_room_id;
+    snapshot->camera_x = data->camera_x;
+    snapshot->camera_y = data->camera_y;
+    snapshot->num_entities = 0;
+    t_room *current_room = get_room(data, data->current_room_id);
+    if(current_room != NULL) {
+        int *ids = current_room->entity_ids;
+        int num_ids = current_room->num_entities;
+        // images are drawn right and down of their position, so look up to a cell up and left of the camera
+        int margin = (current_room->grid != NULL) ? current_room->grid->cell_size : 0;
+        int left = data->camera_x - margin, top = data->camera_y - margin;
+        int right = data->camera_x + data->scr_width, bottom = data->camera_y + data->scr_height;
+        if(current_room->grid != NULL)
+            ids = spatial_grid_query(current_room->grid, left, top, right - left, bottom - top, &num_ids);
+        snapshot_reserve(snapshot, num_ids);
+        for(int i = 0; i < num_ids; i++) {
+            int id = ids[i];
+            int index = slotmap_index(&data->entities, id);
+            if(index < 0)
+                continue;
+            t_entity const* entity = get_entity(data, id);
+            snapshot_entity *ent = &snapshot->entities[snapshot->num_entities];
+            ent->id = id;
+            ent->depth = entity->depth;
+            if(data->hot_entities != NULL) {
+                entity_soa const* soa = data->hot_entities;
+                ent->x = soa->x[index];
+                ent->y = soa->y[index];
+                ent->current_spr_id = soa->current_spr_id[index];
+                ent->spr_current_img = soa->spr_current_img[index];
+            } else {
+                ent->x = entity->x;
+                ent->y = entity->y;
+                ent->current_spr_id = entity->current_spr_id;
+                ent->spr_current_img = entity->spr_current_img;
+            }
+            // only entities moved by the last tick have somewhere to interpolate from
+            bool moved = entity->moved_tick == data->tick;
+            ent->prev_x = moved ? entity->prev_x : ent->x;
+            ent->prev_y = moved ? entity->prev_y : ent->y;
+            // grid cells may stick out past the camera, so test exact positions
+            if(current_room->grid != NULL
+                    && (ent->x < left || ent->x >= right || ent->y < top || ent->y >= bottom))
+                continue;
+            snapshot->num_entities++;
+        }
+    }
+    snapshot_publish(&data->snapshots);
+}
+
+/*
+ * queue_snapshot_images: Queue the current subimage of every entity in a snapshot, in drawing order.
+ * Positions are interpolated between the start and end of the snapshot's last tick by alpha,
+ * and made relative to the snapshot's camera. Entities without a sprite, or whose sprite has
+ * no textures yet, are skipped.
+ * Only reads sprites, which are never changed by update commands, so is safe to call from the render loop.
+ *
+ * alpha (double): How far through the tick after the snapshot's to draw, from 0 (its start) to 1 (its end).
+ */
+void queue_snapshot_images(t_game_data *data, game_snapshot const* snapshot, double alpha, render_queue *queue) {
+    render_queue_clear(queue);
+    for(int i = 0; i < snapshot->num_entities; i++) {
+        snapshot_entity const* ent = &snapshot->entities[i];
+        t_sprite *sprite = get_sprite(data, ent->current_spr_id);
+        if(sprite == NULL || ent->spr_current_img < 0 || ent->spr_current_img >= sprite->num_imgs
+                || !asset_ready(sprite) || (sprite->texture == NULL && sprite->regions == NULL))
+            continue;
+        // packed sprites share their atlas page's texture, so are batched together
+        GLuint texture = (sprite->regions != NULL)
+                         ? data->atlas->pages[sprite->regions[ent->spr_current_img].page].texture
+                         : sprite->texture[ent->spr_current_img];
+        int x = ent->prev_x + (int) lround((ent->x - ent->prev_x) * alpha);
+        int y = ent->prev_y + (int) lround((ent->y - ent->prev_y) * alpha);
+        render_queue_push(queue, ent->current_spr_id, ent->spr_current_img,
+                          x - snapshot->camera_x, y - snapshot->camera_y, ent->depth, texture);
+    }
+    render_queue_sort(queue);
+}
+
+/*
+ * render_frame: Draw a snapshot with the game's renderer, if any, from the furthest back image to the nearest.
+ * Entities are drawn between their positions at the start and end of the snapshot's last tick,
+ * by how far the scheduler is towards the next tick (see scheduler_alpha), so motion stays smooth
+ * when frames are not in step with ticks.
+ * The queue is refilled from the snapshot, so is only reused for its memory; afterwards,
+ * render_queue_num_batches(queue) gives the number of draw calls a batching backend needs.
+ */
+void render_frame(t_game_data *data, game_snapshot const* snapshot, render_queue *queue) {
+    // sprites loaded in the background only get textures here, on the render thread
+    if(data->loader != NULL)
+        loader_upload(data->loader, data->renderer);
+    // upload first, so packed images are queued with their page's texture
+    if(data->renderer != NULL && data->atlas != NULL && data->atlas->dirty) {
+        data->renderer->upload_atlas(data->renderer, data->atlas);
+        data->atlas->dirty = false;
+    }
+    queue_snapshot_images(data, snapshot, scheduler_alpha(&data->scheduler), queue);
+    if(data->renderer == NULL)
+        return;
+    data->renderer->begin_frame(data->renderer, data->scr_width, data->scr_height);
+    for(int i = 0; i < queue->num_images; i++) {
+        queued_image const* image = &queue->images[i];
+        draw_sprite(data->renderer, get_sprite(data, image->spr_id), image->subimg, image->x, image->y);
+    }
+    data->renderer->end_frame(data->renderer);
+}
+
 /*
  * update_loop: Repeatedly update the game state by one iteration.
  *
  * Is distinctly separate from rendering, as it merely alters the game's internal data.
- * Works by getting the current room's contained entities, then calling their update_self() functions.
- * Each function returns an update_command_container struct, containing a set of commands to be executed on game_data.
+ * Works by getting the current room's contained entities, then calling their event handlers on a thread pool
+ * of data->num_workers workers (all cores if 0).
+ * Each handler returns an update_command_container struct, containing a set of commands to be executed on game_data.
  * These commands are gathered and each executed by command_dispatcher functions, which each take
  * a certain type of update_command and the game_data*, returning nothing and updating the game_data.
+ * Commands on different entities are dispatched in parallel on the same pool (see dispatch_commands).
+ * Ticks run at the fixed rate of data->scheduler, sleeping between them (see cnd_scheduler.h).
+ * After each batch of ticks, the state the render loop needs is published to data->snapshots.
  *
  * data (t_game_data *): Pointer to data about game to be updated.
  */
 int loop_update(t_game_data* data) {
+    threadpool *pool = make_threadpool(data->num_workers);
     bool has_game_ended = false;
     while(!has_game_ended) {
-        t_room *current_room = data->current_room;
-        t_update_command_container commands[current_room->num_entities];   // FIXME: memory allocation, too slow
-        // Get all update commands
-        // TODO: thread pool
-        for (int i = 0; i < current_room->num_entities; i++) {
-            int current_entity_id = current_room->entity_ids[i];
-            // TODO: cache all entities in current room
-            t_entity *current_entity = get_entity(data, current_entity_id);
-            if (hashtable_contains(data->entities, current_entity_id))
-                commands[i] = update_entity(data, current_entity);
-        }
-        // TODO: schedule commands properly, adds first, then alters, then removes, finally quit
-        // Parse all commands
-        // (must be done in a separate loop bc. may modify other entities before they update)
-        // TODO: multithreading with thread pool
-        for (int i = current_room->num_entities - 1; i > 0; i--) {
-            t_update_command_container current_commands = commands[i];
-            for (int j = 0; j < current_commands.num_commands; j++) {
-                t_update_command command = current_commands.commands[j];
-                switch (command.type) {
-                    case ALTER_ENTITY:
-                        cmd_alter_entity(data, command.data.alter_ent);
-                        break;
-                    case ADD_ENTITY:
-                        cmd_add_entity(data, command.data.add_ent);
-                        break;
-                    case REM_ENTITY:
-                        cmd_rem_entity(data, command.data.rem_ent);
-                        break;
-                    case ALTER_ROOM:
-                        cmd_alter_room(data, command.data.alter_room);
-                        break;
-                    case NEXT_ROOM:
-                        cmd_next_room(data, command.data.next_room);
-                        break;
-                    case PLAY_SND:
-                        cmd_play_sound(data, command.data.play_snd);
-                        break;
-                    case PAUSE_SND:
-                        cmd_pause_sound(data, command.data.pause_snd);
-                        break;
-                    case END_SND:
-                        cmd_end_sound(data, command.data.end_snd);
-                        break;
-                    case QUIT:
-                        cmd_quit(data, command.data.quit);
-                        has_game_ended = true;
-                        break;
-                    default:
-                        break;
-                }
-            }
-        }
-        // TODO: slow loop if updating too fast
+        // sleep until the next tick, then run every tick due, catching up if the last ones were slow
+        int steps = scheduler_wait(&data->scheduler);
+        for(int i = 0; i < steps && !has_game_ended; i++)
+            has_game_ended = update_frame(data, pool);
+        publish_game_snapshot(data);
     }
+    threadpool_free(pool);
+    arena_free(frame_arena_local());
     return 0;
 }
 
@@ -209,12 +812,20 @@ int loop_update(t_game_data* data) {
  * loop_render: Repeatedly render the game state and display it on screen.
  *
  * Reads sprites of all entities in current room, updates their subimage if needed, and displays all images.
+ * Runs on its own thread alongside loop_update, so only reads the latest snapshot it published,
+ * never the game data being updated; taking a snapshot never waits for the update thread.
+ * Images are gathered into a render queue and radix sorted by depth then texture (see cnd_renderqueue.h),
+ * then drawn by the game's render backend (see set_renderer).
+ * Positions are interpolated by scheduler_alpha, as frames are not in step with the fixed update ticks.
  *
  * data (t_game_data *): Pointer to data about game to be rendered.
  */
 int loop_render(t_game_data* data) {
+    render_queue queue = make_render_queue(0);
     for(;;) {
-        // TODO
+        game_snapshot const* snapshot = snapshot_acquire(&data->snapshots);
+        render_frame(data, snapshot, &queue);
     }
+    render_queue_free(&queue);
     return 0;
 }
@@ -9,18 +9,28 @@
 #include "cnoodle.h"
 #include <stdlib.h>
 
+/*
+ * make_room: Make a room from the room pool, taking ownership of its array of entity IDs.
+ */
 t_room *make_room(int *entity_ids, int num_entities, int width, int height) {
-    t_room *room;
+    t_room *room = pool_alloc(ROOM_POOL);
     room->room_id = 0;
     room->entity_ids = entity_ids;
     room->num_entities = num_entities;
+    room->entity_capacity = 0;
     room->width = width;
     room->height = height;
+    room->grid = NULL;
     return room;
 }
 
+/*
+ * free_room: Free a room made by make_room, with its array of entity IDs and its grid.
+ */
 void free_room(t_room *room) {
     // not responsible for deleting entities, also stored in gamedata
     free(room->entity_ids);
-    free(room);
+    if(room->grid != NULL)
+        spatial_grid_free(room->grid);
+    pool_free(room);
 }
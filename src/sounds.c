@@ -8,29 +8,116 @@
 
 #include "cnoodle.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
 #include <portaudio.h>
 
+/*
+ * make_sound: Make a sound from the sound pool, taking ownership of its path, allocated with malloc.
+ */
 t_sound *make_sound(char *snd_path, int volume) {
-    t_sound *sound;
+    t_sound *sound = pool_alloc(SOUND_POOL);
     sound->snd_id = 0;
     sound->snd_path = snd_path;
     sound->volume = volume;
+    sound->samples = NULL;
+    sound->num_frames = 0;
+    atomic_init(&sound->state, ASSET_READY);
     return sound;
 }
 
+/*
+ * free_sound: Free a sound made by make_sound, with its path and samples.
+ */
 void free_sound(t_sound *sound) {
+    free(sound->samples);
     free(sound->snd_path);
-    free(sound);
+    pool_free(sound);
+}
+
+/*
+ * decode_wav: Private method to decode the rest of an open WAV file into a sound's samples, closing it.
+ */
+static bool decode_wav(t_sound *sound, wav_reader *reader) {
+    if(reader->sample_rate != MIXER_SAMPLE_RATE) {
+        wav_close(reader);
+        return false;
+    }
+    float *samples = malloc(sizeof(float) * 2 * (reader->num_frames > 0 ? reader->num_frames : 1));
+    if(samples == NULL) {
+        perror("Could not allocate sound samples.");
+        exit(EXIT_FAILURE);
+    }
+    free(sound->samples);
+    sound->samples = samples;
+    sound->num_frames = wav_read(reader, samples, reader->num_frames);
+    wav_close(reader);
+    return true;
+}
+
+/*
+ * load_sound: Decode a whole sound into memory, so it is mixed straight from its samples when played.
+ * Sounds not loaded are streamed from disk instead, which suits long music tracks better.
+ *
+ * Returns (bool): false if the file cannot be read, or is not at MIXER_SAMPLE_RATE.
+ */
+bool load_sound(t_sound *sound) {
+    wav_reader reader;
+    return wav_open(&reader, sound->snd_path) && decode_wav(sound, &reader);
+}
+
+/*
+ * decode_sound: Decode a whole sound from its WAV file already read into memory, as load_sound does.
+ *
+ * Returns (bool): false if the file is not a WAV file at MIXER_SAMPLE_RATE.
+ */
+bool decode_sound(t_sound *sound, void const* file_data, size_t size) {
+    wav_reader reader;
+    FILE *file = fmemopen((void *) file_data, size, "rb");
+    return file != NULL && wav_open_stream(&reader, file) && decode_wav(sound, &reader);
+}
+
+/*
+ * sound_gain: Private method to convert a sound's volume in decibels to the factor its samples are scaled by.
+ */
+static float sound_gain(t_sound const* sound) {
+    return powf(10.0f, sound->volume / 20.0f);
 }
 
-void play_sound(t_sound *sound) {
-    // TODO
+/*
+ * play_sound: Play a sound from the start, or resume it if paused.
+ * Loaded sounds are mixed from memory, others are streamed from their file.
+ */
+void play_sound(audio_mixer *mixer, t_sound *sound) {
+    if(sound->samples != NULL)
+        mixer_play(mixer, sound->snd_id, sound->samples, sound->num_frames, sound_gain(sound));
+    else
+        mixer_play_stream(mixer, sound->snd_id, sound->snd_path, sound_gain(sound));
+}
+
+/*
+ * play_cached_sound: Play a sound from a cache of decoded sounds, decoding it on its first play, or resume it if paused.
+ * Sounds loaded with load_sound are played from their own samples, and those too large to cache are streamed.
+ */
+void play_cached_sound(audio_mixer *mixer, sound_cache *cache, t_sound *sound) {
+    // plays the mixer has finished with may let this sound fit in the budget
+    sound_cache_collect(cache, mixer);
+    long num_frames;
+    float const* samples = NULL;
+    if(sound->samples == NULL)
+        samples = sound_cache_acquire(cache, sound->snd_id, sound->snd_path, &num_frames);
+    if(samples == NULL) {
+        play_sound(mixer, sound);
+        return;
+    }
+    if(!mixer_play_borrowed(mixer, sound->snd_id, samples, num_frames, sound_gain(sound)))
+        sound_cache_release(cache, sound->snd_id);
 }
 
-void pause_sound(t_sound *sound) {
-    //
+void pause_sound(audio_mixer *mixer, t_sound *sound) {
+    mixer_pause(mixer, sound->snd_id);
 }
 
-void stop_sound(t_sound *sound) {
-    //
+void stop_sound(audio_mixer *mixer, t_sound *sound) {
+    mixer_end(mixer, sound->snd_id);
 }
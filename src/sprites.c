@@ -7,22 +7,146 @@
  */
 
 #include "cnoodle.h"
+#include "cnd_render.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 
-t_sprite *make_sprite(int period, int num_imgs, GLuint *texture) {
-    t_sprite *sprite;
+/*
+ * make_sprite: Make a sprite from the sprite pool, taking ownership of its array of textures.
+ */
+t_sprite *make_sprite(int num_imgs, int width, int height, GLuint *texture) {
+    t_sprite *sprite = pool_alloc(SPRITE_POOL);
     sprite->spr_id = 0;
-    sprite->period = period;
     sprite->num_imgs = num_imgs;
+    sprite->width = width;
+    sprite->height = height;
     sprite->texture = texture;
+    sprite->masks = NULL;
+    sprite->pixels = NULL;
+    sprite->regions = NULL;
+    atomic_init(&sprite->state, ASSET_READY);
     return sprite;
 }
 
+/*
+ * free_pixels: Private method to free a sprite's masks and copies of its pixels, if any.
+ */
+static void free_pixels(t_sprite *sprite) {
+    if(sprite->masks != NULL) {
+        for(int i = 0; i < sprite->num_imgs; i++)
+            collision_mask_free(&sprite->masks[i]);
+        free(sprite->masks);
+        sprite->masks = NULL;
+    }
+    if(sprite->pixels != NULL) {
+        for(int i = 0; i < sprite->num_imgs; i++)
+            free(sprite->pixels[i]);
+        free(sprite->pixels);
+        sprite->pixels = NULL;
+    }
+}
+
+/*
+ * sprite_set_pixels: Give a sprite its subimages' pixels, when it is loaded.
+ * Builds its collision masks, so it collides pixel perfectly rather than by its hitbox,
+ * and keeps a copy of the pixels for render backends without a GPU.
+ *
+ * pixels (uint32_t const* const*): For each subimage, width * height RGBA pixels (see make_collision_mask).
+ */
+void sprite_set_pixels(t_sprite *sprite, uint32_t const* const* pixels) {
+    free_pixels(sprite);
+    // the atlas holds the old pixels, so draw from the new ones until it is rebuilt
+    free(sprite->regions);
+    sprite->regions = NULL;
+    size_t img_size = sizeof(uint32_t) * sprite->width * sprite->height;
+    sprite->masks = malloc(sizeof(collision_mask) * sprite->num_imgs);
+    sprite->pixels = malloc(sizeof(uint32_t *) * sprite->num_imgs);
+    if(sprite->masks == NULL || sprite->pixels == NULL) {
+        perror("Could not allocate sprite pixels.");
+        exit(EXIT_FAILURE);
+    }
+    for(int i = 0; i < sprite->num_imgs; i++) {
+        sprite->masks[i] = make_collision_mask(pixels[i], sprite->width, sprite->height);
+        // one spare pixel, so an empty subimage still gets an allocation
+        sprite->pixels[i] = malloc(img_size + sizeof(uint32_t));
+        if(sprite->pixels[i] == NULL) {
+            perror("Could not allocate sprite pixels.");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(sprite->pixels[i], pixels[i], img_size);
+    }
+}
+
+/*
+ * decode_sprite: Give a sprite its subimages' pixels from an image file in memory (see cnd_image.h).
+ * Subimages are stacked top to bottom in the image, which must be exactly as wide as the sprite,
+ * and num_imgs times as tall.
+ *
+ * Returns (bool): false if the file is not an image of the sprite's size, leaving the sprite unchanged.
+ */
+bool decode_sprite(t_sprite *sprite, void const* file_data, size_t size) {
+    int width, height;
+    uint32_t *image = decode_image(file_data, size, &width, &height);
+    if(image == NULL)
+        return false;
+    if(width != sprite->width || height != sprite->height * sprite->num_imgs) {
+        free(image);
+        return false;
+    }
+    uint32_t const** subimgs = malloc(sizeof(uint32_t *) * (sprite->num_imgs + 1));
+    if(subimgs == NULL) {
+        perror("Could not allocate sprite pixels.");
+        exit(EXIT_FAILURE);
+    }
+    for(int i = 0; i < sprite->num_imgs; i++)
+        subimgs[i] = image + (size_t) i * width * sprite->height;
+    sprite_set_pixels(sprite, subimgs);
+    free(subimgs);
+    free(image);
+    return true;
+}
+
+/*
+ * load_sprite: Read and decode a sprite's image file, blocking until done (see decode_sprite).
+ * Its subimages still need textures before a GPU render backend can draw them.
+ *
+ * Returns (bool): false if the file cannot be read, or is not an image of the sprite's size.
+ */
+bool load_sprite(t_sprite *sprite, char const* path) {
+    FILE *file = fopen(path, "rb");
+    if(file == NULL)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    char *file_data = malloc(size > 0 ? (size_t) size : 1);
+    if(file_data == NULL) {
+        perror("Could not allocate sprite file.");
+        exit(EXIT_FAILURE);
+    }
+    bool loaded = size >= 0 && fread(file_data, 1, (size_t) size, file) == (size_t) size
+                  && decode_sprite(sprite, file_data, (size_t) size);
+    fclose(file);
+    free(file_data);
+    return loaded;
+}
+
+/*
+ * free_sprite: Free a sprite made by make_sprite, with its textures array, pixels and masks.
+ */
 void free_sprite(t_sprite *sprite) {
+    free_pixels(sprite);
+    free(sprite->regions);
     free(sprite->texture);
-    free(sprite);
+    pool_free(sprite);
 }
 
-void draw_sprite(t_sprite *sprite /* add args needed when rendering finished */) {
-    // TODO
+/*
+ * draw_sprite: Draw a subimage of a sprite with a render backend, its top-left corner at (x, y) on screen.
+ */
+void draw_sprite(render_backend *backend, t_sprite const* sprite, int subimg, int x, int y) {
+    if(subimg < 0 || subimg >= sprite->num_imgs)
+        return;
+    backend->draw_image(backend, sprite, subimg, x, y);
 }
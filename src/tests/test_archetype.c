@@ -0,0 +1,201 @@
+/*
+ * File: test_archetype.c
+ *
+ * Testing suite for entity archetypes and spawning them in batches.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_SPAWNED 100
+#define TEST_FRAMES 5
+
+
+typedef struct {
+    int health;
+    int speed;
+} bullet_data;
+
+typedef struct {
+    t_game_data *data;
+    t_room room;
+    t_sprite sprite;
+    int bullet;     // archetype ID
+} afixture;
+
+
+static bullet_data const bullet_init = { .health = 3, .speed = 7 };
+
+// bullets last a single update
+static t_update_command_container bullet_step(t_game_data const* data, t_entity const* entity) {
+    t_update_command_container commands = make_update_command_container();
+    t_update_command *command = push_command(&commands, REM_ENTITY);
+    command->data.rem_ent.ent_id = entity->id;
+    return commands;
+}
+
+// the bullet archetype is always registered first, so has ID 0
+static t_update_command_container emitter_step(t_game_data const* data, t_entity const* entity) {
+    t_update_command_container commands = make_update_command_container();
+    t_update_command *command = push_command(&commands, SPAWN_BATCH);
+    command->data.spawn_batch = (struct spawn_batch_command) {
+            .arch_id = 0, .count = NUM_SPAWNED, .room_id = data->current_room_id, .x = entity->x, .y = entity->y, .dx = 1
+    };
+    return commands;
+}
+
+static struct spawn_batch_command spawn_cmd(afixture *af, int count) {
+    return (struct spawn_batch_command) {
+            .arch_id = af->bullet, .count = count, .room_id = af->room.room_id, .x = 10, .y = 20, .dx = 2, .dy = 3
+    };
+}
+
+void arch_setup(afixture *af, gconstpointer test_data) {
+    af->data = malloc(sizeof(t_game_data));
+    *af->data = make_game_data(NULL);
+    af->room = (t_room) { .width = 1000, .height = 1000 };
+    add_room(af->data, &af->room);
+    af->data->current_room_id = af->room.room_id;
+    af->sprite = (t_sprite) { .num_imgs = 4, .width = 8, .height = 8 };
+    add_sprite(af->data, &af->sprite);
+    t_archetype bullet = {
+            .event_handlers = { .step = bullet_step }, .spr_id = af->sprite.spr_id, .spr_period = 2, .depth = 5,
+            .ent_data_size = sizeof(bullet_data), .ent_data_init = &bullet_init
+    };
+    af->bullet = register_archetype(af->data, &bullet);
+}
+
+void arch_teardown(afixture *af, gconstpointer test_data) {
+    free(af->room.entity_ids);
+    gamedata_free(af->data);
+    arena_reset(frame_arena_local());
+}
+
+
+void test_register(afixture *af, gconstpointer test_data) {
+    g_assert_cmpint(af->bullet, ==, 0);
+    t_archetype particle = { .spr_period = -1 };
+    g_assert_cmpint(register_archetype(af->data, &particle), ==, 1);
+    g_assert_cmpint(get_archetype(af->data, 0)->depth, ==, 5);
+    g_assert_cmpint(get_archetype(af->data, 1)->spr_period, ==, -1);
+    g_assert_null(get_archetype(af->data, 2));
+    g_assert_null(get_archetype(af->data, -1));
+}
+
+void test_spawn(afixture *af, gconstpointer test_data) {
+    int first_id = af->data->max_id + 1;
+    cmd_spawn_batch(af->data, spawn_cmd(af, NUM_SPAWNED));
+    g_assert_cmpint(af->data->max_id, ==, first_id + NUM_SPAWNED - 1);
+    g_assert_cmpint(af->data->num_entities, ==, NUM_SPAWNED);
+    g_assert_cmpint(af->room.num_entities, ==, NUM_SPAWNED);
+    for(int i = 0; i < NUM_SPAWNED; i++) {
+        t_entity *entity = get_entity(af->data, first_id + i);
+        g_assert_nonnull(entity);
+        g_assert_true(entity->event_handlers.step == bullet_step);
+        g_assert_cmpint(entity->current_spr_id, ==, af->sprite.spr_id);
+        g_assert_cmpint(entity->spr_period, ==, 2);
+        g_assert_cmpint(entity->depth, ==, 5);
+        g_assert_cmpint(entity->x, ==, 10 + 2 * i);
+        g_assert_cmpint(entity->y, ==, 20 + 3 * i);
+        g_assert_false(entity->has_initialised);
+        // each has its own copy of the archetype's data
+        bullet_data *bullet = entity->ent_data;
+        g_assert_cmpint(bullet->health, ==, 3);
+        g_assert_cmpint(bullet->speed, ==, 7);
+        bullet->health = i;
+        g_assert_cmpint(af->room.entity_ids[i], ==, entity->id);
+        g_assert_cmpint(entity->room_id, ==, af->room.room_id);
+        g_assert_cmpint(entity->room_slot, ==, i);
+    }
+    g_assert_cmpint(((bullet_data *) get_entity(af->data, first_id + 1)->ent_data)->health, ==, 1);
+    // later elements still get higher IDs
+    t_entity added = {0};
+    add_entity(af->data, &added);
+    g_assert_cmpint(added.id, ==, first_id + NUM_SPAWNED);
+}
+
+void test_spawn_zeroed(afixture *af, gconstpointer test_data) {
+    t_archetype blank = { .ent_data_size = 3 * sizeof(int) };
+    int arch_id = register_archetype(af->data, &blank);
+    int first_id = spawn_entities(af->data, &(struct spawn_batch_command) { .arch_id = arch_id, .count = 2 });
+    g_assert_cmpint(first_id, !=, 0);
+    int *fields = get_entity(af->data, first_id + 1)->ent_data;
+    g_assert_cmpint(fields[0] + fields[1] + fields[2], ==, 0);
+    // not in any room
+    g_assert_cmpint(get_entity(af->data, first_id)->room_id, ==, 0);
+    g_assert_cmpint(af->room.num_entities, ==, 0);
+}
+
+void test_spawn_invalid(afixture *af, gconstpointer test_data) {
+    int max_id = af->data->max_id;
+    g_assert_cmpint(spawn_entities(af->data, &(struct spawn_batch_command) { .arch_id = 7, .count = 10 }), ==, 0);
+    g_assert_cmpint(spawn_entities(af->data, &(struct spawn_batch_command) { .arch_id = af->bullet, .count = 0 }), ==, 0);
+    g_assert_cmpint(af->data->max_id, ==, max_id);
+    g_assert_cmpint(af->data->num_entities, ==, 0);
+    g_assert_cmpint(af->data->archetypes.num_blocks, ==, 0);
+}
+
+void test_spawn_soa(afixture *af, gconstpointer test_data) {
+    enable_entity_soa(af->data);
+    cmd_spawn_batch(af->data, spawn_cmd(af, NUM_SPAWNED));
+    entity_soa *hot = af->data->hot_entities;
+    g_assert_cmpint(hot->num_entries, ==, NUM_SPAWNED);
+    for(int i = 0; i < NUM_SPAWNED; i++) {
+        int index = slotmap_index(&af->data->entities, af->room.entity_ids[i]);
+        g_assert_cmpint(hot->x[index], ==, 10 + 2 * i);
+        g_assert_cmpint(hot->spr_num_imgs[index], ==, 4);
+    }
+}
+
+void test_release(afixture *af, gconstpointer test_data) {
+    cmd_spawn_batch(af->data, spawn_cmd(af, NUM_SPAWNED));
+    cmd_spawn_batch(af->data, spawn_cmd(af, NUM_SPAWNED));
+    g_assert_cmpint(af->data->archetypes.num_blocks, ==, 2);
+    int first_id = af->data->archetypes.blocks[0].first_id;
+    for(int i = 0; i < NUM_SPAWNED - 1; i++)
+        cmd_rem_entity(af->data, (struct rem_entity_command) { .ent_id = first_id + i });
+    // removing again must not count twice
+    cmd_rem_entity(af->data, (struct rem_entity_command) { .ent_id = first_id });
+    g_assert_cmpint(af->data->archetypes.num_blocks, ==, 2);
+    g_assert_cmpint(af->data->archetypes.blocks[0].num_live, ==, 1);
+    cmd_rem_entity(af->data, (struct rem_entity_command) { .ent_id = first_id + NUM_SPAWNED - 1 });
+    g_assert_cmpint(af->data->archetypes.num_blocks, ==, 1);
+    g_assert_cmpint(af->data->archetypes.blocks[0].first_id, ==, first_id + NUM_SPAWNED);
+    g_assert_cmpint(af->room.num_entities, ==, NUM_SPAWNED);
+    // the second block is freed with the game data
+}
+
+void test_update_loop(afixture *af, gconstpointer test_data) {
+    t_entity emitter = { .x = 50, .y = 60, .event_handlers = { .step = emitter_step } };
+    add_entity(af->data, &emitter);
+    add_room_entity(af->data, &af->room, emitter.id);
+    threadpool *pool = make_threadpool(2);
+    for(int f = 0; f < TEST_FRAMES; f++)
+        g_assert_false(update_frame(af->data, pool));
+    // every batch but the last has removed itself
+    g_assert_cmpint(af->data->num_entities, ==, 1 + NUM_SPAWNED);
+    g_assert_cmpint(af->room.num_entities, ==, 1 + NUM_SPAWNED);
+    g_assert_cmpint(af->data->archetypes.num_blocks, ==, 1);
+    spawn_block const* block = &af->data->archetypes.blocks[0];
+    for(int i = 0; i < NUM_SPAWNED; i++)
+        g_assert_cmpint(get_entity(af->data, block->first_id + i)->x, ==, 50 + i);
+    threadpool_free(pool);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/archetype/register", afixture, NULL, arch_setup, test_register, arch_teardown);
+    g_test_add("/archetype/spawn", afixture, NULL, arch_setup, test_spawn, arch_teardown);
+    g_test_add("/archetype/spawn_zeroed", afixture, NULL, arch_setup, test_spawn_zeroed, arch_teardown);
+    g_test_add("/archetype/spawn_invalid", afixture, NULL, arch_setup, test_spawn_invalid, arch_teardown);
+    g_test_add("/archetype/spawn_soa", afixture, NULL, arch_setup, test_spawn_soa, arch_teardown);
+    g_test_add("/archetype/release", afixture, NULL, arch_setup, test_release, arch_teardown);
+    g_test_add("/archetype/update_loop", afixture, NULL, arch_setup, test_update_loop, arch_teardown);
+    return g_test_run();
+}
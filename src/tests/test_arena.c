@@ -0,0 +1,133 @@
+/*
+ * File: test_arena.c
+ *
+ * Testing suite for frame arenas, and for the update loop not allocating in steady state.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdalign.h>
+
+#define NUM_TEST_ENTS 5000
+#define WARMUP_FRAMES 4
+#define TEST_FRAMES 32
+
+
+typedef struct {
+    t_game_data *data;
+    threadpool *pool;
+    t_room room;
+    t_entity *ents;
+} afixture;
+
+
+static t_update_command_container step_right(t_game_data const* data, t_entity const* entity) {
+    t_update_command_container commands = make_update_command_container();
+    t_update_command *command = push_command(&commands, ALTER_ENTITY);
+    command->data.alter_ent.target_id = entity->id;
+    command->data.alter_ent.modified_attr = X;
+    command->data.alter_ent.int_value = entity->x + 1;
+    return commands;
+}
+
+void loop_setup(afixture *af, gconstpointer test_data) {
+    af->data = malloc(sizeof(t_game_data));
+    *af->data = make_game_data(NULL);
+    af->ents = calloc(NUM_TEST_ENTS, sizeof(t_entity));
+    af->room.entity_ids = malloc(sizeof(int) * NUM_TEST_ENTS);
+    af->room.num_entities = NUM_TEST_ENTS;
+    add_room(af->data, &af->room);
+    af->data->current_room_id = af->room.room_id;
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        af->ents[i].event_handlers.step = step_right;
+        add_entity(af->data, &af->ents[i]);
+        af->room.entity_ids[i] = af->ents[i].id;
+    }
+    // one worker, so every frame splits the same work over the same segment pools
+    af->pool = make_threadpool(1);
+}
+
+void loop_teardown(afixture *af, gconstpointer test_data) {
+    threadpool_free(af->pool);
+    free(af->room.entity_ids);
+    free(af->ents);
+    gamedata_free(af->data);
+    arena_free(frame_arena_local());
+}
+
+
+void test_alloc_aligned() {
+    frame_arena arena = make_frame_arena();
+    for(int i = 1; i < 100; i++) {
+        void *mem = arena_alloc(&arena, i);
+        g_assert_cmpint((uintptr_t) mem % alignof(max_align_t), ==, 0);
+    }
+    arena_free(&arena);
+}
+
+void test_reset_reuses_blocks() {
+    frame_arena arena = make_frame_arena();
+    long allocations = get_heap_allocations();
+    // span several blocks, including one bigger than the default block size
+    void *first = arena_alloc(&arena, 100);
+    arena_alloc(&arena, ARENA_BLOCK_SIZE);
+    arena_alloc(&arena, 3 * ARENA_BLOCK_SIZE);
+    long grown = get_heap_allocations();
+    g_assert_cmpint(grown, >, allocations);
+    for(int frame = 0; frame < 10; frame++) {
+        arena_reset(&arena);
+        g_assert_true(arena_alloc(&arena, 100) == first);
+        arena_alloc(&arena, ARENA_BLOCK_SIZE);
+        arena_alloc(&arena, 3 * ARENA_BLOCK_SIZE);
+    }
+    g_assert_cmpint(get_heap_allocations(), ==, grown);
+    arena_free(&arena);
+}
+
+void test_steady_state_frames(afixture *af, gconstpointer test_data) {
+    for(int frame = 0; frame < WARMUP_FRAMES; frame++)
+        g_assert_false(update_frame(af->data, af->pool));
+    long allocations = get_heap_allocations();
+    for(int frame = 0; frame < TEST_FRAMES; frame++)
+        g_assert_false(update_frame(af->data, af->pool));
+    g_assert_cmpint(get_heap_allocations(), ==, allocations);
+    for(int i = 0; i < NUM_TEST_ENTS; i++)
+        g_assert_cmpint(af->ents[i].x, ==, WARMUP_FRAMES + TEST_FRAMES);
+}
+
+void test_room_churn(afixture *af, gconstpointer test_data) {
+    // entities leaving and joining a room reuse its grown array rather than reallocating
+    t_entity extra[64] = {{0}};
+    for(int i = 0; i < 64; i++)
+        add_entity(af->data, &extra[i]);
+    int first_id = extra[0].id;
+    add_room_entity_range(af->data, &af->room, first_id, 64);
+    int ids[64];
+    for(int i = 0; i < 64; i++)
+        ids[i] = first_id + i;
+    del_room_entities(af->data, ids, 64);
+    long allocations = get_heap_allocations();
+    for(int frame = 0; frame < TEST_FRAMES; frame++) {
+        add_room_entity_range(af->data, &af->room, first_id, 64);
+        g_assert_cmpint(af->room.num_entities, ==, NUM_TEST_ENTS + 64);
+        del_room_entities(af->data, ids, 64);
+        g_assert_cmpint(af->room.num_entities, ==, NUM_TEST_ENTS);
+    }
+    g_assert_cmpint(get_heap_allocations(), ==, allocations);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/arena/alloc_aligned", test_alloc_aligned);
+    g_test_add_func("/arena/reset_reuses_blocks", test_reset_reuses_blocks);
+    g_test_add("/arena/steady_state_frames", afixture, NULL, loop_setup, test_steady_state_frames, loop_teardown);
+    g_test_add("/arena/room_churn", afixture, NULL, loop_setup, test_room_churn, loop_teardown);
+    return g_test_run();
+}
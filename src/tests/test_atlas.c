@@ -0,0 +1,245 @@
+/*
+ * File: test_atlas.c
+ *
+ * Testing suite for texture atlases, and drawing sprites packed in them.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PAGE_SIZE 256
+#define NUM_TEST_IMAGES 500
+#define MAX_IMAGE_SIZE 40
+#define NUM_TEST_SPRITES 30
+#define NUM_TEST_ENTS 200
+#define SCR_SIZE 128
+
+
+typedef struct {
+    texture_atlas *atlas;
+    atlas_region regions[NUM_TEST_IMAGES];
+} afixture;
+
+
+static bool regions_overlap(atlas_region const* a, atlas_region const* b) {
+    // padding must stay empty too
+    return a->page == b->page
+           && a->x < b->x + b->width + ATLAS_PADDING && b->x < a->x + a->width + ATLAS_PADDING
+           && a->y < b->y + b->height + ATLAS_PADDING && b->y < a->y + a->height + ATLAS_PADDING;
+}
+
+static int compare_heights(void const* a, void const* b) {
+    return ((int const*) b)[1] - ((int const*) a)[1];
+}
+
+void atlas_setup(afixture *af, gconstpointer test_data) {
+    af->atlas = make_texture_atlas(PAGE_SIZE);
+}
+
+void atlas_teardown(afixture *af, gconstpointer test_data) {
+    texture_atlas_free(af->atlas);
+}
+
+
+void test_no_overlap(afixture *af, gconstpointer test_data) {
+    srand(1);
+    int sizes[NUM_TEST_IMAGES][2];
+    long area = 0;
+    for(int i = 0; i < NUM_TEST_IMAGES; i++) {
+        sizes[i][0] = 1 + rand() % MAX_IMAGE_SIZE;
+        sizes[i][1] = 1 + rand() % MAX_IMAGE_SIZE;
+        area += sizes[i][0] * sizes[i][1];
+    }
+    // tallest first, as build_sprite_atlas does
+    qsort(sizes, NUM_TEST_IMAGES, sizeof(sizes[0]), compare_heights);
+    for(int i = 0; i < NUM_TEST_IMAGES; i++)
+        af->regions[i] = atlas_insert(af->atlas, sizes[i][0], sizes[i][1]);
+    for(int i = 0; i < NUM_TEST_IMAGES; i++) {
+        atlas_region const* region = &af->regions[i];
+        atlas_page const* page = &af->atlas->pages[region->page];
+        g_assert_cmpint(region->width, ==, sizes[i][0]);
+        g_assert_cmpint(region->height, ==, sizes[i][1]);
+        g_assert_cmpint(region->x, >=, 0);
+        g_assert_cmpint(region->y, >=, 0);
+        g_assert_cmpint(region->x + region->width, <=, page->width);
+        g_assert_cmpint(region->y + region->height, <=, page->height);
+        g_assert_cmpfloat(region->u0 * page->width, ==, region->x);
+        g_assert_cmpfloat(region->v1 * page->height, ==, region->y + region->height);
+        for(int j = 0; j < i; j++)
+            g_assert_false(regions_overlap(region, &af->regions[j]));
+    }
+    g_assert_cmpfloat(atlas_efficiency(af->atlas), ==,
+                      (double) area / ((long) af->atlas->num_pages * PAGE_SIZE * PAGE_SIZE));
+    // all but the last page should be well packed
+    g_assert_cmpfloat(atlas_efficiency(af->atlas), >, 0.7 * (af->atlas->num_pages - 1) / af->atlas->num_pages);
+}
+
+void test_large_image(afixture *af, gconstpointer test_data) {
+    atlas_insert(af->atlas, 10, 10);
+    atlas_region region = atlas_insert(af->atlas, PAGE_SIZE + 5, 3);
+    g_assert_cmpint(region.page, ==, 1);
+    g_assert_cmpint(af->atlas->pages[1].width, ==, PAGE_SIZE + 5 + ATLAS_PADDING);
+    g_assert_cmpint(af->atlas->pages[1].height, ==, PAGE_SIZE);
+    // small images still go in the first page
+    g_assert_cmpint(atlas_insert(af->atlas, 10, 10).page, ==, 0);
+}
+
+void test_blit(afixture *af, gconstpointer test_data) {
+    g_assert_false(af->atlas->dirty);
+    uint32_t pixels[6] = { 1, 2, 3, 4, 5, 6 };
+    atlas_insert(af->atlas, 7, 7);
+    atlas_region region = atlas_insert(af->atlas, 3, 2);
+    atlas_blit(af->atlas, &region, pixels);
+    g_assert_true(af->atlas->dirty);
+    atlas_page const* page = &af->atlas->pages[region.page];
+    for(int row = 0; row < 2; row++) {
+        for(int col = 0; col < 3; col++)
+            g_assert_cmpuint(page->pixels[(region.y + row) * page->width + region.x + col], ==, pixels[row * 3 + col]);
+    }
+    // padding is left transparent
+    g_assert_cmpuint(page->pixels[(region.y + 2) * page->width + region.x], ==, 0);
+    g_assert_cmpuint(page->pixels[region.y * page->width + region.x + 3], ==, 0);
+}
+
+static void (*software_upload_atlas_hook)(render_backend *, texture_atlas *);
+static int num_atlas_uploads;
+
+static void count_atlas_uploads(render_backend *backend, texture_atlas *atlas) {
+    num_atlas_uploads++;
+    software_upload_atlas_hook(backend, atlas);
+}
+
+void test_sprite_atlas() {
+    srand(2);
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    data->scr_width = data->scr_height = SCR_SIZE;
+    t_sprite *sprites = calloc(NUM_TEST_SPRITES, sizeof(t_sprite));
+    GLuint *textures = malloc(sizeof(GLuint) * NUM_TEST_SPRITES * 3);
+    uint32_t *pixels[3];
+    for(int i = 0; i < 3; i++)
+        pixels[i] = malloc(sizeof(uint32_t) * MAX_IMAGE_SIZE * MAX_IMAGE_SIZE);
+    for(int i = 0; i < NUM_TEST_SPRITES; i++) {
+        sprites[i].num_imgs = 1 + i % 3;
+        sprites[i].width = 1 + rand() % MAX_IMAGE_SIZE;
+        sprites[i].height = 1 + rand() % MAX_IMAGE_SIZE;
+        sprites[i].texture = &textures[3 * i];
+        for(int j = 0; j < 3; j++)
+            textures[3 * i + j] = 1000 + 3 * i + j;
+        for(int j = 0; j < sprites[i].num_imgs; j++) {
+            for(int k = 0; k < sprites[i].width * sprites[i].height; k++)
+                pixels[j][k] = (uint32_t) rand() * 2654435761u;
+        }
+        // the last sprite has no pixels, so is not packed
+        if(i < NUM_TEST_SPRITES - 1)
+            sprite_set_pixels(&sprites[i], (uint32_t const* const*) pixels);
+        add_sprite(data, &sprites[i]);
+    }
+    t_room room = {0};
+    t_entity *ents = calloc(NUM_TEST_ENTS, sizeof(t_entity));
+    room.entity_ids = malloc(sizeof(int) * NUM_TEST_ENTS);
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        t_sprite *sprite = &sprites[rand() % NUM_TEST_SPRITES];
+        ents[i].current_spr_id = sprite->spr_id;
+        ents[i].spr_current_img = rand() % sprite->num_imgs;
+        ents[i].x = rand() % SCR_SIZE - MAX_IMAGE_SIZE / 2;
+        ents[i].y = rand() % SCR_SIZE - MAX_IMAGE_SIZE / 2;
+        // images of equal depth are ordered by texture, which the atlas changes, so keep depths unique
+        ents[i].depth = i;
+        add_entity(data, &ents[i]);
+        room.entity_ids[room.num_entities++] = ents[i].id;
+    }
+    add_room(data, &room);
+    data->current_room_id = room.room_id;
+    software_renderer *renderer = make_software_renderer(0);
+    set_renderer(data, &renderer->backend);
+    publish_game_snapshot(data);
+    game_snapshot const* snapshot = snapshot_acquire(&data->snapshots);
+    render_queue queue = make_render_queue(0);
+
+    render_frame(data, snapshot, &queue);
+    uint32_t *unpacked = malloc(sizeof(uint32_t) * SCR_SIZE * SCR_SIZE);
+    for(int i = 0; i < SCR_SIZE * SCR_SIZE; i++)
+        unpacked[i] = renderer->pixels[i];
+
+    build_sprite_atlas(data, 64);
+    g_assert_null(sprites[NUM_TEST_SPRITES - 1].regions);
+    for(int i = 0; i < NUM_TEST_SPRITES - 1; i++)
+        g_assert_nonnull(sprites[i].regions);
+    // every subimage's pixels are in its region of the atlas
+    for(int i = 0; i < NUM_TEST_SPRITES - 1; i++) {
+        for(int j = 0; j < sprites[i].num_imgs; j++) {
+            atlas_region const* region = &sprites[i].regions[j];
+            atlas_page const* page = &data->atlas->pages[region->page];
+            g_assert_cmpint(region->width, ==, sprites[i].width);
+            g_assert_cmpint(region->height, ==, sprites[i].height);
+            for(int row = 0; row < region->height; row++) {
+                g_assert_cmpmem(page->pixels + (region->y + row) * page->width + region->x, sizeof(uint32_t) * region->width,
+                                sprites[i].pixels[j] + row * region->width, sizeof(uint32_t) * region->width);
+            }
+        }
+    }
+    render_frame(data, snapshot, &queue);
+    g_assert_false(data->atlas->dirty);
+    // packing sprites changes no pixel of the frame
+    for(int i = 0; i < SCR_SIZE * SCR_SIZE; i++)
+        g_assert_cmpuint(renderer->pixels[i], ==, unpacked[i]);
+    // at one depth, images batch by page, plus one batch per texture of the unpacked sprite
+    for(int i = 0; i < NUM_TEST_ENTS; i++)
+        ents[i].depth = 0;
+    publish_game_snapshot(data);
+    render_frame(data, snapshot_acquire(&data->snapshots), &queue);
+    g_assert_cmpint(render_queue_num_batches(&queue), <=, data->atlas->num_pages + 3);
+    g_assert_cmpint(data->atlas->num_pages, <, 10);
+    // a backend swapped in after the atlas was uploaded gets the pages too, and draws the same frame
+    for(int i = 0; i < SCR_SIZE * SCR_SIZE; i++)
+        unpacked[i] = renderer->pixels[i];
+    software_renderer *swapped = make_software_renderer(0);
+    software_upload_atlas_hook = swapped->backend.upload_atlas;
+    swapped->backend.upload_atlas = count_atlas_uploads;
+    set_renderer(data, &swapped->backend);
+    g_assert_true(data->atlas->dirty);
+    render_frame(data, snapshot_acquire(&data->snapshots), &queue);
+    g_assert_cmpint(num_atlas_uploads, ==, 1);
+    g_assert_false(data->atlas->dirty);
+    for(int i = 0; i < SCR_SIZE * SCR_SIZE; i++)
+        g_assert_cmpuint(swapped->pixels[i], ==, unpacked[i]);
+
+    render_queue_free(&queue);
+    free(unpacked);
+    free(room.entity_ids);
+    free(ents);
+    for(int i = 0; i < 3; i++)
+        free(pixels[i]);
+    gamedata_free(data);
+    for(int i = 0; i < NUM_TEST_SPRITES; i++) {
+        sprites[i].texture = NULL;  // not owned by the sprite
+        if(sprites[i].pixels != NULL) {
+            for(int j = 0; j < sprites[i].num_imgs; j++) {
+                collision_mask_free(&sprites[i].masks[j]);
+                free(sprites[i].pixels[j]);
+            }
+        }
+        free(sprites[i].masks);
+        free(sprites[i].pixels);
+        free(sprites[i].regions);
+    }
+    free(sprites);
+    free(textures);
+    arena_reset(frame_arena_local());
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/atlas/no_overlap", afixture, NULL, atlas_setup, test_no_overlap, atlas_teardown);
+    g_test_add("/atlas/large_image", afixture, NULL, atlas_setup, test_large_image, atlas_teardown);
+    g_test_add("/atlas/blit", afixture, NULL, atlas_setup, test_blit, atlas_teardown);
+    g_test_add_func("/atlas/sprite_atlas", test_sprite_atlas);
+    return g_test_run();
+}
@@ -0,0 +1,130 @@
+/*
+ * File: test_cmdoptimiser.c
+ *
+ * Testing suite for command scheduling and elimination.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+typedef struct {
+    t_game_data *data;
+    t_update_command_container commands;
+    t_update_command *schedule[16];
+    int num_scheduled;
+} ofixture;
+
+
+static void push(ofixture *of, enum command_type type, int target, int attr) {
+    int index = of->commands.num_commands;
+    t_update_command *command = push_command(&of->commands, type);
+    switch(type) {
+        case ALTER_ENTITY:
+            command->data.alter_ent.target_id = target;
+            command->data.alter_ent.modified_attr = attr;
+            command->data.alter_ent.int_value = index;
+            break;
+        case REM_ENTITY:
+            command->data.rem_ent.ent_id = target;
+            break;
+        case PLAY_SND:
+            command->data.play_snd.sound_id = target;
+            break;
+        case END_SND:
+            command->data.end_snd.sound_id = target;
+            break;
+        default:
+            break;
+    }
+}
+
+static int optimise(ofixture *of) {
+    of->num_scheduled = optimise_commands(of->data, &of->commands, of->schedule);
+    return of->data->optimiser.frame_eliminated;
+}
+
+static t_update_command *nth(ofixture *of, int n) {
+    g_assert_cmpint(n, <, of->num_scheduled);
+    return of->schedule[n];
+}
+
+void opt_setup(ofixture *of, gconstpointer test_data) {
+    of->data = malloc(sizeof(t_game_data));
+    *of->data = make_game_data(NULL);
+    of->data->max_id = 10;
+    of->commands = make_update_command_container();
+}
+
+void opt_teardown(ofixture *of, gconstpointer test_data) {
+    free_update_command_container(&of->commands);
+    gamedata_free(of->data);
+}
+
+
+void test_phases(ofixture *of, gconstpointer test_data) {
+    push(of, QUIT, 0, 0);
+    push(of, REM_ENTITY, 1, 0);
+    push(of, ALTER_ENTITY, 2, X);
+    push(of, ADD_ENTITY, 0, 0);
+    optimise(of);
+    g_assert_cmpint(of->num_scheduled, ==, 4);
+    g_assert_cmpint(nth(of, 0)->type, ==, ADD_ENTITY);
+    g_assert_cmpint(nth(of, 1)->type, ==, ALTER_ENTITY);
+    g_assert_cmpint(nth(of, 2)->type, ==, REM_ENTITY);
+    g_assert_cmpint(nth(of, 3)->type, ==, QUIT);
+}
+
+void test_alter_removed(ofixture *of, gconstpointer test_data) {
+    push(of, ALTER_ENTITY, 1, X);
+    push(of, ALTER_ENTITY, 2, X);
+    push(of, REM_ENTITY, 1, 0);
+    push(of, ALTER_ENTITY, 1, Y);
+    g_assert_cmpint(optimise(of), ==, 2);
+    g_assert_cmpint(of->num_scheduled, ==, 2);
+    g_assert_cmpint(nth(of, 0)->data.alter_ent.target_id, ==, 2);
+    g_assert_cmpint(nth(of, 1)->type, ==, REM_ENTITY);
+    g_assert_cmpint(of->data->optimiser.frame_eliminated, ==, 2);
+}
+
+void test_last_alter_wins(ofixture *of, gconstpointer test_data) {
+    push(of, ALTER_ENTITY, 3, X);
+    push(of, ALTER_ENTITY, 3, Y);
+    push(of, ALTER_ENTITY, 3, X);
+    optimise(of);
+    g_assert_cmpint(of->num_scheduled, ==, 2);
+    g_assert_cmpint(nth(of, 0)->data.alter_ent.modified_attr, ==, Y);
+    g_assert_cmpint(nth(of, 1)->data.alter_ent.int_value, ==, 2);
+    // marks from the last frame must not leak into the next
+    free_update_command_container(&of->commands);
+    push(of, ALTER_ENTITY, 3, X);
+    g_assert_cmpint(optimise(of), ==, 0);
+}
+
+void test_sounds(ofixture *of, gconstpointer test_data) {
+    push(of, PLAY_SND, 4, 0);
+    push(of, PLAY_SND, 4, 0);
+    push(of, PLAY_SND, 5, 0);
+    push(of, END_SND, 5, 0);
+    push(of, END_SND, 5, 0);
+    optimise(of);
+    g_assert_cmpint(of->num_scheduled, ==, 2);
+    g_assert_cmpint(nth(of, 0)->type, ==, PLAY_SND);
+    g_assert_cmpint(nth(of, 0)->data.play_snd.sound_id, ==, 4);
+    g_assert_cmpint(nth(of, 1)->type, ==, END_SND);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/cmdoptimiser/phases", ofixture, NULL, opt_setup, test_phases, opt_teardown);
+    g_test_add("/cmdoptimiser/alter_removed", ofixture, NULL, opt_setup, test_alter_removed, opt_teardown);
+    g_test_add("/cmdoptimiser/last_alter_wins", ofixture, NULL, opt_setup, test_last_alter_wins, opt_teardown);
+    g_test_add("/cmdoptimiser/sounds", ofixture, NULL, opt_setup, test_sounds, opt_teardown);
+    return g_test_run();
+}
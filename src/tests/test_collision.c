@@ -0,0 +1,179 @@
+/*
+ * File: test_collision.c
+ *
+ * Testing suite for collision detection.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_TEST_ENTS 400
+#define AREA_SIZE 400
+#define SPR_SIZE 16
+#define NUM_FRAMES 10
+
+
+typedef struct {
+    t_game_data *data;
+    t_room room;
+    t_sprite sprite;
+    t_entity *ents;
+} cfixture;
+
+
+/*
+ * brute_force_pairs: Count intersecting pairs by testing every pair of entities.
+ */
+static int brute_force_pairs(cfixture *cf) {
+    int num_pairs = 0;
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        for(int j = i + 1; j < NUM_TEST_ENTS; j++) {
+            t_entity *a = &cf->ents[i], *b = &cf->ents[j];
+            if(a->x < b->x + SPR_SIZE && b->x < a->x + SPR_SIZE
+                    && a->y < b->y + SPR_SIZE && b->y < a->y + SPR_SIZE)
+                num_pairs++;
+        }
+    }
+    return num_pairs;
+}
+
+// sets its depth to the ID of the last entity it hit
+static t_update_command_container record_hit(t_game_data const* data, t_entity const* entity, int other_id) {
+    t_update_command_container commands = make_update_command_container();
+    t_update_command *command = push_command(&commands, ALTER_ENTITY);
+    command->data.alter_ent.target_id = entity->id;
+    command->data.alter_ent.modified_attr = DEPTH;
+    command->data.alter_ent.int_value = other_id;
+    return commands;
+}
+
+void collision_setup(cfixture *cf, gconstpointer test_data) {
+    srand(1);
+    cf->data = malloc(sizeof(t_game_data));
+    *cf->data = make_game_data(NULL);
+    cf->sprite.num_imgs = 1;
+    cf->sprite.width = cf->sprite.height = SPR_SIZE;
+    add_sprite(cf->data, &cf->sprite);
+    cf->ents = calloc(NUM_TEST_ENTS, sizeof(t_entity));
+    cf->room.entity_ids = malloc(sizeof(int) * NUM_TEST_ENTS);
+    cf->room.num_entities = NUM_TEST_ENTS;
+    add_room(cf->data, &cf->room);
+    cf->data->current_room_id = cf->room.room_id;
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        cf->ents[i].x = rand() % AREA_SIZE;
+        cf->ents[i].y = rand() % AREA_SIZE;
+        cf->ents[i].current_spr_id = cf->sprite.spr_id;
+        add_entity(cf->data, &cf->ents[i]);
+        cf->room.entity_ids[i] = cf->ents[i].id;
+    }
+    enable_collisions(cf->data);
+}
+
+void collision_teardown(cfixture *cf, gconstpointer test_data) {
+    free(cf->room.entity_ids);
+    free(cf->ents);
+    gamedata_free(cf->data);
+    arena_reset(frame_arena_local());
+}
+
+
+void test_matches_brute_force(cfixture *cf, gconstpointer test_data) {
+    for(int frame = 0; frame < NUM_FRAMES; frame++) {
+        detect_collisions(cf->data, cf->data->collisions);
+        g_assert_cmpint(cf->data->collisions->num_pairs, ==, brute_force_pairs(cf));
+        for(int i = 0; i < cf->data->collisions->num_pairs; i++)
+            g_assert_cmpint(cf->data->collisions->pairs[i].a, <, cf->data->collisions->pairs[i].b);
+        // boxes must stay sorted as entities move
+        for(int i = 0; i < NUM_TEST_ENTS; i++) {
+            cf->ents[i].x += rand() % 11 - 5;
+            cf->ents[i].y += rand() % 11 - 5;
+        }
+        arena_reset(frame_arena_local());
+    }
+}
+
+void test_touching_edges(cfixture *cf, gconstpointer test_data) {
+    cf->room.num_entities = 3;
+    cf->ents[0].x = cf->ents[0].y = 0;
+    cf->ents[1].x = SPR_SIZE;   // touches the first on its right edge, so does not overlap
+    cf->ents[1].y = 0;
+    cf->ents[2].x = cf->ents[2].y = SPR_SIZE - 1;  // overlaps both by one pixel
+    detect_collisions(cf->data, cf->data->collisions);
+    g_assert_cmpint(cf->data->collisions->num_pairs, ==, 2);
+    int const* contacts;
+    int index = slotmap_index(&cf->data->entities, cf->ents[2].id);
+    g_assert_cmpint(get_contacts(cf->data->collisions, index, &contacts), ==, 2);
+    index = slotmap_index(&cf->data->entities, cf->ents[0].id);
+    g_assert_cmpint(get_contacts(cf->data->collisions, index, &contacts), ==, 1);
+    g_assert_cmpint(contacts[0], ==, cf->ents[2].id);
+}
+
+void test_room_changes(cfixture *cf, gconstpointer test_data) {
+    for(int i = 0; i < NUM_TEST_ENTS; i++)
+        cf->ents[i].x = cf->ents[i].y = 0;
+    detect_collisions(cf->data, cf->data->collisions);
+    g_assert_cmpint(cf->data->collisions->num_boxes, ==, NUM_TEST_ENTS);
+    // entities leaving the room, or without a sprite, are dropped
+    cf->room.num_entities = 10;
+    cf->ents[0].current_spr_id = 0;
+    detect_collisions(cf->data, cf->data->collisions);
+    g_assert_cmpint(cf->data->collisions->num_boxes, ==, 9);
+    g_assert_cmpint(cf->data->collisions->num_pairs, ==, 9 * 8 / 2);
+    cf->room.num_entities = NUM_TEST_ENTS;
+    detect_collisions(cf->data, cf->data->collisions);
+    g_assert_cmpint(cf->data->collisions->num_boxes, ==, NUM_TEST_ENTS - 1);
+}
+
+void test_collide_handlers(cfixture *cf, gconstpointer test_data) {
+    cf->room.num_entities = 2;
+    cf->ents[0].x = cf->ents[0].y = 0;
+    cf->ents[1].x = cf->ents[1].y = SPR_SIZE / 2;
+    cf->ents[0].event_handlers.collide = record_hit;
+    cf->ents[1].event_handlers.collide = record_hit;
+    threadpool *pool = make_threadpool(1);
+    g_assert_false(update_frame(cf->data, pool));
+    g_assert_cmpint(cf->ents[0].depth, ==, cf->ents[1].id);
+    g_assert_cmpint(cf->ents[1].depth, ==, cf->ents[0].id);
+    threadpool_free(pool);
+}
+
+void test_pixel_masks(cfixture *cf, gconstpointer test_data) {
+    // sprite solid only on its top-left to bottom-right diagonal
+    uint32_t pixels[SPR_SIZE * SPR_SIZE] = {0};
+    for(int i = 0; i < SPR_SIZE; i++)
+        pixels[i * SPR_SIZE + i] = 0xFF000000u;
+    uint32_t const* imgs[] = {pixels};
+    sprite_set_pixels(&cf->sprite, imgs);
+    cf->room.num_entities = 3;
+    cf->ents[0].x = cf->ents[0].y = 0;
+    cf->ents[1].x = 4;  // boxes overlap, diagonals are parallel so never meet
+    cf->ents[1].y = 0;
+    cf->ents[2].x = cf->ents[2].y = 4;  // diagonal runs along the first's
+    detect_collisions(cf->data, cf->data->collisions);
+    g_assert_cmpint(cf->data->collisions->frame_mask_tests, ==, 3);
+    g_assert_cmpint(cf->data->collisions->num_pairs, ==, 1);
+    g_assert_cmpint(cf->data->collisions->pairs[0].a, ==, cf->ents[0].id);
+    g_assert_cmpint(cf->data->collisions->pairs[0].b, ==, cf->ents[2].id);
+    for(int i = 0; i < cf->sprite.num_imgs; i++) {
+        collision_mask_free(&cf->sprite.masks[i]);
+        free(cf->sprite.pixels[i]);
+    }
+    free(cf->sprite.masks);
+    free(cf->sprite.pixels);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/collision/matches_brute_force", cfixture, NULL, collision_setup, test_matches_brute_force, collision_teardown);
+    g_test_add("/collision/touching_edges", cfixture, NULL, collision_setup, test_touching_edges, collision_teardown);
+    g_test_add("/collision/room_changes", cfixture, NULL, collision_setup, test_room_changes, collision_teardown);
+    g_test_add("/collision/collide_handlers", cfixture, NULL, collision_setup, test_collide_handlers, collision_teardown);
+    g_test_add("/collision/pixel_masks", cfixture, NULL, collision_setup, test_pixel_masks, collision_teardown);
+    return g_test_run();
+}
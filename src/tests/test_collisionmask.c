@@ -0,0 +1,122 @@
+/*
+ * File: test_collisionmask.c
+ *
+ * Testing suite for pixel perfect collision masks.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_TRIALS 2000
+#define MAX_MASK_SIZE 150   // wide enough for three words per row
+#define SOLID 0xFF000000u
+#define CLEAR 0x00FFFFFFu   // white but transparent, so only alpha decides
+
+
+typedef struct {
+    uint32_t *pixels;
+    collision_mask mask;
+} mfixture;
+
+
+/*
+ * random_mask: Make a mask of random size with a few solid pixels, so many overlapping masks miss.
+ */
+static collision_mask random_mask(uint32_t *pixels) {
+    int width = 1 + rand() % MAX_MASK_SIZE, height = 1 + rand() % MAX_MASK_SIZE;
+    for(int i = 0; i < width * height; i++)
+        pixels[i] = (rand() % 20 == 0) ? SOLID : CLEAR;
+    return make_collision_mask(pixels, width, height);
+}
+
+/*
+ * brute_force_intersect: Test every pixel of a against the pixel of b over it.
+ */
+static bool brute_force_intersect(collision_mask const* a, int ax, int ay, collision_mask const* b, int bx, int by) {
+    for(int y = 0; y < a->height; y++) {
+        for(int x = 0; x < a->width; x++) {
+            if(collision_mask_get(a, x, y) && collision_mask_get(b, ax + x - bx, ay + y - by))
+                return true;
+        }
+    }
+    return false;
+}
+
+void mask_setup(mfixture *mf, gconstpointer test_data) {
+    mf->pixels = malloc(sizeof(uint32_t) * 130 * 3);
+    for(int i = 0; i < 130 * 3; i++)
+        mf->pixels[i] = CLEAR;
+    mf->pixels[0] = SOLID;
+    mf->pixels[129] = 0x80000000u;  // exactly the threshold
+    mf->pixels[130 + 64] = 0x7FFFFFFFu;     // just under it
+    mf->pixels[2 * 130 + 64] = SOLID;
+    mf->mask = make_collision_mask(mf->pixels, 130, 3);
+}
+
+void mask_teardown(mfixture *mf, gconstpointer test_data) {
+    collision_mask_free(&mf->mask);
+    free(mf->pixels);
+}
+
+
+void test_make_mask(mfixture *mf, gconstpointer test_data) {
+    g_assert_cmpint(mf->mask.words_per_row, ==, 3);
+    g_assert_true(collision_mask_get(&mf->mask, 0, 0));
+    g_assert_true(collision_mask_get(&mf->mask, 129, 0));
+    g_assert_false(collision_mask_get(&mf->mask, 64, 1));
+    g_assert_true(collision_mask_get(&mf->mask, 64, 2));
+    g_assert_false(collision_mask_get(&mf->mask, 1, 0));
+    // outside the mask is never solid
+    g_assert_false(collision_mask_get(&mf->mask, -1, 0));
+    g_assert_false(collision_mask_get(&mf->mask, 130, 0));
+}
+
+void test_mask_offsets(mfixture *mf, gconstpointer test_data) {
+    // the single solid pixel of a 1x1 mask only hits the solid pixels of the fixture's
+    collision_mask dot = make_collision_mask(&(uint32_t) {SOLID}, 1, 1);
+    for(int x = -2; x < 132; x++) {
+        for(int y = -2; y < 5; y++) {
+            bool expected = collision_mask_get(&mf->mask, x, y);
+            g_assert_cmpint(masks_intersect(&mf->mask, 0, 0, &dot, x, y), ==, expected);
+            g_assert_cmpint(masks_intersect(&dot, x, y, &mf->mask, 0, 0), ==, expected);
+        }
+    }
+    collision_mask_free(&dot);
+}
+
+void test_kernels_match_brute_force() {
+    enum mask_kernel kernels[] = {MASK_KERNEL_SCALAR, MASK_KERNEL_SSE2, MASK_KERNEL_AVX2};
+    uint32_t *pixels = malloc(sizeof(uint32_t) * MAX_MASK_SIZE * MAX_MASK_SIZE);
+    srand(1);
+    for(int trial = 0; trial < NUM_TRIALS; trial++) {
+        collision_mask a = random_mask(pixels), b = random_mask(pixels);
+        int ax = rand() % 200 - 100, ay = rand() % 200 - 100;
+        int bx = rand() % 200 - 100, by = rand() % 200 - 100;
+        bool expected = brute_force_intersect(&a, ax, ay, &b, bx, by);
+        for(int k = 0; k < 3; k++) {
+            // kernels the CPU lacks are skipped
+            if(!use_mask_kernel(kernels[k]))
+                continue;
+            g_assert_cmpint(masks_intersect(&a, ax, ay, &b, bx, by), ==, expected);
+            g_assert_cmpint(masks_intersect(&b, bx, by, &a, ax, ay), ==, expected);
+        }
+        collision_mask_free(&a);
+        collision_mask_free(&b);
+    }
+    g_assert_true(use_mask_kernel(MASK_KERNEL_AUTO));
+    free(pixels);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/collisionmask/make_mask", mfixture, NULL, mask_setup, test_make_mask, mask_teardown);
+    g_test_add("/collisionmask/mask_offsets", mfixture, NULL, mask_setup, test_mask_offsets, mask_teardown);
+    g_test_add_func("/collisionmask/kernels_match_brute_force", test_kernels_match_brute_force);
+    return g_test_run();
+}
@@ -0,0 +1,249 @@
+/*
+ * File: test_entity.c
+ *
+ * Testing suite for entities, and advancing their sprite animations.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_TEST_ENTS 300
+#define NUM_TEST_FRAMES 50
+
+
+typedef struct {
+    t_game_data *data;
+    t_sprite sprites[3];
+    t_room rooms[2];
+    t_entity ents[NUM_TEST_ENTS];
+    t_entity other;     // in the room that is not current
+} efixture;
+
+
+void entity_setup(efixture *ef, gconstpointer test_data) {
+    srand(1);
+    ef->data = malloc(sizeof(t_game_data));
+    *ef->data = make_game_data(NULL);
+    for(int i = 0; i < 3; i++) {
+        ef->sprites[i].num_imgs = 2 + i;
+        add_sprite(ef->data, &ef->sprites[i]);
+    }
+    for(int r = 0; r < 2; r++) {
+        ef->rooms[r].entity_ids = malloc(sizeof(int) * NUM_TEST_ENTS);
+        add_room(ef->data, &ef->rooms[r]);
+    }
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        t_entity *ent = &ef->ents[i];
+        ent->current_spr_id = ef->sprites[rand() % 3].spr_id;
+        ent->spr_period = rand() % 5 - 1;
+        add_entity(ef->data, ent);
+        ef->rooms[0].entity_ids[ef->rooms[0].num_entities++] = ent->id;
+        // some entities join the room later, so are not next to the others in the dense arrays
+        if(i == NUM_TEST_ENTS / 2) {
+            ef->other.current_spr_id = ef->sprites[0].spr_id;
+            ef->other.spr_period = 0;
+            add_entity(ef->data, &ef->other);
+            ef->rooms[1].entity_ids[ef->rooms[1].num_entities++] = ef->other.id;
+        }
+    }
+    ef->data->current_room_id = ef->rooms[0].room_id;
+}
+
+void entity_teardown(efixture *ef, gconstpointer test_data) {
+    for(int r = 0; r < 2; r++)
+        free(ef->rooms[r].entity_ids);
+    gamedata_free(ef->data);
+}
+
+
+void test_animate_entity() {
+    t_entity ent = {0};
+    ent.spr_period = 2;
+    int expected[] = { 0, 0, 1, 1, 2, 2, 0, 0 };
+    for(int f = 0; f < 8; f++) {
+        g_assert_cmpint(ent.spr_current_img, ==, expected[f]);
+        animate_entity(&ent, 3);
+    }
+    // a period of 0 or 1 moves on every frame
+    ent.spr_period = 0;
+    animate_entity(&ent, 3);
+    g_assert_cmpint(ent.spr_current_img, ==, 2);
+    // static sprites, and entities without a sprite, stay as they are
+    ent.spr_period = -1;
+    animate_entity(&ent, 3);
+    g_assert_cmpint(ent.spr_current_img, ==, 2);
+    g_assert_cmpint(ent.spr_last_subimg_time, ==, 0);
+    ent.spr_period = 1;
+    animate_entity(&ent, 0);
+    g_assert_cmpint(ent.spr_current_img, ==, 2);
+    // a subimage past the end of a new sprite wraps around on its next change
+    animate_entity(&ent, 2);
+    g_assert_cmpint(ent.spr_current_img, ==, 0);
+}
+
+void test_soa_matches_entity() {
+    srand(2);
+    entity_soa *soa = make_entity_soa(0);
+    t_entity ents[NUM_TEST_ENTS] = {{0}};
+    int num_imgs[NUM_TEST_ENTS];
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        num_imgs[i] = rand() % 5;
+        ents[i].spr_period = rand() % 6 - 1;
+        ents[i].spr_current_img = rand() % (num_imgs[i] + 2);
+        ents[i].spr_last_subimg_time = rand() % 3;
+        entity_soa_push(soa, &ents[i]);
+        soa->spr_num_imgs[i] = num_imgs[i];
+    }
+    for(int f = 0; f < NUM_TEST_FRAMES; f++) {
+        // odd bounds, so vector code has leftover entities at both ends
+        entity_soa_animate(soa, 3, NUM_TEST_ENTS - 5);
+        for(int i = 3; i < NUM_TEST_ENTS - 5; i++)
+            animate_entity(&ents[i], num_imgs[i]);
+        for(int i = 0; i < NUM_TEST_ENTS; i++) {
+            g_assert_cmpint(soa->spr_current_img[i], ==, ents[i].spr_current_img);
+            g_assert_cmpint(soa->spr_last_subimg_time[i], ==, ents[i].spr_last_subimg_time);
+        }
+    }
+    entity_soa_free(soa);
+}
+
+/*
+ * assert_soa_matches: Check every entity's hot fields against its copies in the game's arrays.
+ */
+static void assert_soa_matches(t_game_data *data) {
+    entity_soa const* soa = data->hot_entities;
+    t_entity **entities = (t_entity **) slotmap_get_elems(&data->entities);
+    g_assert_cmpint(soa->num_entries, ==, data->num_entities);
+    for(int i = 0; i < data->num_entities; i++) {
+        t_entity const* ent = entities[i];
+        t_sprite const* sprite = get_sprite(data, ent->current_spr_id);
+        g_assert_cmpint(slotmap_index(&data->entities, ent->id), ==, i);
+        g_assert_cmpint(soa->x[i], ==, ent->x);
+        g_assert_cmpint(soa->y[i], ==, ent->y);
+        g_assert_cmpint(soa->current_spr_id[i], ==, ent->current_spr_id);
+        g_assert_cmpint(soa->spr_period[i], ==, ent->spr_period);
+        g_assert_cmpint(soa->spr_current_img[i], ==, ent->spr_current_img);
+        g_assert_cmpint(soa->spr_last_subimg_time[i], ==, ent->spr_last_subimg_time);
+        g_assert_cmpint(soa->spr_num_imgs[i], ==, (sprite != NULL) ? sprite->num_imgs : 0);
+        g_assert_cmpmem(&soa->event_handlers[i], sizeof(ent_func_vtable),
+                        &ent->event_handlers, sizeof(ent_func_vtable));
+    }
+}
+
+static t_update_command_container soa_test_step(t_game_data const* data, t_entity const* entity) {
+    return make_update_command_container();
+}
+
+void test_soa_tracks_entities(efixture *ef, gconstpointer test_data) {
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        ef->ents[i].x = i;
+        ef->ents[i].y = -i;
+    }
+    enable_entity_soa(ef->data);
+    assert_soa_matches(ef->data);
+    // entities added later are pushed on the end
+    t_entity later[3] = {{0}};
+    for(int i = 0; i < 3; i++) {
+        later[i].current_spr_id = ef->sprites[i].spr_id;
+        later[i].x = 1000 + i;
+        add_entity(ef->data, &later[i]);
+    }
+    assert_soa_matches(ef->data);
+    // deleting swaps the last entity into the hole, in both stores
+    del_entity(ef->data, ef->ents[0].id);
+    del_entity(ef->data, ef->ents[NUM_TEST_ENTS / 2].id);
+    del_entity(ef->data, later[2].id);
+    assert_soa_matches(ef->data);
+    // alterations write through to the arrays
+    ent_func_vtable handlers = { .step = soa_test_step };
+    int altered[] = { ef->ents[1].id, later[0].id, ef->ents[NUM_TEST_ENTS - 1].id };
+    for(int i = 0; i < 3; i++) {
+        cmd_alter_entity(ef->data, (struct alter_entity_command) {
+                .target_id = altered[i], .modified_attr = X, .int_value = 5000 + i });
+        cmd_alter_entity(ef->data, (struct alter_entity_command) {
+                .target_id = altered[i], .modified_attr = Y, .int_value = 6000 + i });
+        cmd_alter_entity(ef->data, (struct alter_entity_command) {
+                .target_id = altered[i], .modified_attr = CURRENT_SPR, .int_value = ef->sprites[i].spr_id });
+        cmd_alter_entity(ef->data, (struct alter_entity_command) {
+                .target_id = altered[i], .modified_attr = UPDATE_SELF, .event_handlers = &handlers });
+    }
+    assert_soa_matches(ef->data);
+    g_assert_cmpint(ef->data->hot_entities->x[slotmap_index(&ef->data->entities, later[0].id)], ==, 5001);
+    // timers only advance for animated entities
+    entity_soa *soa = ef->data->hot_entities;
+    int before[NUM_TEST_ENTS + 3];
+    for(int i = 0; i < soa->num_entries; i++)
+        before[i] = soa->spr_last_subimg_time[i];
+    entity_soa_tick_subimg_timers(soa);
+    for(int i = 0; i < soa->num_entries; i++)
+        g_assert_cmpint(soa->spr_last_subimg_time[i], ==, before[i] + (soa->spr_period[i] >= 0));
+}
+
+void test_animate_room(efixture *ef, gconstpointer test_data) {
+    threadpool *pool = make_threadpool(1);
+    // the same entities, animated one at a time
+    t_entity expected[NUM_TEST_ENTS];
+    for(int i = 0; i < NUM_TEST_ENTS; i++)
+        expected[i] = ef->ents[i];
+    for(int hot = 0; hot < 2; hot++) {
+        if(hot)
+            enable_entity_soa(ef->data);
+        for(int f = 0; f < NUM_TEST_FRAMES; f++) {
+            update_frame(ef->data, pool);
+            // animating makes no commands
+            g_assert_cmpint(ef->data->optimiser.frame_submitted, ==, 0);
+            for(int i = 0; i < NUM_TEST_ENTS; i++) {
+                t_sprite *sprite = get_sprite(ef->data, expected[i].current_spr_id);
+                animate_entity(&expected[i], sprite->num_imgs);
+                t_entity *ent = get_entity(ef->data, ef->ents[i].id);
+                if(hot)
+                    entity_soa_load(ef->data->hot_entities, slotmap_index(&ef->data->entities, ent->id), ent);
+                g_assert_cmpint(ent->spr_current_img, ==, expected[i].spr_current_img);
+                g_assert_cmpint(ent->spr_last_subimg_time, ==, expected[i].spr_last_subimg_time);
+            }
+        }
+    }
+    // only the current room animates
+    g_assert_cmpint(ef->other.spr_current_img, ==, 0);
+    g_assert_cmpint(ef->other.spr_last_subimg_time, ==, 0);
+    threadpool_free(pool);
+    arena_reset(frame_arena_local());
+}
+
+void test_sprite_changes(efixture *ef, gconstpointer test_data) {
+    enable_entity_soa(ef->data);
+    entity_soa *soa = ef->data->hot_entities;
+    t_entity *ent = &ef->ents[0];
+    int index = slotmap_index(&ef->data->entities, ent->id);
+    soa->spr_period[index] = 0;
+    soa->spr_current_img[index] = 0;
+    cmd_alter_entity(ef->data, (struct alter_entity_command) {
+            .target_id = ent->id, .modified_attr = CURRENT_SPR, .int_value = ef->sprites[2].spr_id
+    });
+    g_assert_cmpint(soa->spr_num_imgs[index], ==, 4);
+    for(int f = 1; f <= 5; f++) {
+        animate_sprites(ef->data);
+        g_assert_cmpint(soa->spr_current_img[index], ==, f % 4);
+    }
+    // once its sprite is gone, the entity stops animating
+    del_sprite(ef->data, ef->sprites[2].spr_id);
+    g_assert_cmpint(soa->spr_num_imgs[index], ==, 0);
+    animate_sprites(ef->data);
+    g_assert_cmpint(soa->spr_current_img[index], ==, 1);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/entity/animate_entity", test_animate_entity);
+    g_test_add_func("/entity/soa_matches_entity", test_soa_matches_entity);
+    g_test_add("/entity/soa_tracks_entities", efixture, NULL, entity_setup, test_soa_tracks_entities, entity_teardown);
+    g_test_add("/entity/animate_room", efixture, NULL, entity_setup, test_animate_room, entity_teardown);
+    g_test_add("/entity/sprite_changes", efixture, NULL, entity_setup, test_sprite_changes, entity_teardown);
+    return g_test_run();
+}
@@ -0,0 +1,299 @@
+/*
+ * File: test_glrender.c
+ *
+ * Testing suite for the OpenGL render backend.
+ *
+ * Runs without a display or GPU on Mesa's surfaceless EGL platform, drawing with llvmpipe into a
+ * framebuffer object, and compares frames with those of the software renderer. Tests are skipped
+ * if no OpenGL 4.4 context can be made.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#define GL_GLEXT_PROTOTYPES
+#include "../cnoodle.h"
+#include <GL/glext.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SCR_WIDTH 37
+#define SCR_HEIGHT 23
+#define SPR_WIDTH 13
+#define SPR_HEIGHT 9
+#define NUM_IMGS 2
+#define NUM_TRIALS 200
+#define NUM_TEST_SPRITES 20
+#define NUM_TEST_ENTS 150
+#define CLEAR_COLOR 0xFF302010u
+#define TOLERANCE 2     // either renderer may round a blend the other way, adding up where images overlap
+
+
+typedef struct {
+    gl_renderer *renderer;
+    software_renderer *reference;
+    GLuint framebuffer;
+    GLuint colorbuffer;
+    t_sprite sprite;
+    GLuint textures[NUM_IMGS];
+} glfixture;
+
+
+static bool have_context = false;
+
+/*
+ * make_context: Make an OpenGL 4.4 core context current without any window, returning false if
+ * there is no EGL display that can.
+ */
+static bool make_context() {
+    EGLint major, minor;
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        // no window system, eg. on a server, so try Mesa's surfaceless platform
+        PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if(get_platform_display == NULL)
+            return false;
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+            return false;
+    }
+    EGLint attributes[] = { EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 4,
+                            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+    if(!eglBindAPI(EGL_OPENGL_API))
+        return false;
+    EGLContext context = eglCreateContext(display, NULL, EGL_NO_CONTEXT, attributes);
+    return context != EGL_NO_CONTEXT && eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+/*
+ * make_texture: Make a texture of an image, as a game would load one itself.
+ */
+static GLuint make_texture(uint32_t const* pixels, int width, int height) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    return texture;
+}
+
+/*
+ * assert_frames_match: Check the framebuffer matches the software renderer's frame, give or take
+ * rounding in each channel. OpenGL rows go bottom to top, so are flipped.
+ */
+static void assert_frames_match(glfixture *glf) {
+    uint32_t *frame = malloc(sizeof(uint32_t) * SCR_WIDTH * SCR_HEIGHT);
+    glReadPixels(0, 0, SCR_WIDTH, SCR_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, frame);
+    for(int y = 0; y < SCR_HEIGHT; y++) {
+        for(int x = 0; x < SCR_WIDTH; x++) {
+            uint32_t actual = frame[(SCR_HEIGHT - 1 - y) * SCR_WIDTH + x];
+            uint32_t expected = software_renderer_get(glf->reference, x, y);
+            for(int shift = 0; shift < 32; shift += 8)
+                g_assert_cmpint(abs((int) ((actual >> shift) & 0xFF) - (int) ((expected >> shift) & 0xFF)), <=, TOLERANCE);
+        }
+    }
+    free(frame);
+}
+
+void glrender_setup(glfixture *glf, gconstpointer test_data) {
+    if(!have_context)
+        return;
+    srand(1);
+    glGenFramebuffers(1, &glf->framebuffer);
+    glGenRenderbuffers(1, &glf->colorbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, glf->colorbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT);
+    glBindFramebuffer(GL_FRAMEBUFFER, glf->framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, glf->colorbuffer);
+    g_assert_cmpint(glCheckFramebufferStatus(GL_FRAMEBUFFER), ==, GL_FRAMEBUFFER_COMPLETE);
+    glf->renderer = make_gl_renderer(CLEAR_COLOR, 0);
+    g_assert_nonnull(glf->renderer);
+    glf->reference = make_software_renderer(CLEAR_COLOR);
+    glf->sprite.num_imgs = NUM_IMGS;
+    glf->sprite.width = SPR_WIDTH;
+    glf->sprite.height = SPR_HEIGHT;
+    glf->sprite.texture = glf->textures;
+    // first subimage is all kinds of alpha, second a half transparent green square
+    uint32_t *pixels[NUM_IMGS];
+    for(int i = 0; i < NUM_IMGS; i++)
+        pixels[i] = malloc(sizeof(uint32_t) * SPR_WIDTH * SPR_HEIGHT);
+    for(int i = 0; i < SPR_WIDTH * SPR_HEIGHT; i++) {
+        uint32_t alpha = (rand() % 3 == 0) ? 0 : (rand() % 3 == 0) ? 255 : rand() % 256;
+        pixels[0][i] = (alpha << 24) | (rand() & 0xFFFFFF);
+        pixels[1][i] = 0x8000FF00u;
+    }
+    sprite_set_pixels(&glf->sprite, (uint32_t const* const*) pixels);
+    for(int i = 0; i < NUM_IMGS; i++) {
+        glf->textures[i] = make_texture(pixels[i], SPR_WIDTH, SPR_HEIGHT);
+        free(pixels[i]);
+    }
+}
+
+void glrender_teardown(glfixture *glf, gconstpointer test_data) {
+    if(!have_context)
+        return;
+    for(int i = 0; i < NUM_IMGS; i++) {
+        collision_mask_free(&glf->sprite.masks[i]);
+        free(glf->sprite.pixels[i]);
+    }
+    free(glf->sprite.masks);
+    free(glf->sprite.pixels);
+    glDeleteTextures(NUM_IMGS, glf->textures);
+    glf->renderer->backend.free(&glf->renderer->backend);
+    glf->reference->backend.free(&glf->reference->backend);
+    glDeleteRenderbuffers(1, &glf->colorbuffer);
+    glDeleteFramebuffers(1, &glf->framebuffer);
+}
+
+
+void test_matches_software(glfixture *glf, gconstpointer test_data) {
+    if(!have_context) {
+        g_test_skip("No OpenGL 4.4 context");
+        return;
+    }
+    render_backend *backends[2] = { &glf->renderer->backend, &glf->reference->backend };
+    for(int frame = 0; frame < GL_RENDER_FRAMES + 1; frame++) {
+        srand(2 + frame);
+        for(int b = 0; b < 2; b++)
+            backends[b]->begin_frame(backends[b], SCR_WIDTH, SCR_HEIGHT);
+        // runs of the same subimage batch together, so count them
+        int runs = 0, last_subimg = -1;
+        for(int i = 0; i < NUM_TRIALS; i++) {
+            int subimg = (rand() % 4 == 0) ? !last_subimg : (last_subimg == -1) ? 0 : last_subimg;
+            int x = rand() % (SCR_WIDTH + 2 * SPR_WIDTH) - SPR_WIDTH - 1;
+            int y = rand() % (SCR_HEIGHT + 2 * SPR_HEIGHT) - SPR_HEIGHT - 1;
+            runs += subimg != last_subimg;
+            last_subimg = subimg;
+            for(int b = 0; b < 2; b++)
+                draw_sprite(backends[b], &glf->sprite, subimg, x, y);
+        }
+        for(int b = 0; b < 2; b++)
+            backends[b]->end_frame(backends[b]);
+        assert_frames_match(glf);
+        g_assert_cmpint(glf->renderer->frame_draw_calls, ==, runs);
+        g_assert_cmpint(glf->renderer->frame_instances, ==, NUM_TRIALS);
+        g_assert_cmpint(glf->renderer->frame_bytes_uploaded, ==, NUM_TRIALS * sizeof(gl_instance));
+    }
+    g_assert_cmpint(glf->renderer->total_bytes_uploaded, ==, (GL_RENDER_FRAMES + 1) * NUM_TRIALS * sizeof(gl_instance));
+}
+
+void test_buffer_grows(glfixture *glf, gconstpointer test_data) {
+    if(!have_context) {
+        g_test_skip("No OpenGL 4.4 context");
+        return;
+    }
+    glf->renderer->backend.free(&glf->renderer->backend);
+    glf->renderer = make_gl_renderer(CLEAR_COLOR, 16);
+    render_backend *backends[2] = { &glf->renderer->backend, &glf->reference->backend };
+    // the first frame overflows its region, so is drawn in pieces, and the next has room
+    for(int frame = 0; frame < 2; frame++) {
+        for(int b = 0; b < 2; b++) {
+            srand(3);
+            backends[b]->begin_frame(backends[b], SCR_WIDTH, SCR_HEIGHT);
+            for(int i = 0; i < 20; i++)
+                draw_sprite(backends[b], &glf->sprite, 1, rand() % SCR_WIDTH - SPR_WIDTH / 2, rand() % SCR_HEIGHT);
+            backends[b]->end_frame(backends[b]);
+        }
+        assert_frames_match(glf);
+        g_assert_cmpint(glf->renderer->frame_instances, ==, 20);
+        g_assert_cmpint(glf->renderer->frame_draw_calls, ==, 2 - frame);
+    }
+    g_assert_cmpint(glf->renderer->capacity, ==, 32);
+    g_assert_false(glf->renderer->grow);
+}
+
+void test_atlas_batches(glfixture *glf, gconstpointer test_data) {
+    if(!have_context) {
+        g_test_skip("No OpenGL 4.4 context");
+        return;
+    }
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    data->scr_width = SCR_WIDTH;
+    data->scr_height = SCR_HEIGHT;
+    t_sprite *sprites = calloc(NUM_TEST_SPRITES, sizeof(t_sprite));
+    uint32_t *pixels = malloc(sizeof(uint32_t) * SPR_WIDTH * SPR_HEIGHT);
+    for(int i = 0; i < NUM_TEST_SPRITES; i++) {
+        sprites[i].num_imgs = 1;
+        sprites[i].width = 1 + rand() % SPR_WIDTH;
+        sprites[i].height = 1 + rand() % SPR_HEIGHT;
+        sprites[i].texture = malloc(sizeof(GLuint));
+        for(int k = 0; k < sprites[i].width * sprites[i].height; k++)
+            pixels[k] = (uint32_t) rand() * 2654435761u;
+        sprites[i].texture[0] = make_texture(pixels, sprites[i].width, sprites[i].height);
+        sprite_set_pixels(&sprites[i], (uint32_t const* const*) &pixels);
+        add_sprite(data, &sprites[i]);
+    }
+    t_room room = {0};
+    t_entity *ents = calloc(NUM_TEST_ENTS, sizeof(t_entity));
+    room.entity_ids = malloc(sizeof(int) * NUM_TEST_ENTS);
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        ents[i].current_spr_id = sprites[rand() % NUM_TEST_SPRITES].spr_id;
+        ents[i].x = rand() % SCR_WIDTH - SPR_WIDTH / 2;
+        ents[i].y = rand() % SCR_HEIGHT - SPR_HEIGHT / 2;
+        ents[i].depth = i;
+        add_entity(data, &ents[i]);
+        room.entity_ids[room.num_entities++] = ents[i].id;
+    }
+    add_room(data, &room);
+    data->current_room_id = room.room_id;
+    render_queue queue = make_render_queue(0);
+    // one frame with the software renderer to compare with, then the rest with OpenGL
+    set_renderer(data, &glf->reference->backend);
+    publish_game_snapshot(data);
+    render_frame(data, snapshot_acquire(&data->snapshots), &queue);
+    data->renderer = NULL;  // still owned by the fixture
+    set_renderer(data, &glf->renderer->backend);
+    render_frame(data, snapshot_acquire(&data->snapshots), &queue);
+    assert_frames_match(glf);
+    g_assert_cmpint(glf->renderer->frame_draw_calls, ==, render_queue_num_batches(&queue));
+
+    build_sprite_atlas(data, 32);
+    render_frame(data, snapshot_acquire(&data->snapshots), &queue);
+    assert_frames_match(glf);
+    g_assert_cmpint(glf->renderer->num_page_textures, ==, data->atlas->num_pages);
+    g_assert_cmpint(glf->renderer->frame_draw_calls, ==, render_queue_num_batches(&queue));
+    g_assert_cmpint(glf->renderer->frame_bytes_uploaded, ==,
+                    queue.num_images * sizeof(gl_instance) + data->atlas->num_pages * 32 * 32 * sizeof(uint32_t));
+    // at one depth, there is one draw call per atlas page
+    for(int i = 0; i < NUM_TEST_ENTS; i++)
+        ents[i].depth = 0;
+    publish_game_snapshot(data);
+    render_frame(data, snapshot_acquire(&data->snapshots), &queue);
+    g_assert_cmpint(glf->renderer->frame_draw_calls, ==, data->atlas->num_pages);
+    g_assert_cmpint(glf->renderer->frame_instances, ==, queue.num_images);
+    g_assert_cmpint(glf->renderer->frame_bytes_uploaded, ==, queue.num_images * sizeof(gl_instance));
+
+    render_queue_free(&queue);
+    free(room.entity_ids);
+    free(ents);
+    free(pixels);
+    data->renderer = NULL;
+    gamedata_free(data);
+    for(int i = 0; i < NUM_TEST_SPRITES; i++) {
+        glDeleteTextures(1, sprites[i].texture);
+        free(sprites[i].texture);
+        collision_mask_free(&sprites[i].masks[0]);
+        free(sprites[i].masks);
+        free(sprites[i].pixels[0]);
+        free(sprites[i].pixels);
+        free(sprites[i].regions);
+    }
+    free(sprites);
+    arena_reset(frame_arena_local());
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    have_context = make_context();
+    g_test_add("/glrender/matches_software", glfixture, NULL, glrender_setup, test_matches_software, glrender_teardown);
+    g_test_add("/glrender/buffer_grows", glfixture, NULL, glrender_setup, test_buffer_grows, glrender_teardown);
+    g_test_add("/glrender/atlas_batches", glfixture, NULL, glrender_setup, test_atlas_batches, glrender_teardown);
+    return g_test_run();
+}
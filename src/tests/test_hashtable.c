@@ -12,31 +12,70 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#define NUM_TEST_ENTS 1000
+
 
 typedef struct {
     hashtable table;
+    t_entity ents[NUM_TEST_ENTS];
 } hfixture;
 
 
 void table_setup(hfixture *hf, gconstpointer test_data) {
-    hf->table = make_hashtable();
-    t_entity *ent1 = make_entity(NULL, 0, 0, NULL);
-    ent1->id = 0;
-    hashtable_add(*(hf->table), (void *) ent1, ENTITY);
-    t_entity *ent2 = make_entity(NULL, 1, 1, (void *) ent1);
-    ent2->id = 1;
-    hashtable_add(*(hf->table), (void *) ent2, ENTITY);
+    hf->table = make_hashtable(0);
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        hf->ents[i].id = i;
+        hf->ents[i].x = i;
+        hashtable_add(&hf->table, (void *) &hf->ents[i], ENTITY);
+    }
 }
 
 void table_teardown(hfixture *hf, gconstpointer test_data) {
-    hashtable_free(hf->table);
+    hashtable_free(&hf->table);
 }
 
 
-// TODO: tests here
+void test_get(hfixture *hf, gconstpointer test_data) {
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        t_entity *ent = hashtable_get(&hf->table, i);
+        g_assert_nonnull(ent);
+        g_assert_cmpint(ent->x, ==, i);
+    }
+    g_assert_null(hashtable_get(&hf->table, NUM_TEST_ENTS));
+    g_assert_null(hashtable_get(&hf->table, -1));
+}
 
+void test_grows(hfixture *hf, gconstpointer test_data) {
+    g_assert_cmpint(hashtable_get_num_entries(&hf->table), ==, NUM_TEST_ENTS);
+    g_assert_cmpint(hf->table.capacity, >=, NUM_TEST_ENTS);
+}
 
-int main() {
-    // TODO: run tests here
+void test_del(hfixture *hf, gconstpointer test_data) {
+    for(int i = 0; i < NUM_TEST_ENTS; i += 2)
+        hashtable_del(&hf->table, i);
+    g_assert_cmpint(hashtable_get_num_entries(&hf->table), ==, NUM_TEST_ENTS / 2);
+    for(int i = 0; i < NUM_TEST_ENTS; i++)
+        g_assert_true(hashtable_contains(&hf->table, i) == (i % 2 == 1));
 }
 
+void test_get_ids(hfixture *hf, gconstpointer test_data) {
+    int *ids = hashtable_get_ids(&hf->table);
+    bool seen[NUM_TEST_ENTS] = { false };
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        g_assert_cmpint(ids[i], >=, 0);
+        g_assert_cmpint(ids[i], <, NUM_TEST_ENTS);
+        g_assert_false(seen[ids[i]]);
+        seen[ids[i]] = true;
+    }
+    arena_reset(frame_arena_local());
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/hashtable/get", hfixture, NULL, table_setup, test_get, table_teardown);
+    g_test_add("/hashtable/grows", hfixture, NULL, table_setup, test_grows, table_teardown);
+    g_test_add("/hashtable/del", hfixture, NULL, table_setup, test_del, table_teardown);
+    g_test_add("/hashtable/get_ids", hfixture, NULL, table_setup, test_get_ids, table_teardown);
+    return g_test_run();
+}
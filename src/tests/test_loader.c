@@ -0,0 +1,248 @@
+/*
+ * File: test_loader.c
+ *
+ * Testing suite for image decoding and the background asset loader.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define SPR_WIDTH 4
+#define SPR_HEIGHT 3
+#define SPR_IMGS 2
+#define NUM_TEST_FRAMES 100
+
+
+typedef struct {
+    char dir[256];
+    t_game_data *data;
+    uint32_t pixels[SPR_IMGS * SPR_WIDTH * SPR_HEIGHT];     // subimages top to bottom
+} lfixture;
+
+
+static void write_le(FILE *file, int num_bytes, uint32_t value) {
+    for(int i = 0; i < num_bytes; i++)
+        fputc((value >> (8 * i)) & 0xFF, file);
+}
+
+/*
+ * write_pam: Write pixels as a PAM image with alpha, with a comment in its header.
+ */
+static void write_pam(char const* path, uint32_t const* pixels, int width, int height) {
+    FILE *file = fopen(path, "wb");
+    g_assert_nonnull(file);
+    fprintf(file, "P7\n# made by test_loader\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n",
+            width, height);
+    fwrite(pixels, sizeof(uint32_t), (size_t) width * height, file);
+    fclose(file);
+}
+
+static void write_wav(char const* path) {
+    FILE *file = fopen(path, "wb");
+    g_assert_nonnull(file);
+    fwrite("RIFF", 1, 4, file);
+    write_le(file, 4, 36 + NUM_TEST_FRAMES * 2);
+    fwrite("WAVEfmt ", 1, 8, file);
+    write_le(file, 4, 16);
+    write_le(file, 2, WAV_PCM);
+    write_le(file, 2, 1);
+    write_le(file, 4, MIXER_SAMPLE_RATE);
+    write_le(file, 4, MIXER_SAMPLE_RATE * 2);
+    write_le(file, 2, 2);
+    write_le(file, 2, 16);
+    fwrite("data", 1, 4, file);
+    write_le(file, 4, NUM_TEST_FRAMES * 2);
+    for(int i = 0; i < NUM_TEST_FRAMES; i++)
+        write_le(file, 2, (uint16_t) (i * 100));
+    fclose(file);
+}
+
+static char *asset_path(lfixture *lf, char const* name) {
+    static char path[300];
+    snprintf(path, sizeof(path), "%s/%s", lf->dir, name);
+    return path;
+}
+
+void loader_setup(lfixture *lf, gconstpointer test_data) {
+    sprintf(lf->dir, "/tmp/cnd_test_loader_%d", (int) getpid());
+    g_assert_cmpint(mkdir(lf->dir, 0700), ==, 0);
+    for(int i = 0; i < SPR_IMGS * SPR_WIDTH * SPR_HEIGHT; i++)
+        lf->pixels[i] = (i % 3 == 0) ? 0x11223344u * (uint32_t) i : 0x80FF0000u | (uint32_t) i;
+    write_pam(asset_path(lf, "sprite.pam"), lf->pixels, SPR_WIDTH, SPR_HEIGHT * SPR_IMGS);
+    write_wav(asset_path(lf, "sound.wav"));
+    lf->data = malloc(sizeof(t_game_data));
+    *lf->data = make_game_data(NULL);
+    enable_asset_loader(lf->data, 2);
+}
+
+void loader_teardown(lfixture *lf, gconstpointer test_data) {
+    gamedata_free(lf->data);
+    remove(asset_path(lf, "sprite.pam"));
+    remove(asset_path(lf, "sound.wav"));
+    remove(asset_path(lf, "wrong_size.pam"));
+    rmdir(lf->dir);
+}
+
+
+void test_decode_image() {
+    int width, height;
+    // PPMs are opaque, and headers may have comments anywhere
+    char const ppm[] = "P6 # comment\n2 1\n255\n\x01\x02\x03\xFF\x00\x10";
+    uint32_t *pixels = decode_image(ppm, sizeof(ppm) - 1, &width, &height);
+    g_assert_nonnull(pixels);
+    g_assert_cmpint(width, ==, 2);
+    g_assert_cmpint(height, ==, 1);
+    g_assert_cmphex(pixels[0], ==, 0xFF030201u);
+    g_assert_cmphex(pixels[1], ==, 0xFF1000FFu);
+    free(pixels);
+    char const pam[] = "P7\nWIDTH 1\nHEIGHT 1\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n\x01\x02\x03\x04";
+    pixels = decode_image(pam, sizeof(pam) - 1, &width, &height);
+    g_assert_nonnull(pixels);
+    g_assert_cmphex(pixels[0], ==, 0x04030201u);
+    free(pixels);
+    // cut short, not 8 bits per channel, or not an image at all
+    g_assert_null(decode_image(ppm, sizeof(ppm) - 2, &width, &height));
+    char const deep[] = "P6 1 1 65535\n\x01\x02\x03\x04\x05\x06";
+    g_assert_null(decode_image(deep, sizeof(deep) - 1, &width, &height));
+    char const mismatched[] = "P7\nWIDTH 1\nHEIGHT 1\nDEPTH 3\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n\x01\x02\x03";
+    g_assert_null(decode_image(mismatched, sizeof(mismatched) - 1, &width, &height));
+    g_assert_null(decode_image("RIFF", 4, &width, &height));
+    g_assert_null(decode_image("", 0, &width, &height));
+}
+
+void test_load_sprite(lfixture *lf, gconstpointer test_data) {
+    t_sprite *sprite = make_sprite(SPR_IMGS, SPR_WIDTH, SPR_HEIGHT, NULL);
+    g_assert_true(load_sprite(sprite, asset_path(lf, "sprite.pam")));
+    for(int i = 0; i < SPR_IMGS; i++)
+        g_assert_cmpmem(sprite->pixels[i], sizeof(uint32_t) * SPR_WIDTH * SPR_HEIGHT,
+                        lf->pixels + i * SPR_WIDTH * SPR_HEIGHT, sizeof(uint32_t) * SPR_WIDTH * SPR_HEIGHT);
+    g_assert_nonnull(sprite->masks);
+    // subimages must fill the image exactly
+    t_sprite wrong = { .num_imgs = SPR_IMGS + 1, .width = SPR_WIDTH, .height = SPR_HEIGHT };
+    g_assert_false(load_sprite(&wrong, asset_path(lf, "sprite.pam")));
+    g_assert_null(wrong.pixels);
+    g_assert_false(load_sprite(&wrong, asset_path(lf, "missing.pam")));
+    free_sprite(sprite);
+}
+
+void test_load_async(lfixture *lf, gconstpointer test_data) {
+    t_game_data *data = lf->data;
+    t_sprite *sprite = load_sprite_async(data, asset_path(lf, "sprite.pam"), SPR_IMGS, SPR_WIDTH, SPR_HEIGHT);
+    t_sound *sound = load_sound_async(data, asset_path(lf, "sound.wav"), -6);
+    // handles are given out at once, before anything is read
+    g_assert_true(get_sprite(data, sprite->spr_id) == sprite);
+    g_assert_true(get_sound(data, sound->snd_id) == sound);
+    g_assert_cmpint(sprite->width, ==, SPR_WIDTH);
+    loader_wait(data->loader);
+    g_assert_cmpint(data->loader->loaded, ==, 2);
+    g_assert_cmpint(data->loader->failed, ==, 0);
+    g_assert_cmpint(data->loader->bytes_read, >, (long) sizeof(lf->pixels));
+    // sounds are usable once decoded
+    g_assert_true(asset_ready(sound));
+    g_assert_cmpint(sound->num_frames, ==, NUM_TEST_FRAMES);
+    g_assert_cmpfloat(sound->samples[2 * 3 + 1], ==, 300 / 32768.0f);
+    g_assert_cmpint(sound->volume, ==, -6);
+    // sprites then wait for the render thread to give them textures
+    g_assert_cmpint(atomic_load(&sprite->state), ==, ASSET_DECODED);
+    g_assert_false(asset_ready(sprite));
+    software_renderer *renderer = make_software_renderer(0);
+    g_assert_cmpint(loader_upload(data->loader, &renderer->backend), ==, 1);
+    g_assert_true(asset_ready(sprite));
+    g_assert_cmpmem(sprite->pixels[1], sizeof(uint32_t) * SPR_WIDTH * SPR_HEIGHT,
+                    lf->pixels + SPR_WIDTH * SPR_HEIGHT, sizeof(uint32_t) * SPR_WIDTH * SPR_HEIGHT);
+    g_assert_cmpint(loader_upload(data->loader, &renderer->backend), ==, 0);
+    // a new backend gives the sprite textures of its own before it is drawn again
+    set_renderer(data, &renderer->backend);
+    software_renderer *swapped = make_software_renderer(0);
+    set_renderer(data, &swapped->backend);
+    g_assert_false(asset_ready(sprite));
+    g_assert_cmpint(loader_upload(data->loader, &swapped->backend), ==, 1);
+    g_assert_true(asset_ready(sprite));
+    g_assert_cmpint(loader_upload(data->loader, &swapped->backend), ==, 0);
+}
+
+void test_load_failed(lfixture *lf, gconstpointer test_data) {
+    t_game_data *data = lf->data;
+    write_pam(asset_path(lf, "wrong_size.pam"), lf->pixels, SPR_WIDTH, SPR_HEIGHT);
+    t_sprite *wrong = load_sprite_async(data, asset_path(lf, "wrong_size.pam"), SPR_IMGS, SPR_WIDTH, SPR_HEIGHT);
+    t_sprite *missing = load_sprite_async(data, asset_path(lf, "missing.pam"), 1, 1, 1);
+    t_sound *not_wav = load_sound_async(data, asset_path(lf, "sprite.pam"), 0);
+    loader_wait(data->loader);
+    g_assert_cmpint(data->loader->failed, ==, 3);
+    g_assert_cmpint(atomic_load(&wrong->state), ==, ASSET_FAILED);
+    g_assert_cmpint(atomic_load(&missing->state), ==, ASSET_FAILED);
+    g_assert_cmpint(atomic_load(&not_wav->state), ==, ASSET_FAILED);
+    g_assert_cmpint(loader_upload(data->loader, NULL), ==, 0);
+}
+
+void test_not_ready(lfixture *lf, gconstpointer test_data) {
+    t_game_data *data = lf->data;
+    data->mixer = make_mixer();     // mixed offline below, rather than on an output
+    t_sprite *sprite = load_sprite_async(data, asset_path(lf, "sprite.pam"), SPR_IMGS, SPR_WIDTH, SPR_HEIGHT);
+    t_sound *sound = load_sound_async(data, asset_path(lf, "sound.wav"), 0);
+    loader_wait(data->loader);
+    t_room room = {0};
+    t_entity entity = {0};
+    entity.current_spr_id = sprite->spr_id;
+    add_entity(data, &entity);
+    room.entity_ids = &entity.id;
+    room.num_entities = 1;
+    add_room(data, &room);
+    data->current_room_id = room.room_id;
+    publish_game_snapshot(data);
+    render_queue queue = make_render_queue(0);
+    // not drawn until it has textures, which render_frame gives it first
+    queue_snapshot_images(data, snapshot_acquire(&data->snapshots), 1.0, &queue);
+    g_assert_cmpint(queue.num_images, ==, 0);
+    render_frame(data, snapshot_acquire(&data->snapshots), &queue);
+    g_assert_cmpint(queue.num_images, ==, 1);
+    render_queue_free(&queue);
+    // a sound still loading is not played
+    float out[2 * 16];
+    atomic_store(&sound->state, ASSET_LOADING);
+    cmd_play_sound(data, (struct play_sound_command) { .sound_id = sound->snd_id });
+    mixer_mix(data->mixer, out, 16);
+    g_assert_cmpint(atomic_load(&data->mixer->voices_playing), ==, 0);
+    atomic_store(&sound->state, ASSET_READY);
+    cmd_play_sound(data, (struct play_sound_command) { .sound_id = sound->snd_id });
+    mixer_mix(data->mixer, out, 16);
+    g_assert_cmpint(atomic_load(&data->mixer->voices_playing), ==, 1);
+}
+
+void test_upload_limit(lfixture *lf, gconstpointer test_data) {
+    t_game_data *data = lf->data;
+    int num_sprites = LOADER_UPLOADS_PER_FRAME + 5;
+    for(int i = 0; i < num_sprites; i++)
+        load_sprite_async(data, asset_path(lf, "sprite.pam"), SPR_IMGS, SPR_WIDTH, SPR_HEIGHT);
+    loader_wait(data->loader);
+    // a burst of loads is given textures over several frames
+    g_assert_cmpint(loader_upload(data->loader, NULL), ==, LOADER_UPLOADS_PER_FRAME);
+    g_assert_cmpint(loader_upload(data->loader, NULL), ==, 5);
+    int *ids = get_sprite_ids(data);
+    for(int i = 0; i < data->num_sprites; i++)
+        g_assert_true(asset_ready(get_sprite(data, ids[i])));
+    // freed with assets still queued, which are abandoned
+    for(int i = 0; i < 200; i++)
+        load_sound_async(data, asset_path(lf, "sound.wav"), 0);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/loader/decode_image", test_decode_image);
+    g_test_add("/loader/load_sprite", lfixture, NULL, loader_setup, test_load_sprite, loader_teardown);
+    g_test_add("/loader/load_async", lfixture, NULL, loader_setup, test_load_async, loader_teardown);
+    g_test_add("/loader/load_failed", lfixture, NULL, loader_setup, test_load_failed, loader_teardown);
+    g_test_add("/loader/not_ready", lfixture, NULL, loader_setup, test_not_ready, loader_teardown);
+    g_test_add("/loader/upload_limit", lfixture, NULL, loader_setup, test_upload_limit, loader_teardown);
+    return g_test_run();
+}
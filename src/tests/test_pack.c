@@ -0,0 +1,272 @@
+/*
+ * File: test_pack.c
+ *
+ * Testing suite for game packs.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NUM_TEST_ENTITIES 5
+
+
+typedef struct {
+    char path[256];
+    t_game_data *data;      // game data the pack was saved from
+    t_room rooms[2];
+    t_sprite sprite;
+    t_sound sound;
+    t_entity entities[NUM_TEST_ENTITIES];
+} pfixture;
+
+
+static t_game_data *load(char const* path) {
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data((char *) path);
+    return data;
+}
+
+static char *read_file(char const* path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    g_assert_nonnull(file);
+    fseek(file, 0, SEEK_END);
+    *size = (size_t) ftell(file);
+    rewind(file);
+    char *contents = malloc(*size);
+    g_assert_cmpuint(fread(contents, 1, *size, file), ==, *size);
+    fclose(file);
+    return contents;
+}
+
+/*
+ * corrupt: Overwrite part of a saved pack, or truncate it to size bytes if value is NULL.
+ */
+static void corrupt(char const* path, long offset, void const* value, size_t size) {
+    if(value == NULL) {
+        g_assert_cmpint(truncate(path, offset), ==, 0);
+        return;
+    }
+    FILE *file = fopen(path, "r+b");
+    g_assert_nonnull(file);
+    fseek(file, offset, SEEK_SET);
+    fwrite(value, 1, size, file);
+    fclose(file);
+}
+
+void pack_setup(pfixture *pf, gconstpointer test_data) {
+    sprintf(pf->path, "/tmp/cnd_test_pack_%d.pack", (int) getpid());
+    pf->data = malloc(sizeof(t_game_data));
+    *pf->data = make_game_data(NULL);
+    pf->data->scr_width = 640;
+    pf->data->scr_height = 480;
+    memset(pf->rooms, 0, sizeof(pf->rooms));
+    for(int r = 0; r < 2; r++) {
+        pf->rooms[r].width = 1000 + r;
+        pf->rooms[r].height = 2000 + r;
+        pf->rooms[r].entity_ids = malloc(sizeof(int) * NUM_TEST_ENTITIES);
+        add_room(pf->data, &pf->rooms[r]);
+    }
+    pf->sprite = (t_sprite) { .num_imgs = 3, .width = 16, .height = 24 };
+    add_sprite(pf->data, &pf->sprite);
+    pf->sound = (t_sound) { .volume = -6, .snd_path = "sounds/jump.wav" };
+    add_sound(pf->data, &pf->sound);
+    memset(pf->entities, 0, sizeof(pf->entities));
+    for(int i = 0; i < NUM_TEST_ENTITIES; i++) {
+        pf->entities[i].x = 10 * i;
+        pf->entities[i].y = -20 * i;
+        pf->entities[i].depth = i % 2;
+        pf->entities[i].spr_period = i + 1;
+        pf->entities[i].spr_current_img = i % 3;
+        pf->entities[i].current_spr_id = pf->sprite.spr_id;
+        add_entity(pf->data, &pf->entities[i]);
+        // the first room gets the first two entities, the second the rest
+        t_room *room = &pf->rooms[i < 2 ? 0 : 1];
+        room->entity_ids[room->num_entities++] = pf->entities[i].id;
+    }
+    // removed elements leave gaps in the IDs, which are kept
+    del_entity(pf->data, pf->entities[1].id);
+    pf->rooms[0].num_entities = 1;
+    pf->data->current_room_id = pf->rooms[1].room_id;
+    g_assert_true(save_game_pack(pf->data, pf->path));
+}
+
+void pack_teardown(pfixture *pf, gconstpointer test_data) {
+    for(int r = 0; r < 2; r++)
+        free(pf->rooms[r].entity_ids);
+    gamedata_free(pf->data);
+    remove(pf->path);
+}
+
+
+void test_round_trip(pfixture *pf, gconstpointer test_data) {
+    t_game_data *data = load(pf->path);
+    g_assert_nonnull(data->pack);
+    g_assert_cmpint(data->scr_width, ==, 640);
+    g_assert_cmpint(data->scr_height, ==, 480);
+    g_assert_cmpint(data->current_room_id, ==, pf->rooms[1].room_id);
+    g_assert_cmpint(data->max_id, ==, pf->data->max_id);
+    g_assert_cmpint(data->num_rooms, ==, 2);
+    g_assert_cmpint(data->num_sprites, ==, 1);
+    g_assert_cmpint(data->num_sounds, ==, 1);
+    g_assert_cmpint(data->num_entities, ==, NUM_TEST_ENTITIES - 1);
+    for(int r = 0; r < 2; r++) {
+        t_room *room = get_room(data, pf->rooms[r].room_id);
+        g_assert_nonnull(room);
+        g_assert_cmpint(room->width, ==, pf->rooms[r].width);
+        g_assert_cmpint(room->height, ==, pf->rooms[r].height);
+        g_assert_cmpmem(room->entity_ids, sizeof(int) * room->num_entities,
+                        pf->rooms[r].entity_ids, sizeof(int) * pf->rooms[r].num_entities);
+    }
+    t_sprite *sprite = get_sprite(data, pf->sprite.spr_id);
+    g_assert_nonnull(sprite);
+    g_assert_cmpint(sprite->num_imgs, ==, 3);
+    g_assert_cmpint(sprite->width, ==, 16);
+    g_assert_cmpint(sprite->height, ==, 24);
+    t_sound *sound = get_sound(data, pf->sound.snd_id);
+    g_assert_nonnull(sound);
+    g_assert_cmpint(sound->volume, ==, -6);
+    g_assert_true(strcmp(sound->snd_path, "sounds/jump.wav") == 0);
+    // paths are used where the pack is mapped, not copied
+    g_assert_true((char *) sound->snd_path > (char *) data->pack->mapping
+                  && (char *) sound->snd_path < (char *) data->pack->mapping + data->pack->size);
+    g_assert_null(get_entity(data, pf->entities[1].id));
+    for(int i = 0; i < NUM_TEST_ENTITIES; i++) {
+        if(i == 1)
+            continue;
+        t_entity *entity = get_entity(data, pf->entities[i].id);
+        g_assert_nonnull(entity);
+        g_assert_cmpint(entity->x, ==, pf->entities[i].x);
+        g_assert_cmpint(entity->y, ==, pf->entities[i].y);
+        g_assert_cmpint(entity->depth, ==, pf->entities[i].depth);
+        g_assert_cmpint(entity->spr_period, ==, pf->entities[i].spr_period);
+        g_assert_cmpint(entity->spr_current_img, ==, pf->entities[i].spr_current_img);
+        g_assert_cmpint(entity->current_spr_id, ==, pf->sprite.spr_id);
+    }
+    // saving what was loaded gives the same pack
+    char again[300];
+    snprintf(again, sizeof(again), "%s.again", pf->path);
+    g_assert_true(save_game_pack(data, again));
+    size_t first_size, second_size;
+    char *first = read_file(pf->path, &first_size), *second = read_file(again, &second_size);
+    g_assert_cmpmem(first, first_size, second, second_size);
+    free(first);
+    free(second);
+    remove(again);
+    // elements added afterwards are never given an ID from the pack
+    t_entity added = {0};
+    add_entity(data, &added);
+    g_assert_cmpint(added.id, ==, pf->data->max_id + 1);
+    del_entity(data, added.id);
+    gamedata_free(data);
+}
+
+void test_invalid(pfixture *pf, gconstpointer test_data) {
+    struct pack_header header;
+    FILE *file = fopen(pf->path, "rb");
+    g_assert_cmpuint(fread(&header, sizeof(header), 1, file), ==, 1);
+    fclose(file);
+    g_assert_null(open_game_pack("/tmp/cnd_no_such_pack.pack"));
+    // broken packs are not loaded at all, leaving the game data empty
+    uint32_t version = PACK_VERSION + 1;
+    corrupt(pf->path, offsetof(struct pack_header, version), &version, sizeof(version));
+    t_game_data *data = load(pf->path);
+    g_assert_null(data->pack);
+    g_assert_cmpint(data->num_entities, ==, 0);
+    g_assert_cmpint(data->num_rooms, ==, 0);
+    gamedata_free(data);
+    corrupt(pf->path, 0, "CNDPAKC", 8);
+    g_assert_null(open_game_pack(pf->path));
+    corrupt(pf->path, 0, &header, sizeof(header));
+    g_assert_true(save_game_pack(pf->data, pf->path));
+    // an ID greater than the largest given out would clash with later elements
+    int32_t id = header.max_id + 1;
+    corrupt(pf->path, (long) header.entities_offset, &id, sizeof(id));
+    g_assert_null(open_game_pack(pf->path));
+    g_assert_true(save_game_pack(pf->data, pf->path));
+    uint32_t first_entity = header.num_room_entity_ids;
+    corrupt(pf->path, (long) header.rooms_offset + offsetof(struct pack_room, first_entity),
+            &first_entity, sizeof(first_entity));
+    g_assert_null(open_game_pack(pf->path));
+    g_assert_true(save_game_pack(pf->data, pf->path));
+    uint32_t path = header.strings_size;
+    corrupt(pf->path, (long) header.sounds_offset + offsetof(struct pack_sound, path), &path, sizeof(path));
+    g_assert_null(open_game_pack(pf->path));
+    g_assert_true(save_game_pack(pf->data, pf->path));
+    // adding a second room with the same ID would silently replace the first
+    int32_t first_room_id;
+    file = fopen(pf->path, "rb");
+    fseek(file, (long) header.rooms_offset, SEEK_SET);
+    g_assert_cmpuint(fread(&first_room_id, sizeof(first_room_id), 1, file), ==, 1);
+    fclose(file);
+    corrupt(pf->path, (long) header.rooms_offset + sizeof(struct pack_room), &first_room_id, sizeof(first_room_id));
+    g_assert_null(open_game_pack(pf->path));
+    g_assert_true(save_game_pack(pf->data, pf->path));
+    int32_t first_entity_id = pf->entities[0].id;
+    corrupt(pf->path, (long) header.entities_offset + sizeof(struct pack_entity), &first_entity_id,
+            sizeof(first_entity_id));
+    g_assert_null(open_game_pack(pf->path));
+    g_assert_true(save_game_pack(pf->data, pf->path));
+    corrupt(pf->path, (long) header.entities_offset + 8, NULL, 0);
+    g_assert_null(open_game_pack(pf->path));
+    corrupt(pf->path, sizeof(header) - 1, NULL, 0);
+    g_assert_null(open_game_pack(pf->path));
+}
+
+void test_render_loaded(pfixture *pf, gconstpointer test_data) {
+    t_game_data *data = load(pf->path);
+    t_sprite *sprite = get_sprite(data, pf->sprite.spr_id);
+    g_assert_nonnull(sprite->texture);
+    for(int i = 0; i < sprite->num_imgs; i++)
+        g_assert_cmpuint(sprite->texture[i], ==, 0);
+    software_renderer *renderer = make_software_renderer(0);
+    set_renderer(data, &renderer->backend);
+    data->camera_x = -100;
+    data->camera_y = -200;
+    publish_game_snapshot(data);
+    render_queue queue = make_render_queue(0);
+    render_frame(data, snapshot_acquire(&data->snapshots), &queue);
+    // every entity of the current room is queued, but packs hold no pixels, so nothing is drawn
+    g_assert_cmpint(queue.num_images, ==, 3);
+    g_assert_cmpint(renderer->frame_images, ==, 0);
+    // sprites without any textures at all are not queued
+    sprite->texture = NULL;
+    render_frame(data, snapshot_acquire(&data->snapshots), &queue);
+    g_assert_cmpint(queue.num_images, ==, 0);
+    render_queue_free(&queue);
+    gamedata_free(data);
+}
+
+void test_alter_loaded_room(pfixture *pf, gconstpointer test_data) {
+    t_game_data *data = load(pf->path);
+    t_room *room = get_room(data, pf->rooms[1].room_id);
+    g_assert_cmpint(room->num_entities, ==, 3);
+    // loaded rooms own their entity IDs, so can be given new ones like any other room
+    int *entity_ids = malloc(sizeof(int));
+    entity_ids[0] = pf->entities[0].id;
+    cmd_alter_room(data, (struct alter_room_command) {
+            .target_id = room->room_id, .modified_attr = ENTITIES, .entity_ids = entity_ids, .num_entities = 1
+    });
+    g_assert_true(room->entity_ids == entity_ids);
+    cmd_alter_room(data, (struct alter_room_command) {
+            .target_id = room->room_id, .modified_attr = WIDTH, .int_value = 50
+    });
+    g_assert_cmpint(room->width, ==, 50);
+    gamedata_free(data);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/pack/round_trip", pfixture, NULL, pack_setup, test_round_trip, pack_teardown);
+    g_test_add("/pack/invalid", pfixture, NULL, pack_setup, test_invalid, pack_teardown);
+    g_test_add("/pack/render_loaded", pfixture, NULL, pack_setup, test_render_loaded, pack_teardown);
+    g_test_add("/pack/alter_loaded_room", pfixture, NULL, pack_setup, test_alter_loaded_room, pack_teardown);
+    return g_test_run();
+}
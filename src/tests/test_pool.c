@@ -0,0 +1,169 @@
+/*
+ * File: test_pool.c
+ *
+ * Testing suite for object pools, and the element constructors that allocate from them.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#define NUM_TEST_SLOTS (POOL_SLAB_SLOTS + 1)    // just over one slab
+
+
+static void *free_all(void *arg) {
+    void **slots = arg;
+    for(int i = 0; i < NUM_TEST_SLOTS; i++)
+        pool_free(slots[i]);
+    return NULL;
+}
+
+
+void test_reuse(void) {
+    pool_stats before = get_pool_stats(ROOM_POOL);
+    void *slot = pool_alloc(ROOM_POOL);
+    g_assert_cmpint((uintptr_t) slot % _Alignof(max_align_t), ==, 0);
+    g_assert_cmpint(get_pool_stats(ROOM_POOL).in_use, ==, before.in_use + 1);
+    pool_free(slot);
+    // freed slots are handed out again first
+    g_assert_true(pool_alloc(ROOM_POOL) == slot);
+    pool_free(slot);
+    pool_stats after = get_pool_stats(ROOM_POOL);
+    g_assert_cmpint(after.in_use, ==, before.in_use);
+    g_assert_cmpint(after.allocs, ==, before.allocs + 2);
+}
+
+void test_slabs(void) {
+    void **slots = malloc(sizeof(void *) * NUM_TEST_SLOTS);
+    pool_stats before = get_pool_stats(SOUND_POOL);
+    for(int i = 0; i < NUM_TEST_SLOTS; i++) {
+        slots[i] = pool_alloc(SOUND_POOL);
+        memset(slots[i], 0xAB, sizeof(t_sound));
+    }
+    pool_stats full = get_pool_stats(SOUND_POOL);
+    g_assert_cmpint(full.in_use, ==, before.in_use + NUM_TEST_SLOTS);
+    g_assert_cmpint(full.slabs, >=, before.slabs + 1);
+    g_assert_cmpint(full.slabs, <=, before.slabs + 2);
+    for(int i = 0; i < NUM_TEST_SLOTS; i++)
+        pool_free(slots[i]);
+    // churn reuses the same slabs
+    for(int i = 0; i < NUM_TEST_SLOTS; i++)
+        slots[i] = pool_alloc(SOUND_POOL);
+    for(int i = 0; i < NUM_TEST_SLOTS; i++)
+        pool_free(slots[i]);
+    g_assert_cmpint(get_pool_stats(SOUND_POOL).slabs, ==, full.slabs);
+    g_assert_cmpint(get_pool_stats(SOUND_POOL).in_use, ==, before.in_use);
+    free(slots);
+}
+
+void test_other_thread_frees(void) {
+    void **slots = malloc(sizeof(void *) * NUM_TEST_SLOTS);
+    for(int i = 0; i < NUM_TEST_SLOTS; i++)
+        slots[i] = pool_alloc(SPRITE_POOL);
+    pool_stats full = get_pool_stats(SPRITE_POOL);
+    pthread_t thread;
+    pthread_create(&thread, NULL, free_all, slots);
+    pthread_join(thread, NULL);
+    g_assert_cmpint(get_pool_stats(SPRITE_POOL).in_use, ==, full.in_use - NUM_TEST_SLOTS);
+    // given back to this thread, so taken again without carving more slabs
+    for(int i = 0; i < NUM_TEST_SLOTS; i++)
+        slots[i] = pool_alloc(SPRITE_POOL);
+    g_assert_cmpint(get_pool_stats(SPRITE_POOL).slabs, ==, full.slabs);
+    for(int i = 0; i < NUM_TEST_SLOTS; i++)
+        pool_free(slots[i]);
+    free(slots);
+}
+
+void test_entity_pool_for(void) {
+    g_assert_cmpint(entity_pool_for(0), ==, ENTITY_POOL);
+    g_assert_cmpint(entity_pool_for(1), ==, ENTITY_POOL_16);
+    g_assert_cmpint(entity_pool_for(16), ==, ENTITY_POOL_16);
+    g_assert_cmpint(entity_pool_for(17), ==, ENTITY_POOL_32);
+    g_assert_cmpint(entity_pool_for(100), ==, ENTITY_POOL_128);
+    g_assert_cmpint(entity_pool_for(POOL_MAX_ENT_DATA), ==, ENTITY_POOL_256);
+    g_assert_cmpint(entity_pool_for(POOL_MAX_ENT_DATA + 1), ==, NUM_POOLS);
+}
+
+void test_make_entity(void) {
+    int *ent_data = malloc(sizeof(int));
+    t_entity *entity = make_entity(3, 10, 20, ent_data);
+    g_assert_true(entity->pooled);
+    g_assert_cmpint(entity->id, ==, 0);
+    g_assert_null(entity->event_handlers.step);
+    g_assert_cmpint(entity->current_spr_id, ==, 3);
+    g_assert_cmpint(entity->spr_period, ==, -1);
+    g_assert_cmpint(entity->x, ==, 10);
+    g_assert_cmpint(entity->y, ==, 20);
+    g_assert_cmpint(entity->room_id, ==, 0);
+    g_assert_true(entity->ent_data == ent_data);
+    free_entity(entity);
+}
+
+void test_make_entity_with_data(void) {
+    pool_stats before = get_pool_stats(ENTITY_POOL_64);
+    t_entity *entity = make_entity_with_data(0, 1, 2, 40);
+    g_assert_true(entity->ent_data == entity_inline_data(entity));
+    unsigned char zeroes[40] = { 0 };
+    g_assert_cmpmem(entity->ent_data, 40, zeroes, 40);
+    memset(entity->ent_data, 0xFF, 40);
+    g_assert_cmpint(get_pool_stats(ENTITY_POOL_64).in_use, ==, before.in_use + 1);
+    free_entity(entity);
+    g_assert_cmpint(get_pool_stats(ENTITY_POOL_64).in_use, ==, before.in_use);
+
+    // too large to keep inline
+    t_entity *large = make_entity_with_data(0, 1, 2, POOL_MAX_ENT_DATA * 4);
+    g_assert_false(large->ent_data == entity_inline_data(large));
+    ((char *) large->ent_data)[POOL_MAX_ENT_DATA * 4 - 1] = 1;
+    free_entity(large);
+
+    t_entity *no_data = make_entity_with_data(0, 1, 2, 0);
+    g_assert_null(no_data->ent_data);
+    free_entity(no_data);
+
+    // entities not made by make_entity are still freed with free
+    t_entity *unpooled = calloc(1, sizeof(t_entity));
+    unpooled->ent_data = malloc(8);
+    free_entity(unpooled);
+}
+
+void test_make_elements(void) {
+    t_room *room = make_room(malloc(sizeof(int) * 4), 4, 100, 200);
+    g_assert_cmpint(room->num_entities, ==, 4);
+    g_assert_cmpint(room->entity_capacity, ==, 0);
+    g_assert_null(room->grid);
+    free_room(room);
+
+    t_sprite *sprite = make_sprite(2, 8, 8, calloc(2, sizeof(GLuint)));
+    g_assert_cmpint(sprite->num_imgs, ==, 2);
+    g_assert_null(sprite->masks);
+    g_assert_true(asset_ready(sprite));
+    free_sprite(sprite);
+
+    char *path = malloc(16);
+    strcpy(path, "sound.wav");
+    t_sound *sound = make_sound(path, 5);
+    g_assert_cmpint(sound->volume, ==, 5);
+    g_assert_null(sound->samples);
+    g_assert_true(asset_ready(sound));
+    free_sound(sound);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/pool/reuse", test_reuse);
+    g_test_add_func("/pool/slabs", test_slabs);
+    g_test_add_func("/pool/other_thread_frees", test_other_thread_frees);
+    g_test_add_func("/pool/entity_pool_for", test_entity_pool_for);
+    g_test_add_func("/pool/make_entity", test_make_entity);
+    g_test_add_func("/pool/make_entity_with_data", test_make_entity_with_data);
+    g_test_add_func("/pool/make_elements", test_make_elements);
+    return g_test_run();
+}
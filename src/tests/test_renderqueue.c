@@ -0,0 +1,80 @@
+/*
+ * File: test_renderqueue.c
+ *
+ * Testing suite for render queues.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_TEST_IMAGES 5000
+
+
+typedef struct {
+    render_queue queue;
+} rfixture;
+
+
+void queue_setup(rfixture *rf, gconstpointer test_data) {
+    rf->queue = make_render_queue(0);
+}
+
+void queue_teardown(rfixture *rf, gconstpointer test_data) {
+    render_queue_free(&rf->queue);
+}
+
+
+void test_sorted_by_depth_then_texture(rfixture *rf, gconstpointer test_data) {
+    srand(1);
+    for(int i = 0; i < NUM_TEST_IMAGES; i++)
+        render_queue_push(&rf->queue, i, 0, 0, 0, rand() % 2001 - 1000, rand() % 70000);
+    render_queue_sort(&rf->queue);
+    g_assert_cmpint(rf->queue.num_images, ==, NUM_TEST_IMAGES);
+    for(int i = 1; i < NUM_TEST_IMAGES; i++) {
+        queued_image *prev = &rf->queue.images[i - 1], *image = &rf->queue.images[i];
+        g_assert_cmpint(prev->depth, <=, image->depth);
+        if(prev->depth == image->depth)
+            g_assert_cmpuint(prev->texture, <=, image->texture);
+    }
+}
+
+void test_stable(rfixture *rf, gconstpointer test_data) {
+    // images with equal depth and texture must stay in the order they were queued in
+    for(int i = 0; i < NUM_TEST_IMAGES; i++)
+        render_queue_push(&rf->queue, i, 0, 0, 0, i % 3, 7 + i % 2);
+    render_queue_sort(&rf->queue);
+    for(int i = 1; i < NUM_TEST_IMAGES; i++) {
+        queued_image *prev = &rf->queue.images[i - 1], *image = &rf->queue.images[i];
+        if(prev->depth == image->depth && prev->texture == image->texture)
+            g_assert_cmpint(prev->spr_id, <, image->spr_id);
+    }
+    g_assert_cmpint(render_queue_num_batches(&rf->queue), ==, 6);
+}
+
+void test_reuse(rfixture *rf, gconstpointer test_data) {
+    for(int frame = 0; frame < 3; frame++) {
+        render_queue_clear(&rf->queue);
+        for(int i = 0; i < 100; i++)
+            render_queue_push(&rf->queue, i, frame, i, -i, -i, 1);
+        render_queue_sort(&rf->queue);
+        g_assert_cmpint(rf->queue.num_images, ==, 100);
+        g_assert_cmpint(rf->queue.images[0].depth, ==, -99);
+        g_assert_cmpint(rf->queue.images[0].x, ==, 99);
+        g_assert_cmpint(rf->queue.images[99].subimg, ==, frame);
+        g_assert_cmpint(render_queue_num_batches(&rf->queue), ==, 1);
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/renderqueue/sorted_by_depth_then_texture", rfixture, NULL, queue_setup, test_sorted_by_depth_then_texture, queue_teardown);
+    g_test_add("/renderqueue/stable", rfixture, NULL, queue_setup, test_stable, queue_teardown);
+    g_test_add("/renderqueue/reuse", rfixture, NULL, queue_setup, test_reuse, queue_teardown);
+    return g_test_run();
+}
@@ -0,0 +1,92 @@
+/*
+ * File: test_ring.c
+ *
+ * Testing suite for the single producer, single consumer ring.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnd_ring.h"
+#include <glib.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#define NUM_TEST_ELEMS 200000
+
+
+void test_capacity() {
+    spsc_ring ring;
+    init_spsc_ring(&ring, 100, sizeof(int));
+    g_assert_cmpuint(ring.capacity, ==, 128);
+    g_assert_cmpuint(spsc_ring_space(&ring), ==, 128);
+    int elems[200];
+    for(int i = 0; i < 200; i++)
+        elems[i] = i;
+    // only as many as fit are written
+    g_assert_cmpuint(spsc_ring_write(&ring, elems, 200), ==, 128);
+    g_assert_cmpuint(spsc_ring_count(&ring), ==, 128);
+    g_assert_cmpuint(spsc_ring_write(&ring, elems, 1), ==, 0);
+    spsc_ring_clear(&ring);
+    g_assert_cmpuint(spsc_ring_count(&ring), ==, 0);
+    spsc_ring_free(&ring);
+}
+
+void test_wraparound() {
+    spsc_ring ring;
+    init_spsc_ring(&ring, 16, sizeof(int));
+    int next_write = 0, next_read = 0;
+    int elems[16];
+    // odd sized writes and reads, so spans split across the end of the buffer
+    for(int round = 0; round < 100; round++) {
+        int count = 1 + round % 11;
+        for(int i = 0; i < count; i++)
+            elems[i] = next_write + i;
+        next_write += spsc_ring_write(&ring, elems, count);
+        unsigned read = spsc_ring_read(&ring, elems, 1 + round % 7);
+        for(unsigned i = 0; i < read; i++)
+            g_assert_cmpint(elems[i], ==, next_read++);
+        g_assert_cmpuint(spsc_ring_count(&ring), ==, next_write - next_read);
+    }
+    spsc_ring_free(&ring);
+}
+
+static void *produce(void *arg) {
+    spsc_ring *ring = arg;
+    long elems[32];
+    long next = 0;
+    while(next < NUM_TEST_ELEMS) {
+        int count = 1 + next % 32;
+        for(int i = 0; i < count; i++)
+            elems[i] = next + i;
+        next += spsc_ring_write(ring, elems, (next + count > NUM_TEST_ELEMS) ? NUM_TEST_ELEMS - next : count);
+    }
+    return NULL;
+}
+
+void test_threads() {
+    spsc_ring ring;
+    init_spsc_ring(&ring, 64, sizeof(long));
+    pthread_t producer;
+    pthread_create(&producer, NULL, produce, &ring);
+    long elems[32];
+    long next = 0;
+    // every element arrives once, in order
+    while(next < NUM_TEST_ELEMS) {
+        unsigned read = spsc_ring_read(&ring, elems, 1 + next % 29);
+        for(unsigned i = 0; i < read; i++)
+            g_assert_cmpint(elems[i], ==, next++);
+    }
+    pthread_join(producer, NULL);
+    g_assert_cmpuint(spsc_ring_count(&ring), ==, 0);
+    spsc_ring_free(&ring);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/ring/capacity", test_capacity);
+    g_test_add_func("/ring/wraparound", test_wraparound);
+    g_test_add_func("/ring/threads", test_threads);
+    return g_test_run();
+}
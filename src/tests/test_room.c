@@ -0,0 +1,192 @@
+/*
+ * File: test_room.c
+ *
+ * Testing suite for room membership: adding entities to rooms, and removing them through the index.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_TEST_ENTS 100   // the first half in the indexed room, the rest written into the other directly
+#define ROOM_SIZE 1000
+#define CELL_SIZE 100
+
+
+typedef struct {
+    t_game_data *data;
+    t_room indexed;     // filled with add_room_entity
+    t_room written;     // filled by writing IDs into its array, so not indexed
+    t_entity *ents;
+} rfixture;
+
+
+static bool room_has(t_room const* room, int id) {
+    for(int i = 0; i < room->num_entities; i++) {
+        if(room->entity_ids[i] == id)
+            return true;
+    }
+    return false;
+}
+
+// every indexed entity must be where its index says
+static void assert_indexed(t_game_data *data, t_room const* room) {
+    for(int i = 0; i < room->num_entities; i++) {
+        t_entity const* entity = get_entity(data, room->entity_ids[i]);
+        g_assert_cmpint(entity->room_id, ==, room->room_id);
+        g_assert_cmpint(entity->room_slot, ==, i);
+    }
+}
+
+static t_update_command *rem_command(int id) {
+    t_update_command *command = calloc(1, sizeof(t_update_command));
+    command->type = REM_ENTITY;
+    command->data.rem_ent.ent_id = id;
+    return command;
+}
+
+void room_setup(rfixture *rf, gconstpointer test_data) {
+    rf->data = malloc(sizeof(t_game_data));
+    *rf->data = make_game_data(NULL);
+    rf->indexed = (t_room) { .width = ROOM_SIZE, .height = ROOM_SIZE };
+    rf->written = (t_room) { .width = ROOM_SIZE, .height = ROOM_SIZE };
+    rf->written.entity_ids = malloc(sizeof(int) * NUM_TEST_ENTS);
+    add_room(rf->data, &rf->indexed);
+    add_room(rf->data, &rf->written);
+    rf->data->current_room_id = rf->indexed.room_id;
+    enable_room_grid(rf->data, &rf->indexed, CELL_SIZE);
+    rf->ents = calloc(NUM_TEST_ENTS, sizeof(t_entity));
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        rf->ents[i].x = i * 10;
+        rf->ents[i].y = i * 10;
+        add_entity(rf->data, &rf->ents[i]);
+        if(i < NUM_TEST_ENTS / 2)
+            add_room_entity(rf->data, &rf->indexed, rf->ents[i].id);
+        else
+            rf->written.entity_ids[rf->written.num_entities++] = rf->ents[i].id;
+    }
+}
+
+void room_teardown(rfixture *rf, gconstpointer test_data) {
+    free(rf->indexed.entity_ids);
+    spatial_grid_free(rf->indexed.grid);
+    free(rf->written.entity_ids);
+    free(rf->ents);
+    gamedata_free(rf->data);
+    arena_reset(frame_arena_local());
+}
+
+
+void test_add_indexed(rfixture *rf, gconstpointer test_data) {
+    g_assert_cmpint(rf->indexed.num_entities, ==, NUM_TEST_ENTS / 2);
+    g_assert_cmpint(rf->indexed.entity_capacity, >=, rf->indexed.num_entities);
+    assert_indexed(rf->data, &rf->indexed);
+    g_assert_true(spatial_grid_contains(rf->indexed.grid, rf->ents[0].id));
+    // not known to be in a room until it is searched for
+    g_assert_cmpint(rf->ents[NUM_TEST_ENTS - 1].room_id, ==, 0);
+}
+
+void test_rem_swaps_last(rfixture *rf, gconstpointer test_data) {
+    int id = rf->ents[3].id;
+    int last = rf->indexed.entity_ids[rf->indexed.num_entities - 1];
+    cmd_rem_entity(rf->data, (struct rem_entity_command) { .ent_id = id });
+    g_assert_cmpint(rf->indexed.num_entities, ==, NUM_TEST_ENTS / 2 - 1);
+    g_assert_null(get_entity(rf->data, id));
+    g_assert_false(room_has(&rf->indexed, id));
+    g_assert_false(spatial_grid_contains(rf->indexed.grid, id));
+    g_assert_cmpint(rf->indexed.entity_ids[3], ==, last);
+    assert_indexed(rf->data, &rf->indexed);
+    // other rooms untouched
+    g_assert_cmpint(rf->written.num_entities, ==, NUM_TEST_ENTS / 2);
+}
+
+void test_rem_unindexed(rfixture *rf, gconstpointer test_data) {
+    int id = rf->ents[NUM_TEST_ENTS / 2 + 5].id;
+    cmd_rem_entity(rf->data, (struct rem_entity_command) { .ent_id = id });
+    g_assert_cmpint(rf->written.num_entities, ==, NUM_TEST_ENTS / 2 - 1);
+    g_assert_false(room_has(&rf->written, id));
+    g_assert_cmpint(rf->indexed.num_entities, ==, NUM_TEST_ENTS / 2);
+}
+
+void test_rem_stale_index(rfixture *rf, gconstpointer test_data) {
+    // reorder the indexed room behind the index's back
+    int first = rf->indexed.entity_ids[0];
+    rf->indexed.entity_ids[0] = rf->indexed.entity_ids[1];
+    rf->indexed.entity_ids[1] = first;
+    cmd_rem_entity(rf->data, (struct rem_entity_command) { .ent_id = first });
+    g_assert_false(room_has(&rf->indexed, first));
+    g_assert_cmpint(rf->indexed.num_entities, ==, NUM_TEST_ENTS / 2 - 1);
+}
+
+void test_rem_batch(rfixture *rf, gconstpointer test_data) {
+    // every other entity of both rooms, in one run as scheduled by the optimiser
+    int num_commands = NUM_TEST_ENTS / 2;
+    t_update_command **commands = malloc(sizeof(t_update_command *) * num_commands);
+    for(int i = 0; i < num_commands; i++)
+        commands[i] = rem_command(rf->ents[2 * i].id);
+    g_assert_false(dispatch_commands(rf->data, NULL, commands, num_commands));
+    g_assert_cmpint(rf->indexed.num_entities, ==, NUM_TEST_ENTS / 4);
+    g_assert_cmpint(rf->written.num_entities, ==, NUM_TEST_ENTS / 4);
+    g_assert_cmpint(rf->data->num_entities, ==, NUM_TEST_ENTS / 2);
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        bool kept = i % 2 == 1;
+        g_assert_true((get_entity(rf->data, rf->ents[i].id) != NULL) == kept);
+        g_assert_true(room_has(i < NUM_TEST_ENTS / 2 ? &rf->indexed : &rf->written, rf->ents[i].id) == kept);
+    }
+    assert_indexed(rf->data, &rf->indexed);
+    // searched for entities are indexed where they were moved to
+    assert_indexed(rf->data, &rf->written);
+    for(int i = 0; i < num_commands; i++)
+        free(commands[i]);
+    free(commands);
+}
+
+void test_add_to_room(rfixture *rf, gconstpointer test_data) {
+    t_entity entity = { .x = 500, .y = 500 };
+    cmd_add_entity(rf->data, (struct add_entity_command) { .new_entity = &entity, .room_id = rf->indexed.room_id });
+    g_assert_cmpint(rf->indexed.num_entities, ==, NUM_TEST_ENTS / 2 + 1);
+    g_assert_cmpint(rf->indexed.entity_ids[NUM_TEST_ENTS / 2], ==, entity.id);
+    g_assert_true(spatial_grid_contains(rf->indexed.grid, entity.id));
+    assert_indexed(rf->data, &rf->indexed);
+    cmd_rem_entity(rf->data, (struct rem_entity_command) { .ent_id = entity.id });
+    g_assert_false(room_has(&rf->indexed, entity.id));
+
+    // no room given
+    t_entity roomless = {0};
+    cmd_add_entity(rf->data, (struct add_entity_command) { .new_entity = &roomless });
+    g_assert_cmpint(roomless.room_id, ==, 0);
+    g_assert_cmpint(rf->indexed.num_entities + rf->written.num_entities, ==, NUM_TEST_ENTS);
+}
+
+void test_alter_reindexes(rfixture *rf, gconstpointer test_data) {
+    // swap the rooms' entities over
+    int *entity_ids = malloc(sizeof(int) * NUM_TEST_ENTS / 2);
+    for(int i = 0; i < NUM_TEST_ENTS / 2; i++)
+        entity_ids[i] = rf->ents[NUM_TEST_ENTS / 2 + i].id;
+    struct alter_room_command cmd = { .target_id = rf->indexed.room_id, .modified_attr = ENTITIES,
+                                      .entity_ids = entity_ids, .num_entities = NUM_TEST_ENTS / 2 };
+    cmd_alter_room(rf->data, cmd);
+    g_assert_cmpint(rf->indexed.entity_capacity, ==, 0);
+    assert_indexed(rf->data, &rf->indexed);
+    int id = entity_ids[7];
+    cmd_rem_entity(rf->data, (struct rem_entity_command) { .ent_id = id });
+    g_assert_false(room_has(&rf->indexed, id));
+    g_assert_cmpint(rf->indexed.num_entities, ==, NUM_TEST_ENTS / 2 - 1);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/room/add_indexed", rfixture, NULL, room_setup, test_add_indexed, room_teardown);
+    g_test_add("/room/rem_swaps_last", rfixture, NULL, room_setup, test_rem_swaps_last, room_teardown);
+    g_test_add("/room/rem_unindexed", rfixture, NULL, room_setup, test_rem_unindexed, room_teardown);
+    g_test_add("/room/rem_stale_index", rfixture, NULL, room_setup, test_rem_stale_index, room_teardown);
+    g_test_add("/room/rem_batch", rfixture, NULL, room_setup, test_rem_batch, room_teardown);
+    g_test_add("/room/add_to_room", rfixture, NULL, room_setup, test_add_to_room, room_teardown);
+    g_test_add("/room/alter_reindexes", rfixture, NULL, room_setup, test_alter_reindexes, room_teardown);
+    return g_test_run();
+}
@@ -0,0 +1,112 @@
+/*
+ * File: test_scheduler.c
+ *
+ * Testing suite for the fixed timestep tick scheduler.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TEST_TICK_RATE 200
+#define TEST_TICKS 40
+
+
+static long long elapsed_ns(struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000000LL + (now.tv_nsec - start->tv_nsec);
+}
+
+static void busy_for(long long ns) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while(elapsed_ns(&start) < ns);
+}
+
+
+void test_fixed_rate() {
+    tick_scheduler scheduler;
+    init_tick_scheduler(&scheduler, TEST_TICK_RATE, DEFAULT_MAX_STEPS);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int ticks = 0;
+    while(ticks < TEST_TICKS) {
+        int steps = scheduler_wait(&scheduler);
+        g_assert_cmpint(steps, >=, 1);
+        g_assert_cmpint(steps, <=, DEFAULT_MAX_STEPS);
+        double alpha = scheduler_alpha(&scheduler);
+        g_assert_cmpfloat(alpha, >=, 0.0);
+        g_assert_cmpfloat(alpha, <, 1.0);
+        ticks += steps;
+    }
+    // first tick is immediate, so the rest should take (TEST_TICKS - 1) tick lengths
+    long long expected = (TEST_TICKS - 1) * (1000000000LL / TEST_TICK_RATE);
+    g_assert_cmpint(elapsed_ns(&start), >=, expected);
+    scheduler_stats stats = scheduler_get_stats(&scheduler);
+    g_assert_cmpint(stats.num_ticks, ==, ticks);
+    g_assert_cmpint(stats.num_dropped, ==, 0);
+    g_assert_cmpint(stats.idle_ns, >, 0);
+}
+
+void test_alpha() {
+    tick_scheduler scheduler;
+    init_tick_scheduler(&scheduler, TEST_TICK_RATE, DEFAULT_MAX_STEPS);
+    // nothing to interpolate before the first tick
+    g_assert_cmpfloat(scheduler_alpha(&scheduler), ==, 1.0);
+    scheduler_wait(&scheduler);
+    scheduler_wait(&scheduler);
+    double start = scheduler_alpha(&scheduler);
+    g_assert_cmpfloat(start, <, 1.0);
+    // grows while the render loop waits for the next tick, without the update loop waking
+    busy_for(1000000000LL / TEST_TICK_RATE / 2);
+    double half = scheduler_alpha(&scheduler);
+    g_assert_cmpfloat(half, >=, 0.5);
+    g_assert_cmpfloat(half, >, start);
+    // and stops at the next tick while the update loop is late for it
+    busy_for(1000000000LL / TEST_TICK_RATE);
+    g_assert_cmpfloat(scheduler_alpha(&scheduler), ==, 1.0);
+    scheduler_wait(&scheduler);
+    g_assert_cmpfloat(scheduler_alpha(&scheduler), <, 1.0);
+}
+
+void test_catch_up() {
+    tick_scheduler scheduler;
+    init_tick_scheduler(&scheduler, TEST_TICK_RATE, DEFAULT_MAX_STEPS);
+    g_assert_cmpint(scheduler_wait(&scheduler), ==, 1);
+    // an update taking three and a half ticks should be caught up on next wait, without sleeping
+    busy_for(7 * 1000000000LL / TEST_TICK_RATE / 2);
+    g_assert_cmpint(scheduler_wait(&scheduler), ==, 3);
+    g_assert_cmpfloat(scheduler_alpha(&scheduler), >=, 0.5);
+    scheduler_stats stats = scheduler_get_stats(&scheduler);
+    g_assert_cmpint(stats.num_overruns, ==, 1);
+    g_assert_cmpint(stats.num_dropped, ==, 0);
+}
+
+void test_max_steps() {
+    tick_scheduler scheduler;
+    init_tick_scheduler(&scheduler, TEST_TICK_RATE, 2);
+    scheduler_wait(&scheduler);
+    busy_for(10 * 1000000000LL / TEST_TICK_RATE);
+    g_assert_cmpint(scheduler_wait(&scheduler), ==, 2);
+    scheduler_stats stats = scheduler_get_stats(&scheduler);
+    g_assert_cmpint(stats.num_dropped, >=, 8);
+    // dropped ticks are gone, so the next one is less than a tick away
+    g_assert_cmpfloat(scheduler_alpha(&scheduler), <, 1.0);
+    g_assert_cmpint(scheduler_wait(&scheduler), ==, 1);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/scheduler/fixed_rate", test_fixed_rate);
+    g_test_add_func("/scheduler/alpha", test_alpha);
+    g_test_add_func("/scheduler/catch_up", test_catch_up);
+    g_test_add_func("/scheduler/max_steps", test_max_steps);
+    return g_test_run();
+}
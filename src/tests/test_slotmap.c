@@ -0,0 +1,85 @@
+/*
+ * File: test_slotmap.c
+ *
+ * Testing suite for slotmaps.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_TEST_ENTS 1000
+
+
+typedef struct {
+    slotmap map;
+    t_entity ents[NUM_TEST_ENTS];
+} sfixture;
+
+
+void map_setup(sfixture *sf, gconstpointer test_data) {
+    sf->map = make_slotmap(0);
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        sf->ents[i].id = i + 1;
+        slotmap_add(&sf->map, sf->ents[i].id, (void *) &sf->ents[i]);
+    }
+}
+
+void map_teardown(sfixture *sf, gconstpointer test_data) {
+    slotmap_free(&sf->map);
+}
+
+
+void test_get(sfixture *sf, gconstpointer test_data) {
+    for(int i = 0; i < NUM_TEST_ENTS; i++)
+        g_assert_true(slotmap_get(&sf->map, i + 1) == &sf->ents[i]);
+    g_assert_null(slotmap_get(&sf->map, 0));
+    g_assert_null(slotmap_get(&sf->map, -5));
+    g_assert_null(slotmap_get(&sf->map, NUM_TEST_ENTS * 100));
+}
+
+void test_del_keeps_dense(sfixture *sf, gconstpointer test_data) {
+    for(int i = 1; i <= NUM_TEST_ENTS; i += 3)
+        slotmap_del(&sf->map, i);
+    int num = slotmap_get_num_entries(&sf->map);
+    int *ids = slotmap_get_ids(&sf->map);
+    t_entity **elems = (t_entity **) slotmap_get_elems(&sf->map);
+    for(int i = 0; i < num; i++) {
+        g_assert_cmpint(ids[i] % 3, !=, 1);
+        g_assert_cmpint(elems[i]->id, ==, ids[i]);
+        g_assert_cmpint(slotmap_index(&sf->map, ids[i]), ==, i);
+    }
+    for(int i = 1; i <= NUM_TEST_ENTS; i += 3)
+        g_assert_false(slotmap_contains(&sf->map, i));
+}
+
+void test_add_range(sfixture *sf, gconstpointer test_data) {
+    t_entity *range = calloc(NUM_TEST_ENTS, sizeof(t_entity));
+    void **elems = malloc(sizeof(void *) * NUM_TEST_ENTS);
+    for(int i = 0; i < NUM_TEST_ENTS; i++)
+        elems[i] = &range[i];
+    slotmap_add_range(&sf->map, NUM_TEST_ENTS + 1, NUM_TEST_ENTS, elems);
+    g_assert_cmpint(slotmap_get_num_entries(&sf->map), ==, 2 * NUM_TEST_ENTS);
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        g_assert_true(slotmap_get(&sf->map, NUM_TEST_ENTS + 1 + i) == &range[i]);
+        g_assert_cmpint(slotmap_index(&sf->map, NUM_TEST_ENTS + 1 + i), ==, NUM_TEST_ENTS + i);
+    }
+    g_assert_true(slotmap_get(&sf->map, 1) == &sf->ents[0]);
+    slotmap_del(&sf->map, NUM_TEST_ENTS + 1);
+    g_assert_null(slotmap_get(&sf->map, NUM_TEST_ENTS + 1));
+    free(elems);
+    free(range);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/slotmap/get", sfixture, NULL, map_setup, test_get, map_teardown);
+    g_test_add("/slotmap/del_keeps_dense", sfixture, NULL, map_setup, test_del_keeps_dense, map_teardown);
+    g_test_add("/slotmap/add_range", sfixture, NULL, map_setup, test_add_range, map_teardown);
+    return g_test_run();
+}
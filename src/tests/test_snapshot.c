@@ -0,0 +1,167 @@
+/*
+ * File: test_snapshot.c
+ *
+ * Testing suite for game state snapshots, read while the update loop runs.
+ * Build with -fsanitize=thread to check that the loops do not race.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define NUM_TEST_ENTS 500
+#define TEST_TICKS 400
+#define TEST_TICK_RATE 2000
+
+
+typedef struct {
+    t_game_data *data;
+    t_room room;
+    t_entity *ents;
+    atomic_bool update_done;
+} sfixture;
+
+
+// moves right one pixel per tick, and the first entity ends the game after TEST_TICKS ticks
+static t_update_command_container step_right(t_game_data const* data, t_entity const* entity) {
+    t_update_command_container commands = make_update_command_container();
+    t_update_command *command = push_command(&commands, ALTER_ENTITY);
+    command->data.alter_ent.target_id = entity->id;
+    command->data.alter_ent.modified_attr = X;
+    command->data.alter_ent.int_value = entity->x + 1;
+    if(entity->x + 1 >= TEST_TICKS && entity->y == 0)
+        push_command(&commands, QUIT);
+    return commands;
+}
+
+static void *run_update(void *arg) {
+    sfixture *sf = arg;
+    loop_update(sf->data);
+    atomic_store(&sf->update_done, true);
+    return NULL;
+}
+
+void snap_setup(sfixture *sf, gconstpointer test_data) {
+    sf->data = malloc(sizeof(t_game_data));
+    *sf->data = make_game_data(NULL);
+    sf->data->num_workers = 2;
+    init_tick_scheduler(&sf->data->scheduler, TEST_TICK_RATE, DEFAULT_MAX_STEPS);
+    sf->ents = calloc(NUM_TEST_ENTS, sizeof(t_entity));
+    sf->room.entity_ids = malloc(sizeof(int) * NUM_TEST_ENTS);
+    sf->room.num_entities = NUM_TEST_ENTS;
+    add_room(sf->data, &sf->room);
+    sf->data->current_room_id = sf->room.room_id;
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        sf->ents[i].y = i;
+        sf->ents[i].event_handlers.step = step_right;
+        add_entity(sf->data, &sf->ents[i]);
+        sf->room.entity_ids[i] = sf->ents[i].id;
+    }
+    atomic_init(&sf->update_done, false);
+}
+
+void snap_teardown(sfixture *sf, gconstpointer test_data) {
+    free(sf->room.entity_ids);
+    free(sf->ents);
+    gamedata_free(sf->data);
+}
+
+
+void test_empty_before_publish(sfixture *sf, gconstpointer test_data) {
+    game_snapshot const* snapshot = snapshot_acquire(&sf->data->snapshots);
+    g_assert_cmpint(snapshot->tick, ==, 0);
+    g_assert_cmpint(snapshot->num_entities, ==, 0);
+}
+
+void test_publish(sfixture *sf, gconstpointer test_data) {
+    sf->data->camera_x = 7;
+    publish_game_snapshot(sf->data);
+    game_snapshot const* snapshot = snapshot_acquire(&sf->data->snapshots);
+    g_assert_cmpint(snapshot->camera_x, ==, 7);
+    g_assert_cmpint(snapshot->current_room_id, ==, sf->room.room_id);
+    g_assert_cmpint(snapshot->num_entities, ==, NUM_TEST_ENTS);
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        g_assert_cmpint(snapshot->entities[i].id, ==, sf->ents[i].id);
+        g_assert_cmpint(snapshot->entities[i].y, ==, i);
+    }
+    // nothing new published, so the reader keeps the same snapshot
+    sf->data->camera_x = 8;
+    g_assert_true(snapshot_acquire(&sf->data->snapshots) == snapshot);
+    g_assert_cmpint(snapshot->camera_x, ==, 7);
+}
+
+void test_interpolate(sfixture *sf, gconstpointer test_data) {
+    GLuint texture = 1;
+    t_sprite sprite = { .num_imgs = 1, .texture = &texture };
+    add_sprite(sf->data, &sprite);
+    for(int i = 0; i < NUM_TEST_ENTS; i++)
+        sf->ents[i].current_spr_id = sprite.spr_id;
+    // every other entity moves ten pixels right in one tick, twice over
+    for(int i = 0; i < NUM_TEST_ENTS; i += 2) {
+        for(int j = 0; j < 2; j++)
+            cmd_alter_entity(sf->data, (struct alter_entity_command) {
+                    .target_id = sf->ents[i].id, .modified_attr = X, .int_value = 5 * (j + 1) });
+    }
+    sf->data->tick++;
+    publish_game_snapshot(sf->data);
+    game_snapshot const* snapshot = snapshot_acquire(&sf->data->snapshots);
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        g_assert_cmpint(snapshot->entities[i].prev_x, ==, 0);
+        g_assert_cmpint(snapshot->entities[i].x, ==, (i % 2 == 0) ? 10 : 0);
+    }
+    render_queue queue = make_render_queue(0);
+    queue_snapshot_images(sf->data, snapshot, 0.3, &queue);
+    g_assert_cmpint(queue.num_images, ==, NUM_TEST_ENTS);
+    for(int i = 0; i < queue.num_images; i++)
+        g_assert_cmpint(queue.images[i].x, ==, (queue.images[i].y % 2 == 0) ? 3 : 0);
+    // a tick without moving leaves nothing to interpolate
+    sf->data->tick++;
+    publish_game_snapshot(sf->data);
+    snapshot = snapshot_acquire(&sf->data->snapshots);
+    for(int i = 0; i < NUM_TEST_ENTS; i++)
+        g_assert_cmpint(snapshot->entities[i].prev_x, ==, snapshot->entities[i].x);
+    queue_snapshot_images(sf->data, snapshot, 0.0, &queue);
+    for(int i = 0; i < queue.num_images; i++)
+        g_assert_cmpint(queue.images[i].x, ==, (queue.images[i].y % 2 == 0) ? 10 : 0);
+    render_queue_free(&queue);
+}
+
+void test_concurrent_loops(sfixture *sf, gconstpointer test_data) {
+    pthread_t update_thread;
+    pthread_create(&update_thread, NULL, run_update, sf);
+    // act as the render loop: every snapshot must be one whole tick, never a mix of two
+    unsigned long last_tick = 0;
+    long num_read = 0;
+    while(!atomic_load(&sf->update_done)) {
+        game_snapshot const* snapshot = snapshot_acquire(&sf->data->snapshots);
+        g_assert_cmpint(snapshot->tick, >=, last_tick);
+        last_tick = snapshot->tick;
+        if(snapshot->tick == 0)
+            continue;
+        g_assert_cmpint(snapshot->num_entities, ==, NUM_TEST_ENTS);
+        for(int i = 0; i < snapshot->num_entities; i++) {
+            g_assert_cmpint(snapshot->entities[i].x, ==, snapshot->tick);
+            g_assert_cmpint(snapshot->entities[i].y, ==, i);
+        }
+        num_read++;
+    }
+    pthread_join(update_thread, NULL);
+    g_assert_cmpint(num_read, >, 0);
+    g_assert_cmpint(snapshot_acquire(&sf->data->snapshots)->tick, ==, TEST_TICKS);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/snapshot/empty_before_publish", sfixture, NULL, snap_setup, test_empty_before_publish, snap_teardown);
+    g_test_add("/snapshot/publish", sfixture, NULL, snap_setup, test_publish, snap_teardown);
+    g_test_add("/snapshot/interpolate", sfixture, NULL, snap_setup, test_interpolate, snap_teardown);
+    g_test_add("/snapshot/concurrent_loops", sfixture, NULL, snap_setup, test_concurrent_loops, snap_teardown);
+    return g_test_run();
+}
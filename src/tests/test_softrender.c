@@ -0,0 +1,208 @@
+/*
+ * File: test_softrender.c
+ *
+ * Testing suite for the software render backend.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SCR_WIDTH 37    // not a multiple of four, so SIMD rows have leftover pixels
+#define SCR_HEIGHT 23
+#define SPR_WIDTH 13
+#define SPR_HEIGHT 9
+#define NUM_IMGS 2
+#define NUM_TRIALS 200
+#define CLEAR_COLOR 0xFF302010u
+
+
+typedef struct {
+    software_renderer *renderer;
+    t_sprite sprite;
+    GLuint textures[NUM_IMGS];
+} swfixture;
+
+
+/*
+ * reference_blend: Blend a pixel over an opaque one in floating point, rounded to nearest.
+ */
+static uint32_t reference_blend(uint32_t src, uint32_t dst) {
+    double a = (src >> 24) / 255.0;
+    uint32_t out = 0xFF000000u;
+    for(int shift = 0; shift < 24; shift += 8) {
+        double value = ((src >> shift) & 0xFF) * a + ((dst >> shift) & 0xFF) * (1.0 - a);
+        out |= (uint32_t) (value + 0.5) << shift;
+    }
+    return out;
+}
+
+/*
+ * reference_draw: Draw a subimage into a framebuffer pixel by pixel, skipping pixels off screen.
+ */
+static void reference_draw(uint32_t *frame, t_sprite const* sprite, int subimg, int x, int y) {
+    for(int row = 0; row < sprite->height; row++) {
+        for(int col = 0; col < sprite->width; col++) {
+            if(x + col < 0 || x + col >= SCR_WIDTH || y + row < 0 || y + row >= SCR_HEIGHT)
+                continue;
+            uint32_t *dst = &frame[(y + row) * SCR_WIDTH + x + col];
+            *dst = reference_blend(sprite->pixels[subimg][row * sprite->width + col], *dst);
+        }
+    }
+}
+
+void softrender_setup(swfixture *swf, gconstpointer test_data) {
+    srand(1);
+    swf->renderer = make_software_renderer(CLEAR_COLOR);
+    swf->sprite.num_imgs = NUM_IMGS;
+    swf->sprite.width = SPR_WIDTH;
+    swf->sprite.height = SPR_HEIGHT;
+    swf->sprite.texture = swf->textures;
+    // first subimage is all kinds of alpha, second a half transparent green square
+    uint32_t *pixels[NUM_IMGS];
+    for(int i = 0; i < NUM_IMGS; i++)
+        pixels[i] = malloc(sizeof(uint32_t) * SPR_WIDTH * SPR_HEIGHT);
+    for(int i = 0; i < SPR_WIDTH * SPR_HEIGHT; i++) {
+        uint32_t alpha = (rand() % 3 == 0) ? 0 : (rand() % 3 == 0) ? 255 : rand() % 256;
+        pixels[0][i] = (alpha << 24) | (rand() & 0xFFFFFF);
+        pixels[1][i] = 0x8000FF00u;
+    }
+    sprite_set_pixels(&swf->sprite, (uint32_t const* const*) pixels);
+    for(int i = 0; i < NUM_IMGS; i++)
+        free(pixels[i]);
+}
+
+void softrender_teardown(swfixture *swf, gconstpointer test_data) {
+    for(int i = 0; i < NUM_IMGS; i++) {
+        collision_mask_free(&swf->sprite.masks[i]);
+        free(swf->sprite.pixels[i]);
+    }
+    free(swf->sprite.masks);
+    free(swf->sprite.pixels);
+    swf->renderer->backend.free(&swf->renderer->backend);
+}
+
+
+void test_blend_values(swfixture *swf, gconstpointer test_data) {
+    render_backend *backend = &swf->renderer->backend;
+    backend->begin_frame(backend, SCR_WIDTH, SCR_HEIGHT);
+    g_assert_cmphex(software_renderer_get(swf->renderer, 0, 0), ==, CLEAR_COLOR);
+    draw_sprite(backend, &swf->sprite, 1, 2, 3);
+    draw_sprite(backend, &swf->sprite, 1, 4, 3);
+    backend->end_frame(backend);
+    // 128/255 of green over the clear color, then again where the two overlap
+    g_assert_cmphex(software_renderer_get(swf->renderer, 2, 3), ==, 0xFF189008u);
+    g_assert_cmphex(software_renderer_get(swf->renderer, 4, 3), ==, 0xFF0CC804u);
+    g_assert_cmphex(software_renderer_get(swf->renderer, 1, 3), ==, CLEAR_COLOR);
+    g_assert_cmphex(software_renderer_get(swf->renderer, 2, 2), ==, CLEAR_COLOR);
+    g_assert_cmpint(swf->renderer->frame_images, ==, 2);
+    g_assert_cmpint(swf->renderer->frame_pixels, ==, 2 * SPR_WIDTH * SPR_HEIGHT);
+}
+
+void test_matches_reference(swfixture *swf, gconstpointer test_data) {
+    render_backend *backend = &swf->renderer->backend;
+    uint32_t *expected = malloc(sizeof(uint32_t) * SCR_WIDTH * SCR_HEIGHT);
+    for(int simd = 0; simd < 2; simd++) {
+        swf->renderer->use_simd = simd;
+        srand(2);
+        backend->begin_frame(backend, SCR_WIDTH, SCR_HEIGHT);
+        for(int i = 0; i < SCR_WIDTH * SCR_HEIGHT; i++)
+            expected[i] = CLEAR_COLOR;
+        // positions overlapping every edge of the screen, and some entirely off it
+        for(int i = 0; i < NUM_TRIALS; i++) {
+            int subimg = rand() % NUM_IMGS;
+            int x = rand() % (SCR_WIDTH + 2 * SPR_WIDTH) - SPR_WIDTH - 1;
+            int y = rand() % (SCR_HEIGHT + 2 * SPR_HEIGHT) - SPR_HEIGHT - 1;
+            draw_sprite(backend, &swf->sprite, subimg, x, y);
+            reference_draw(expected, &swf->sprite, subimg, x, y);
+        }
+        backend->end_frame(backend);
+        for(int y = 0; y < SCR_HEIGHT; y++) {
+            for(int x = 0; x < SCR_WIDTH; x++)
+                g_assert_cmphex(software_renderer_get(swf->renderer, x, y), ==, expected[y * SCR_WIDTH + x]);
+        }
+    }
+    free(expected);
+}
+
+void test_render_frame(swfixture *swf, gconstpointer test_data) {
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    data->scr_width = SCR_WIDTH;
+    data->scr_height = SCR_HEIGHT;
+    data->camera_x = 100;
+    data->camera_y = 50;
+    add_sprite(data, &swf->sprite);
+    t_room room = {0};
+    t_entity ents[2] = {{0}};
+    room.entity_ids = malloc(sizeof(int) * 2);
+    for(int i = 0; i < 2; i++) {
+        ents[i].current_spr_id = swf->sprite.spr_id;
+        ents[i].spr_current_img = 1;
+        ents[i].x = 100 + i;
+        ents[i].y = 50;
+        add_entity(data, &ents[i]);
+        room.entity_ids[room.num_entities++] = ents[i].id;
+    }
+    add_room(data, &room);
+    data->current_room_id = room.room_id;
+    // the first entity is in front, so is drawn last even though it is queued first
+    ents[0].depth = 1;
+    ents[1].spr_current_img = 0;
+    set_renderer(data, &swf->renderer->backend);
+    publish_game_snapshot(data);
+    render_queue queue = make_render_queue(0);
+    render_frame(data, snapshot_acquire(&data->snapshots), &queue);
+    uint32_t expected = reference_blend(swf->sprite.pixels[0][0], CLEAR_COLOR);
+    g_assert_cmphex(software_renderer_get(swf->renderer, 1, 0), ==, reference_blend(0x8000FF00u, expected));
+    render_queue_free(&queue);
+    free(room.entity_ids);
+    // the game data owns the renderer now, so the fixture must not free it again
+    swf->renderer = make_software_renderer(CLEAR_COLOR);
+    gamedata_free(data);
+}
+
+void test_write_ppm(swfixture *swf, gconstpointer test_data) {
+    render_backend *backend = &swf->renderer->backend;
+    backend->begin_frame(backend, SCR_WIDTH, SCR_HEIGHT);
+    draw_sprite(backend, &swf->sprite, 0, 5, 5);
+    backend->end_frame(backend);
+    char path[] = "/tmp/cnd_softrender_XXXXXX";
+    close(mkstemp(path));
+    g_assert_true(software_renderer_write_ppm(swf->renderer, path));
+    FILE *file = fopen(path, "rb");
+    int width, height, max;
+    g_assert_cmpint(fscanf(file, "P6 %d %d %d", &width, &height, &max), ==, 3);
+    g_assert_cmpint(width, ==, SCR_WIDTH);
+    g_assert_cmpint(height, ==, SCR_HEIGHT);
+    g_assert_cmpint(max, ==, 255);
+    fgetc(file);    // single whitespace before the pixels
+    for(int y = 0; y < SCR_HEIGHT; y++) {
+        for(int x = 0; x < SCR_WIDTH; x++) {
+            uint32_t pixel = software_renderer_get(swf->renderer, x, y);
+            g_assert_cmpint(fgetc(file), ==, pixel & 0xFF);
+            g_assert_cmpint(fgetc(file), ==, (pixel >> 8) & 0xFF);
+            g_assert_cmpint(fgetc(file), ==, (pixel >> 16) & 0xFF);
+        }
+    }
+    g_assert_cmpint(fgetc(file), ==, EOF);
+    fclose(file);
+    unlink(path);
+    g_assert_false(software_renderer_write_ppm(swf->renderer, "/nonexistent/dir/frame.ppm"));
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/softrender/blend_values", swfixture, NULL, softrender_setup, test_blend_values, softrender_teardown);
+    g_test_add("/softrender/matches_reference", swfixture, NULL, softrender_setup, test_matches_reference, softrender_teardown);
+    g_test_add("/softrender/render_frame", swfixture, NULL, softrender_setup, test_render_frame, softrender_teardown);
+    g_test_add("/softrender/write_ppm", swfixture, NULL, softrender_setup, test_write_ppm, softrender_teardown);
+    return g_test_run();
+}
@@ -0,0 +1,401 @@
+/*
+ * File: test_sound.c
+ *
+ * Testing suite for sounds, reading WAV files and the audio mixer.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define NUM_TEST_FRAMES 300     // more than a block, so blocks are mixed back to back
+#define NUM_STREAM_FRAMES 50000
+#define NUM_PIPE_FRAMES 8192
+#define TOLERANCE 1e-6
+
+
+/*
+ * write_le: Write an unsigned integer of some number of bytes, least significant byte first.
+ */
+static void write_le(FILE *file, int num_bytes, uint32_t value) {
+    for(int i = 0; i < num_bytes; i++)
+        fputc((value >> (8 * i)) & 0xFF, file);
+}
+
+/*
+ * write_wav_header: Write a WAV header for num_frames frames, with a chunk the reader must skip if extra.
+ */
+static void write_wav_header(FILE *file, int format, int channels, int bits, int rate, long num_frames, bool extra) {
+    uint32_t data_size = (uint32_t) (num_frames * channels * bits / 8);
+    fwrite("RIFF", 1, 4, file);
+    write_le(file, 4, 4 + 24 + (extra ? 12 : 0) + 8 + data_size);
+    fwrite("WAVE", 1, 4, file);
+    fwrite("fmt ", 1, 4, file);
+    write_le(file, 4, 16);
+    write_le(file, 2, format);
+    write_le(file, 2, channels);
+    write_le(file, 4, rate);
+    write_le(file, 4, rate * channels * bits / 8);
+    write_le(file, 2, channels * bits / 8);
+    write_le(file, 2, bits);
+    if(extra) {
+        // odd sized, so padded
+        fwrite("LIST", 1, 4, file);
+        write_le(file, 4, 3);
+        fwrite("abc", 1, 4, file);
+    }
+    fwrite("data", 1, 4, file);
+    write_le(file, 4, data_size);
+}
+
+/*
+ * write_samples: Write samples from -1 to 1 as 16 bit integers or 32 bit floats.
+ */
+static void write_samples(FILE *file, int format, float const* samples, long num_samples) {
+    for(long i = 0; i < num_samples; i++) {
+        if(format == WAV_PCM) {
+            write_le(file, 2, (uint16_t) (int16_t) lrintf(samples[i] * 32767.0f));
+        } else {
+            uint32_t value;
+            memcpy(&value, &samples[i], sizeof(float));
+            write_le(file, 4, value);
+        }
+    }
+}
+
+static void write_wav(char const* path, int format, int channels, int rate, float const* samples, long num_frames) {
+    FILE *file = fopen(path, "wb");
+    g_assert_nonnull(file);
+    write_wav_header(file, format, channels, (format == WAV_PCM) ? 16 : 32, rate, num_frames, true);
+    write_samples(file, format, samples, num_frames * channels);
+    fclose(file);
+}
+
+static char *temp_path(char *path, char const* name) {
+    sprintf(path, "/tmp/cnd_test_sound_%d_%s", (int) getpid(), name);
+    return path;
+}
+
+/*
+ * ramp: Make a stereo sound whose samples are all different, and small enough never to clip.
+ */
+static float *ramp(long num_frames) {
+    float *samples = malloc(sizeof(float) * 2 * num_frames);
+    for(long i = 0; i < 2 * num_frames; i++)
+        samples[i] = (float) ((i % 2000) - 1000) / 4000.0f;
+    return samples;
+}
+
+/*
+ * wait_for: Wait up to a second for a value written by another thread to reach another.
+ */
+static bool wait_for(_Atomic int *value, int expected) {
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 1000000 };
+    for(int i = 0; i < 1000; i++) {
+        if(atomic_load(value) == expected)
+            return true;
+        nanosleep(&pause, NULL);
+    }
+    return false;
+}
+
+/*
+ * wait_for_frames: Wait until a stream has a block decoded, or has been decoded to its end.
+ */
+static void wait_for_frames(mixer_stream *stream) {
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 100000 };
+    while(spsc_ring_count(&stream->frames) < MIXER_BLOCK_FRAMES && !atomic_load(&stream->finished))
+        nanosleep(&pause, NULL);
+}
+
+
+void test_wav_pcm_mono() {
+    char path[256];
+    temp_path(path, "mono.wav");
+    float samples[] = { 0.0f, 0.5f, -1.0f, 1.0f, 0.25f };
+    write_wav(path, WAV_PCM, 1, 22050, samples, 5);
+    wav_reader reader;
+    g_assert_true(wav_open(&reader, path));
+    g_assert_cmpint(reader.format, ==, WAV_PCM);
+    g_assert_cmpint(reader.channels, ==, 1);
+    g_assert_cmpint(reader.sample_rate, ==, 22050);
+    g_assert_cmpint(reader.num_frames, ==, 5);
+    float frames[2 * 8];
+    g_assert_cmpint(wav_read(&reader, frames, 8), ==, 5);
+    for(int i = 0; i < 5; i++) {
+        // played out of both channels
+        g_assert_cmpfloat(fabsf(frames[2 * i] - samples[i]), <, 1.0f / 16384);
+        g_assert_cmpfloat(frames[2 * i + 1], ==, frames[2 * i]);
+    }
+    g_assert_cmpint(wav_read(&reader, frames, 8), ==, 0);
+    wav_close(&reader);
+    remove(path);
+}
+
+void test_wav_float_stereo() {
+    char path[256];
+    temp_path(path, "stereo.wav");
+    float *samples = ramp(NUM_TEST_FRAMES);
+    write_wav(path, WAV_FLOAT, 2, MIXER_SAMPLE_RATE, samples, NUM_TEST_FRAMES);
+    wav_reader reader;
+    g_assert_true(wav_open(&reader, path));
+    float *frames = malloc(sizeof(float) * 2 * NUM_TEST_FRAMES);
+    // read in pieces, the last cut short by the end of the file
+    g_assert_cmpint(wav_read(&reader, frames, 100), ==, 100);
+    g_assert_cmpint(wav_read(&reader, frames + 200, 250), ==, NUM_TEST_FRAMES - 100);
+    g_assert_cmpmem(frames, sizeof(float) * 2 * NUM_TEST_FRAMES, samples, sizeof(float) * 2 * NUM_TEST_FRAMES);
+    wav_close(&reader);
+    free(frames);
+    free(samples);
+    remove(path);
+}
+
+void test_wav_invalid() {
+    char path[256];
+    temp_path(path, "invalid.wav");
+    wav_reader reader;
+    g_assert_false(wav_open(&reader, path));
+    // 8 bit samples are not supported
+    FILE *file = fopen(path, "wb");
+    write_wav_header(file, WAV_PCM, 1, 8, MIXER_SAMPLE_RATE, 4, true);
+    fwrite("abcd", 1, 4, file);
+    fclose(file);
+    g_assert_false(wav_open(&reader, path));
+    g_assert_null(reader.file);
+    file = fopen(path, "wb");
+    fwrite("RIFX", 1, 4, file);
+    fclose(file);
+    g_assert_false(wav_open(&reader, path));
+    remove(path);
+}
+
+void test_mix_values() {
+    float *a = ramp(NUM_TEST_FRAMES);
+    float *b = malloc(sizeof(float) * 2 * NUM_TEST_FRAMES);
+    for(int i = 0; i < 2 * NUM_TEST_FRAMES; i++)
+        b[i] = (i % 3 == 0) ? 0.9f : -0.3f;     // loud enough to clip when added to a
+    float out[2][2 * NUM_TEST_FRAMES];
+    for(int simd = 0; simd < 2; simd++) {
+        audio_mixer *mixer = make_mixer();
+        mixer->use_simd = simd;
+        g_assert_true(mixer_play(mixer, 1, a, NUM_TEST_FRAMES, 0.5f));
+        g_assert_true(mixer_play(mixer, 2, b, NUM_TEST_FRAMES / 2, 2.0f));
+        mixer_mix(mixer, out[simd], NUM_TEST_FRAMES);
+        for(int i = 0; i < 2 * NUM_TEST_FRAMES; i++) {
+            double expected = a[i] * 0.5 + ((i < NUM_TEST_FRAMES) ? b[i] * 2.0 : 0.0);
+            expected = (expected > 1.0) ? 1.0 : (expected < -1.0) ? -1.0 : expected;
+            g_assert_cmpfloat(fabs(out[simd][i] - expected), <, TOLERANCE);
+        }
+        // both sounds were played to their end, freeing their voices
+        g_assert_cmpint(atomic_load(&mixer->voices_playing), ==, 0);
+        g_assert_cmpint(atomic_load(&mixer->frames_mixed), ==, NUM_TEST_FRAMES);
+        mixer_free(mixer);
+    }
+    for(int i = 0; i < 2 * NUM_TEST_FRAMES; i++)
+        g_assert_cmpfloat(fabsf(out[0][i] - out[1][i]), <, TOLERANCE);
+    free(a);
+    free(b);
+}
+
+void test_pause_resume_end() {
+    float *samples = ramp(1000);
+    float out[2 * 100];
+    audio_mixer *mixer = make_mixer();
+    mixer_play(mixer, 1, samples, 1000, 1.0f);
+    mixer_mix(mixer, out, 100);
+    g_assert_cmpfloat(out[0], ==, samples[0]);
+    // paused sounds are silent, but still hold their voice
+    mixer_pause(mixer, 1);
+    mixer_mix(mixer, out, 100);
+    for(int i = 0; i < 200; i++)
+        g_assert_cmpfloat(out[i], ==, 0.0f);
+    g_assert_cmpint(atomic_load(&mixer->voices_playing), ==, 1);
+    // playing again resumes where it was paused
+    mixer_play(mixer, 1, samples, 1000, 1.0f);
+    mixer_mix(mixer, out, 100);
+    g_assert_cmpmem(out, sizeof(out), samples + 200, sizeof(out));
+    g_assert_cmpint(atomic_load(&mixer->voices_playing), ==, 1);
+    // playing while not paused plays it again over itself
+    mixer_play(mixer, 1, samples, 1000, 1.0f);
+    mixer_mix(mixer, out, 100);
+    g_assert_cmpint(atomic_load(&mixer->voices_playing), ==, 2);
+    g_assert_cmpfloat(fabsf(out[0] - (samples[400] + samples[0])), <, TOLERANCE);
+    mixer_end(mixer, 1);
+    mixer_mix(mixer, out, 100);
+    for(int i = 0; i < 200; i++)
+        g_assert_cmpfloat(out[i], ==, 0.0f);
+    g_assert_cmpint(atomic_load(&mixer->voices_playing), ==, 0);
+    mixer_free(mixer);
+    free(samples);
+}
+
+void test_voices_dropped() {
+    float *samples = ramp(100);
+    float out[2 * 100];
+    audio_mixer *mixer = make_mixer();
+    for(int i = 0; i < MIXER_MAX_VOICES + 3; i++)
+        mixer_play(mixer, i + 1, samples, 100, 0.01f);
+    mixer_mix(mixer, out, 10);
+    g_assert_cmpint(atomic_load(&mixer->voices_playing), ==, MIXER_MAX_VOICES);
+    g_assert_cmpint(atomic_load(&mixer->voices_dropped), ==, 3);
+    // commands beyond what the queue holds are dropped too
+    for(int i = 0; i < MIXER_COMMANDS + 5; i++)
+        mixer_pause(mixer, 1);
+    g_assert_cmpint(mixer->commands_dropped, ==, 5);
+    mixer_free(mixer);
+    free(samples);
+}
+
+void test_stream() {
+    char path[256];
+    temp_path(path, "stream.wav");
+    float *samples = ramp(NUM_STREAM_FRAMES);
+    write_wav(path, WAV_FLOAT, 2, MIXER_SAMPLE_RATE, samples, NUM_STREAM_FRAMES);
+    audio_mixer *mixer = make_mixer();
+    g_assert_true(mixer_play_stream(mixer, 1, path, 1.0f));
+    mixer_stream *stream = &mixer->streams[0];
+    g_assert_cmpint(atomic_load(&stream->state), ==, STREAM_ACTIVE);
+    float *out = malloc(sizeof(float) * 2 * NUM_STREAM_FRAMES);
+    // mix offline, waiting for the decode thread as a device's pace would
+    for(int done = 0; done < NUM_STREAM_FRAMES; done += MIXER_BLOCK_FRAMES) {
+        int count = (NUM_STREAM_FRAMES - done < MIXER_BLOCK_FRAMES) ? NUM_STREAM_FRAMES - done : MIXER_BLOCK_FRAMES;
+        wait_for_frames(stream);
+        mixer_mix(mixer, out + 2 * done, count);
+    }
+    g_assert_cmpmem(out, sizeof(float) * 2 * NUM_STREAM_FRAMES, samples, sizeof(float) * 2 * NUM_STREAM_FRAMES);
+    g_assert_cmpint(atomic_load(&mixer->underruns), ==, 0);
+    // once played to the end, the decode thread closes it and frees its slot
+    g_assert_cmpint(atomic_load(&mixer->voices_playing), ==, 0);
+    g_assert_true(wait_for(&stream->state, STREAM_FREE));
+    g_assert_null(stream->reader.file);
+
+    // only files at the mixer's sample rate can be streamed
+    write_wav(path, WAV_FLOAT, 2, 22050, samples, 10);
+    g_assert_false(mixer_play_stream(mixer, 1, path, 1.0f));
+    g_assert_cmpint(atomic_load(&stream->state), ==, STREAM_FREE);
+    mixer_free(mixer);
+    free(out);
+    free(samples);
+    remove(path);
+}
+
+/*
+ * slow_disk: Writes a WAV file into a pipe, stopping after its first frames until released,
+ * so the decode thread is stuck as if the disk were slow.
+ */
+struct slow_disk {
+    char const* path;
+    float *samples;
+    _Atomic int released;
+};
+
+static void *write_slowly(void *arg) {
+    struct slow_disk *disk = arg;
+    FILE *file = fopen(disk->path, "wb");
+    // pipes cannot seek past extra chunks
+    write_wav_header(file, WAV_FLOAT, 2, 32, MIXER_SAMPLE_RATE, NUM_PIPE_FRAMES, false);
+    write_samples(file, WAV_FLOAT, disk->samples, 2 * 4 * MIXER_BLOCK_FRAMES);
+    fflush(file);
+    wait_for(&disk->released, 1);
+    write_samples(file, WAV_FLOAT, disk->samples + 2 * 4 * MIXER_BLOCK_FRAMES,
+                  2 * (NUM_PIPE_FRAMES - 4 * MIXER_BLOCK_FRAMES));
+    fclose(file);
+    return NULL;
+}
+
+void test_underrun() {
+    char path[256];
+    temp_path(path, "pipe.wav");
+    g_assert_cmpint(mkfifo(path, 0600), ==, 0);
+    struct slow_disk disk = { .path = path, .samples = ramp(NUM_PIPE_FRAMES) };
+    atomic_init(&disk.released, 0);
+    pthread_t writer;
+    pthread_create(&writer, NULL, write_slowly, &disk);
+    audio_mixer *mixer = make_mixer();
+    // the first 4 blocks are decoded before playing, then the decode thread waits on the pipe
+    g_assert_true(mixer_play_stream(mixer, 1, path, 1.0f));
+    float *out = malloc(sizeof(float) * 2 * NUM_PIPE_FRAMES);
+    mixer_mix(mixer, out, 8 * MIXER_BLOCK_FRAMES);
+    g_assert_cmpmem(out, sizeof(float) * 2 * 4 * MIXER_BLOCK_FRAMES, disk.samples, sizeof(float) * 2 * 4 * MIXER_BLOCK_FRAMES);
+    for(int i = 2 * 4 * MIXER_BLOCK_FRAMES; i < 2 * 8 * MIXER_BLOCK_FRAMES; i++)
+        g_assert_cmpfloat(out[i], ==, 0.0f);
+    g_assert_cmpint(atomic_load(&mixer->underruns), ==, 4);
+    g_assert_cmpint(atomic_load(&mixer->voices_playing), ==, 1);
+    // once the disk catches up, the stream carries on where it left off
+    atomic_store(&disk.released, 1);
+    pthread_join(writer, NULL);
+    mixer_stream *stream = &mixer->streams[0];
+    for(int done = 4 * MIXER_BLOCK_FRAMES; done < NUM_PIPE_FRAMES; done += MIXER_BLOCK_FRAMES) {
+        wait_for_frames(stream);
+        mixer_mix(mixer, out + 2 * done, MIXER_BLOCK_FRAMES);
+    }
+    g_assert_cmpmem(out, sizeof(float) * 2 * NUM_PIPE_FRAMES, disk.samples, sizeof(float) * 2 * NUM_PIPE_FRAMES);
+    g_assert_cmpint(atomic_load(&mixer->underruns), ==, 4);
+    mixer_free(mixer);
+    free(out);
+    free(disk.samples);
+    remove(path);
+}
+
+void test_sound_commands() {
+    char path[256];
+    temp_path(path, "sound.wav");
+    float *samples = ramp(MIXER_SAMPLE_RATE);
+    write_wav(path, WAV_PCM, 2, MIXER_SAMPLE_RATE, samples, MIXER_SAMPLE_RATE);
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    t_sound *sound = calloc(1, sizeof(t_sound));
+    sound->snd_path = path;
+    sound->volume = -6;
+    add_sound(data, sound);
+    // without audio enabled, sound commands do nothing
+    cmd_play_sound(data, (struct play_sound_command) { .sound_id = sound->snd_id });
+    g_assert_true(enable_audio(data, AUDIO_NULL));
+    audio_mixer *mixer = data->mixer;
+    for(int loaded = 0; loaded < 2; loaded++) {
+        if(loaded) {
+            g_assert_true(load_sound(sound));
+            g_assert_cmpint(sound->num_frames, ==, MIXER_SAMPLE_RATE);
+            g_assert_cmpfloat(fabsf(sound->samples[1] - samples[1]), <, 1.0f / 16384);
+        }
+        cmd_play_sound(data, (struct play_sound_command) { .sound_id = sound->snd_id });
+        g_assert_true(wait_for(&mixer->voices_playing, 1));
+        cmd_pause_sound(data, (struct pause_sound_command) { .sound_id = sound->snd_id });
+        cmd_end_sound(data, (struct end_sound_command) { .sound_id = sound->snd_id });
+        g_assert_true(wait_for(&mixer->voices_playing, 0));
+        // unknown sounds are ignored
+        cmd_play_sound(data, (struct play_sound_command) { .sound_id = sound->snd_id + 1 });
+    }
+    g_assert_cmpint(mixer->commands_dropped, ==, 0);
+    // the null output asks for blocks as a device would
+    g_assert_cmpint(atomic_load(&mixer->frames_mixed), >, 0);
+    free(sound->samples);
+    free(sound);
+    gamedata_free(data);
+    free(samples);
+    remove(path);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/sound/wav_pcm_mono", test_wav_pcm_mono);
+    g_test_add_func("/sound/wav_float_stereo", test_wav_float_stereo);
+    g_test_add_func("/sound/wav_invalid", test_wav_invalid);
+    g_test_add_func("/sound/mix_values", test_mix_values);
+    g_test_add_func("/sound/pause_resume_end", test_pause_resume_end);
+    g_test_add_func("/sound/voices_dropped", test_voices_dropped);
+    g_test_add_func("/sound/stream", test_stream);
+    g_test_add_func("/sound/underrun", test_underrun);
+    g_test_add_func("/sound/sound_commands", test_sound_commands);
+    return g_test_run();
+}
@@ -0,0 +1,221 @@
+/*
+ * File: test_soundcache.c
+ *
+ * Testing suite for the cache of decoded sounds.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NUM_TEST_SOUNDS 3
+#define NUM_TEST_FRAMES 1000
+
+
+typedef struct {
+    char paths[NUM_TEST_SOUNDS][256];
+    float *samples[NUM_TEST_SOUNDS];
+    size_t sound_bytes;     // memory mapped for each sound
+} cfixture;
+
+
+static void write_le(FILE *file, int num_bytes, uint32_t value) {
+    for(int i = 0; i < num_bytes; i++)
+        fputc((value >> (8 * i)) & 0xFF, file);
+}
+
+/*
+ * write_wav: Write a 32 bit float stereo WAV file.
+ */
+static void write_wav(char const* path, float const* samples, long num_frames) {
+    FILE *file = fopen(path, "wb");
+    g_assert_nonnull(file);
+    uint32_t data_size = (uint32_t) (num_frames * 8);
+    fwrite("RIFF", 1, 4, file);
+    write_le(file, 4, 36 + data_size);
+    fwrite("WAVEfmt ", 1, 8, file);
+    write_le(file, 4, 16);
+    write_le(file, 2, WAV_FLOAT);
+    write_le(file, 2, 2);
+    write_le(file, 4, MIXER_SAMPLE_RATE);
+    write_le(file, 4, MIXER_SAMPLE_RATE * 8);
+    write_le(file, 2, 8);
+    write_le(file, 2, 32);
+    fwrite("data", 1, 4, file);
+    write_le(file, 4, data_size);
+    fwrite(samples, sizeof(float), 2 * num_frames, file);
+    fclose(file);
+}
+
+static bool file_exists(char const* path, char const* suffix) {
+    char name[300];
+    snprintf(name, sizeof(name), "%s%s", path, suffix);
+    return access(name, F_OK) == 0;
+}
+
+void cache_setup(cfixture *cf, gconstpointer test_data) {
+    for(int s = 0; s < NUM_TEST_SOUNDS; s++) {
+        sprintf(cf->paths[s], "/tmp/cnd_test_soundcache_%d_%d.wav", (int) getpid(), s);
+        cf->samples[s] = malloc(sizeof(float) * 2 * NUM_TEST_FRAMES);
+        for(int i = 0; i < 2 * NUM_TEST_FRAMES; i++)
+            cf->samples[s][i] = (float) (s * 1000 + i % 1000) / 8000.0f;
+        write_wav(cf->paths[s], cf->samples[s], NUM_TEST_FRAMES);
+    }
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    cf->sound_bytes = page + (sizeof(float) * 2 * NUM_TEST_FRAMES + page - 1) / page * page;
+}
+
+void cache_teardown(cfixture *cf, gconstpointer test_data) {
+    char name[300];
+    for(int s = 0; s < NUM_TEST_SOUNDS; s++) {
+        remove(cf->paths[s]);
+        snprintf(name, sizeof(name), "%s%s", cf->paths[s], SOUND_CACHE_SUFFIX);
+        remove(name);
+        free(cf->samples[s]);
+    }
+}
+
+
+void test_hits_misses(cfixture *cf, gconstpointer test_data) {
+    sound_cache *cache = make_sound_cache(1 << 20, false);
+    long num_frames = 0;
+    float const* first = sound_cache_acquire(cache, 1, cf->paths[0], &num_frames);
+    g_assert_nonnull(first);
+    g_assert_cmpint(num_frames, ==, NUM_TEST_FRAMES);
+    g_assert_cmpmem(first, sizeof(float) * 2 * NUM_TEST_FRAMES, cf->samples[0], sizeof(float) * 2 * NUM_TEST_FRAMES);
+    g_assert_cmpuint((uintptr_t) first % (uintptr_t) sysconf(_SC_PAGESIZE), ==, 0);
+    // every play of a sound shares its samples
+    g_assert_true(sound_cache_acquire(cache, 1, cf->paths[0], &num_frames) == first);
+    g_assert_nonnull(sound_cache_acquire(cache, 2, cf->paths[1], &num_frames));
+    g_assert_cmpint(cache->hits, ==, 1);
+    g_assert_cmpint(cache->misses, ==, 2);
+    g_assert_cmpuint(cache->resident_bytes, ==, 2 * cf->sound_bytes);
+    // without persistence, no cache file is written
+    g_assert_false(file_exists(cf->paths[0], SOUND_CACHE_SUFFIX));
+    // missing files are not cached
+    g_assert_null(sound_cache_acquire(cache, 3, "/tmp/cnd_no_such_sound.wav", &num_frames));
+    g_assert_cmpint(cache->misses, ==, 2);
+    sound_cache_free(cache);
+}
+
+void test_cache_file(cfixture *cf, gconstpointer test_data) {
+    long num_frames;
+    sound_cache *cache = make_sound_cache(1 << 20, true);
+    g_assert_nonnull(sound_cache_acquire(cache, 1, cf->paths[0], &num_frames));
+    g_assert_cmpint(cache->file_loads, ==, 0);
+    g_assert_true(file_exists(cf->paths[0], SOUND_CACHE_SUFFIX));
+    g_assert_false(file_exists(cf->paths[0], SOUND_CACHE_SUFFIX ".tmp"));
+    sound_cache_free(cache);
+    // a later run maps the cache file rather than decoding
+    cache = make_sound_cache(1 << 20, true);
+    float const* samples = sound_cache_acquire(cache, 1, cf->paths[0], &num_frames);
+    g_assert_cmpint(cache->misses, ==, 1);
+    g_assert_cmpint(cache->file_loads, ==, 1);
+    g_assert_cmpint(num_frames, ==, NUM_TEST_FRAMES);
+    g_assert_cmpmem(samples, sizeof(float) * 2 * NUM_TEST_FRAMES, cf->samples[0], sizeof(float) * 2 * NUM_TEST_FRAMES);
+    sound_cache_free(cache);
+    // once the sound changes, its cache file is out of date, so it is decoded again
+    write_wav(cf->paths[0], cf->samples[1], NUM_TEST_FRAMES / 2);
+    cache = make_sound_cache(1 << 20, true);
+    samples = sound_cache_acquire(cache, 1, cf->paths[0], &num_frames);
+    g_assert_cmpint(cache->file_loads, ==, 0);
+    g_assert_cmpint(num_frames, ==, NUM_TEST_FRAMES / 2);
+    g_assert_cmpmem(samples, sizeof(float) * NUM_TEST_FRAMES, cf->samples[1], sizeof(float) * NUM_TEST_FRAMES);
+    sound_cache_free(cache);
+}
+
+void test_lru_eviction(cfixture *cf, gconstpointer test_data) {
+    long num_frames;
+    sound_cache *cache = make_sound_cache(2 * cf->sound_bytes, false);
+    for(int s = 0; s < 2; s++) {
+        sound_cache_acquire(cache, s + 1, cf->paths[s], &num_frames);
+        sound_cache_release(cache, s + 1);
+    }
+    // the first sound is played again, so the second is the one played least recently
+    sound_cache_acquire(cache, 1, cf->paths[0], &num_frames);
+    sound_cache_release(cache, 1);
+    g_assert_nonnull(sound_cache_acquire(cache, 3, cf->paths[2], &num_frames));
+    g_assert_cmpint(cache->evictions, ==, 1);
+    g_assert_nonnull(slotmap_get(&cache->sounds, 1));
+    g_assert_null(slotmap_get(&cache->sounds, 2));
+    g_assert_cmpuint(cache->resident_bytes, ==, 2 * cf->sound_bytes);
+    // sounds still playing are never evicted, so there is no room for another
+    sound_cache_acquire(cache, 1, cf->paths[0], &num_frames);
+    g_assert_null(sound_cache_acquire(cache, 2, cf->paths[1], &num_frames));
+    g_assert_cmpint(cache->evictions, ==, 1);
+    sound_cache_release(cache, 3);
+    g_assert_nonnull(sound_cache_acquire(cache, 2, cf->paths[1], &num_frames));
+    g_assert_cmpint(cache->evictions, ==, 2);
+    g_assert_null(slotmap_get(&cache->sounds, 3));
+    sound_cache_free(cache);
+    // sounds larger than the whole budget are never cached
+    cache = make_sound_cache(cf->sound_bytes - 1, false);
+    g_assert_null(sound_cache_acquire(cache, 1, cf->paths[0], &num_frames));
+    g_assert_cmpuint(cache->resident_bytes, ==, 0);
+    sound_cache_free(cache);
+}
+
+void test_mixer_returns(cfixture *cf, gconstpointer test_data) {
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    data->mixer = make_mixer();     // mixed offline below, rather than on an output
+    enable_sound_cache(data, 1 << 20, false);
+    t_sound sounds[2] = {{0}};
+    for(int s = 0; s < 2; s++) {
+        sounds[s].snd_path = cf->paths[s];
+        add_sound(data, &sounds[s]);
+    }
+    // loaded sounds are played from their own samples instead
+    g_assert_true(load_sound(&sounds[1]));
+    for(int i = 0; i < 3; i++) {
+        cmd_play_sound(data, (struct play_sound_command) { .sound_id = sounds[0].snd_id });
+        cmd_play_sound(data, (struct play_sound_command) { .sound_id = sounds[1].snd_id });
+    }
+    sound_cache *cache = data->sound_cache;
+    g_assert_cmpint(cache->misses, ==, 1);
+    g_assert_cmpint(cache->hits, ==, 2);
+    cached_sound *cached = slotmap_get(&cache->sounds, sounds[0].snd_id);
+    g_assert_cmpint(cached->plays, ==, 3);
+    g_assert_null(slotmap_get(&cache->sounds, sounds[1].snd_id));
+    float out[2 * NUM_TEST_FRAMES];
+    mixer_mix(data->mixer, out, NUM_TEST_FRAMES / 2);
+    g_assert_cmpint(atomic_load(&data->mixer->voices_playing), ==, 6);
+    // each play is handed back once the mixer has finished with it
+    sound_cache_collect(cache, data->mixer);
+    g_assert_cmpint(cached->plays, ==, 3);
+    mixer_mix(data->mixer, out, NUM_TEST_FRAMES / 2);
+    sound_cache_collect(cache, data->mixer);
+    g_assert_cmpint(cached->plays, ==, 0);
+    // playing while paused resumes, handing the new play straight back
+    cmd_play_sound(data, (struct play_sound_command) { .sound_id = sounds[0].snd_id });
+    cmd_pause_sound(data, (struct pause_sound_command) { .sound_id = sounds[0].snd_id });
+    cmd_play_sound(data, (struct play_sound_command) { .sound_id = sounds[0].snd_id });
+    mixer_mix(data->mixer, out, 10);
+    sound_cache_collect(cache, data->mixer);
+    g_assert_cmpint(cached->plays, ==, 1);
+    g_assert_cmpint(atomic_load(&data->mixer->voices_playing), ==, 1);
+    cmd_end_sound(data, (struct end_sound_command) { .sound_id = sounds[0].snd_id });
+    mixer_mix(data->mixer, out, 10);
+    sound_cache_collect(cache, data->mixer);
+    g_assert_cmpint(cached->plays, ==, 0);
+    g_assert_cmpint(atomic_load(&data->mixer->returns_dropped), ==, 0);
+    free(sounds[1].samples);
+    gamedata_free(data);
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/soundcache/hits_misses", cfixture, NULL, cache_setup, test_hits_misses, cache_teardown);
+    g_test_add("/soundcache/cache_file", cfixture, NULL, cache_setup, test_cache_file, cache_teardown);
+    g_test_add("/soundcache/lru_eviction", cfixture, NULL, cache_setup, test_lru_eviction, cache_teardown);
+    g_test_add("/soundcache/mixer_returns", cfixture, NULL, cache_setup, test_mixer_returns, cache_teardown);
+    return g_test_run();
+}
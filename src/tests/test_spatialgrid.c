@@ -0,0 +1,133 @@
+/*
+ * File: test_spatialgrid.c
+ *
+ * Testing suite for spatial grids, and culling of snapshots with them.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ROOM_SIZE 1000
+#define CELL_SIZE 100
+#define NUM_TEST_ENTS 100   // one per cell, at the cell's centre
+
+
+typedef struct {
+    spatial_grid *grid;
+} gfixture;
+
+
+static bool query_has(spatial_grid *grid, int x, int y, int width, int height, int id) {
+    int num_ids;
+    int *ids = spatial_grid_query(grid, x, y, width, height, &num_ids);
+    for(int i = 0; i < num_ids; i++) {
+        if(ids[i] == id)
+            return true;
+    }
+    return false;
+}
+
+static int query_count(spatial_grid *grid, int x, int y, int width, int height) {
+    int num_ids;
+    spatial_grid_query(grid, x, y, width, height, &num_ids);
+    return num_ids;
+}
+
+void grid_setup(gfixture *gf, gconstpointer test_data) {
+    gf->grid = make_spatial_grid(ROOM_SIZE, ROOM_SIZE, CELL_SIZE);
+    for(int i = 0; i < NUM_TEST_ENTS; i++)
+        spatial_grid_insert(gf->grid, i + 1, (i % 10) * CELL_SIZE + 50, (i / 10) * CELL_SIZE + 50);
+}
+
+void grid_teardown(gfixture *gf, gconstpointer test_data) {
+    spatial_grid_free(gf->grid);
+    arena_reset(frame_arena_local());
+}
+
+
+void test_query(gfixture *gf, gconstpointer test_data) {
+    g_assert_cmpint(query_count(gf->grid, 0, 0, ROOM_SIZE, ROOM_SIZE), ==, NUM_TEST_ENTS);
+    g_assert_cmpint(query_count(gf->grid, 0, 0, 1, 1), ==, 1);
+    g_assert_cmpint(query_count(gf->grid, 150, 150, 200, 200), ==, 9);
+    g_assert_true(query_has(gf->grid, 210, 310, 1, 1, 33));
+}
+
+void test_move(gfixture *gf, gconstpointer test_data) {
+    spatial_grid_move(gf->grid, 1, 950, 950);
+    g_assert_false(query_has(gf->grid, 0, 0, 100, 100, 1));
+    g_assert_true(query_has(gf->grid, 900, 900, 100, 100, 1));
+    g_assert_cmpint(query_count(gf->grid, 900, 900, 100, 100), ==, 2);
+    // moving within a cell leaves it where it is
+    spatial_grid_move(gf->grid, 1, 999, 901);
+    g_assert_cmpint(query_count(gf->grid, 0, 0, ROOM_SIZE, ROOM_SIZE), ==, NUM_TEST_ENTS);
+}
+
+void test_outside_room(gfixture *gf, gconstpointer test_data) {
+    spatial_grid_move(gf->grid, 50, -500, 5000);
+    g_assert_true(query_has(gf->grid, -1000, 900, 1001, 1000, 50));
+    g_assert_false(query_has(gf->grid, 100, 0, 900, 1000, 50));
+}
+
+void test_remove(gfixture *gf, gconstpointer test_data) {
+    for(int i = 1; i <= NUM_TEST_ENTS; i += 2)
+        spatial_grid_remove(gf->grid, i);
+    spatial_grid_remove(gf->grid, 1);
+    spatial_grid_remove(gf->grid, NUM_TEST_ENTS * 10);
+    g_assert_cmpint(query_count(gf->grid, 0, 0, ROOM_SIZE, ROOM_SIZE), ==, NUM_TEST_ENTS / 2);
+    for(int i = 1; i <= NUM_TEST_ENTS; i++)
+        g_assert_true(spatial_grid_contains(gf->grid, i) == (i % 2 == 0));
+}
+
+void test_culled_snapshot() {
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    data->scr_width = data->scr_height = 200;
+    t_room room = { .width = ROOM_SIZE, .height = ROOM_SIZE, .num_entities = NUM_TEST_ENTS };
+    room.entity_ids = malloc(sizeof(int) * NUM_TEST_ENTS);
+    t_entity *ents = calloc(NUM_TEST_ENTS, sizeof(t_entity));
+    add_room(data, &room);
+    data->current_room_id = room.room_id;
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        ents[i].x = (i % 10) * CELL_SIZE + 50;
+        ents[i].y = (i / 10) * CELL_SIZE + 50;
+        add_entity(data, &ents[i]);
+        room.entity_ids[i] = ents[i].id;
+    }
+    enable_room_grid(data, &room, CELL_SIZE);
+    data->camera_x = data->camera_y = 400;
+    publish_game_snapshot(data);
+    // camera covers [300, 600) with the margin, so three entities across and down
+    game_snapshot const* snapshot = snapshot_acquire(&data->snapshots);
+    g_assert_cmpint(snapshot->num_entities, ==, 9);
+
+    // an entity moving into view through a dispatched command is found by the grid
+    struct alter_entity_command move = { .target_id = ents[0].id, .modified_attr = X, .int_value = 450 };
+    cmd_alter_entity(data, move);
+    move.modified_attr = Y;
+    cmd_alter_entity(data, move);
+    publish_game_snapshot(data);
+    snapshot = snapshot_acquire(&data->snapshots);
+    g_assert_cmpint(snapshot->num_entities, ==, 10);
+
+    free(room.entity_ids);
+    spatial_grid_free(room.grid);
+    free(ents);
+    gamedata_free(data);
+    arena_reset(frame_arena_local());
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add("/spatialgrid/query", gfixture, NULL, grid_setup, test_query, grid_teardown);
+    g_test_add("/spatialgrid/move", gfixture, NULL, grid_setup, test_move, grid_teardown);
+    g_test_add("/spatialgrid/outside_room", gfixture, NULL, grid_setup, test_outside_room, grid_teardown);
+    g_test_add("/spatialgrid/remove", gfixture, NULL, grid_setup, test_remove, grid_teardown);
+    g_test_add_func("/spatialgrid/culled_snapshot", test_culled_snapshot);
+    return g_test_run();
+}
@@ -0,0 +1,133 @@
+/*
+ * File: test_threadpool.c
+ *
+ * Testing suite for the work-stealing thread pool, and for parallel updates keeping room order.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+
+#include "../cnoodle.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#define NUM_TEST_ITEMS 10000
+#define NUM_TEST_ENTS 4096
+#define NUM_TEST_WORKERS 4
+#define NUM_TEST_FRAMES 10
+
+
+typedef struct {
+    t_game_data *data;
+    threadpool *pool;
+    t_room room;
+    t_entity *ents;
+    t_entity target;    // altered by every entity in the room
+} tfixture;
+
+
+static int target_id;
+
+/*
+ * alter_target: Set the target's X to this entity's Y, after an uneven amount of busy work,
+ * so workers finish their own chunks at different times and steal from each other.
+ */
+static t_update_command_container alter_target(t_game_data const* data, t_entity const* entity) {
+    volatile int spin = 0;
+    for(int i = 0; i < (entity->id * 7919) % 2000; i++)
+        spin += i;
+    t_update_command_container commands = make_update_command_container();
+    t_update_command *command = push_command(&commands, ALTER_ENTITY);
+    command->data.alter_ent.target_id = target_id;
+    command->data.alter_ent.modified_attr = X;
+    command->data.alter_ent.int_value = entity->y;
+    return commands;
+}
+
+void pool_setup(tfixture *tf, gconstpointer test_data) {
+    tf->data = malloc(sizeof(t_game_data));
+    *tf->data = make_game_data(NULL);
+    add_entity(tf->data, &tf->target);
+    target_id = tf->target.id;
+    tf->ents = calloc(NUM_TEST_ENTS, sizeof(t_entity));
+    tf->room.entity_ids = malloc(sizeof(int) * NUM_TEST_ENTS);
+    tf->room.num_entities = NUM_TEST_ENTS;
+    add_room(tf->data, &tf->room);
+    tf->data->current_room_id = tf->room.room_id;
+    for(int i = 0; i < NUM_TEST_ENTS; i++) {
+        tf->ents[i].y = i;
+        tf->ents[i].event_handlers.step = alter_target;
+        add_entity(tf->data, &tf->ents[i]);
+        tf->room.entity_ids[i] = tf->ents[i].id;
+    }
+    tf->pool = make_threadpool(NUM_TEST_WORKERS);
+}
+
+void pool_teardown(tfixture *tf, gconstpointer test_data) {
+    threadpool_free(tf->pool);
+    free(tf->room.entity_ids);
+    free(tf->ents);
+    gamedata_free(tf->data);
+    arena_free(frame_arena_local());
+}
+
+
+static _Atomic int item_runs[NUM_TEST_ITEMS];
+static _Atomic int bad_workers;
+
+static void count_items(void *ctx, int begin, int end, int worker) {
+    if(worker < 0 || worker >= NUM_TEST_WORKERS)
+        atomic_fetch_add(&bad_workers, 1);
+    for(int i = begin; i < end; i++)
+        atomic_fetch_add(&item_runs[i], 1);
+}
+
+void test_runs_every_item() {
+    threadpool *pool = make_threadpool(NUM_TEST_WORKERS);
+    g_assert_cmpint(threadpool_num_workers(pool), ==, NUM_TEST_WORKERS);
+    for(int job = 0; job < 20; job++) {
+        for(int i = 0; i < NUM_TEST_ITEMS; i++)
+            atomic_store(&item_runs[i], 0);
+        // a chunk size that does not divide the items, so the last chunk is short
+        threadpool_run(pool, NUM_TEST_ITEMS, 7, count_items, NULL);
+        for(int i = 0; i < NUM_TEST_ITEMS; i++)
+            g_assert_cmpint(atomic_load(&item_runs[i]), ==, 1);
+    }
+    g_assert_cmpint(atomic_load(&bad_workers), ==, 0);
+    threadpool_free(pool);
+    arena_free(frame_arena_local());
+}
+
+void test_commands_in_room_order(tfixture *tf, gconstpointer test_data) {
+    for(int f = 0; f < NUM_TEST_FRAMES; f++) {
+        t_update_command_container commands = update_entities(tf->data, tf->pool);
+        g_assert_cmpint(commands.num_commands, ==, NUM_TEST_ENTS);
+        command_iter iter = iter_commands(&commands);
+        t_update_command *command;
+        int expected = 0;
+        while((command = next_command(&iter)) != NULL)
+            g_assert_cmpint(command->data.alter_ent.int_value, ==, expected++);
+        g_assert_cmpint(expected, ==, NUM_TEST_ENTS);
+        free_update_command_container(&commands);
+        arena_reset(frame_arena_local());
+    }
+}
+
+void test_last_alter_wins(tfixture *tf, gconstpointer test_data) {
+    for(int f = 0; f < NUM_TEST_FRAMES; f++) {
+        tf->target.x = -1;
+        g_assert_false(update_frame(tf->data, tf->pool));
+        g_assert_cmpint(tf->target.x, ==, NUM_TEST_ENTS - 1);
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/threadpool/runs_every_item", test_runs_every_item);
+    g_test_add("/threadpool/commands_in_room_order", tfixture, NULL, pool_setup, test_commands_in_room_order, pool_teardown);
+    g_test_add("/threadpool/last_alter_wins", tfixture, NULL, pool_setup, test_last_alter_wins, pool_teardown);
+    return g_test_run();
+}
@@ -0,0 +1,166 @@
+/*
+ * File: mkpack.c
+ *
+ * Builds a game pack (see cnd_pack.h) from a text description of a game's rooms, sprites, sounds
+ * and entities, for make_game_data to load.
+ *
+ * Usage: mkpack <description> <pack>
+ *
+ * The description has one element per line; blank lines and lines starting with # are ignored.
+ * Elements are named so that others can refer to them, and are given IDs in the order they appear.
+ *
+ *     screen <width> <height>
+ *     sprite <name> <num_imgs> <width> <height>
+ *     sound <name> <volume> <path>
+ *     room <name> <width> <height>
+ *     entity <room> <sprite or -> <x> <y> [depth] [spr_period]
+ *     start <room>
+ *
+ * The first room is started in unless another is given with start.
+ *
+ * Author: Jack Romo <sharrackor@gmail.com>
+ */
+
+#include "../cnoodle.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_LINE 4096
+#define MAX_NAME 256
+
+/*
+ * named: An element's name in the description, and the ID it was given.
+ */
+typedef struct {
+    char name[MAX_NAME];
+    int id;
+} named;
+
+typedef struct {
+    named *elems;
+    int count;
+    int capacity;
+} name_table;
+
+static void add_name(name_table *table, char const* name, int id) {
+    if(table->count == table->capacity) {
+        table->capacity = (table->capacity > 0) ? table->capacity * 2 : 16;
+        table->elems = realloc(table->elems, sizeof(named) * table->capacity);
+        if(table->elems == NULL) {
+            perror("Could not allocate names.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    snprintf(table->elems[table->count].name, MAX_NAME, "%s", name);
+    table->elems[table->count++].id = id;
+}
+
+/*
+ * find_name: Get the ID of a named element, or 0 if there is none.
+ */
+static int find_name(name_table const* table, char const* name) {
+    for(int i = 0; i < table->count; i++) {
+        if(strcmp(table->elems[i].name, name) == 0)
+            return table->elems[i].id;
+    }
+    return 0;
+}
+
+static void *alloc_elem(size_t size) {
+    void *elem = calloc(1, size);
+    if(elem == NULL) {
+        perror("Could not allocate element.");
+        exit(EXIT_FAILURE);
+    }
+    return elem;
+}
+
+int main(int argc, char *argv[]) {
+    if(argc != 3) {
+        fprintf(stderr, "Usage: %s <description> <pack>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    FILE *description = fopen(argv[1], "r");
+    if(description == NULL) {
+        perror("Could not open description");
+        return EXIT_FAILURE;
+    }
+    t_game_data *data = malloc(sizeof(t_game_data));
+    *data = make_game_data(NULL);
+    name_table sprites = {0}, sounds = {0}, rooms = {0};
+    char line[MAX_LINE], kind[32], name[MAX_NAME], other[MAX_NAME];
+    int line_num = 0, start_id = 0;
+    bool ok = true;
+    while(ok && fgets(line, sizeof(line), description) != NULL) {
+        line_num++;
+        int a = 0, b = 0, c = 0, d = 0, n = 0;
+        if(sscanf(line, "%31s", kind) != 1 || kind[0] == '#')
+            continue;
+        if(strcmp(kind, "screen") == 0 && sscanf(line, "%*s %d %d", &a, &b) == 2) {
+            data->scr_width = a;
+            data->scr_height = b;
+        } else if(strcmp(kind, "sprite") == 0 && sscanf(line, "%*s %255s %d %d %d", name, &a, &b, &c) == 4) {
+            t_sprite *sprite = alloc_elem(sizeof(t_sprite));
+            sprite->num_imgs = a;
+            sprite->width = b;
+            sprite->height = c;
+            add_sprite(data, sprite);
+            add_name(&sprites, name, sprite->spr_id);
+        } else if(strcmp(kind, "sound") == 0 && sscanf(line, "%*s %255s %d %n", name, &a, &n) == 2 && n > 0) {
+            t_sound *sound = alloc_elem(sizeof(t_sound));
+            sound->volume = a;
+            line[strcspn(line, "\r\n")] = '\0';
+            sound->snd_path = strdup(line + n);
+            add_sound(data, sound);
+            add_name(&sounds, name, sound->snd_id);
+        } else if(strcmp(kind, "room") == 0 && sscanf(line, "%*s %255s %d %d", name, &a, &b) == 3) {
+            t_room *room = alloc_elem(sizeof(t_room));
+            room->width = a;
+            room->height = b;
+            add_room(data, room);
+            add_name(&rooms, name, room->room_id);
+            if(start_id == 0)
+                start_id = room->room_id;
+        } else if(strcmp(kind, "entity") == 0
+                  && (n = sscanf(line, "%*s %255s %255s %d %d %d %d", name, other, &a, &b, &c, &d)) >= 4) {
+            t_room *room = get_room(data, find_name(&rooms, name));
+            int spr_id = (strcmp(other, "-") == 0) ? 0 : find_name(&sprites, other);
+            if(room == NULL || (spr_id == 0 && strcmp(other, "-") != 0)) {
+                fprintf(stderr, "%s:%d: no such room or sprite.\n", argv[1], line_num);
+                ok = false;
+                continue;
+            }
+            t_entity *entity = alloc_elem(sizeof(t_entity));
+            entity->current_spr_id = spr_id;
+            entity->x = a;
+            entity->y = b;
+            // depth and period are optional
+            entity->depth = (n >= 5) ? c : 0;
+            entity->spr_period = (n >= 6) ? d : -1;
+            add_entity(data, entity);
+            add_room_entity(data, room, entity->id);
+        } else if(strcmp(kind, "start") == 0 && sscanf(line, "%*s %255s", name) == 1
+                  && find_name(&rooms, name) != 0) {
+            start_id = find_name(&rooms, name);
+        } else {
+            fprintf(stderr, "%s:%d: cannot read '%s'.\n", argv[1], line_num, kind);
+            ok = false;
+        }
+    }
+    fclose(description);
+    data->current_room_id = start_id;
+    if(ok && !save_game_pack(data, argv[2])) {
+        perror("Could not write pack");
+        ok = false;
+    }
+    if(ok)
+        printf("%s: %d rooms, %d sprites, %d sounds, %d entities\n", argv[2], data->num_rooms, data->num_sprites,
+               data->num_sounds, data->num_entities);
+    // the process ends here, so elements are left for it to free
+    free(sprites.elems);
+    free(sounds.elems);
+    free(rooms.elems);
+    gamedata_free(data);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}